@@ -7,6 +7,9 @@
 /* Define if shifting of signed integers works */
 #undef HAVE_SIGNED_SHIFT
 
+/* Define if the compiler supports thread-local storage (__thread) */
+#undef HAVE_THREAD_LOCAL
+
 /* Define path of WFA datafiles (automata, resource files) */
 #undef FIASCO_SHARE 
 
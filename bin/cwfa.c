@@ -25,7 +25,9 @@
 #include "binerror.h"
 #include "misc.h"
 #include "params.h"
+#include "bit-io.h"
 #include "fiasco.h"
+#include "y4m.h"
 
 /*****************************************************************************
 
@@ -39,7 +41,7 @@ param_t params [] =
    *  Options for standard user
    */
   {"image-name", "FILE", 'i', PSTR, {0}, NULL,
-   "Compress raw PPM/PGM image(s) `%s'."},
+   "Compress PPM/PGM image(s) or YUV4MPEG2 stream `%s'."},
   {"output-name", "FILE", 'o', PSTR, {0}, "-",
    "Write automaton to `%s' (`-' means stdout)."},
   {"quality", "REAL", 'q', PFLOAT, {0}, "20.0",
@@ -84,12 +86,22 @@ param_t params [] =
    "Use cross-B-search for interpolated mc."},
   {"B-as-past-ref", NULL, '\0', PFLAG, {0}, "FALSE",
    "Use B-frames as reference images." },
+  {"motion-search", "NUM", '\0', PINT, {0}, "0",
+   "Set motion vector search to `%s' (0-2)."},
+  {"search-range", "NUM", '\0', PINT, {0}, "16",
+   "Set motion vector search range to `%s' (2-128)."},
   {"prediction", NULL, '\0', PFLAG, {0}, "FALSE",
    "Use additional predictive coding."},
   {"progress-meter", "NUM", '\0', PINT, {0}, "2",
    "Set type of progress meter to `%s'."},
   {"smooth", "NUM", '\0', PINT, {0}, "70",
    "Smooth image(s) by factor `%s' (0-100)"},
+  {"threads", "NUM", '\0', PINT, {0}, "1",
+   "Use `%s' threads (0 means one per processor)."},
+  {"mosaic", "NUM", '\0', PINT, {0}, "0",
+   "Code still image in independent square tiles of width `%s'."},
+  {"index", NULL, '\0', PFLAG, {0}, "FALSE",
+   "Append frame index for random access to video frames."},
 #if 0
   /*
    *  Options currently not activated (maybe in future versions of FIASCO)
@@ -142,6 +154,13 @@ param_t params [] =
 static void 
 checkargs (int argc, char **argv, char const ***image_template,
 	   char **wfa_name, float *quality, fiasco_c_options_t **options);
+static int
+y4m_coder (const char *y4m_name, const char *wfa_name, float quality,
+	   fiasco_c_options_t *options);
+static size_t
+write_file (void *data, const void *buffer, size_t size);
+static int
+seek_file (void *data, unsigned long offset);
 
 /*****************************************************************************
 
@@ -161,7 +180,10 @@ main (int argc, char **argv)
 
    checkargs (argc, argv, &image_template, &wfa_name, &quality, &options);
 
-   if (fiasco_coder (image_template, wfa_name, quality, options))
+   if ((!image_template [0] || !image_template [1])
+       && is_y4m_input (image_template [0])
+       ? y4m_coder (image_template [0], wfa_name, quality, options)
+       : fiasco_coder (image_template, wfa_name, quality, options))
       return 0;
    else
    {
@@ -197,9 +219,10 @@ checkargs (int argc, char **argv, char const ***image_template,
    int	 i;				/* counter */
    
    optind = parseargs (params, argc, argv,
-		       "Compress raw PPM/PGM image FILEs to a FIASCO file.",
+		       "Compress PPM/PGM image FILEs to a FIASCO file.",
 		       "With no image FILE, or if FILE is -, "
 		       "read standard input.\n"
+		       "A single FILE may also be a YUV4MPEG2 stream.\n"
 		       "FILE must be either a filename"
 		       " or an image template of the form:\n"
 		       "`prefix[start-end{+,-}step]suffix'\n"
@@ -288,6 +311,41 @@ checkargs (int argc, char **argv, char const ***image_template,
 	    error (fiasco_get_error_message ());
       }
       
+      {
+	 int n = * (int *) parameter_value (params, "threads");
+      
+	 if (!fiasco_c_options_set_threads (*options, max (0, n)))
+	    error (fiasco_get_error_message ());
+      }
+      
+      {
+	 int n = * (int *) parameter_value (params, "mosaic");
+      
+	 if (!fiasco_c_options_set_mosaic (*options, max (0, n), max (0, n)))
+	    error (fiasco_get_error_message ());
+      }
+      
+      {
+	 int i = * (int *) parameter_value (params, "index");
+      
+	 if (!fiasco_c_options_set_frame_index (*options, i))
+	    error (fiasco_get_error_message ());
+      }
+      
+      {
+	 int s = * (int *) parameter_value (params, "motion-search");
+      
+	 if (!fiasco_c_options_set_motion_search (*options, s))
+	    error (fiasco_get_error_message ());
+      }
+      
+      {
+	 int r = * (int *) parameter_value (params, "search-range");
+      
+	 if (!fiasco_c_options_set_search_range (*options, r))
+	    error (fiasco_get_error_message ());
+      }
+      
       {
 	 char *t = (char *) parameter_value (params, "title");
 	 
@@ -392,3 +450,86 @@ checkargs (int argc, char **argv, char const ***image_template,
 	 write_parameters (params, stderr);
    }
 }	
+
+static int
+y4m_coder (const char *y4m_name, const char *wfa_name, float quality,
+	   fiasco_c_options_t *options)
+/*
+ *  Compress the YUV4MPEG2 stream 'y4m_name' with the given 'quality'
+ *  and 'options' and write the FIASCO stream to 'wfa_name'.
+ *  Frames are pushed to the coder one at a time, the frame rate is
+ *  taken from the stream header. The number of frames is not known in
+ *  advance, it is stored in the FIASCO header at the end if 'wfa_name'
+ *  is a regular file.
+ *
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   y4m_t	    *y4m = open_y4m_input (y4m_name);
+   unsigned char    *buffer;		/* planes of current frame */
+   FILE		    *output;		/* FIASCO stream */
+   fiasco_encoder_t *encoder;		/* incremental coder */
+   int		     success;
+
+   if (!fiasco_c_options_set_video_param (options, y4m->rate, NO, YES, YES))
+      error (fiasco_get_error_message ());
+
+   output = open_file (wfa_name, "FIASCO_DATA", WRITE_ACCESS);
+   if (!output)
+      file_error (wfa_name);
+
+   encoder = fiasco_encoder_new (y4m->width, y4m->height,
+				 y4m->layout != FIASCO_GRAY_8, 0, quality,
+				 options, write_file, seek_file, output);
+   if (!encoder)
+      error (fiasco_get_error_message ());
+
+   buffer = fiasco_calloc (y4m->frame_size, sizeof (unsigned char));
+   while (read_y4m_frame (y4m, buffer))
+   {
+      fiasco_image_t *image
+	 = fiasco_image_new_from_buffer (buffer, y4m->width, y4m->height,
+					 0, y4m->layout);
+
+      if (!image || !fiasco_encoder_push_frame (encoder, image))
+	 error (fiasco_get_error_message ());
+      fiasco_image_delete (image);
+   }
+   fiasco_free (buffer);
+   success = fiasco_encoder_finish (encoder);
+
+   if (output != stdout)
+      fclose (output);
+   else
+      fflush (output);
+   close_y4m (y4m);
+
+   return success;
+}
+
+static size_t
+write_file (void *data, const void *buffer, size_t size)
+/*
+ *  Write 'size' bytes of the FIASCO stream from 'buffer' to the file 'data'.
+ *
+ *  Return value:
+ *	number of bytes written
+ */
+{
+   return fwrite (buffer, 1, size, (FILE *) data);
+}
+
+static int
+seek_file (void *data, unsigned long offset)
+/*
+ *  Continue writing the FIASCO stream at byte 'offset' of the file 'data'.
+ *
+ *  Return value:
+ *	1 on success
+ *	0 if the file doesn't support random access (e.g., a pipe)
+ */
+{
+   return fseek ((FILE *) data, offset, SEEK_SET) == 0;
+}
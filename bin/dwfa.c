@@ -31,6 +31,7 @@
 #include "misc.h"
 #include "params.h"
 #include "fiasco.h"
+#include "y4m.h"
 
 /*****************************************************************************
 
@@ -40,10 +41,15 @@
 
 static int 
 checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
-	   int *fps, char **image_name, fiasco_d_options_t **options);
+	   int *fps, char **image_name, bool_t *y4m, fiasco_layout_e *layout,
+	   fiasco_d_options_t **options);
 static void
 video_decoder (const char *wfa_name, const char *image_name, bool_t panel,
 	       bool_t double_resolution, int fps, fiasco_d_options_t *options);
+static y4m_t *
+y4m_decoder (const char *wfa_name, const char *image_name, int fps,
+	     fiasco_layout_e layout, fiasco_d_options_t *options,
+	     y4m_t *output);
 static void
 get_output_template (const char *image_name, const char *wfa_name,
 		     bool_t color, char **basename, char **suffix);
@@ -61,15 +67,29 @@ main (int argc, char **argv)
    bool_t    	       double_resolution = NO; /* double resolution of image */
    bool_t    	       panel             = NO; /* control panel */
    int  	       fps               = -1; /* frame display rate */
+   bool_t	       y4m		 = NO; /* write YUV4MPEG2 stream */
+   fiasco_layout_e     layout	 = FIASCO_YUV_420; /* planes of stream */
    fiasco_d_options_t *options 	       	 = NULL; /* additional coder options */
    int	     	       last_arg;	/* last processed cmdline parameter */
 
    init_error_handling (argv[0]);
 
    last_arg = checkargs (argc, argv, &double_resolution, &panel, &fps,
-			 &image_name, &options);
+			 &image_name, &y4m, &layout, &options);
    
-   if (last_arg >= argc)
+   if (y4m)				/* all frames go to a single stream */
+   {
+      y4m_t *output = NULL;		/* YUV4MPEG2 output stream */
+      
+      if (last_arg >= argc)
+	 output = y4m_decoder ("-", image_name, fps, layout, options, output);
+      else
+	 while (last_arg++ < argc)
+	    output = y4m_decoder (argv [last_arg - 1], image_name, fps, layout,
+				  options, output);
+      close_y4m (output);
+   }
+   else if (last_arg >= argc)
       video_decoder ("-", image_name, panel, double_resolution, fps, options);
    else
       while (last_arg++ < argc)
@@ -89,6 +109,8 @@ param_t params [] =
 {
   {"output", "FILE", 'o', PSTR, {0}, "-",
    "Write raw PNM frame(s) to `%s'."},
+  {"y4m", "FORMAT", 'y', PSTR, {0}, NULL,
+   "Write YUV4MPEG2 stream with chroma format `%s' (420, 444, mono)."},
   {"double", NULL, 'd', PFLAG, {0}, "FALSE",
    "Interpolate images to double size before display."},
   {"fast", NULL, 'r', PFLAG, {0}, "FALSE",
@@ -101,12 +123,15 @@ param_t params [] =
    "Set display rate to `%s' frames per second."},
   {"smoothing", "NUM", 's', PINT, {0}, "-1",
    "Smooth image(s) by factor `%s' (0-100)"},
+  {"threads", "NUM", '\0', PINT, {0}, "1",
+   "Use `%s' threads (0 means one per processor)."},
   {NULL, NULL, 0, 0, {0}, NULL, NULL }
 };
 
 static int 
 checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
-	   int *fps, char **image_name, fiasco_d_options_t **options)
+	   int *fps, char **image_name, bool_t *y4m, fiasco_layout_e *layout,
+	   fiasco_d_options_t **options)
 /*
  *  Check validness of command line parameters and of the parameter files.
  *
@@ -114,8 +139,8 @@ checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
  *	index in argv of the first argv-element that is not an option.
  *
  *  Side effects:
- *	'double_resolution', 'panel', 'fps', 'image_name' and 'options'
- *      are modified.
+ *	'double_resolution', 'panel', 'fps', 'image_name', 'y4m', 'layout'
+ *	and 'options' are modified.
  */
 {
    int optind;				/* last processed commandline param */
@@ -124,6 +149,8 @@ checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
 		       "Decode FIASCO-FILEs and write frame(s) to disk.",
 		       "With no FIASCO-FILE, or if FIASCO-FILE is -, "
 		       "read standard input.\n"
+		       "If the output FILE ends in .y4m, all frames are "
+		       "written to a YUV4MPEG2 stream.\n"
 		       "Environment:\n"
 		       "FIASCO_DATA   Search path for automata files. "
 		       "Default: ./\n"
@@ -136,6 +163,21 @@ checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
    *panel             = *((bool_t *) parameter_value (params, "panel"));
    *fps		      = *((int *)    parameter_value (params, "framerate"));
 
+   {
+      char *format = (char *) parameter_value (params, "y4m");
+      char *suffix = *image_name ? strrchr (*image_name, '.') : NULL;
+
+      *y4m = format || (suffix && strcaseeq (suffix, ".y4m"));
+      if (!format || streq (format, "420"))
+	 *layout = FIASCO_YUV_420;
+      else if (streq (format, "444"))
+	 *layout = FIASCO_YUV_444;
+      else if (streq (format, "mono"))
+	 *layout = FIASCO_GRAY_8;
+      else
+	 error ("Invalid YUV4MPEG2 chroma format `%s' specified.", format);
+   }
+
    /*
     *  Additional options ... (have to be set with the fiasco_set_... methods)
     */
@@ -162,6 +204,13 @@ checkargs (int argc, char **argv, bool_t *double_resolution, bool_t *panel,
 	 error (fiasco_get_error_message ());
    }
 
+   {
+      int n = *((int *) parameter_value (params, "threads"));
+      
+      if (!fiasco_d_options_set_threads (*options, max (0, n)))
+	 error (fiasco_get_error_message ());
+   }
+
    return optind;
 }
 
@@ -171,7 +220,7 @@ video_decoder (const char *wfa_name, const char *image_name, bool_t panel,
 {
    do
    {
-      unsigned  	width, height, frames, n;
+      unsigned  	width, height, frames, digits, n;
       fiasco_decoder_t *decoder_state;
       char     	       *filename;
       char     	       *basename;	/* basename of decoded frame */
@@ -191,17 +240,21 @@ video_decoder (const char *wfa_name, const char *image_name, bool_t panel,
       if (!(height = fiasco_decoder_get_height (decoder_state)))
 	  error (fiasco_get_error_message ());
 
-      if (!(frames = fiasco_decoder_get_length (decoder_state)))
-	 error (fiasco_get_error_message ());
+      /*
+       *  The number of frames of a stream read from a pipe may be
+       *  unknown (zero) until the end of the stream is reached
+       */
+      frames = fiasco_decoder_get_length (decoder_state);
+      digits = frames > 1 ? (int) (log10 (frames - 1) + 1) : 3;
       
       get_output_template (image_name, wfa_name,
 			   fiasco_decoder_is_color (decoder_state),
 			   &basename, &suffix);
 
       filename = fiasco_calloc (strlen (basename) + strlen (suffix) + 2
-			 + 10 + (int) (log10 (frames) + 1), sizeof (char));
+			 + 10 + digits, sizeof (char));
 
-      for (n = 0; n < frames; n++)
+      for (n = 0; n < frames || (!frames && image_name); n++)
       {
 	 clock_t fps_timer;		/* frames per second timer struct */
 	 
@@ -219,14 +272,16 @@ video_decoder (const char *wfa_name, const char *image_name, bool_t panel,
 	    else
 	    {
 	       fprintf (stderr, "Decoding frame %d to file `%s.%0*d.%s\n",
-			n, basename, (int) (log10 (frames - 1) + 1),
-			n, suffix);
-	       sprintf (filename, "%s.%0*d.%s", basename,
-			(int) (log10 (frames - 1) + 1), n, suffix);
+			n, basename, digits, n, suffix);
+	       sprintf (filename, "%s.%0*d.%s", basename, digits, n, suffix);
 	    }
 
 	    if (!fiasco_decoder_write_frame (decoder_state, filename))
+	    {
+	       if (!frames && fiasco_decoder_get_length (decoder_state) == n)
+		  break;		/* end of stream */
 	       error (fiasco_get_error_message ());
+	    }
 	 }
       }
       free (filename);
@@ -234,6 +289,64 @@ video_decoder (const char *wfa_name, const char *image_name, bool_t panel,
    } while (panel);
 }
 
+static y4m_t *
+y4m_decoder (const char *wfa_name, const char *image_name, int fps,
+	     fiasco_layout_e layout, fiasco_d_options_t *options,
+	     y4m_t *output)
+/*
+ *  Decode the FIASCO stream 'wfa_name' and append its frames to the
+ *  YUV4MPEG2 stream 'output'. If 'output' is NULL then the stream
+ *  'image_name' is created using the given chroma 'layout' and the
+ *  display rate 'fps' (or the rate of the FIASCO stream if 'fps' <= 0).
+ *  The frames are decoded straight to the YUV planes.
+ *
+ *  Return value:
+ *	pointer to the YUV4MPEG2 stream
+ */
+{
+   fiasco_decoder_t *decoder;		/* FIASCO decoder */
+   unsigned char    *buffer;		/* planes of current frame */
+   unsigned	     width, height, frames, n;
+
+   if (!(decoder = fiasco_decoder_new (wfa_name, options)))
+      error (fiasco_get_error_message ());
+   if (!(width = fiasco_decoder_get_width (decoder)))
+      error (fiasco_get_error_message ());
+   if (!(height = fiasco_decoder_get_height (decoder)))
+      error (fiasco_get_error_message ());
+   frames = fiasco_decoder_get_length (decoder); /* zero if unknown */
+
+   if (!output)
+   {
+      if (layout != FIASCO_GRAY_8 && ((width & 1) || (height & 1)))
+	 error ("`%s': width and height of frames have to be even numbers.",
+		wfa_name);
+      output = open_y4m_output (image_name, width, height,
+				fps > 0 ? (unsigned) fps
+				: fiasco_decoder_get_rate (decoder), layout);
+   }
+   else if (width != output->width || height != output->height)
+      error ("`%s': frame size %dx%d differs from size %dx%d of the "
+	     "YUV4MPEG2 stream.", wfa_name, width, height,
+	     output->width, output->height);
+
+   buffer = fiasco_calloc (output->frame_size, sizeof (unsigned char));
+   for (n = 0; !frames || n < frames; n++)
+   {
+      if (!fiasco_decoder_get_frame_into (decoder, buffer, 0, output->layout))
+      {
+	 if (!frames && fiasco_decoder_get_length (decoder) == n)
+	    break;			/* end of stream */
+	 error (fiasco_get_error_message ());
+      }
+      write_y4m_frame (output, buffer);
+   }
+   fiasco_free (buffer);
+   fiasco_decoder_delete (decoder);
+
+   return output;
+}
+
 static void
 get_output_template (const char *image_name, const char *wfa_name,
 		     bool_t color, char **basename, char **suffix)
@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <stdio.h>
 
@@ -44,11 +45,21 @@ param_t params [] =
    "Set display rate to `%s' frames per second."},
   {"smoothing", "NUM", 's', PINT, {0}, "-1",
    "Smooth image(s) by factor `%s' (0-100)"},
+  {"list", NULL, 'l', PFLAG, {0}, "FALSE",
+   "List frames and section sizes of FILEs instead of concatenating."},
+  {"benchmark", "NUM", 'b', PINT, {0}, "0",
+   "Parse FILEs `%s' times and report the parse throughput."},
   {NULL, NULL, 0, 0, {0}, NULL, NULL }	/* no additional parameters */
 };
 
 bool_t
 wfa_equal (const wfa_info_t *wi1, const wfa_info_t *wi2);
+static void
+list_frames (const char *filename);
+static void
+benchmark (const char *filename, unsigned runs);
+static unsigned
+count_frames (const char *filename);
 
 int
 main (int argc, char **argv)
@@ -70,6 +81,31 @@ main (int argc, char **argv)
       return 1;
    }
 
+   if (* (int *) parameter_value (params, "list")
+       || * (int *) parameter_value (params, "benchmark") > 0)
+   {
+      try
+      {
+	 int runs = * (int *) parameter_value (params, "benchmark");
+	 int file;
+
+	 for (file = optind; file < argc; file++)
+	    if (runs > 0)
+	       benchmark (argv [file], runs);
+	    else
+	       list_frames (argv [file]);
+      }
+      catch
+      {
+	 fprintf (stderr, "Error: ");
+	 fprintf (stderr, fiasco_get_error_message ());
+	 fprintf (stderr, "\n");
+
+	 return 1;
+      }
+      return 0;
+   }
+
    try
    {
       wfa_info_t  wi_compare;		/* WFA info structure 1st file */
@@ -77,7 +113,6 @@ main (int argc, char **argv)
       bitfile_t  *output;		/* new FIASCO stream */
       unsigned    offset;		/* frame offset for current file */
       unsigned    total_frames;		/* total # frames of all files  */
-      unsigned    length   = 0;		/* max. string length of filenames */
       char 	 *filename;
 
       /*
@@ -91,6 +126,8 @@ main (int argc, char **argv)
 	 bitfile_t *input = open_wfa (argv [file], &wi_read);
 	 
 	 close_bitfile (input);
+	 if (!wi_read.frames)		/* number of frames is unknown */
+	    wi_read.frames = count_frames (argv [file]);
 
 	 if (argc > 2 && wi_read.release < 2) /* no alignment in version 1 */
 	    error ("%s:\nCan't concatenate FIASCO files with "
@@ -107,14 +144,14 @@ main (int argc, char **argv)
 	 else
 	    wi_compare = wi_read;
 
-	 length = max (length, strlen (argv [file]));
 	 total_frames += wi_read.frames;
       }
       
       /*
        *  Write FIASCO header (with computed number of frames)
        */
-      wi_compare.frames = total_frames;
+      wi_compare.frames	    = total_frames;
+      wi_compare.open_ended = NO;
 
       filename = (char *) parameter_value (params, "output-name");
       output   = open_bitfile (filename, "FIASCO_DATA", WRITE_ACCESS);
@@ -156,48 +193,22 @@ main (int argc, char **argv)
        */
       for (offset = 0, file = optind; file < argc; file++)
       {
-	 unsigned  *position;
-	 unsigned   n;
-	 unsigned   bitpos;
-	 wfa_t     *wfa   = alloc_wfa (NO);
-	 video_t   *video = alloc_video (NO);
-	 bitfile_t *input = open_wfa (argv [file], wfa->wfainfo);
-	 unsigned   progress = 0;
+	 frame_index_t *index;
+	 unsigned       n;
+	 unsigned       bitpos;
+	 wfa_t         *wfa   = alloc_wfa (NO);
+	 bitfile_t     *input = open_wfa (argv [file], wfa->wfainfo);
 	 
 	 read_basis (wfa->wfainfo->basis_name, wfa);
 
 	 if (fiasco_get_verbosity ())
-	 {
-	    if (length < 48)
-	       fprintf (stderr, "%*s ", length, argv [file]);
-	    else
-	       fprintf (stderr, "%s\n", argv [file]);
-	 }
+	    fprintf (stderr, "%s\n", argv [file]);
 	 
 	 /*
-	  *  Save file positions of frame `n' in array `positions [n]' 
+	  *  Get file positions of the frames from the frame index
+	  *  (or by parsing the frames if the stream has no index)
 	  */
-	 position = fiasco_calloc (wfa->wfainfo->frames + 1, sizeof (unsigned));
-	 for (n = 0; n < wfa->wfainfo->frames; n++)
-	 {
-	    image_t *frame;
-	    
-	    position [n] = bits_processed (input);
-	    frame = get_next_frame (NO, 0, wfa->wfainfo->smoothing, NULL,
-				    FORMAT_4_4_4, video, NULL, wfa, input);
-
-	    if ((n * 30.0 / wfa->wfainfo->frames) > progress)
-	    {
-	       if (fiasco_get_verbosity ())
-		  fprintf (stderr, "#");
-	       progress = n * 30.0 / wfa->wfainfo->frames + 1;
-	    }
-	 }
-	 if (fiasco_get_verbosity ())
-	    fprintf (stderr, "\n");
-	 
-	 position [n] = bits_processed (input);
-	 close_bitfile (input);
+	 index = read_frame_index (bits_processed (input), wfa, input);
 	 
 	 /*
 	  *  For each frame:
@@ -205,9 +216,7 @@ main (int argc, char **argv)
 	  *  - write modified frame header
 	  *  - copy remaining frame bits
 	  */
-	 input = open_bitfile (argv [file], NULL, READ_ACCESS);
-	 for (bitpos = bits_processed (input); bitpos < position [0]; bitpos++)
-	    get_bit (input);
+	 seek_bitfile (input, index->offset [0]);
 	 for (n = 0; n < wfa->wfainfo->frames; n++)
 	 {
 	    const int rice_k = 8;	/* parameter of Rice Code */
@@ -224,15 +233,19 @@ main (int argc, char **argv)
 	    OUTPUT_BYTE_ALIGN (output);
 	    
 	    for (bitpos = bits_processed (input);
-		 bitpos < position [n + 1]; bitpos++)
-	       put_bit (output, get_bit (input));
+		 bitpos < index->offset [n + 1];
+		 bitpos = bits_processed (input))
+	    {
+	       unsigned bits = min (32, index->offset [n + 1] - bitpos);
+	       
+	       put_bits (output, get_bits (input, bits), bits);
+	    }
 	 }
 	 close_bitfile (input);
 
 	 offset += wfa->wfainfo->frames;
 	 
-	 fiasco_free (position);
-	 free_video (video);
+	 free_frame_index (index);
 	 free_wfa (wfa);
       }
 
@@ -254,6 +267,7 @@ bool_t
 wfa_equal (const wfa_info_t *wi1, const wfa_info_t *wi2)
 {
    if (streq (wi1->basis_name, wi2->basis_name)
+       && wi1->release == wi2->release
        && wi1->smoothing == wi2->smoothing
        && wi1->max_states == wi2->max_states
        && wi1->chroma_max_states == wi2->chroma_max_states
@@ -278,3 +292,111 @@ wfa_equal (const wfa_info_t *wi1, const wfa_info_t *wi2)
    else
       return 0;
 }
+
+static void
+list_frames (const char *filename)
+/*
+ *  Print frame type, display number, position and the size of each
+ *  section of all frames of the FIASCO file 'filename' on stdout.
+ *  The frames are parsed but not decoded.
+ *
+ *  No return value.
+ */
+{
+   wfa_t     *wfa   = alloc_wfa (NO);
+   bitfile_t *input = open_wfa (filename, wfa->wfainfo);
+   unsigned   n;
+
+   read_basis (wfa->wfainfo->basis_name, wfa);
+   if (!wfa->wfainfo->frames)		/* number of frames is unknown */
+      wfa->wfainfo->frames = count_frames (filename);
+
+   printf ("%s: %dx%d %s, %d frame%s\n", filename,
+	   wfa->wfainfo->width, wfa->wfainfo->height,
+	   wfa->wfainfo->color ? "color" : "gray",
+	   wfa->wfainfo->frames, wfa->wfainfo->frames > 1 ? "s" : "");
+   printf ("frame type display   offset header tiling   tree"
+	   "     nd     mc matrices weights\n");
+   for (n = 0; n < wfa->wfainfo->frames; n++)
+   {
+      frame_bits_t bits;
+      unsigned	   offset = bits_processed (input);
+      unsigned	   number = parse_next_wfa (wfa, &bits, input);
+
+      printf ("%5d    %c %7d %8d %6d %6d %6d %6d %6d %8d %7d\n", n,
+	      wfa->frame_type == I_FRAME
+	      ? 'I' : (wfa->frame_type == P_FRAME ? 'P' : 'B'),
+	      number, offset, bits.header, bits.tiling, bits.tree, bits.nd,
+	      bits.mc, bits.matrices, bits.weights);
+      remove_states (wfa->basis_states, wfa);
+   }
+   
+   close_bitfile (input);
+   free_wfa (wfa);
+}
+
+static void
+benchmark (const char *filename, unsigned runs)
+/*
+ *  Parse all frames of the FIASCO file 'filename' 'runs' times and
+ *  print the throughput of the parser (without decoding) on stdout.
+ *
+ *  No return value.
+ */
+{
+   wfa_t     *wfa   = alloc_wfa (NO);
+   bitfile_t *input = open_wfa (filename, wfa->wfainfo);
+   unsigned   first = bits_processed (input); /* position of 1st frame */
+   unsigned   n, run;
+   clock_t    start;
+   double     seconds, bytes;
+
+   read_basis (wfa->wfainfo->basis_name, wfa);
+   if (!wfa->wfainfo->frames)		/* number of frames is unknown */
+      wfa->wfainfo->frames = count_frames (filename);
+
+   start = clock ();
+   for (run = 0; run < runs; run++)
+   {
+      seek_bitfile (input, first);
+      for (n = 0; n < wfa->wfainfo->frames; n++)
+      {
+	 parse_next_wfa (wfa, NULL, input);
+	 remove_states (wfa->basis_states, wfa);
+      }
+   }
+   seconds = (double) (clock () - start) / CLOCKS_PER_SEC;
+   bytes   = (double) (bits_processed (input) - first) / 8 * runs;
+
+   printf ("%s: %d frame%s, %.0f bytes parsed in %.3f s, %.2f MB/s\n",
+	   filename, wfa->wfainfo->frames,
+	   wfa->wfainfo->frames > 1 ? "s" : "", bytes, seconds,
+	   seconds > 0 ? bytes / seconds / (1024 * 1024) : 0.0);
+   
+   close_bitfile (input);
+   free_wfa (wfa);
+}
+
+static unsigned
+count_frames (const char *filename)
+/*
+ *  Count the frames of the FIASCO file 'filename' whose header doesn't
+ *  store the number of frames (the coder wrote the stream to a pipe).
+ *
+ *  Return value:
+ *	number of frames
+ */
+{
+   wfa_t     *wfa   = alloc_wfa (NO);
+   bitfile_t *input = open_wfa (filename, wfa->wfainfo);
+   unsigned   frames;
+
+   read_basis (wfa->wfainfo->basis_name, wfa);
+   free_frame_index (read_frame_index (bits_processed (input), wfa, input));
+   frames = wfa->wfainfo->frames;
+   
+   close_bitfile (input);
+   free_wfa (wfa);
+
+   return frames;
+}
@@ -435,6 +435,9 @@ browse_mwfa (toptions_t *options)
 
    input = open_wfa (options->wfa_name, wfa->wfainfo);
    read_basis (wfa->wfainfo->basis_name, wfa);
+   if (!wfa->wfainfo->frames)		/* number of frames is unknown */
+      free_frame_index (read_frame_index (bits_processed (input), wfa,
+					  input));
    
    while (frame_n++ < wfa->wfainfo->frames && counter > 0) 
    {
@@ -0,0 +1,326 @@
+/*
+ *  y4m.c:		Input and output of YUV4MPEG2 streams
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  A YUV4MPEG2 stream consists of a header line
+ *  `YUV4MPEG2 W<width> H<height> F<num>:<den> C<chroma> ...' followed
+ *  by the frames. Each frame starts with a line `FRAME ...' followed by
+ *  the 8 bit planes Y, Cb and Cr. The planes are passed unchanged to
+ *  and from the FIASCO pixel layouts FIASCO_YUV_420, FIASCO_YUV_444 and
+ *  FIASCO_GRAY_8.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "binerror.h"
+#include "misc.h"
+#include "bit-io.h"
+#include "fiasco.h"
+#include "y4m.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define MAX_LINE 1024			/* max. length of a header line */
+
+static const char *Y4M_MAGIC = "YUV4MPEG2";
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static bool_t
+read_line (y4m_t *y4m, char *line);
+static bool_t
+read_frame_header (y4m_t *y4m);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+bool_t
+is_y4m_input (const char *filename)
+/*
+ *  Check whether the input file 'filename' is a YUV4MPEG2 stream.
+ *  Only the first character of the standard input is peeked at.
+ *
+ *  Return value:
+ *	YES if 'filename' starts with the YUV4MPEG2 signature
+ *	NO  otherwise (or if the file can't be opened)
+ */
+{
+   FILE	  *file = open_file (filename, "FIASCO_IMAGES", READ_ACCESS);
+   char	   magic [9];			/* signature of file */
+   bool_t  y4m;
+
+   if (!file)
+      return NO;
+   if (file == stdin)
+   {
+      int c = getc (file);
+
+      if (c != EOF)
+	 ungetc (c, file);
+      return c == Y4M_MAGIC [0];
+   }
+   y4m = fread (magic, 1, sizeof (magic), file) == sizeof (magic)
+	 && memcmp (magic, Y4M_MAGIC, sizeof (magic)) == 0;
+   fclose (file);
+
+   return y4m;
+}
+
+y4m_t *
+open_y4m_input (const char *filename)
+/*
+ *  Open the YUV4MPEG2 stream 'filename' and read its header.
+ *  Frames with 4:2:0, 4:4:4 or monochrome planes are supported.
+ *
+ *  Return value:
+ *	pointer to the new stream, positioned at the first frame
+ */
+{
+   y4m_t *y4m = fiasco_calloc (1, sizeof (y4m_t));
+   char	  line [MAX_LINE];		/* header line */
+   char	 *token;			/* current parameter */
+   char	 *chroma = "420";		/* chroma format */
+
+   y4m->name = strdup (filename ? filename : "stdin");
+   y4m->file = open_file (filename, "FIASCO_IMAGES", READ_ACCESS);
+   if (!y4m->file)
+      file_error (y4m->name);
+
+   if (!read_line (y4m, line) || !(token = strtok (line, " "))
+       || !streq (token, Y4M_MAGIC))
+      error ("`%s' is not a YUV4MPEG2 stream.", y4m->name);
+
+   y4m->rate = 25;
+   while ((token = strtok (NULL, " ")))
+      switch (*token)
+      {
+	 case 'W':
+	    y4m->width = atoi (token + 1);
+	    break;
+	 case 'H':
+	    y4m->height = atoi (token + 1);
+	    break;
+	 case 'F':
+	 {
+	    unsigned num, den;		/* frame rate num / den */
+
+	    if (sscanf (token + 1, "%u:%u", &num, &den) == 2 && num && den)
+	       y4m->rate = max (1, (num + den / 2) / den);
+	    break;
+	 }
+	 case 'C':
+	    chroma = token + 1;
+	    break;
+	 default:			/* interlacing, aspect ratio, ... */
+	    break;
+      }
+
+   if (!y4m->width || !y4m->height || (y4m->width & 1) || (y4m->height & 1))
+      error ("`%s': width and height of frames have to be even numbers.",
+	     y4m->name);
+
+   if (streq (chroma, "420") || streq (chroma, "420jpeg")
+       || streq (chroma, "420paldv") || streq (chroma, "420mpeg2"))
+   {
+      y4m->layout     = FIASCO_YUV_420;
+      y4m->frame_size = y4m->width * y4m->height * 3 / 2;
+   }
+   else if (streq (chroma, "444"))
+   {
+      y4m->layout     = FIASCO_YUV_444;
+      y4m->frame_size = y4m->width * y4m->height * 3;
+   }
+   else if (streq (chroma, "mono"))
+   {
+      y4m->layout     = FIASCO_GRAY_8;
+      y4m->frame_size = y4m->width * y4m->height;
+   }
+   else
+      error ("`%s': chroma format `%s' is not supported.", y4m->name, chroma);
+
+   return y4m;
+}
+
+bool_t
+read_y4m_frame (y4m_t *y4m, unsigned char *buffer)
+/*
+ *  Read the next frame of the input stream 'y4m' to 'buffer'.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO  if the end of the stream has been reached
+ *
+ *  Side effects:
+ *	'buffer' is filled with the 'y4m->frame_size' bytes of the planes
+ */
+{
+   if (!read_frame_header (y4m))
+      return NO;
+   if (fread (buffer, 1, y4m->frame_size, y4m->file) != y4m->frame_size)
+      error ("`%s': last frame is truncated.", y4m->name);
+
+   return YES;
+}
+
+y4m_t *
+open_y4m_output (const char *filename, unsigned width, unsigned height,
+		 unsigned rate, fiasco_layout_e layout)
+/*
+ *  Create the YUV4MPEG2 stream 'filename' for frames of size
+ *  'width' x 'height' with the planes given by 'layout' and write
+ *  the header. The frame rate is set to 'rate' frames per second.
+ *
+ *  Return value:
+ *	pointer to the new stream
+ */
+{
+   y4m_t      *y4m = fiasco_calloc (1, sizeof (y4m_t));
+   const char *chroma;			/* chroma format */
+
+   y4m->name   = strdup (filename ? filename : "stdout");
+   y4m->width  = width;
+   y4m->height = height;
+   y4m->rate   = rate;
+   y4m->layout = layout;
+   switch (layout)
+   {
+      case FIASCO_YUV_420:
+	 chroma		 = "420jpeg";
+	 y4m->frame_size = width * height * 3 / 2;
+	 break;
+      case FIASCO_YUV_444:
+	 chroma		 = "444";
+	 y4m->frame_size = width * height * 3;
+	 break;
+      case FIASCO_GRAY_8:
+	 chroma		 = "mono";
+	 y4m->frame_size = width * height;
+	 break;
+      default:
+	 error ("Pixel layout %d can't be stored in a YUV4MPEG2 stream.",
+		layout);
+	 chroma = NULL;
+   }
+
+   y4m->file = open_file (filename, "FIASCO_IMAGES", WRITE_ACCESS);
+   if (!y4m->file)
+      file_error (y4m->name);
+   if (fprintf (y4m->file, "%s W%u H%u F%u:1 Ip A1:1 C%s\n", Y4M_MAGIC,
+		width, height, rate, chroma) < 0)
+      file_error (y4m->name);
+
+   return y4m;
+}
+
+void
+write_y4m_frame (y4m_t *y4m, const unsigned char *buffer)
+/*
+ *  Append the frame stored in 'buffer' to the output stream 'y4m'.
+ *
+ *  No return value.
+ */
+{
+   if (fputs ("FRAME\n", y4m->file) == EOF
+       || fwrite (buffer, 1, y4m->frame_size, y4m->file) != y4m->frame_size)
+      file_error (y4m->name);
+}
+
+void
+close_y4m (y4m_t *y4m)
+/*
+ *  Close the stream 'y4m' and discard the stream structure.
+ *
+ *  No return value.
+ */
+{
+   if (!y4m)
+      return;
+   if (y4m->file == stdin || y4m->file == stdout)
+   {
+      if (fflush (y4m->file))
+	 file_error (y4m->name);
+   }
+   else if (fclose (y4m->file))
+      file_error (y4m->name);
+
+   free (y4m->name);
+   fiasco_free (y4m);
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static bool_t
+read_line (y4m_t *y4m, char *line)
+/*
+ *  Read the next header line of the stream 'y4m' to 'line'
+ *  (without the terminating newline).
+ *
+ *  Return value:
+ *	YES on success
+ *	NO  if the end of the stream has been reached
+ */
+{
+   unsigned n;				/* number of characters */
+   int	    c;				/* current character */
+
+   for (n = 0; (c = getc (y4m->file)) != '\n'; n++)
+   {
+      if (c == EOF)
+      {
+	 if (n == 0)
+	    return NO;
+	 error ("`%s': header line is truncated.", y4m->name);
+      }
+      if (n + 1 >= MAX_LINE)
+	 error ("`%s': header line is too long.", y4m->name);
+      line [n] = c;
+   }
+   line [n] = 0;
+
+   return YES;
+}
+
+static bool_t
+read_frame_header (y4m_t *y4m)
+/*
+ *  Read the header line of the next frame of stream 'y4m'.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO  if the end of the stream has been reached
+ */
+{
+   char line [MAX_LINE];		/* frame header */
+
+   if (!read_line (y4m, line))
+      return NO;
+   if (strncmp (line, "FRAME", 5) != 0 || (line [5] && line [5] != ' '))
+      error ("`%s': frame header expected.", y4m->name);
+
+   return YES;
+}
@@ -0,0 +1,44 @@
+/*
+ *  y4m.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _Y4M_H
+#define _Y4M_H
+
+#include <stdio.h>
+#include "types.h"
+#include "fiasco.h"
+
+typedef struct y4m
+/*
+ *  YUV4MPEG2 stream of video frames
+ */
+{
+   FILE		  *file;		/* input or output stream */
+   char		  *name;		/* filename (for messages) */
+   unsigned	   width;		/* width of frames */
+   unsigned	   height;		/* height of frames */
+   unsigned	   rate;		/* frames per second */
+   fiasco_layout_e layout;		/* planes of a frame: FIASCO_YUV_420,
+					   FIASCO_YUV_444 or FIASCO_GRAY_8 */
+   size_t	   frame_size;		/* bytes of the planes of a frame */
+} y4m_t;
+
+bool_t
+is_y4m_input (const char *filename);
+y4m_t *
+open_y4m_input (const char *filename);
+bool_t
+read_y4m_frame (y4m_t *y4m, unsigned char *buffer);
+y4m_t *
+open_y4m_output (const char *filename, unsigned width, unsigned height,
+		 unsigned rate, fiasco_layout_e layout);
+void
+write_y4m_frame (y4m_t *y4m, const unsigned char *buffer);
+void
+close_y4m (y4m_t *y4m);
+
+#endif /* not _Y4M_H */
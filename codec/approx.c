@@ -31,6 +31,7 @@
 #include "approx.h"
 #include "coeff.h"
 #include "wfalib.h"
+#include "thread-pool.h"
 
 /*****************************************************************************
 
@@ -50,6 +51,36 @@ typedef struct mp
    real_t costs;
 } mp_t;
 
+typedef struct mp_step
+/*
+ *  Parameters of step 'n' of the matching pursuit algorithm, shared
+ *  by the tasks which search the domain blocks in parallel.
+ */
+{
+   const mp_t	       *mp;		/* current linear combination */
+   unsigned		n;		/* current vector of the OB */
+   unsigned		index;		/* vector to orthogonalize */
+   real_t		norm;		/* norm of range image */
+   real_t		additional_bits; /* bits for mc, nd, and tree */
+   real_t		price;		/* langrange multiplier */
+   real_t		min_costs;	/* costs to beat */
+   real_t		min_norm;	/* lower bound of norm */
+   int			y_state;
+   const range_t       *range;
+   const domain_pool_t *domain_pool;
+   const coeff_t       *coeff;
+   const wfa_t	       *wfa;
+   const coding_t      *c;
+   const word_t	       *domain_blocks;	/* current set of domain images */
+   unsigned		domains;	/* number of domain images */
+   unsigned		tasks;		/* number of parallel tasks */
+} mp_step_t;
+
+/*
+ *  Don't split the domain pool into parts smaller than this
+ */
+#define MIN_DOMAINS_PER_TASK 64
+
 /*****************************************************************************
 
 			     prototypes
@@ -57,8 +88,16 @@ typedef struct mp
 *****************************************************************************/
 
 static void
-orthogonalize (unsigned index, unsigned n, unsigned level, real_t min_norm,
-	       const word_t *domain_blocks, const coding_t *c);
+orthogonalize (const mp_step_t *step);
+static void
+orthogonalize_domains (void *data, unsigned task);
+static void
+find_candidates (void *data, unsigned task);
+static real_t
+estimate_costs (unsigned domain, const mp_step_t *step);
+static void
+evaluate_candidate (unsigned domain, mp_candidate_t *candidate,
+		    const mp_step_t *step);
 static void 
 matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
 		  unsigned max_edges, int y_state, const range_t *range,
@@ -270,44 +309,6 @@ approximate_range (real_t max_costs, real_t price, int max_edges,
    return mp.costs;
 }
 
-/*****************************************************************************
-
-			     local variables
-  
-*****************************************************************************/
-
-static real_t norm_ortho_vector [MAXSTATES];     
-/*
- *  Square-norm of the i-th vector of the orthogonal basis (OB)
- *  ||o_i||^2; i = 0, ... ,n
- */
-static real_t ip_image_ortho_vector [MAXEDGES];
-/* 
- *  Inner product between the i-th vector of the OB and the given range: 
- *  <b, o_i>; i = 0, ... ,n 
- */
-static real_t ip_domain_ortho_vector [MAXSTATES][MAXEDGES];
-/* 
- *  Inner product between the i-th vector of the OB and the image of domain j: 
- *  <s_j, o_i>; j = 0, ... , wfa->states; i = 0, ... ,n, 
- */
-static real_t rem_denominator [MAXSTATES];     
-static real_t rem_numerator [MAXSTATES];
-/*
- *  At step n of the orthogonalization the comparitive value
- *  (numerator_i / denominator_i):= <b, o_n>^2 / ||o_n|| ,
- *  is computed for every domain i,
- *  where o_n := s_i - \sum(k = 0, ... , n-1) {(<s_i, o_k> / ||o_k||^2) o_k}
- *  To avoid computing the same values over and over again,
- *  the constant (remaining) parts of every domain are
- *  stored in 'rem_numerator' and 'rem_denominator' separately
- */
-static bool_t used [MAXSTATES];    
-/*
- *  Shows whether a domain image was already used in a
- *  linear combination (YES) or not (NO)
- */
-
 /*****************************************************************************
 
 				private code
@@ -339,7 +340,8 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
  *  No return value.
  *
  *  Side effects:
- *	vectors, factors, rate, distortion and costs are stored in 'mp'
+ *	vectors, factors, rate, distortion and costs are stored in 'mp',
+ *	the scratch arrays of 'c->workspace' are overwritten
  */
 {
    unsigned	 n;			/* current vector of the OB */
@@ -351,6 +353,8 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
    const real_t  min_norm = 2e-3;	/* lower bound of norm */
    unsigned 	 best_n   = 0;
    unsigned	 size 	  = size_of_level (range->level);
+   mp_workspace_t *ws	  = c->workspace; /* scratch arrays of this coder */
+   mp_step_t	 step;			/* parameters of the parallel search */
  
    /*
     *  Initialize domain pool and inner product arrays
@@ -359,25 +363,25 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
 					  domain_pool->model);
    for (domain = 0; domain_blocks [domain] >= 0; domain++)
    {
-      used [domain] = NO;
-      rem_denominator [domain]		/* norm of domain */
+      ws->used [domain] = NO;
+      ws->rem_denominator [domain]		/* norm of domain */
 	 = get_ip_state_state (domain_blocks [domain], domain_blocks [domain],
 			       range->level, c);
-      if (rem_denominator [domain] / size < min_norm)
-	 used [domain] = YES;		/* don't use domains with small norm */
+      if (ws->rem_denominator [domain] / size < min_norm)
+	 ws->used [domain] = YES;	/* don't use domains with small norm */
       else
-	 rem_numerator [domain]		/* inner product <s_domain, b> */
+	 ws->rem_numerator [domain]	/* inner product <s_domain, b> */
 	    = get_ip_image_state (range->image, range->address,
 				  range->level, domain_blocks [domain], c);
-      if (!used [domain] && fabs (rem_numerator [domain]) < min_norm)
-	 used [domain] = YES;
+      if (!ws->used [domain] && fabs (ws->rem_numerator [domain]) < min_norm)
+	 ws->used [domain] = YES;
    }
 
    /*
     *  Exclude all domain blocks given in array 'mp->exclude'
     */
    for (n = 0; isdomain (mp->exclude [n]); n++)
-      used [mp->exclude [n]] = YES;
+      ws->used [mp->exclude [n]] = YES;
 
    /*
     *  Compute the approximation costs if 'range' is approximated with
@@ -399,6 +403,22 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
    mp->costs        = (mp->matrix_bits + mp->weights_bits
 		       + additional_bits) * price + mp->err;
 
+   step.mp              = mp;
+   step.norm            = norm;
+   step.additional_bits = additional_bits;
+   step.price           = price;
+   step.min_norm        = min_norm;
+   step.y_state         = y_state;
+   step.range           = range;
+   step.domain_pool     = domain_pool;
+   step.coeff           = coeff;
+   step.wfa             = wfa;
+   step.c               = c;
+   step.domain_blocks   = domain_blocks;
+   step.domains         = domain;	/* number of domain blocks */
+   step.tasks           = min (thread_pool_size (c->pool),
+			       max (1, step.domains / MIN_DOMAINS_PER_TASK));
+   
    n = 0;
    do 
    {
@@ -413,192 +433,30 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
        *  (No progress is indicated by index == -1)
        */
       
-      real_t min_matrix_bits  = 0;
-      real_t min_weights_bits = 0;
-      real_t min_error 	      = 0;
-      real_t min_weight [MAXEDGES];
       real_t min_costs = full_search ? MAXCOSTS : mp->costs;
+
+      /*
+       *  The candidates are rated in parallel (see find_candidates ()).
+       *  Afterwards, the domains are visited in the order of a sequential
+       *  search: the first candidate with minimal costs wins. Hence, the
+       *  chosen vector does not depend on the number of threads.
+       */
+      step.n         = n;
+      step.min_costs = min_costs;
+      run_tasks (c->pool, step.tasks, find_candidates, &step);
       
-      for (index = -1, domain = 0; domain_blocks [domain] >= 0; domain++) 
-	 if (!used [domain]) 
+      for (index = -1, domain = 0; domain < step.domains; domain++) 
+	 if (!ws->used [domain]
+	     && ws->candidate [domain].estimate < min_costs)
 	 {
-	    real_t    matrix_bits, weights_bits;
-	    /*
-	     *  To speed up the search through the domain images,
-	     *  the costs of using domain image 'domain' as next vector
-	     *  can be approximated in a first step:
-	     *  improvement of image quality
-	     *	  <= square (rem_numerator[domain]) / rem_denominator[domain]
-	     */
-	    {
-		  word_t   vectors [MAXEDGES + 1];
-		  word_t   states [MAXEDGES + 1];
-		  real_t   weights [MAXEDGES + 1];
-		  unsigned i, k;
-		  
-		  for (i = 0, k = 0; k < n; k++)
-		     if (mp->weight [k] != 0)
-		     {
-			vectors [i] = mp->indices [k];
-			states [i]  = domain_blocks [vectors [i]];
-			weights [i] = mp->weight [k];
-			i++;
-		     }
-		  vectors [i] 	  = domain;
-		  states [i]  	  = domain_blocks [domain];
-		  weights [i] 	  = 0.5;
-		  vectors [i + 1] = -1;
-		  states [i + 1]  = -1;
-
-		  weights_bits = coeff->bits (weights, states, range->level,
-					      coeff);
-		  matrix_bits = domain_pool->bits (domain_blocks, vectors,
-						   range->level, y_state,
-						   wfa, domain_pool->model);
-	    }
-	    if (((matrix_bits + weights_bits + additional_bits) * price +
-		 mp->err -
-		 square (rem_numerator [domain]) / rem_denominator [domain])
-		< min_costs)
-	    {
-	       /*
-		*  1.) Compute the weights (linear factors) c_i of the
-		*  linear combination
-		*  b = c_0 v_0 + ... + c_(n-1) v_(n-1) + c_n v_'domain'
-		*  Use backward substitution to obtain c_i from the linear
-		*  factors of the lin. comb. b = d_0 o_0 + ... + d_n o_n
-		*  of the corresponding orthogonal vectors {o_0, ..., o_n}.
-		*  Vector o_n of the orthogonal basis is obtained by using
-		*  vector 'v_domain' in step n of the Gram Schmidt
-		*  orthogonalization (see above for definition of o_n).
-		*  Recursive formula for the coefficients c_i:
-		*  c_n := <b, o_n> / ||o_n||^2
-		*  for i = n - 1, ... , 0:
-		*  c_i := <b, o_i> / ||o_i||^2 +
-		*          \sum (k = i + 1, ... , n){ c_k <v_k, o_i>
-		*					/ ||o_i||^2 }
-		*  2.) Because linear factors are stored with reduced precision
-		*  factor c_i is rounded with the given precision in step i
-		*  of the recursive formula. 
-		*/
-
-	       unsigned k;		/* counter */
-	       int    	l;		/* counter */
-	       real_t 	m_bits;		/* number of matrix bits to store */
-	       real_t 	w_bits;		/* number of weights bits to store */
-	       real_t 	r [MAXEDGES];	/* rounded linear factors */
-	       real_t 	f [MAXEDGES];	/* linear factors */
-	       int    	v [MAXEDGES];	/* mapping of domains to vectors */
-	       real_t 	costs;		/* current approximation costs */
-	       real_t 	m_err;		/* current approximation error */
-
-	       f [n] = rem_numerator [domain] / rem_denominator [domain];
-	       v [n] = domain;		/* corresponding mapping */
-	       for (k = 0; k < n; k++)
-	       {
-		  f [k] = ip_image_ortho_vector [k] / norm_ortho_vector [k];
-		  v [k] = mp->indices [k];
-	       }
+	    mp_candidate_t *candidate = &ws->candidate [domain];
 	    
-	       for (l = n; l >= 0; l--) 
-	       {
-		  rpf_t *rpf = domain_blocks [v [l]]
-			       ? coeff->rpf : coeff->dc_rpf;
-
-		  r [l] = f [l] = btor (rtob (f [l], rpf), rpf);
-		     
-		  for (k = 0; k < (unsigned) l; k++)
-		     f [k] -= f [l] * ip_domain_ortho_vector [v [l]][k]
-			      / norm_ortho_vector [k] ;
-	       } 
-
-	       /*
-		*  Compute the number of output bits of the linear combination
-		*  and store the weights with reduced precision. The
-		*  resulting linear combination is
-		*  b = r_0 v_0 + ... + r_(n-1) v_(n-1) + r_n v_'domain'
-		*/
-	       {
-		  word_t vectors [MAXEDGES + 1];
-		  word_t states [MAXEDGES + 1];
-		  real_t weights [MAXEDGES + 1];
-		  int	 i;
-		  
-		  for (i = 0, k = 0; k <= n; k++)
-		     if (f [k] != 0)
-		     {
-			vectors [i] = v [k];
-			states [i]  = domain_blocks [v [k]];
-			weights [i] = f [k];
-			i++;
-		     }
-		  vectors [i] = -1;
-		  states [i]  = -1;
-
-		  w_bits = coeff->bits (weights, states, range->level, coeff);
-		  m_bits = domain_pool->bits (domain_blocks, vectors,
-					      range->level, y_state,
-					      wfa, domain_pool->model);
-	       }
-	       
-	       /*
-		*  To compute the approximation error, the corresponding
-		*  linear factors of the linear combination 
-		*  b = r_0 o_0 + ... + r_(n-1) o_(n-1) + r_n o_'domain'
-		*  with orthogonal vectors must be computed with following
-		*  formula:
-		*  r_i := r_i +
-		*          \sum (k = i + 1, ... , n) { r_k <v_k, o_i>
-		*					/ ||o_i||^2 }
-		*/
-	       for (l = 0; (unsigned) l <= n; l++)
-	       {
-		  /*
-		   *  compute <v_n, o_n>
-		   */
-		  real_t a;
-
-		  a = get_ip_state_state (domain_blocks [v [l]],
-					  domain_blocks [domain],
-					  range->level, c);
-		  for (k = 0; k < n; k++) 
-		     a -= ip_domain_ortho_vector [v [l]][k]
-			  / norm_ortho_vector [k]
-			  * ip_domain_ortho_vector [domain][k];
-		  ip_domain_ortho_vector [v [l]][n] = a;
-	       }
-	       norm_ortho_vector [n]     = rem_denominator [domain];
-	       ip_image_ortho_vector [n] = rem_numerator [domain];
- 	    
-	       for (k = 0; k <= n; k++)
-		  for (l = k + 1; (unsigned) l <= n; l++)
-		     r [k] += ip_domain_ortho_vector [v [l]][k] * r [l]
-			      / norm_ortho_vector [k];
-	       /*
-		*  Compute approximation error:
-		*  error := ||b||^2 +
-		*  \sum (k = 0, ... , n){r_k^2 ||o_k||^2 - 2 r_k <b, o_k>}
-		*/
-	       m_err = norm;
-	       for (k = 0; k <= n; k++)
-		  m_err += square (r [k]) * norm_ortho_vector [k]
-			 - 2 * r [k] * ip_image_ortho_vector [k];
-	       if (m_err < 0)		/* TODO: return MAXCOSTS */
-		  warning ("Negative image norm: %f"
-			   " (current domain: %d, level = %d)",
-			   (double) m_err, domain, range->level);
-
-	       costs = (m_bits + w_bits + additional_bits) * price + m_err;
-	       if (costs < min_costs)	/* found a better approximation */
-	       {
-		  index            = domain;
-		  min_costs        = costs;
-		  min_matrix_bits  = m_bits;
-		  min_weights_bits = w_bits;
-		  min_error        = m_err;
-		  for (k = 0; k <= n; k++)
-		     min_weight [k] = f [k];
-	       }
+	    if (!candidate->evaluated)	/* skipped by a parallel task */
+	       evaluate_candidate (domain, candidate, &step);
+	    if (candidate->costs < min_costs) /* found a better approx. */
+	    {
+	       index     = domain;
+	       min_costs = candidate->costs;
 	    }
 	 }
       
@@ -606,15 +464,16 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
       {
 	 if (min_costs < mp->costs)
 	 {
-	    unsigned k;
+	    unsigned	    k;
+	    mp_candidate_t *best = &ws->candidate [index];
 	    
 	    mp->costs        = min_costs;
-	    mp->err          = min_error;
-	    mp->matrix_bits  = min_matrix_bits;
-	    mp->weights_bits = min_weights_bits;
+	    mp->err          = best->err;
+	    mp->matrix_bits  = best->matrix_bits;
+	    mp->weights_bits = best->weights_bits;
 	    
 	    for (k = 0; k <= n; k++)
-	       mp->weight [k] = min_weight [k];
+	       mp->weight [k] = best->weight [k];
 
 	    best_n = n + 1;
 	 }
@@ -622,12 +481,13 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
 	 mp->indices [n] = index;
 	 mp->into [n]    = domain_blocks [index];
 
-	 used [index] = YES;
+	 ws->used [index] = YES;
 
 	 /* 
 	  *  Gram-Schmidt orthogonalization step n 
 	  */
-	 orthogonalize (index, n, range->level, min_norm, domain_blocks, c);
+	 step.index = index;
+	 orthogonalize (&step);
 	 n++;
       }	
    } 
@@ -642,28 +502,287 @@ matching_pursuit (mp_t *mp, bool_t full_search, real_t price,
 }
 
 static void
-orthogonalize (unsigned index, unsigned n, unsigned level, real_t min_norm,
-	       const word_t *domain_blocks, const coding_t *c)
+find_candidates (void *data, unsigned task)
 /*
- *  Step 'n' of the Gram-Schmidt orthogonalization procedure:
- *  vector 'index' is orthogonalized with respect to the set
- *  {u_[0], ... , u_['n' - 1]}. The size of the image blocks is given by
- *  'level'. If the denominator gets smaller than 'min_norm' then
- *  the corresponding domain is excluded from the list of available
- *  domain blocks.
+ *  Rate the domain blocks of the given 'task' of matching pursuit step
+ *  'data'->n as next vector of the linear combination. The domain
+ *  blocks are split into 'data'->tasks contiguous parts.
+ *
+ *  The costs of a domain are computed only if its estimated costs are
+ *  below 'data'->min_costs and below the costs of the best domain of
+ *  this part seen so far. Since the other parts are not taken into
+ *  account, a domain may be skipped that a sequential search would
+ *  evaluate. matching_pursuit () evaluates these domains afterwards.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the candidates of the part are stored in 'data'->c->workspace
+ */
+{
+   const mp_step_t *step  = (const mp_step_t *) data;
+   mp_workspace_t  *ws    = step->c->workspace;
+   unsigned	    first = task * step->domains / step->tasks;
+   unsigned	    last  = (task + 1) * step->domains / step->tasks;
+   real_t	    min_costs = step->min_costs;
+   unsigned	    domain;
+
+   for (domain = first; domain < last; domain++)
+      if (!ws->used [domain])
+      {
+	 mp_candidate_t *candidate = &ws->candidate [domain];
+
+	 candidate->evaluated = NO;
+	 candidate->estimate  = estimate_costs (domain, step);
+	 if (candidate->estimate < min_costs)
+	 {
+	    evaluate_candidate (domain, candidate, step);
+	    if (candidate->costs < min_costs)
+	       min_costs = candidate->costs;
+	 }
+      }
+}
+
+static real_t
+estimate_costs (unsigned domain, const mp_step_t *step)
+/*
+ *  To speed up the search through the domain images, the costs of
+ *  using domain image 'domain' as next vector can be approximated in a
+ *  first step:
+ *  improvement of image quality
+ *	<= square (rem_numerator[domain]) / rem_denominator[domain]
+ *
+ *  Return value:
+ *	estimated approximation costs
+ */
+{
+   word_t	   vectors [MAXEDGES + 1];
+   word_t	   states [MAXEDGES + 1];
+   real_t	   weights [MAXEDGES + 1];
+   unsigned	   i, k;
+   real_t	   matrix_bits, weights_bits;
+   const mp_t	  *mp 		 = step->mp;
+   const word_t   *domain_blocks = step->domain_blocks;
+   mp_workspace_t *ws 		 = step->c->workspace;
+		  
+   for (i = 0, k = 0; k < step->n; k++)
+      if (mp->weight [k] != 0)
+      {
+	 vectors [i] = mp->indices [k];
+	 states [i]  = domain_blocks [vectors [i]];
+	 weights [i] = mp->weight [k];
+	 i++;
+      }
+   vectors [i] 	   = domain;
+   states [i]  	   = domain_blocks [domain];
+   weights [i] 	   = 0.5;
+   vectors [i + 1] = -1;
+   states [i + 1]  = -1;
+
+   weights_bits = step->coeff->bits (weights, states, step->range->level,
+				     step->coeff);
+   matrix_bits  = step->domain_pool->bits (domain_blocks, vectors,
+					   step->range->level, step->y_state,
+					   step->wfa, step->domain_pool->model);
+
+   return (matrix_bits + weights_bits + step->additional_bits) * step->price
+	  + mp->err
+	  - square (ws->rem_numerator [domain]) / ws->rem_denominator [domain];
+}
+
+static void
+evaluate_candidate (unsigned domain, mp_candidate_t *candidate,
+		    const mp_step_t *step)
+/*
+ *  Compute the approximation costs if domain image 'domain' is used
+ *  as vector n = 'step'->n of the linear combination.
+ *  Only the scratch arrays of steps 0, ... , n - 1 are read, so several
+ *  candidates can be evaluated at the same time.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	costs, rate, distortion and weights are stored in 'candidate'
+ */
+{
+   /*
+    *  1.) Compute the weights (linear factors) c_i of the
+    *  linear combination
+    *  b = c_0 v_0 + ... + c_(n-1) v_(n-1) + c_n v_'domain'
+    *  Use backward substitution to obtain c_i from the linear
+    *  factors of the lin. comb. b = d_0 o_0 + ... + d_n o_n
+    *  of the corresponding orthogonal vectors {o_0, ..., o_n}.
+    *  Vector o_n of the orthogonal basis is obtained by using
+    *  vector 'v_domain' in step n of the Gram Schmidt
+    *  orthogonalization (see above for definition of o_n).
+    *  Recursive formula for the coefficients c_i:
+    *  c_n := <b, o_n> / ||o_n||^2
+    *  for i = n - 1, ... , 0:
+    *  c_i := <b, o_i> / ||o_i||^2 +
+    *          \sum (k = i + 1, ... , n){ c_k <v_k, o_i>
+    *					/ ||o_i||^2 }
+    *  2.) Because linear factors are stored with reduced precision
+    *  factor c_i is rounded with the given precision in step i
+    *  of the recursive formula. 
+    */
+
+   unsigned	   n = step->n;		/* current vector of the OB */
+   unsigned	   k;			/* counter */
+   int    	   l;			/* counter */
+   real_t 	   m_bits;		/* number of matrix bits to store */
+   real_t 	   w_bits;		/* number of weights bits to store */
+   real_t 	   r [MAXEDGES];	/* rounded linear factors */
+   real_t 	   f [MAXEDGES];	/* linear factors */
+   int    	   v [MAXEDGES];	/* mapping of domains to vectors */
+   real_t 	   m_err;		/* current approximation error */
+   real_t	   norm_n;		/* ||o_n||^2 */
+   real_t	   ip_image_n;		/* <b, o_n> */
+   const mp_t	  *mp 		 = step->mp;
+   const coeff_t  *coeff 	 = step->coeff;
+   const word_t   *domain_blocks = step->domain_blocks;
+   mp_workspace_t *ws 		 = step->c->workspace;
+
+   norm_n     = ws->rem_denominator [domain];
+   ip_image_n = ws->rem_numerator [domain];
+
+   f [n] = ip_image_n / norm_n;
+   v [n] = domain;			/* corresponding mapping */
+   for (k = 0; k < n; k++)
+   {
+      f [k] = ws->ip_image_ortho_vector [k] / ws->norm_ortho_vector [k];
+      v [k] = mp->indices [k];
+   }
+	    
+   for (l = n; l >= 0; l--) 
+   {
+      rpf_t *rpf = domain_blocks [v [l]] ? coeff->rpf : coeff->dc_rpf;
+
+      r [l] = f [l] = btor (rtob (f [l], rpf), rpf);
+		     
+      for (k = 0; k < (unsigned) l; k++)
+	 f [k] -= f [l] * ws->ip_domain_ortho_vector [v [l]][k]
+		  / ws->norm_ortho_vector [k] ;
+   } 
+
+   /*
+    *  Compute the number of output bits of the linear combination
+    *  and store the weights with reduced precision. The
+    *  resulting linear combination is
+    *  b = r_0 v_0 + ... + r_(n-1) v_(n-1) + r_n v_'domain'
+    */
+   {
+      word_t vectors [MAXEDGES + 1];
+      word_t states [MAXEDGES + 1];
+      real_t weights [MAXEDGES + 1];
+      int    i;
+		  
+      for (i = 0, k = 0; k <= n; k++)
+	 if (f [k] != 0)
+	 {
+	    vectors [i] = v [k];
+	    states [i]  = domain_blocks [v [k]];
+	    weights [i] = f [k];
+	    i++;
+	 }
+      vectors [i] = -1;
+      states [i]  = -1;
+
+      w_bits = coeff->bits (weights, states, step->range->level, coeff);
+      m_bits = step->domain_pool->bits (domain_blocks, vectors,
+					step->range->level, step->y_state,
+					step->wfa, step->domain_pool->model);
+   }
+	       
+   /*
+    *  To compute the approximation error, the corresponding
+    *  linear factors of the linear combination 
+    *  b = r_0 o_0 + ... + r_(n-1) o_(n-1) + r_n o_'domain'
+    *  with orthogonal vectors must be computed with following
+    *  formula:
+    *  r_i := r_i +
+    *          \sum (k = i + 1, ... , n) { r_k <v_k, o_i>
+    *					/ ||o_i||^2 }
+    *  Only the products <v_l, o_k> with k < l are required, they have
+    *  been computed in the orthogonalization steps 0, ... , n - 1.
+    */
+   for (k = 0; k <= n; k++)
+      for (l = k + 1; (unsigned) l <= n; l++)
+	 r [k] += ws->ip_domain_ortho_vector [v [l]][k] * r [l]
+		  / ws->norm_ortho_vector [k];
+   /*
+    *  Compute approximation error:
+    *  error := ||b||^2 +
+    *  \sum (k = 0, ... , n){r_k^2 ||o_k||^2 - 2 r_k <b, o_k>}
+    */
+   m_err = step->norm;
+   for (k = 0; k < n; k++)
+      m_err += square (r [k]) * ws->norm_ortho_vector [k]
+	       - 2 * r [k] * ws->ip_image_ortho_vector [k];
+   m_err += square (r [n]) * norm_n - 2 * r [n] * ip_image_n;
+   if (m_err < 0)			/* TODO: return MAXCOSTS */
+      warning ("Negative image norm: %f"
+	       " (current domain: %d, level = %d)",
+	       (double) m_err, domain, step->range->level);
+
+   candidate->evaluated    = YES;
+   candidate->costs        = (m_bits + w_bits + step->additional_bits)
+			     * step->price + m_err;
+   candidate->matrix_bits  = m_bits;
+   candidate->weights_bits = w_bits;
+   candidate->err          = m_err;
+   for (k = 0; k <= n; k++)
+      candidate->weight [k] = f [k];
+}
+
+static void
+orthogonalize (const mp_step_t *step)
+/*
+ *  Step n = 'step'->n of the Gram-Schmidt orthogonalization procedure:
+ *  vector 'step'->index is orthogonalized with respect to the set
+ *  {u_[0], ... , u_['n' - 1]}.
  *
  *  No return value.
  *
  *  Side effects:
  *	The remainder values (numerator and denominator) of
- *	all 'domain_blocks' are updated. 
+ *	all domain blocks are updated in 'c->workspace'.
  */
 {
-   unsigned domain;
+   unsigned	   n  = step->n;
+   mp_workspace_t *ws = step->c->workspace;
    
-   ip_image_ortho_vector [n] = rem_numerator [index];
-   norm_ortho_vector [n]     = rem_denominator [index];
+   ws->ip_image_ortho_vector [n] = ws->rem_numerator [step->index];
+   ws->norm_ortho_vector [n]     = ws->rem_denominator [step->index];
+
+   run_tasks (step->c->pool, step->tasks, orthogonalize_domains,
+	      (void *) step);
+}
 
+static void
+orthogonalize_domains (void *data, unsigned task)
+/*
+ *  Orthogonalize the domain blocks of the given 'task' with respect to
+ *  the new vector of the orthogonal basis (see orthogonalize ()). If
+ *  the denominator gets smaller than 'min_norm' then the corresponding
+ *  domain is excluded from the list of available domain blocks.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	The remainder values (numerator and denominator) of
+ *	the domain blocks of the part are updated in 'c->workspace'.
+ */
+{
+   const mp_step_t *step  = (const mp_step_t *) data;
+   unsigned	    n     = step->n;
+   unsigned	    index = step->index;
+   unsigned	    level = step->range->level;
+   unsigned	    first = task * step->domains / step->tasks;
+   unsigned	    last  = (task + 1) * step->domains / step->tasks;
+   const word_t    *domain_blocks = step->domain_blocks;
+   mp_workspace_t  *ws    = step->c->workspace;
+   unsigned	    domain;
+   
    /*
     *  Compute inner products between all domain images and 
     *  vector n of the orthogonal basis:
@@ -673,30 +792,31 @@ orthogonalize (unsigned index, unsigned n, unsigned level, real_t min_norm,
     *  Moreover the denominator and numerator parts of the comparitive
     *  value are updated.
     */
-   for (domain = 0; domain_blocks [domain] >= 0; domain++) 
-      if (!used [domain]) 
+   for (domain = first; domain < last; domain++) 
+      if (!ws->used [domain]) 
       {
 	 unsigned k;
 	 real_t   tmp = get_ip_state_state (domain_blocks [index],
-					    domain_blocks [domain], level, c);
+					    domain_blocks [domain], level,
+					    step->c);
 	 
 	 for (k = 0; k < n; k++) 
-	    tmp -= ip_domain_ortho_vector [domain][k] / norm_ortho_vector [k]
-		   * ip_domain_ortho_vector [index][k];
-	 ip_domain_ortho_vector [domain][n] = tmp;
-	 rem_denominator [domain] -= square (tmp) / norm_ortho_vector [n];
-	 rem_numerator [domain]   -= ip_image_ortho_vector [n]
-				     / norm_ortho_vector [n]
-				     * ip_domain_ortho_vector [domain][n] ;
+	    tmp -= ws->ip_domain_ortho_vector [domain][k]
+		   / ws->norm_ortho_vector [k]
+		   * ws->ip_domain_ortho_vector [index][k];
+	 ws->ip_domain_ortho_vector [domain][n] = tmp;
+	 ws->rem_denominator [domain]
+	    -= square (tmp) / ws->norm_ortho_vector [n];
+	 ws->rem_numerator [domain]
+	    -= ws->ip_image_ortho_vector [n] / ws->norm_ortho_vector [n]
+	       * ws->ip_domain_ortho_vector [domain][n];
 
 	 /*
 	  *  Exclude vectors with small denominator
 	  */
-	 if (!used [domain]) 
-	    if (rem_denominator [domain] / size_of_level (level) < min_norm) 
-	       used [domain] = YES;
+	 if (!ws->used [domain]) 
+	    if (ws->rem_denominator [domain] / size_of_level (level)
+		< step->min_norm) 
+	       ws->used [domain] = YES;
       }
 }
-
-
-
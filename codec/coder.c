@@ -18,6 +18,8 @@
 
 #include <math.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "types.h"
@@ -42,7 +44,10 @@
 #include "domain-pool.h"
 #include "coeff.h"
 #include "coder.h"
+#include "vector.h"
 #include "rpf.h"
+#include "mosaic.h"
+#include "thread-pool.h"
 
 /*****************************************************************************
 
@@ -52,22 +57,139 @@
 
 const real_t MAXCOSTS =	1e20;
 
+/*****************************************************************************
+
+				local variables
+  
+*****************************************************************************/
+
+typedef struct gop_job
+/*
+ *  Groups of pictures of a video, shared by the tasks which encode them.
+ */
+{
+   char const * const *template;	/* filenames of the frames */
+   const wfa_info_t   *wi;		/* number, size and color of frames */
+   const unsigned     *first;		/* first frame of each group */
+   FILE		     **stream;		/* coded stream of each group */
+   unsigned	      *bits;		/* number of bits of each stream */
+   frame_index_t     **index;		/* frame index of each group */
+   float	       quality;		/* compression quality */
+   const c_options_t  *options;		/* options of every group */
+} gop_job_t;
+
+typedef struct cfiasco
+/*
+ *  State of the incremental video coder. A frame is encoded as soon as
+ *  its reference frames are available, B-frames wait in 'lookahead'
+ *  for their future reference frame.
+ */
+{
+   char		       id [8];
+   wfa_t	      *wfa;		/* WFA of the current frame */
+   coding_t	      *c;		/* coder, NULL if mosaic */
+   bitfile_t	      *output;		/* FIASCO stream */
+   fiasco_write_f      write;		/* write callback of 'output' */
+   fiasco_seek_f       seek;		/* seek callback or NULL */
+   void		      *data;		/* argument of the callbacks */
+   float	       quality;		/* compression quality */
+   const c_options_t  *options;		/* coder options */
+   fiasco_c_options_t *default_options;	/* NULL if options are given */
+   unsigned	       first;		/* display number of first frame */
+   unsigned	       last;		/* display number of last frame + 1 */
+   unsigned	       display;		/* display number of next frame */
+   image_t	      *reconst;		/* decoded reference image */
+   bool_t	       future_frame;	/* YES if last frame was in future */
+   lqueue_t	      *lookahead;	/* B-frames in display order */
+} cfiasco_t;
+
 /*****************************************************************************
 
 				prototypes
   
 *****************************************************************************/
 
+static bool_t
+check_parameters (float quality, const fiasco_c_options_t *options);
+static void
+close_output (bitfile_t *volatile *output);
+static int
+encode_stream (char const * const *inputname, bitfile_t *output,
+	       float quality, const fiasco_c_options_t *options);
+static void
+encode_frames (char const * const *template, bitfile_t *output, wfa_t *wfa,
+	       float quality, const c_options_t *cop);
+static bool_t
+check_input_frames (char const * const *inputname, wfa_info_t *wi);
 static coding_t *
-alloc_coder (char const * const *inputname, const c_options_t *options,
-	     wfa_info_t *wi);
+alloc_coder (const c_options_t *options, wfa_info_t *wi);
 static void
 free_coder (coding_t *c);
 static char *
 get_input_image_name (char const * const *templptr, unsigned ith_image);
 static void
 video_coder (char const * const *image_template, bitfile_t *output,
-	     wfa_t *wfa, coding_t *c);
+	     wfa_t *wfa, coding_t *c, unsigned first, unsigned last);
+static void
+start_video (cfiasco_t *cfiasco, unsigned first, unsigned last);
+static void
+push_video_frame (cfiasco_t *cfiasco, image_t *image);
+static void
+code_video_frame (cfiasco_t *cfiasco, image_t *image, unsigned frame,
+		  frame_type_e type, bool_t future_frame);
+static void
+flush_video (cfiasco_t *cfiasco);
+static void
+end_video (cfiasco_t *cfiasco);
+static void
+patch_frame_count (cfiasco_t *cfiasco, unsigned long long length);
+static cfiasco_t *
+cast_cfiasco (fiasco_encoder_t *encoder);
+static void
+patch_frame_count (cfiasco_t *cfiasco, unsigned long long length)
+/*
+ *  Store the number of frames in the header of the video of 'cfiasco'
+ *  whose number of frames was unknown when the header has been written.
+ *  The header is written again at the start of the stream if the
+ *  stream can be repositioned by the seek callback, afterwards the
+ *  stream is positioned at its end (byte 'length'). Otherwise, the
+ *  number of frames remains zero and decoders have to look for the
+ *  end marker.
+ *
+ *  No return value.
+ */
+{
+   bitfile_t *header;
+   void	     *buffer;
+   size_t     size;
+
+   if (!cfiasco->seek || !cfiasco->seek (cfiasco->data, 0))
+      return;
+
+   header = open_growable_bitfile ();
+   write_header (cfiasco->wfa->wfainfo, header);
+   buffer = detach_growable_bitfile (header, &size);
+   if (cfiasco->write (cfiasco->data, buffer, size) != size
+       || !cfiasco->seek (cfiasco->data, length))
+   {
+      free (buffer);
+      error ("Can't store the number of frames in the stream header.");
+   }
+   free (buffer);
+}
+
+static unsigned
+split_video (unsigned frames, const char *pattern, unsigned *first);
+static void
+gop_coder (char const * const *template, bitfile_t *output,
+	   const wfa_info_t *wi, float quality, const c_options_t *options,
+	   unsigned gops, const unsigned *first);
+static void
+encode_gop (void *data, unsigned task);
+static int
+append_gop (bitfile_t *output, FILE *stream, unsigned bits);
+static void
+copy_bits (bitfile_t *output, bitfile_t *input, unsigned bits);
 static void 
 frame_coder (wfa_t *wfa, coding_t *c, bitfile_t *output);
 static void
@@ -100,149 +222,632 @@ fiasco_coder (char const * const *inputname, const char *outputname,
  *	0 otherwise
  */
 {
+   bitfile_t *volatile output = NULL;	/* closed if the coder fails */
+
    try
    {
-      char const * const default_input [] = {"-", NULL};
-      fiasco_c_options_t *default_options = NULL;
-      const c_options_t  *cop;
-      char const * const *template;
+      int success;
       
+      if (!check_parameters (quality, options))
+	 return 0;
+
       /*
-       *  Check parameters
+       *  Open output stream
        */
-      if (!inputname || !inputname [0] || streq (inputname [0], "-"))
-	 template = default_input;
+      output = open_bitfile (outputname, "FIASCO_DATA", WRITE_ACCESS);
+      if (!output)
+      {
+	 set_error (_("Can't write outputfile `%s'.\n%s"),
+		    outputname ? outputname : "<stdout>",
+		    get_system_error ());
+	 return 0;
+      }
+      success = encode_stream (inputname, output, quality, options);
+      close_bitfile (output);
+
+      return success;
+   }
+   catch
+   {
+      close_output (&output);
+      return 0;
+   }
+}
+
+int
+fiasco_coder_to_memory (char const * const *inputname,
+			void **buffer, size_t *size,
+			float quality, const fiasco_c_options_t *options)
+/*
+ *  FIASCO coder.
+ *  Encode image or video frames given by the array of filenames `inputname'
+ *  (see fiasco_coder ()) and write the FIASCO stream to a new block of
+ *  memory. The memory block has to be released with free ().
+ *
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ *
+ *  Side effects:
+ *	'buffer' and 'size' are set to address and size of the stream
+ */
+{
+   bitfile_t *volatile output = NULL;	/* closed if the coder fails */
+
+   if (!buffer || !size)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."),
+		 buffer ? "size" : "buffer");
+      return 0;
+   }
+   try
+   {
+      if (!check_parameters (quality, options))
+	 return 0;
+
+      output = open_growable_bitfile ();
+      if (!encode_stream (inputname, output, quality, options))
+      {
+	 close_bitfile (output);
+	 return 0;
+      }
+      *buffer = detach_growable_bitfile (output, size);
+
+      return 1;
+   }
+   catch
+   {
+      close_output (&output);
+      return 0;
+   }
+}
+
+int
+fiasco_coder_to_callback (char const * const *inputname,
+			  fiasco_write_f write, void *data,
+			  float quality, const fiasco_c_options_t *options)
+/*
+ *  FIASCO coder.
+ *  Encode image or video frames given by the array of filenames `inputname'
+ *  (see fiasco_coder ()) and pass the FIASCO stream in blocks to the
+ *  callback 'write' ('data', buffer, size).
+ *
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   bitfile_t *volatile output = NULL;	/* closed if the coder fails */
+
+   if (!write)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "write");
+      return 0;
+   }
+   try
+   {
+      int success;
+
+      if (!check_parameters (quality, options))
+	 return 0;
+
+      output  = open_callback_bitfile (NULL, write, data);
+      success = encode_stream (inputname, output, quality, options);
+      close_bitfile (output);
+
+      return success;
+   }
+   catch
+   {
+      close_output (&output);
+      return 0;
+   }
+}
+
+fiasco_encoder_t *
+fiasco_encoder_new (unsigned width, unsigned height, int color,
+		    unsigned frames, float quality,
+		    const fiasco_c_options_t *options,
+		    fiasco_write_f write, fiasco_seek_f seek, void *data)
+/*
+ *  Incremental FIASCO coder constructor.
+ *  Prepare the encoding of a sequence of #'frames' frames of size
+ *  'width' x 'height' (grayscale or 'color') with the given 'quality'
+ *  and 'options'. If 'frames' is zero then the number of frames is
+ *  unknown, the sequence ends with the last frame passed before
+ *  fiasco_encoder_finish () is called. The frames are passed one by
+ *  one in display order to fiasco_encoder_push_frame (), the FIASCO
+ *  stream is passed in blocks to the callback 'write' ('data', buffer,
+ *  size). If the callback 'seek' ('data', offset) is not NULL and
+ *  succeeds then the number of frames of a sequence of unknown length
+ *  is stored in the header of the stream at the end. Only the
+ *  reference frames and the B-frames waiting for their future
+ *  reference frame are kept in memory. 'options' have to stay valid
+ *  until fiasco_encoder_finish () is called.
+ *
+ *  Return value:
+ *	pointer to the new coder
+ *	or NULL in case of an error
+ */
+{
+   if (!write)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "write");
+      return NULL;
+   }
+   if (!width || !height || (width & 1) || (height & 1))
+   {
+      set_error (_("Width and height of images must be "
+		   "positive even numbers."));
+      return NULL;
+   }
+   try
+   {
+      fiasco_encoder_t *encoder;
+      cfiasco_t	       *cfiasco;
+
+      if (!check_parameters (quality, options))
+	 return NULL;
+
+      cfiasco = fiasco_calloc (1, sizeof (cfiasco_t));
+      strcpy (cfiasco->id, "CFIASCO");
+      if (options)
+	 cfiasco->options = cast_c_options ((fiasco_c_options_t *) options);
+      else
+      {
+	 cfiasco->default_options = fiasco_c_options_new ();
+	 cfiasco->options	  = cast_c_options (cfiasco->default_options);
+      }
+      cfiasco->quality = quality;
+      cfiasco->write   = write;
+      cfiasco->seek    = seek;
+      cfiasco->data    = data;
+      cfiasco->output  = open_callback_bitfile (NULL, write, data);
+      cfiasco->wfa     = alloc_wfa (YES);
+      cfiasco->wfa->wfainfo->frames	= frames;
+      cfiasco->wfa->wfainfo->open_ended = frames ? NO : YES;
+      cfiasco->wfa->wfainfo->width	= width;
+      cfiasco->wfa->wfainfo->height	= height;
+      cfiasco->wfa->wfainfo->color	= color ? YES : NO;
+
+      if (cfiasco->options->mosaic_width && frames != 1)
+	 warning (_("Mosaic containers valid only with "
+		    "still image compression."));
+      if (cfiasco->options->mosaic_width && frames == 1)
+      {
+	 cfiasco->c    = NULL;		/* frame is passed to mosaic_coder */
+	 cfiasco->last = 1;
+      }
+      else
+      {
+	 cfiasco->c = alloc_coder (cfiasco->options, cfiasco->wfa->wfainfo);
+	 read_basis (cfiasco->options->basis_name, cfiasco->wfa);
+	 append_basis_states (cfiasco->wfa->basis_states, cfiasco->wfa,
+			      cfiasco->c);
+	 cfiasco->c->price = 128 * 64 / quality;
+	 start_video (cfiasco, 0, frames ? frames : UINT_MAX);
+      }
+
+      encoder		  = fiasco_calloc (1, sizeof (fiasco_encoder_t));
+      encoder->push_frame = fiasco_encoder_push_frame;
+      encoder->finish	  = fiasco_encoder_finish;
+      encoder->private	  = cfiasco;
+
+      return encoder;
+   }
+   catch
+   {
+      return NULL;
+   }
+}
+
+int
+fiasco_encoder_push_frame (fiasco_encoder_t *encoder,
+			   const fiasco_image_t *image)
+/*
+ *  Encode 'image' as the next frame (in display order) of the sequence
+ *  of the incremental coder 'encoder'. The frame is copied (and
+ *  converted to 4:4:4 format), i.e., 'image' may be changed or
+ *  discarded after the call.
+ *
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   cfiasco_t  *cfiasco = cast_cfiasco (encoder);
+   image_t    *frame;
+   wfa_info_t *wi;
+
+   if (!cfiasco)
+      return 0;
+   if (!image)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "image");
+      return 0;
+   }
+   if (!(frame = cast_image ((fiasco_image_t *) image)))
+      return 0;
+
+   wi = cfiasco->wfa->wfainfo;
+   if (cfiasco->display >= cfiasco->last)
+   {
+      set_error (_("All %d frames of the sequence have already been "
+		   "encoded."), cfiasco->last);
+      return 0;
+   }
+   if (frame->width != wi->width || frame->height != wi->height)
+   {
+      set_error (_("All images of a sequence have to be of the same size."));
+      return 0;
+   }
+   if (frame->color != wi->color)
+   {
+      set_error (_("All images of a sequence have to use the same "
+		   "color model."));
+      return 0;
+   }
+
+   try
+   {
+      image_t *copy = convert_image (frame, FORMAT_4_4_4);
+      
+      if (cfiasco->c)
+	 push_video_frame (cfiasco, copy);
       else
-	 template = inputname;
+      {
+	 mosaic_coder (copy, cfiasco->output, cfiasco->quality,
+		       cfiasco->options);
+	 free_image (copy);
+	 cfiasco->display++;
+      }
+   }
+   catch
+   {
+      return 0;
+   }
+
+   return 1;
+}
+
+int
+fiasco_encoder_finish (fiasco_encoder_t *encoder)
+/*
+ *  Incremental FIASCO coder destructor.
+ *  If the number of frames was unknown then encode the B-frames
+ *  waiting for a future reference frame and terminate the stream.
+ *  Write the frame index (if requested) and flush the FIASCO stream.
+ *
+ *  Return value:
+ *	1 if all frames of the sequence have been encoded
+ *	0 otherwise
+ *
+ *  Side effects:
+ *	structure 'encoder' is discarded.
+ */
+{
+   cfiasco_t  *cfiasco = cast_cfiasco (encoder);
+   wfa_info_t *wi;
+   int	       success;
+
+   if (!cfiasco)
+      return 0;
+
+   try
+   {
+      wi = cfiasco->wfa->wfainfo;
+      if (wi->open_ended && cfiasco->display)
+      {
+	 flush_video (cfiasco);
+	 wi->frames = cfiasco->last = cfiasco->display;
+      }
+      success = cfiasco->display && cfiasco->display == cfiasco->last;
+      if (cfiasco->c)
+      {
+	 end_video (cfiasco);
+	 if (wi->open_ended && cfiasco->display)
+	    write_end_marker (cfiasco->c->index, cfiasco->output);
+	 if (success && cfiasco->c->index)
+	    write_frame_index (cfiasco->c->index, cfiasco->output);
+	 free_coder (cfiasco->c);
+      }
+      if (success && wi->open_ended)
+      {
+	 unsigned long long length = cfiasco->output->bits_processed / 8;
+
+	 close_bitfile (cfiasco->output);
+	 patch_frame_count (cfiasco, length);
+      }
+      else
+	 close_bitfile (cfiasco->output);
+      free_wfa (cfiasco->wfa);
+      if (cfiasco->default_options)
+	 fiasco_c_options_delete (cfiasco->default_options);
+      if (!cfiasco->display)
+	 set_error (_("No frame of the sequence has been encoded."));
+      else if (!success)
+	 set_error (_("Only %d of %d frames of the sequence have been "
+		      "encoded."), cfiasco->display, cfiasco->last);
+      strcpy (cfiasco->id, " ");
+      fiasco_free (cfiasco);
+      fiasco_free (encoder);
+   }
+   catch
+   {
+      return 0;
+   }
+
+   return success;
+}
+
+void
+image_coder (image_t *image, bitfile_t *output, float quality,
+	     const c_options_t *options)
+/*
+ *  Encode the still image 'image' with the given 'quality' and 'options'
+ *  and write the FIASCO stream to 'output'.
+ *
+ *  No return value.
+ */
+{
+   wfa_t    *wfa = alloc_wfa (YES);
+   coding_t *c;
+
+   wfa->wfainfo->frames = 1;
+   wfa->wfainfo->width  = image->width;
+   wfa->wfainfo->height = image->height;
+   wfa->wfainfo->color  = image->color;
+   
+   c = alloc_coder (options, wfa->wfainfo);
+   read_basis (options->basis_name, wfa);
+   append_basis_states (wfa->basis_states, wfa, c);
+	 
+   c->price          = 128 * 64 / quality;
+   c->mt->frame_type = I_FRAME;
+   c->mt->number     = 0;
+   c->mt->original   = image;
+   if (c->tiling->exponent) 
+      perform_tiling (c->mt->original, c->tiling);
+
+   frame_coder (wfa, c, output);
+
+   c->mt->original = NULL;
+   free_wfa (wfa);
+   free_coder (c);
+}
+
+/*****************************************************************************
+
+				private code
+  
+*****************************************************************************/
+
+static bool_t
+check_parameters (float quality, const fiasco_c_options_t *options)
+/*
+ *  Check coding 'quality' and 'options' of the public coder functions.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO otherwise
+ */
+{
+   if (quality <= 0)
+   {
+      set_error (_("Compression quality has to be positive."));
+      return NO;
+   }
+   else if (quality >= 100)
+   {
+      warning (_("Quality typically is 1 (worst) to 100 (best).\n"
+		 "Be prepared for a long running time."));
+   }
+
+   if (options && !cast_c_options ((fiasco_c_options_t *) options))
+      return NO;
+
+   return YES;
+}
+
+static void
+close_output (bitfile_t *volatile *output)
+/*
+ *  Close the stream '*output' of a failed public coder function (if
+ *  it has been opened already). '*output' is reset first, hence the
+ *  stream is not closed twice if flushing the stream fails, too.
+ *
+ *  No return value.
+ */
+{
+   bitfile_t *stream = *output;
+
+   *output = NULL;
+   if (stream)
+      close_bitfile (stream);
+}
+
+static int
+encode_stream (char const * const *inputname, bitfile_t *output,
+	       float quality, const fiasco_c_options_t *options)
+/*
+ *  Encode image or video frames given by the array of filenames
+ *  'inputname' with the given 'quality' and 'options' and write the
+ *  FIASCO stream to 'output'. 'output' is not closed.
+ *
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   char const * const default_input [] = {"-", NULL};
+   fiasco_c_options_t *default_options = NULL;
+   const c_options_t  *cop;
+   char const * const *template;
+   wfa_t	      *wfa;
+   bool_t	       success;
+   volatile bool_t     raised = NO;	/* the coder raised an error */
+   env_t	       saved_env;	/* jump buffer of the caller */
+      
+   if (!inputname || !inputname [0] || streq (inputname [0], "-"))
+      template = default_input;
+   else
+      template = inputname;
       
-      if (quality <= 0)
+   if (options)
+      cop = cast_c_options ((fiasco_c_options_t *) options);
+   else
+   {
+      default_options = fiasco_c_options_new ();
+      cop 	      = cast_c_options (default_options);
+   }
+
+   wfa = alloc_wfa (YES);
+   save_env (saved_env);
+   try
+   {
+      success = check_input_frames (template, wfa->wfainfo);
+      if (success)
+	 encode_frames (template, output, wfa, quality, cop);
+   }
+   catch
+   {
+      raised = YES;
+   }
+   restore_env (saved_env);
+
+   free_wfa (wfa);
+   if (default_options)
+      fiasco_c_options_delete (default_options);
+   if (raised)
+      raise_error ();
+
+   return success ? 1 : 0;
+}
+
+static void
+encode_frames (char const * const *template, bitfile_t *output, wfa_t *wfa,
+	       float quality, const c_options_t *cop)
+/*
+ *  Encode the frames given by the array of filenames 'template' with
+ *  the given 'quality' and options 'cop' and write the FIASCO stream
+ *  to 'output'. Number of frames, size and color model have to be
+ *  stored in 'wfa'->wfainfo already.
+ *
+ *  No return value.
+ */
+{
+   if (cop->mosaic_width && wfa->wfainfo->frames > 1)
+      warning (_("Mosaic containers valid only with "
+		 "still image compression."));
+	    
+   if (cop->mosaic_width && wfa->wfainfo->frames == 1)
+   {
+      char    *image_name = get_input_image_name (template, 0);
+      image_t *image      = read_image (image_name);
+
+      mosaic_coder (image, output, quality, cop);
+
+      free_image (image);
+      if (image_name)
+	 fiasco_free (image_name);
+   }
+   else
+   {
+      unsigned *first = fiasco_calloc (wfa->wfainfo->frames + 1,
+				       sizeof (unsigned));
+      unsigned  gops;			/* number of groups of pictures */
+
+      gops = cop->reference_filename
+	     ? 1 : split_video (wfa->wfainfo->frames, cop->pattern, first);
+      if (gops > 1 && cop->threads != 1)
+	 gop_coder (template, output, wfa->wfainfo, quality, cop,
+		    gops, first);
+      else
       {
-	 set_error (_("Compression quality has to be positive."));
-	 return 0;
+	 coding_t *c = alloc_coder (cop, wfa->wfainfo);
+	 
+	 read_basis (cop->basis_name, wfa);
+	 append_basis_states (wfa->basis_states, wfa, c);
+	 
+	 c->price = 128 * 64 / quality;
+	 
+	 video_coder (template, output, wfa, c, 0, wfa->wfainfo->frames);
+	 if (c->index)
+	    write_frame_index (c->index, output);
+	 free_coder (c);
       }
-      else if (quality >= 100)
+      fiasco_free (first);
+   }
+}
+
+static bool_t
+check_input_frames (char const * const *inputname, wfa_info_t *wi)
+/*
+ *  Check whether all image frames given by 'inputname' are readable
+ *  and of same type.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO otherwise
+ *
+ *  Side effects:
+ *	number of frames, size and color model are stored in 'wi'
+ */
+{
+   char     *filename;
+   unsigned  width, w = 0, height, h = 0;
+   bool_t    color, c = NO;
+   unsigned  n;
+      
+   for (n = 0; (filename = get_input_image_name (inputname, n)); n++)
+   {
+      FILE *file = read_pnmheader (filename, &width, &height, &color);
+      if (!file)
       {
-	 warning (_("Quality typically is 1 (worst) to 100 (best).\n"
-		    "Be prepared for a long running time."));
+	 set_error (_("Can't open frame `%s'.\n%s"),
+		    filename ? filename : "<stdout>", get_system_error ());
+	 return NO;
       }
-
-      if (options)
+      fclose (file);
+      if (n)
       {
-	 cop = cast_c_options ((fiasco_c_options_t *) options);
-	 if (!cop)
-	    return 0;
+	 if (w != width || h != height)
+	    error (_("`%s': all images of a sequence have to be "
+		     "of the same size."), filename ? filename : "<stdin>");
+	 if (c != color)
+	    error (_("`%s': all images a sequence have to use the same "
+		     "color model."), filename ? filename : "<stdin>");
       }
       else
       {
-	 default_options = fiasco_c_options_new ();
-	 cop 		 = cast_c_options (default_options);
-      }
-
-   /*
-    *  Open output stream and initialize WFA
-    */
-      {
-	 bitfile_t *output = open_bitfile (outputname, "FIASCO_DATA",
-					   WRITE_ACCESS);
-	 if (!output)
-	 {
-	    set_error (_("Can't write outputfile `%s'.\n%s"),
-		       outputname ? outputname : "<stdout>",
-		       get_system_error ());
-	    if (default_options)
-	       fiasco_c_options_delete (default_options);
-	    return 0;
-	 }
-	 else
-	 {
-	    wfa_t    *wfa = alloc_wfa (YES);
-	    coding_t *c   = alloc_coder (template, cop, wfa->wfainfo);
-	 
-	    read_basis (cop->basis_name, wfa);
-	    append_basis_states (wfa->basis_states, wfa, c);
-	 
-	    c->price = 128 * 64 / quality;
-	 
-	    video_coder (template, output, wfa, c);
-	 
-	    close_bitfile (output);
-	    free_wfa (wfa);
-	    free_coder (c);
-	 
-	    if (default_options)
-	       fiasco_c_options_delete (default_options);
-	 }
+	 w = width;
+	 h = height;
+	 c = color;
       }
-      return 1;
-   }
-   catch
-   {
-      return 0;
+      fiasco_free (filename);
    }
-}
-
-/*****************************************************************************
+   wi->frames = n;
+   wi->width  = w;
+   wi->height = h;
+   wi->color  = c;
 
-				private code
-  
-*****************************************************************************/
+   return YES;
+}
 
 static coding_t *
-alloc_coder (char const * const *inputname, const c_options_t *options,
-	     wfa_info_t *wi)
+alloc_coder (const c_options_t *options, wfa_info_t *wi)
 /*
  *  Coder structure constructor.
  *  Allocate memory for the FIASCO coder structure and
  *  fill in default values specified by 'options'.
+ *  Number of frames, size and color model have to be set in 'wi'.
  *
  *  Return value:
- *	pointer to the new coder structure or NULL on error
+ *	pointer to the new coder structure
  */
 {
    coding_t *c = NULL;
    
-   /*
-    *  Check whether all specified image frames are readable and of same type
-    */
-   {
-      char     *filename;
-      unsigned 	width, w = 0, height, h = 0;
-      bool_t	color, c = NO;
-      unsigned 	n;
-      
-      for (n = 0; (filename = get_input_image_name (inputname, n)); n++)
-      {
-	 FILE *file = read_pnmheader (filename, &width, &height, &color);
-	 if (!file)
-	 {
-	    set_error (_("Can't open frame `%s'.\n%s"),
-		       filename ? filename : "<stdout>", get_system_error ());
-	    return NULL;
-	 }
-	 fclose (file);
-	 if (n)
-	 {
-	    if (w != width || h != height)
-	       error (_("`%s': all images of a sequence have to be "
-			"of the same size."), filename ? filename : "<stdin>");
-	    if (c != color)
-	       error (_("`%s': all images a sequence have to use the same "
-			"color model."), filename ? filename : "<stdin>");
-	 }
-	 else
-	 {
-	    w = width;
-	    h = height;
-	    c = color;
-	 }
-	 fiasco_free (filename);
-      }
-      wi->frames = n;
-      wi->width  = w;
-      wi->height = h;
-      wi->color  = c;
-   }
-
    /*
     *  Levels ...
     */
@@ -264,7 +869,7 @@ alloc_coder (char const * const *inputname, const c_options_t *options,
    c->tiling = alloc_tiling (options->tiling_method,
 			     options->tiling_exponent, wi->level);
 
-   if (wi->frames > 1 && c->tiling->exponent > 0)
+   if (wi->frames != 1 && c->tiling->exponent > 0)
    {
       c->tiling->exponent = 0;
       warning (_("Image tiling valid only with still image compression."));
@@ -294,11 +899,13 @@ alloc_coder (char const * const *inputname, const c_options_t *options,
    
    c->products_level  = max (0, (c->options.lc_max_level
 				 - c->options.images_level - 1));
-   c->pixels 	      = fiasco_calloc (size_of_level (c->options.lc_max_level),
-				sizeof (real_t));
+   c->pixels = fiasco_aligned_calloc (size_of_level (c->options.lc_max_level),
+				      sizeof (real_t));
    c->images_of_state = fiasco_calloc (MAXSTATES, sizeof (real_t *));
    c->ip_images_state = fiasco_calloc (MAXSTATES, sizeof (real_t *));
    c->ip_states_state = fiasco_calloc (MAXSTATES * MAXLEVEL, sizeof (real_t *));
+   c->workspace       = fiasco_calloc (1, sizeof (mp_workspace_t));
+   c->pool            = alloc_thread_pool (c->options.threads);
    
    debug_message ("Imageslevel :%d, Productslevel :%d",
 		  c->options.images_level, c->products_level);
@@ -307,6 +914,8 @@ alloc_coder (char const * const *inputname, const c_options_t *options,
 		  size_of_tree (c->products_level) * 4,
 		  (c->options.lc_max_level - c->options.images_level),
 		  size_of_level (c->options.lc_max_level));
+   debug_message ("Inner product kernels : %s", vector_kernel_name ());
+   debug_message ("Threads : %d", thread_pool_size (c->pool));
    
    /*
     *  Domain pools ...
@@ -354,13 +963,17 @@ alloc_coder (char const * const *inputname, const c_options_t *options,
     *  p_min_level, p_max_level are also used for ND prediction
     */
    wi->search_range   = options->search_range;
+   wi->release	      = wi->search_range > 16 ? FIASCO_BINFILE_RELEASE : 2;
    wi->fps 	      = options->fps;
    wi->half_pixel     = options->half_pixel_prediction;
    wi->cross_B_search = options->half_pixel_prediction;
    wi->B_as_past_ref  = options->B_as_past_ref;
    wi->smoothing      = options->smoothing;
    
-   c->mt = alloc_motion (wi);
+   c->mt = alloc_motion (wi, options->motion_search);
+
+   c->index = options->frame_index && wi->frames != 1
+	      ? alloc_frame_index (wi->frames) : NULL;
 
    return c;
 }
@@ -379,11 +992,15 @@ free_coder (coding_t *c)
 {
    free_tiling (c->tiling);
    free_motion (c->mt);
+   if (c->index)
+      free_frame_index (c->index);
    
-   fiasco_free (c->pixels);
+   fiasco_aligned_free (c->pixels);
    fiasco_free (c->images_of_state);
    fiasco_free (c->ip_images_state);
    fiasco_free (c->ip_states_state);
+   fiasco_free (c->workspace);
+   free_thread_pool (c->pool);
    fiasco_free (c);
 }
 
@@ -489,182 +1106,526 @@ get_input_image_name (char const * const *templptr, unsigned ith_image)
 
 static void
 video_coder (char const * const *image_template, bitfile_t *output,
-	     wfa_t *wfa, coding_t *c)
+	     wfa_t *wfa, coding_t *c, unsigned first, unsigned last)
 /*
- *  Toplevel function to encode a sequence of video frames specified
- *  by 'image_template'. The output is written to stream 'output'.
+ *  Toplevel function to encode the frames 'first', ..., 'last' - 1
+ *  of the sequence of video frames specified by 'image_template'.
+ *  The output is written to stream 'output'.
  *  Coding options are given by 'c'.
  *
  *  No return value.
  */
 {
-   unsigned  display;			/* picture number in display order */
-   int	     future_display;		/* number of future reference */
-   int	     frame;			/* current frame number */
-   char	    *image_name;		/* image name of current frame */
-   image_t  *reconst 	  = NULL; 	/* decoded reference image */
-   bool_t    future_frame = NO;		/* YES if last frame was in future */
+   cfiasco_t  cfiasco;			/* state of the video coder */
+   unsigned   display;			/* picture number in display order */
+   char	     *image_name;		/* image name of current frame */
    
    debug_message ("Generating %d WFA's ...", wfa->wfainfo->frames);
 
-   future_display = -1;
-   frame          = -1;
-   display        = 0;
+   cfiasco.wfa    = wfa;
+   cfiasco.c      = c;
+   cfiasco.output = output;
+   start_video (&cfiasco, first, last);
 
-   while ((image_name = get_input_image_name (image_template, display)))
+   for (display = first;
+	display < last
+	&& (image_name = get_input_image_name (image_template, display));
+	display++)
    {
-      frame_type_e type;		/* current frame type: I, B, P */
+      debug_message ("Reading frame `%s'.", image_name);
+      push_video_frame (&cfiasco, read_image (image_name));
+      fiasco_free (image_name);
+   }
+
+   end_video (&cfiasco);
+}
+
+static void
+start_video (cfiasco_t *cfiasco, unsigned first, unsigned last)
+/*
+ *  Prepare the incremental coding of the frames 'first', ..., 'last' - 1
+ *  of a video. WFA, coder and output stream have to be set in 'cfiasco'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the video state of 'cfiasco' is initialized
+ */
+{
+   cfiasco->first        = first;
+   cfiasco->last         = last;
+   cfiasco->display      = first;
+   cfiasco->reconst      = NULL;
+   cfiasco->future_frame = NO;
+   cfiasco->lookahead    = alloc_queue (sizeof (image_t *));
+}
+
+static void
+push_video_frame (cfiasco_t *cfiasco, image_t *image)
+/*
+ *  Append 'image' as the next frame (in display order) to the video of
+ *  'cfiasco'. I- and P-frames are encoded immediately, followed by the
+ *  B-frames which have been waiting for this future reference
+ *  frame. The last frame of the video is encoded as P-frame if it
+ *  should be a B-frame.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'image' is discarded after it has been encoded
+ */
+{
+   coding_t	*c	 = cfiasco->c;
+   unsigned	 display = cfiasco->display++;
+   frame_type_e	 type;			/* current frame type: I, B, P */
+
+   /*
+    *  Determine type of next frame.
+    */
+   if (display == cfiasco->first && !c->options.reference_filename)
+      type = I_FRAME;			/* Force first frame to be intra */
+   else
+      type = pattern2type (display, c->options.pattern);
       
-      /*
-       *  Determine type of next frame.
-       *  Skip already coded frames (future reference!)
-       */
-      if (display == 0 && !c->options.reference_filename)
-	 type = I_FRAME;		/* Force first frame to be intra */
-      else
-	 type = pattern2type (display, c->options.pattern);
+   if (type != I_FRAME && c->options.reference_filename)
+      /* Load reference from disk */
+   {
+      debug_message ("Reading reference frame `%s'.",
+		     c->options.reference_filename);
+      if (cfiasco->reconst)
+	 free_image (cfiasco->reconst);
+      cfiasco->reconst		    = read_image (c->options.reference_filename);
+      c->options.reference_filename = NULL;
+   }
+
+   if (type == B_FRAME && display + 1 < cfiasco->last)
+      queue_append (cfiasco->lookahead, &image); /* wait for future ref */
+   else
+   {
+      unsigned  pending = list_sizeof (cfiasco->lookahead);
+      image_t  *b_frame;		/* B-frame waiting for 'image' */
       
-      if (type != I_FRAME && c->options.reference_filename)
-	 /* Load reference from disk */
-      {
-	 debug_message ("Reading reference frame `%s'.",
-			c->options.reference_filename);
-	 reconst 	 = read_image (c->options.reference_filename);
-	 c->options.reference_filename = NULL;
-      }
-      if ((int) display == future_display) /* Skip already coded future ref */
-      {				
-	 display++;
-	 continue;
-      }	  
-      else if (type == B_FRAME && (int) display > future_display) 
-      {
-	 unsigned i = display;
-	 /*
-	  *  Search for future reference
-	  */
-	 while (type == B_FRAME)
-	 {
-	    char *name;			/* image name of future frame */
+      if (type == B_FRAME)		/* Force last frame to be 'P' */
+	 type = P_FRAME;
+      code_video_frame (cfiasco, image, display, type, pending > 0);
 
-	    i++;
-	    name = get_input_image_name (image_template, i);
-	    
-	    if (!name)			/* Force last valid frame to be 'P' */
-	    {
-	       future_display = i - 1;
-	       type = P_FRAME;
-	    }
-	    else
-	    {
-	       future_display = i;    
-	       image_name     = name;
-	       type 	      = pattern2type (i, c->options.pattern);
-	    }
-	    frame = future_display;
-	 }
-      }
-      else
-      {
-	 frame = display;
-	 display++;
-      }
+      for (display -= pending; queue_remove (cfiasco->lookahead, &b_frame);
+	   display++)
+	 code_video_frame (cfiasco, b_frame, display, B_FRAME, NO);
+   }
+}
+
+static void
+code_video_frame (cfiasco_t *cfiasco, image_t *image, unsigned frame,
+		  frame_type_e type, bool_t future_frame)
+/*
+ *  Encode 'image' as frame number 'frame' of type 'type' of the video of
+ *  'cfiasco'. 'future_frame' has to be set if the frame is the future
+ *  reference of the following B-frames.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'image' is discarded,
+ *	the reference frames of 'cfiasco' are updated
+ */
+{
+   coding_t *c	 = cfiasco->c;
+   wfa_t    *wfa = cfiasco->wfa;
 
-      debug_message ("Coding \'%s\' [%c-frame].", image_name,
-		     type == I_FRAME ? 'I' : (type == P_FRAME ? 'P' : 'B'));
+   debug_message ("Coding frame %d [%c-frame].", frame,
+		  type == I_FRAME ? 'I' : (type == P_FRAME ? 'P' : 'B'));
        
-      /*
-       *  Depending on current frame type update past and future frames
-       *  which are needed as reference frames.
-       */
-      c->mt->frame_type = type;
-      if (type == I_FRAME)
-      {
-	 if (c->mt->past)		/* discard past frame */
-	    free_image (c->mt->past);
-	 c->mt->past = NULL;
-	 if (c->mt->future)		/* discard future frame */
-	    free_image (c->mt->future);
-	 c->mt->future = NULL;
-	 if (reconst)			/* discard current frame */
-	    free_image (reconst);
-	 reconst = NULL;
-      }
-      else if (type == P_FRAME)
+   /*
+    *  Depending on current frame type update past and future frames
+    *  which are needed as reference frames.
+    */
+   c->mt->frame_type = type;
+   if (type == I_FRAME)
+   {
+      if (c->mt->past)			/* discard past frame */
+	 free_image (c->mt->past);
+      c->mt->past = NULL;
+      if (c->mt->future)		/* discard future frame */
+	 free_image (c->mt->future);
+      c->mt->future = NULL;
+      if (cfiasco->reconst)		/* discard current frame */
+	 free_image (cfiasco->reconst);
+      cfiasco->reconst = NULL;
+   }
+   else if (type == P_FRAME)
+   {
+      if (c->mt->past)			/* discard past frame */
+	 free_image (c->mt->past);
+      c->mt->past      = cfiasco->reconst; /* past frame <- current frame */
+      cfiasco->reconst = NULL;
+      if (c->mt->future)		/* discard future frame */
+	 free_image (c->mt->future);
+      c->mt->future = NULL;
+   }
+   else					/* B_FRAME */
+   {
+      if (cfiasco->future_frame)	/* last frame was future frame */
       {
-	 if (c->mt->past)		/* discard past frame */
-	    free_image (c->mt->past);
-	 c->mt->past = reconst;		/* past frame <- current frame */
-	 reconst    = NULL;
 	 if (c->mt->future)		/* discard future frame */
 	    free_image (c->mt->future);
-	 c->mt->future = NULL;
+	 c->mt->future	  = cfiasco->reconst; /* future frame <- current */
+	 cfiasco->reconst = NULL;
       }
-      else				/* B_FRAME */
+      else
       {
-	 if (future_frame)		/* last frame was future frame */
+	 if (wfa->wfainfo->B_as_past_ref == YES)
 	 {
-	    if (c->mt->future)		/* discard future frame */
-	       free_image (c->mt->future);
-	    c->mt->future = reconst;	/* future frame <- current frame */
-	    reconst      = NULL;
+	    if (c->mt->past)		/* discard past frame */
+	       free_image (c->mt->past);
+	    c->mt->past	     = cfiasco->reconst; /* past frame <- current */
+	    cfiasco->reconst = NULL;
 	 }
 	 else
 	 {
-	    if (wfa->wfainfo->B_as_past_ref == YES)
-	    {
-	       if (c->mt->past)		/* discard past frame */
-		  free_image (c->mt->past);
-	       c->mt->past = reconst;	/* past frame <- current frame */
-	       reconst    = NULL;
-	    }
-	    else
-	    {
-	       if (reconst)		/* discard current frame */
-		  free_image (reconst);
-	       reconst = NULL;
-	    }
+	    if (cfiasco->reconst)	/* discard current frame */
+	       free_image (cfiasco->reconst);
+	    cfiasco->reconst = NULL;
 	 }
       }
+   }
 
-      /*
-       *  Start WFA coding of current frame
-       */
-      future_frame   = frame == future_display;
-      c->mt->number   = frame;
-      c->mt->original = read_image (image_name);
-      if (c->tiling->exponent && type == I_FRAME) 
-	 perform_tiling (c->mt->original, c->tiling);
+   /*
+    *  Start WFA coding of current frame
+    */
+   cfiasco->future_frame = future_frame;
+   c->mt->number	 = frame;
+   c->mt->original	 = image;
+   if (c->tiling->exponent && type == I_FRAME) 
+      perform_tiling (c->mt->original, c->tiling);
 
-      frame_coder (wfa, c, output);
+   frame_coder (wfa, c, cfiasco->output);
 
-      /*
-       *  Regenerate image:
-       *  1. Compute approximation of WFA ranges (real image bintree order)
-       *  2. Generate byte image in rasterscan order
-       *  3. Apply motion compensation
-       */
-      reconst = decode_image (wfa->wfainfo->width, wfa->wfainfo->height,
-			      FORMAT_4_4_4, NULL, wfa);
+   /*
+    *  Regenerate image:
+    *  1. Compute approximation of WFA ranges (real image bintree order)
+    *  2. Generate byte image in rasterscan order
+    *  3. Apply motion compensation
+    */
+   cfiasco->reconst = decode_image (wfa->wfainfo->width, wfa->wfainfo->height,
+				    FORMAT_4_4_4, NULL, wfa, c->pool, NULL);
 
-      if (type != I_FRAME)
-	 restore_mc (0, reconst, c->mt->past, c->mt->future, wfa);
+   if (type != I_FRAME)
+      restore_mc (0, cfiasco->reconst, c->mt->past, c->mt->future, wfa);
 
-      if (c->mt->original)
-	 free_image (c->mt->original);
-      c->mt->original = NULL;
+   free_image (c->mt->original);
+   c->mt->original = NULL;
       
-      remove_states (wfa->basis_states, wfa); /* Clear WFA structure */
+   remove_states (wfa->basis_states, wfa); /* Clear WFA structure */
+}
+
+static void
+flush_video (cfiasco_t *cfiasco)
+/*
+ *  End the video of 'cfiasco' whose number of frames was unknown with
+ *  the last pushed frame: encode the B-frames which are still waiting
+ *  for their future reference frame, the last one is encoded as
+ *  P-frame.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'cfiasco->last' is set to the number of frames
+ */
+{
+   image_t *image;
+
+   cfiasco->last = cfiasco->display;
+   if (list_remove (cfiasco->lookahead, TAIL, &image))
+   {
+      cfiasco->display--;
+      push_video_frame (cfiasco, image);
+   }
+}
+
+static void
+end_video (cfiasco_t *cfiasco)
+/*
+ *  Discard the reference frames and the frames waiting for their
+ *  future reference frame of the video of 'cfiasco'.
+ *
+ *  No return value.
+ */
+{
+   motion_t *mt = cfiasco->c->mt;
+   image_t  *b_frame;
+
+   while (queue_remove (cfiasco->lookahead, &b_frame))
+      free_image (b_frame);
+   free_queue (cfiasco->lookahead);
+   cfiasco->lookahead = NULL;
+
+   if (cfiasco->reconst)
+      free_image (cfiasco->reconst);
+   cfiasco->reconst = NULL;
+   if (mt->future)
+      free_image (mt->future);
+   mt->future = NULL;
+   if (mt->past)
+      free_image (mt->past);
+   mt->past = NULL;
+   if (mt->original)
+      free_image (mt->original);
+   mt->original = NULL;
+}
+
+static unsigned
+split_video (unsigned frames, const char *pattern, unsigned *first)
+/*
+ *  Split a video of #'frames' frames with the frame type 'pattern' into
+ *  groups of pictures which can be encoded independently. A group
+ *  starts with an I-frame which is not the future reference of
+ *  preceding B-frames.
+ *
+ *  Return value:
+ *	number of groups
+ *
+ *  Side effects:
+ *	the first frame of each group is stored in 'first', followed by
+ *	the number of frames
+ */
+{
+   unsigned gops = 0;
+   unsigned frame;
+
+   for (frame = 0; frame < frames; frame++)
+      if (frame == 0 || (pattern2type (frame, pattern) == I_FRAME
+			 && pattern2type (frame - 1, pattern) != B_FRAME))
+	 first [gops++] = frame;
+   first [gops] = frames;
+
+   return gops;
+}
+
+static void
+gop_coder (char const * const *template, bitfile_t *output,
+	   const wfa_info_t *wi, float quality, const c_options_t *options,
+	   unsigned gops, const unsigned *first)
+/*
+ *  Encode the #'gops' groups of pictures of the video given by
+ *  'template' with the given 'quality'. Group n consists of the frames
+ *  'first' [n], ..., 'first' [n + 1] - 1. The groups are distributed
+ *  among 'options->threads' threads, each group is encoded to a
+ *  separate stream by a coder of its own. The streams are appended to
+ *  'output' in display order (see append_gop ()), the frame index of
+ *  the video is merged from the indices of the groups.
+ *
+ *  No return value.
+ */
+{
+   gop_job_t	  job;
+   c_options_t	  gop_options;
+   thread_pool_t *pool;
+   frame_index_t *index = NULL;		/* frame index of the video */
+   unsigned	  gop;
+
+   /*
+    *  Each group coder runs in a single thread and without progress meter.
+    */
+   gop_options		      = *options;
+   gop_options.threads	      = 1;
+   gop_options.progress_meter = FIASCO_PROGRESS_NONE;
+
+   debug_message ("Encoding %d groups of pictures.", gops);
+
+   job.template = template;
+   job.wi	= wi;
+   job.first	= first;
+   job.stream	= fiasco_calloc (gops, sizeof (FILE *));
+   job.bits	= fiasco_calloc (gops, sizeof (unsigned));
+   job.index	= fiasco_calloc (gops, sizeof (frame_index_t *));
+   job.quality	= quality;
+   job.options	= &gop_options;
+
+   pool = alloc_thread_pool (options->threads);
+   run_tasks (pool, gops, encode_gop, &job);
+   free_thread_pool (pool);
+
+   if (options->frame_index)
+      index = alloc_frame_index (wi->frames);
+
+   /*
+    *  Append the streams of the groups
+    */
+   for (gop = 0; gop < gops; gop++)
+   {
+      unsigned start = bits_processed (output);
+      int      shift = append_gop (output, job.stream [gop], job.bits [gop]);
+
+      if (index)
+      {
+	 frame_index_t *group = job.index [gop];
+	 unsigned	n;
+
+	 for (n = 0; n < group->frames; n++, index->frames++)
+	 {
+	    index->offset [index->frames]
+	       = start + group->offset [n] + (n ? shift : 0);
+	    index->type [index->frames]   = group->type [n];
+	    index->number [index->frames] = group->number [n];
+	 }
+	 free_frame_index (group);
+      }
+      fclose (job.stream [gop]);
    }
 
-   if (reconst)
-      free_image (reconst);
-   if (c->mt->future)
-      free_image (c->mt->future);
-   if (c->mt->past)
-      free_image (c->mt->past);
-   if (c->mt->original)
-      free_image (c->mt->original);
+   if (index)
+   {
+      write_frame_index (index, output);
+      free_frame_index (index);
+   }
+   fiasco_free (job.stream);
+   fiasco_free (job.bits);
+   fiasco_free (job.index);
+}
+
+static void
+encode_gop (void *data, unsigned task)
+/*
+ *  Encode group of pictures 'task' of the video 'data' to a temporary
+ *  file.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the temporary file, its number of bits (without the padding of
+ *	the last byte) and the frame index of the group are stored in
+ *	'data'->stream ['task'], 'data'->bits ['task'] and
+ *	'data'->index ['task']
+ */
+{
+   gop_job_t *job = (gop_job_t *) data;
+   wfa_t     *wfa = alloc_wfa (YES);
+   coding_t  *c;
+   bitfile_t *output;
+
+   wfa->wfainfo->frames = job->wi->frames;
+   wfa->wfainfo->width  = job->wi->width;
+   wfa->wfainfo->height = job->wi->height;
+   wfa->wfainfo->color  = job->wi->color;
+
+   c = alloc_coder (job->options, wfa->wfainfo);
+   read_basis (job->options->basis_name, wfa);
+   append_basis_states (wfa->basis_states, wfa, c);
+   c->price = 128 * 64 / job->quality;
+
+   if (!(job->stream [task] = tmpfile ()))
+      error ("Can't create temporary file.\n%s", get_system_error ());
+   output = attach_bitfile (job->stream [task], "(group)", WRITE_ACCESS);
+
+   video_coder (job->template, output, wfa, c,
+		job->first [task], job->first [task + 1]);
+
+   job->bits [task] = bits_processed (output);
+   detach_bitfile (output);
+   job->index [task] = c->index;
+   c->index	     = NULL;
+   free_coder (c);
+   free_wfa (wfa);
+}
+
+static int
+append_gop (bitfile_t *output, FILE *stream, unsigned bits)
+/*
+ *  Append the first 'bits' bits of the group of pictures 'stream' to
+ *  'output'. The group has been encoded starting at bit 0 of 'stream',
+ *  but its frames don't start at byte boundaries of 'output'. The
+ *  header of the first frame is padded to the next byte boundary (see
+ *  write_next_wfa ()), hence this padding is recomputed for the
+ *  position of the group in 'output'. All following parts of the
+ *  group are aligned relative to the end of this padding.
+ *
+ *  Return value:
+ *	number of bits the group is moved behind the first frame header
+ */
+{
+   bitfile_t *input;			/* coded stream of the group */
+   unsigned   header;			/* bits of first frame header */
+   unsigned   old_padding, new_padding;	/* alignment of first frame header */
+
+   rewind (stream);
+   input = attach_bitfile (stream, "(group)", READ_ACCESS);
+
+   if (bits_processed (output) % 8 == 0) /* first group: same alignment */
+   {
+      copy_bits (output, input, bits);
+      detach_bitfile (input);
+      return 0;
+   }
+
+   {
+      const unsigned rice_k = 8;	/* parameter of Rice Code */
+
+      read_rice_code (rice_k, input);	/* number of states */
+      read_rice_code (rice_k, input);	/* frame type */
+      read_rice_code (rice_k, input);	/* frame number */
+   }
+   header      = bits_processed (input);
+   old_padding = (8 - header % 8) % 8;
+   new_padding = (8 - (bits_processed (output) + header) % 8) % 8;
+
+   seek_bitfile (input, 0);
+   copy_bits (output, input, header);
+   get_bits (input, old_padding);
+   put_bits (output, 0, new_padding);
+   copy_bits (output, input, bits - header - old_padding);
+   detach_bitfile (input);
+
+   return (int) new_padding - (int) old_padding;
+}
+
+static void
+copy_bits (bitfile_t *output, bitfile_t *input, unsigned bits)
+/*
+ *  Copy the next 'bits' bits of stream 'input' to stream 'output'.
+ *
+ *  No return value.
+ */
+{
+   for (; bits >= 32; bits -= 32)
+      put_bits (output, get_bits (input, 32), 32);
+   if (bits)
+      put_bits (output, get_bits (input, bits), bits);
+}
+
+static cfiasco_t *
+cast_cfiasco (fiasco_encoder_t *encoder)
+/*
+ *  Cast pointer `encoder' to type cfiasco_t.
+ *  Check whether `encoder' is a valid object of type cfiasco_t.
+ *
+ *  Return value:
+ *	pointer to cfiasco_t struct on success
+ *      NULL otherwise
+ */
+{
+   cfiasco_t *this;
+
+   if (!encoder)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "encoder");
+      return NULL;
+   }
+   this = (cfiasco_t *) encoder->private;
+   if (this)
+   {
+      if (!streq (this->id, "CFIASCO"))
+      {
+	 set_error (_("Parameter `encoder' doesn't match required type."));
+	 return NULL;
+      }
+   }
+   else
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "encoder");
+   }
+
+   return this;
 }
 
 static frame_type_e
@@ -704,6 +1665,7 @@ frame_coder (wfa_t *wfa, coding_t *c, bitfile_t *output)
    range_t  range;			/* first range == the entire image */
    real_t   costs;			/* total costs (minimized quantity) */
    unsigned bits;			/* number of bits written on disk */
+   unsigned lc_min_level = c->options.lc_min_level; /* of luminance */
    clock_t  ptimer;
    
    prg_timer (&ptimer, START);
@@ -735,6 +1697,9 @@ frame_coder (wfa_t *wfa, coding_t *c, bitfile_t *output)
 				   c->options.lc_min_level,
 				   c->options.lc_max_level);
 
+   if (c->mt->frame_type != I_FRAME)
+      prepare_motion_search (c->mt, wfa->wfainfo);
+
    if (!c->mt->original->color)		/* grayscale image */
    {
       memset (&range, 0, sizeof (range_t));
@@ -846,6 +1811,12 @@ frame_coder (wfa_t *wfa, coding_t *c, bitfile_t *output)
 		    wfa->wfainfo->level + 2, wfa, c);
 
       wfa->root_state = wfa->states - 1;
+      /*
+       *  The chroma level limit is valid for this frame only: otherwise
+       *  the luminance of the next frame would depend on the chroma
+       *  bands of the previous frame of the group of pictures.
+       */
+      c->options.lc_min_level = lc_min_level;
    }
 
    for (state = wfa->basis_states; state < MAXSTATES; state++)
@@ -854,7 +1825,7 @@ frame_coder (wfa_t *wfa, coding_t *c, bitfile_t *output)
       
       if (c->images_of_state [state])
       {
-	 fiasco_free (c->images_of_state [state]);
+	 free_state_image (c->images_of_state [state]);
 	 c->images_of_state [state] = NULL;
       }
       if (c->ip_images_state [state])
@@ -19,6 +19,12 @@
 
 #include "types.h"
 #include "cwfa.h"
+#include "image.h"
+#include "bit-io.h"
+
+void
+image_coder (image_t *image, bitfile_t *output, float quality,
+	     const c_options_t *options);
 
 #endif /* not _CODER_H */
 
@@ -26,6 +26,7 @@
 #include "ip.h"
 #include "misc.h"
 #include "wfalib.h"
+#include "vector.h"
 #include "control.h"
 
 /*****************************************************************************
@@ -38,6 +39,8 @@ static void
 clear_or_alloc (real_t **ptr, size_t size);
 static void 
 compute_images (unsigned from, unsigned to, const wfa_t *wfa, coding_t *c);
+static void 
+clear_or_alloc_state_image (real_t **ptr, const coding_t *c);
 
 /*****************************************************************************
 
@@ -73,8 +76,7 @@ append_state (bool_t auxiliary_state, real_t final, unsigned level_of_state,
       /*
        *  Allocate memory for inner products and for state images
        */
-      clear_or_alloc (&c->images_of_state [wfa->states],
-		      size_of_tree (c->options.images_level));
+      clear_or_alloc_state_image (&c->images_of_state [wfa->states], c);
 	 
       for (level = c->options.images_level + 1;
 	   level <= c->options.lc_max_level; level++)
@@ -109,7 +111,7 @@ append_state (bool_t auxiliary_state, real_t final, unsigned level_of_state,
        */
       if (c->images_of_state [wfa->states] != NULL)
       {
-	 fiasco_free (c->images_of_state [wfa->states]);
+	 free_state_image (c->images_of_state [wfa->states]);
 	 c->images_of_state [wfa->states] = NULL;
       }
       for (level = 0; level <= c->options.lc_max_level; level++)
@@ -150,8 +152,7 @@ append_basis_states (unsigned basis_states, wfa_t *wfa, coding_t *c)
 
    for (state = 0; state < basis_states; state++)
    {
-      clear_or_alloc (&c->images_of_state [state],
-		      size_of_tree (c->options.images_level));
+      clear_or_alloc_state_image (&c->images_of_state [state], c);
 
       for (level = c->options.images_level + 1;
 	   level <= c->options.lc_max_level; level++)
@@ -196,6 +197,36 @@ append_transitions (unsigned state, unsigned label, const real_t *weight,
    }
 }
 
+real_t *
+alloc_state_image (const coding_t *c)
+/*
+ *  Allocate memory for the image of a state at the levels
+ *  0, ... ,'c->options.images_level'.
+ *  The memory block is padded by one element such that the subimage of
+ *  each level >= 4 starts at an aligned address, i.e., at
+ *  image + address_of_level (level) = block + size_of_level (level).
+ *
+ *  Return value:
+ *	pointer to the cleared state image
+ */
+{
+   unsigned  size  = size_of_tree (c->options.images_level) + 1;
+   real_t   *block = fiasco_aligned_calloc (size, sizeof (real_t));
+
+   return block + 1;
+}
+
+void
+free_state_image (real_t *image)
+/*
+ *  Free state 'image' allocated with alloc_state_image ().
+ *
+ *  No return value.
+ */
+{
+   fiasco_aligned_free (image - 1);
+}
+
 /*****************************************************************************
 
 				private code
@@ -242,7 +273,6 @@ compute_images (unsigned from, unsigned to, const wfa_t *wfa, coding_t *c)
 	    for (edge = 0; isedge (domain = wfa->into[state][label][edge]);
 		 edge++)
 	    {
-	       unsigned n;
 	       real_t 	weight = wfa->weight [state][label][edge];
 	       
 	       dst = c->images_of_state [state] + address_of_level (level) +
@@ -250,13 +280,26 @@ compute_images (unsigned from, unsigned to, const wfa_t *wfa, coding_t *c)
 	       src = c->images_of_state [domain]
 		     + address_of_level (level - 1);
 		  
-	       for (n = size_of_level (level - 1); n; n--)
-		  *dst++ += *src++ * weight;
+	       add_scaled_vector (dst, src, weight, size_of_level (level - 1));
 	    }
 	 }
 
 }
 
+static void 
+clear_or_alloc_state_image (real_t **ptr, const coding_t *c)
+/*
+ *  if *ptr == NULL 	allocate memory with alloc_state_image
+ *  otherwise 		fill the state image *ptr with 0
+ */
+{
+   if (*ptr == NULL) 
+      *ptr = alloc_state_image (c);
+   else 
+      memset (*ptr, 0, size_of_tree (c->options.images_level)
+	      * sizeof (real_t));
+}
+
 static void 
 clear_or_alloc (real_t **ptr, size_t size)
 /*
@@ -28,6 +28,10 @@ append_basis_states (unsigned basis_states, wfa_t *wfa, coding_t *c);
 void    
 append_state (bool_t auxiliary_state, real_t final, unsigned level_of_state,
 	      wfa_t *wfa, coding_t *c);
+real_t *
+alloc_state_image (const coding_t *c);
+void
+free_state_image (real_t *image);
 
 #endif /* not _CONTROL_H */
 
@@ -27,6 +27,7 @@
 #include "list.h"
 #include "wfalib.h"
 #include "options.h"
+#include "thread-pool.h"
 
 extern const real_t MAXCOSTS;
 
@@ -41,6 +42,14 @@ typedef struct motion
    real_t        *ybits;		/* # bits for mv y-component */
    real_t       **mc_forward_norms; 	/* norms of mcpe */
    real_t       **mc_backward_norms; 	/* norms of mcpe */
+   fiasco_mv_search_e search;		/* motion vector search strategy */
+   image_t	 *original_half;	/* subsampled images of pyramid */
+   image_t	 *past_half;		/* search, NULL otherwise */
+   image_t	 *future_half;
+   int		  forward_mv [MAXLEVEL][2]; /* last forward mv of each level */
+   int		  backward_mv [MAXLEVEL][2]; /* last backward mv of each level */
+   word_t	 *past_plane [4];	/* full and half pixel samples */
+   word_t	 *future_plane [4];	/* of the reference frames */
 } motion_t;
 
 typedef struct range
@@ -74,6 +83,39 @@ typedef struct range
    bool_t   prediction;			/* range is predicted? */
 } range_t;
 
+typedef struct mp_candidate
+/*
+ *  Rating of domain j as next vector o_n of the linear combination
+ */
+{
+   real_t estimate;			/* estimated costs */
+   bool_t evaluated;			/* are the fields below valid? */
+   real_t costs;			/* approximation costs */
+   real_t matrix_bits;			/* rate of the matrix row */
+   real_t weights_bits;			/* rate of the weights */
+   real_t err;				/* approximation error */
+   real_t weight [MAXEDGES];		/* quantized weights c_0, ..., c_n */
+} mp_candidate_t;
+
+typedef struct mp_workspace
+/*
+ *  Scratch arrays of the matching pursuit algorithm (see approx.c):
+ *  o_i denotes the i-th vector of the orthogonal basis (OB), b the
+ *  current range and s_j the image of domain j. Every coder owns a
+ *  private workspace, hence several coders may run at the same time.
+ */
+{
+   real_t norm_ortho_vector [MAXEDGES];	/* ||o_i||^2 */
+   real_t ip_image_ortho_vector [MAXEDGES]; /* <b, o_i> */
+   real_t ip_domain_ortho_vector [MAXSTATES][MAXEDGES]; /* <s_j, o_i> */
+   real_t rem_denominator [MAXSTATES];	/* constant parts of the comparitive
+					   value <b, o_n>^2 / ||o_n||^2 */
+   real_t rem_numerator [MAXSTATES];	/* of every domain at step n */
+   bool_t used [MAXSTATES];		/* domain already used in the
+					   linear combination? */
+   mp_candidate_t candidate [MAXSTATES]; /* rating of every domain */
+} mp_workspace_t;
+
 typedef struct coding
 /*
  *  All parameters and variables that must be accessible through the coding
@@ -100,6 +142,10 @@ typedef struct coding
    coeff_t   	  *d_coeff;
    domain_pool_t  *domain_pool;
    domain_pool_t  *d_domain_pool;
+   mp_workspace_t *workspace;		/* matching pursuit scratch arrays */
+   thread_pool_t  *pool;		/* threads of the domain search */
+   unsigned	   percent;		/* status of progress meter */
+   frame_index_t  *index;		/* positions of the frames or NULL */
    c_options_t     options;		/* global options */
 } coding_t;
 
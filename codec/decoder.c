@@ -29,8 +29,34 @@
 #include "motion.h"
 #include "read.h"
 #include "wfalib.h"
+#include "thread-pool.h"
+#include "vector.h"
 #include "decoder.h"
 
+/*****************************************************************************
+
+				local variables
+  
+*****************************************************************************/
+
+/*
+ *  A level of state images is split into at most TASKS_PER_THREAD tasks
+ *  per thread, each task computes at least MIN_PIXELS_PER_TASK pixels.
+ */
+#define TASKS_PER_THREAD    4
+#define MIN_PIXELS_PER_TASK 4096
+
+typedef struct simg_job
+{
+   word_t	  **simg;		/* state images */
+   const u_word_t  *offset;		/* offsets of state images */
+   const wfa_t	   *wfa;
+   unsigned	    level;		/* current level */
+   unsigned	   *state;		/* states to compute at 'level' */
+   unsigned	    states;		/* number of states in 'state'[] */
+   unsigned	    tasks;		/* number of tasks */
+} simg_job_t;
+
 /*****************************************************************************
 
 				prototypes
@@ -39,15 +65,36 @@
 
 static void
 compute_state_images (unsigned frame_level, word_t **simg,
-		      const u_word_t *offset, const wfa_t *wfa);
+		      const u_word_t *offset, const wfa_t *wfa,
+		      thread_pool_t *pool);
+static void
+compute_state_images_task (void *data, unsigned task);
+static void
+compute_state_image (unsigned state, unsigned level, word_t **simg,
+		     const u_word_t *offset, const wfa_t *wfa);
 static void
 free_state_images (unsigned max_level, bool_t color, word_t **state_image,
 		   u_word_t *offset, const unsigned *root_state,
-		   unsigned range_state, format_e format, const wfa_t *wfa);
+		   unsigned range_state, format_e format, const wfa_t *wfa,
+		   simg_arena_t *arena);
 static void
 alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 		    const unsigned *root_state, unsigned range_state,
-		    unsigned max_level, format_e format, const wfa_t *wfa);
+		    unsigned max_level, format_e format, const wfa_t *wfa,
+		    simg_arena_t *arena);
+static word_t *
+alloc_simg (simg_arena_t *arena, size_t pixels, bool_t clear);
+static void
+free_simg (simg_arena_t *arena, word_t *simg);
+static void
+reset_arena (simg_arena_t *arena);
+static image_t *
+alloc_frame (video_t *video, unsigned width, unsigned height, bool_t color,
+	     format_e format, bool_t clear);
+static image_t *
+clone_frame (video_t *video, image_t *image);
+static void
+release_frame (video_t *video, image_t *frame);
 static void
 compute_actual_size (unsigned luminance_root,
 		     unsigned *width, unsigned *height, const wfa_t *wfa);
@@ -81,15 +128,23 @@ alloc_video (bool_t store_wfa)
 
    video->future = video->sfuture = video->past
 		 = video->frame   = video->sframe = NULL;
+   video->pool   = NULL;
+   video->pipeline = NULL;
+
+   video->n_spare       = 0;
+   video->arena.buffer  = NULL;
+   video->arena.size    = video->arena.used = video->arena.needed = 0;
 
    if (store_wfa)
    {
       video->wfa        = alloc_wfa (NO);
       video->wfa_past   = alloc_wfa (NO);
       video->wfa_future = alloc_wfa (NO);
+      video->wfa_last   = alloc_wfa (NO);
    }
    else
-      video->wfa = video->wfa_past = video->wfa_future = NULL;
+      video->wfa = video->wfa_past = video->wfa_future
+		 = video->wfa_last = NULL;
 
    return video;
 }
@@ -106,6 +161,8 @@ free_video (video_t *video)
  *	'video' struct is discarded.
  */
 {
+   if (video->pipeline)
+      free_pipeline (video->pipeline);
    if (video->past)
       free_image (video->past);
    if (video->future)
@@ -116,12 +173,17 @@ free_video (video_t *video)
       free_image (video->frame);
    if (video->sframe)
       free_image (video->sframe);
-   if (video->wfa)
+   if (video->wfa_past)		/* WFAs allocated by alloc_video () */
+   {
       free_wfa (video->wfa);
-   if (video->wfa_past)
       free_wfa (video->wfa_past);
-   if (video->wfa_future)
       free_wfa (video->wfa_future);
+      free_wfa (video->wfa_last);
+   }
+   while (video->n_spare)
+      free_image (video->spare [--video->n_spare]);
+   if (video->arena.buffer)
+      fiasco_aligned_free (video->arena.buffer);
 
    fiasco_free (video);
 }
@@ -142,6 +204,12 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
  *  from disk.
  *  'format' gives the color format to be used (either 4:2:0 or 4:4:4).
  *  If 'timer' is not NULL, then accumulate running time statistics. 
+ *  If 'video->pipeline' is not NULL, then the WFA of each frame is taken
+ *  from the pipeline instead of reading it from 'input' (requires that
+ *  'store_wfa' is FALSE).
+ *  If the end marker of a stream with an unknown number of frames is
+ *  read then the number of frames is stored in 'orig_wfa' and an
+ *  error is raised.
  *
  *  Return value:
  *	pointer to decoded frame
@@ -161,12 +229,12 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
        *  as reference frame. So just return the stored frame.
        */
       if (video->frame) /* discard current frame */
-	 free_image (video->frame);
+	 release_frame (video, video->frame);
       video->frame  = video->future;
       video->future = NULL;
 
       if (video->sframe) /* discard current (smoothed) frame */
-	 free_image (video->sframe);
+	 release_frame (video, video->sframe);
       video->sframe  = video->sfuture;
       video->sfuture = NULL;
 
@@ -191,7 +259,7 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	    video->wfa = orig_wfa;
 	 else
 	 {
-	    tmp_wfa = alloc_wfa (NO);
+	    tmp_wfa = video->wfa_last;
 	    copy_wfa (tmp_wfa, video->wfa);
 	    copy_wfa (video->wfa, orig_wfa);
 	 }
@@ -200,7 +268,15 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	  *  First step: read WFA from disk
 	  */
 	 prg_timer (&ptimer, START);
-	 frame_number = read_next_wfa (video->wfa, input);
+	 if (video->pipeline)
+	    video->wfa = pipeline_get_wfa (video->pipeline, &frame_number);
+	 else
+	    frame_number = read_next_wfa (video->wfa, input);
+	 if (!video->wfa->states)	/* end marker of open ended stream */
+	 {
+	    orig_wfa->wfainfo->frames = video->display;
+	    error ("FIASCO stream contains no more frames.");
+	 }
 	 stop_timer [0] = prg_timer (&ptimer, STOP);
 	 if (timer)
 	 {
@@ -229,37 +305,37 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	 if (video->wfa->frame_type == I_FRAME)
 	 {
 	    if (video->past)		/* discard past frame */
-	       free_image (video->past);
+	       release_frame (video, video->past);
 	    video->past = NULL;
 	    if (video->future)		/* discard future frame */
-	       free_image (video->future);
+	       release_frame (video, video->future);
 	    video->future = NULL;
 	    if (video->sfuture)		/* discard (smoothed) future frame */
-	       free_image (video->sfuture);
+	       release_frame (video, video->sfuture);
 	    video->sfuture = NULL;
 	    if (video->frame)		/* discard current frame */
-	       free_image (video->frame);
+	       release_frame (video, video->frame);
 	    video->frame = NULL;
 	    if (video->sframe)		/* discard current (smoothed) frame */
-	       free_image (video->sframe);
+	       release_frame (video, video->sframe);
 	    video->sframe = NULL;
 	 }
 	 else if (video->wfa->frame_type == P_FRAME)
 	 {
 	    if (video->past)		/* discard past frame */
-	       free_image (video->past);
+	       release_frame (video, video->past);
 	    video->past = video->frame;	/* past <- current frame */
 	    video->frame = NULL;
 	    if (video->sframe)		/* discard current (smoothed) frame */
-	       free_image (video->sframe);
+	       release_frame (video, video->sframe);
 	    video->sframe = NULL;
 	    if (store_wfa)
 	       copy_wfa (video->wfa_past, tmp_wfa);
 	    if (video->future)		/* discard future frame */
-	       free_image (video->future);
+	       release_frame (video, video->future);
 	    video->future = NULL;
 	    if (video->sfuture)		/* discard (smoothed) future frame */
-	       free_image (video->sfuture);
+	       release_frame (video, video->sfuture);
 	    video->sfuture = NULL;
 	 }
 	 else				/* B_FRAME */
@@ -267,18 +343,18 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	    if (current_frame_is_future_frame)
 	    {
 	       if (video->future)	/* discard future frame */
-		  free_image (video->future);
+		  release_frame (video, video->future);
 	       video->future = frame;	/* future <- current frame */
 	       if (video->sfuture)	/* discard (smoothed) future frame */
-		  free_image (video->sfuture);
+		  release_frame (video, video->sfuture);
 	       video->sfuture = sframe;	/* future <- current (smoothed) */
 	       if (store_wfa)
 		  copy_wfa (video->wfa_future, tmp_wfa);
 	       if (video->frame)	/* discard current frame */
-		  free_image (video->frame);
+		  release_frame (video, video->frame);
 	       video->frame = NULL;
 	       if (video->sframe)	/* discard current (smoothed) frame */
-		  free_image (video->sframe);
+		  release_frame (video, video->sframe);
 	       video->sframe = NULL;
 	       frame  = NULL;
 	       sframe = NULL;
@@ -288,11 +364,11 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	       if (video->wfa->wfainfo->B_as_past_ref == YES)
 	       {
 		  if (video->past)	/* discard past frame */
-		     free_image (video->past);
+		     release_frame (video, video->past);
 		  video->past  = video->frame; /* past <- current frame */
 		  video->frame = NULL;
 		  if (video->sframe)	/* discard current (smoothed) frame */
-		     free_image (video->sframe);
+		     release_frame (video, video->sframe);
 		  video->sframe = NULL;
 		  if (store_wfa)
 		     copy_wfa (video->wfa_past, tmp_wfa);
@@ -300,17 +376,14 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	       else
 	       {
 		  if (video->frame)	/* discard current */
-		     free_image (video->frame);
+		     release_frame (video, video->frame);
 		  video->frame = NULL;
 		  if (video->sframe)	/* discard current (smoothed) frame */
-		     free_image (video->sframe);
+		     release_frame (video, video->sframe);
 		  video->sframe = NULL;
 	       }
 	    }
 	 }
-	 if (tmp_wfa)
-	    free_wfa (tmp_wfa);
-	 
 	 current_frame_is_future_frame = NO;
 	 /*
 	  *  Second step: decode image
@@ -341,9 +414,15 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 		  orig_height++;
 	    }
 	 
+	    if (!video->arena.buffer)	/* initial size of state images */
+	    {
+	       video->arena.needed = orig_width * orig_height
+				     * (video->wfa->wfainfo->color ? 3 : 1);
+	       reset_arena (&video->arena);
+	    }
 	    frame = decode_image (orig_width, orig_height, format,
 				  timer != NULL ? stop_timer : NULL,
-				  video->wfa);
+				  video->wfa, video->pool, video);
 	    if (timer)
 	    {
 	       timer->preprocessing [video->wfa->frame_type] += stop_timer [0];
@@ -373,7 +452,7 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	    smoothing = video->wfa->wfainfo->smoothing;
 	 if (smoothing > 0 && smoothing <= 100)
 	 {
-	    sframe = clone_image (frame);
+	    sframe = clone_frame (video, frame);
 	    smooth_image (smoothing, video->wfa, sframe);
 	 }
 	 else
@@ -397,7 +476,9 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 	    current_frame_is_future_frame = YES;
 	 }
       
-	 if (!store_wfa)
+	 if (video->pipeline)
+	    pipeline_put_wfa (video->pipeline, video->wfa);
+	 else if (!store_wfa)
 	    remove_states (video->wfa->basis_states, video->wfa);
       } while (!video->frame);
 
@@ -410,12 +491,16 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 
 image_t *
 decode_image (unsigned orig_width, unsigned orig_height, format_e format,
-	      unsigned *dec_timer, const wfa_t *wfa)
+	      unsigned *dec_timer, const wfa_t *wfa, thread_pool_t *pool,
+	      video_t *video)
 /*
  *  Compute image which is represented by the given 'wfa'.
  *  'orig_width'x'orig_height' gives the resolution of the image at
  *  coding time. Use 4:2:0 subsampling or 4:4:4 'format' for color images.
  *  If 'dec_timer' is given, accumulate running time statistics. 
+ *  The state images are computed by the threads of 'pool' (may be NULL).
+ *  If 'video' is not NULL then the frame buffer and the memory of the
+ *  state images are taken from the buffers of 'video'.
  *  
  *  Return value:
  *	pointer to decoded image
@@ -464,7 +549,8 @@ decode_image (unsigned orig_width, unsigned orig_height, format_e format,
 			&width, &height, wfa);
    width  = max (width, orig_width);
    height = max (height, orig_height);
-   frame = alloc_image (width, height, wfa->wfainfo->color, format);
+   frame = alloc_frame (video, width, height, wfa->wfainfo->color, format,
+			YES);
    
    /*
     *  Allocate buffers for intermediate state images
@@ -476,7 +562,7 @@ decode_image (unsigned orig_width, unsigned orig_height, format_e format,
       wfa->level_of_state [wfa->tree[wfa->root_state][1]] = 128;
    }
    alloc_state_images (&images, &offsets, frame, root_state, 0, max_level, 
-		       format, wfa);
+		       format, wfa, video ? &video->arena : NULL);
 
    if (dec_timer)
       dec_timer [0] += prg_timer (&ptimer, STOP);
@@ -485,7 +571,7 @@ decode_image (unsigned orig_width, unsigned orig_height, format_e format,
     *  Decode all state images, forming the complete image.
     */
    prg_timer (&ptimer, START);
-   compute_state_images (max_level, images, offsets, wfa);
+   compute_state_images (max_level, images, offsets, wfa, pool);
    if (dec_timer)
       dec_timer [1] += prg_timer (&ptimer, STOP);
 
@@ -494,7 +580,7 @@ decode_image (unsigned orig_width, unsigned orig_height, format_e format,
     */
    prg_timer (&ptimer, START);
    free_state_images (max_level, frame->color, images, offsets, root_state, 0,
-		      format, wfa);
+		      format, wfa, video ? &video->arena : NULL);
    
    /*
     *  Crop decoded image if the image size differs.
@@ -615,8 +701,8 @@ decode_range (unsigned range_state, unsigned range_label, unsigned range_level,
 				 height_of_level (range_level + 1),
 				 NO, FORMAT_4_4_4);
    alloc_state_images (&images, &offsets, state_image, NULL, range_state,
-		       range_level + 1, NO, wfa);
-   compute_state_images (range_level + 1, images, offsets, wfa);
+		       range_level + 1, NO, wfa, NULL);
+   compute_state_images (range_level + 1, images, offsets, wfa, NULL);
 
    range = fiasco_calloc (size_of_level (range_level), sizeof (word_t));
 
@@ -665,7 +751,7 @@ decode_range (unsigned range_state, unsigned range_label, unsigned range_level,
    }
    
    free_state_images (range_level + 1, NO, images, offsets, NULL, range_state,
-		      NO, wfa);
+		      NO, wfa, NULL);
    free_image (state_image);
    
    return range;
@@ -877,13 +963,17 @@ compute_actual_size (unsigned luminance_root,
 static void
 alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 		    const unsigned *root_state, unsigned range_state,
-		    unsigned max_level, format_e format, const wfa_t *wfa)
+		    unsigned max_level, format_e format, const wfa_t *wfa,
+		    simg_arena_t *arena)
 /*
  *  Generate list of 'wfa' state images which have to be computed for
  *  each level to obtain the decoded 'frame'. 'root_state[]' denotes the
  *  state images of the three color bands.
  *  'max_level' fives the max. level of a linear combination.
- *  Memory is allocated for every required state image.
+ *  Memory is allocated for every required state image, either from
+ *  the given 'arena' or - if 'arena' is NULL - with fiasco_calloc ().
+ *  Arena memory is cleared only if the state image is not completely
+ *  overwritten by compute_state_images ().
  *  Use 4:2:0 subsampling or 4:4:4 'format' for color images.
  *  If 'range_state' > 0 then rather compute image of 'range_state' than 
  *  image of 'wfa->root_state'.
@@ -898,11 +988,37 @@ alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 {
    word_t   **simg;			/* ptr to list of state image ptr's */
    u_word_t  *offs;			/* ptr to list of offsets */
+   bool_t    *covered;			/* image is completely computed */
    unsigned   level;			/* counter */
    
    simg	= fiasco_calloc (wfa->states * (max_level + 1), sizeof (word_t *));
    offs	= fiasco_calloc (wfa->states * (max_level + 1), sizeof (u_word_t));
 
+   /*
+    *  A state image is completely computed if each of its labels is
+    *  approximated by a linear combination or given by a completely
+    *  computed child. Children always have smaller state numbers.
+    */
+   covered = fiasco_calloc (wfa->states, sizeof (bool_t));
+   if (arena)
+   {
+      unsigned state, label;
+      
+      for (state = 1; state < wfa->states; state++)
+      {
+	 covered [state] = YES;
+	 for (label = 0; label < MAXLABELS; label++)
+	 {
+	    int child = wfa->tree [state][label];
+	    
+	    if (!isedge (wfa->into [state][label][0])
+		&& !(ischild (child) && child < (int) state
+		     && covered [child]))
+	       covered [state] = NO;
+	 }
+      }
+   }
+
    /*
     *  Initialize buffers for those state images which are at 'max_level'.
     */
@@ -961,7 +1077,8 @@ alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 		      *  Allocate new image block.
 		      */
 		     simg [child + (level - 1) * wfa->states]
-			= fiasco_calloc (size_of_level (level - 1), sizeof (word_t));
+			= alloc_simg (arena, size_of_level (level - 1),
+				      !covered [child]);
 		     offs [child + (level - 1) * wfa->states]
 			= width_of_level (level - 1);
 		  }
@@ -1002,7 +1119,8 @@ alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 		      && !simg [domain + (level - 1) * wfa->states])
 		  {
 		     simg [domain + (level - 1) * wfa->states]
-			= fiasco_calloc (size_of_level (level - 1), sizeof (word_t));
+			= alloc_simg (arena, size_of_level (level - 1),
+				      !covered [domain]);
 		     offs [domain + (level - 1) * wfa->states]
 			= width_of_level (level - 1);
 		  }
@@ -1010,6 +1128,8 @@ alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
       
    }
 
+   fiasco_free (covered);
+
    *images  = simg;
    *offsets = offs;
 }
@@ -1017,7 +1137,8 @@ alloc_state_images (word_t ***images, u_word_t **offsets, const image_t *frame,
 static void
 free_state_images (unsigned max_level, bool_t color, word_t **state_image,
 		   u_word_t *offset, const unsigned *root_state,
-		   unsigned range_state, format_e format, const wfa_t *wfa)
+		   unsigned range_state, format_e format, const wfa_t *wfa,
+		   simg_arena_t *arena)
 /*
  *  Free memory of state images.
  *  For more details refer to the inverse function 'alloc_state_images()'.
@@ -1025,7 +1146,8 @@ free_state_images (unsigned max_level, bool_t color, word_t **state_image,
  *  No return value.
  *
  *  Side effects:
- *	arrays 'state_image' and 'offset' are discarded.
+ *	arrays 'state_image' and 'offset' are discarded,
+ *	the memory of the 'arena' is recycled.
  */
 {
    word_t   marker;			/* ptr is required as a marker */
@@ -1075,7 +1197,8 @@ free_state_images (unsigned max_level, bool_t color, word_t **state_image,
 		  if (isedge (wfa->into[state][label][0])
 		      && (state_image [child + (level - 1) * wfa->states]
 			  != &marker))
-		     fiasco_free (state_image [child + (level - 1) * wfa->states]);
+		     free_simg (arena, state_image [child + (level - 1)
+						    * wfa->states]);
 		  state_image [child + (level - 1) * wfa->states] = &marker;
 	       }
       /*
@@ -1094,25 +1217,187 @@ free_state_images (unsigned max_level, bool_t color, word_t **state_image,
 		      && (state_image [domain + (level - 1) * wfa->states]
 			  != &marker))
 		  {
-		     fiasco_free (state_image [domain + (level - 1) * wfa->states]);
+		     free_simg (arena, state_image [domain + (level - 1)
+						    * wfa->states]);
 		     state_image [domain + (level - 1) * wfa->states]
 			= &marker;
 		  }
    }
    fiasco_free (state_image);
    fiasco_free (offset);
+   if (arena)
+      reset_arena (arena);
+}
+
+static word_t *
+alloc_simg (simg_arena_t *arena, size_t pixels, bool_t clear)
+/*
+ *  Allocate memory for a state image of #'pixels' pixels. The memory is
+ *  taken from the 'arena' and cleared if 'clear' is TRUE. If 'arena' is
+ *  NULL or exhausted then the memory is allocated with fiasco_calloc ().
+ *
+ *  Return value:
+ *	pointer to the state image
+ *
+ *  Side effects:
+ *	the counters of 'arena' are updated
+ */
+{
+   word_t *simg;
+
+   if (!arena)
+      return fiasco_calloc (pixels, sizeof (word_t));
+
+   pixels	  = (pixels + 7) & ~7;	/* keep images aligned */
+   arena->needed += pixels;
+   if (arena->used + pixels > arena->size)
+      return fiasco_calloc (pixels, sizeof (word_t));
+
+   simg		= arena->buffer + arena->used;
+   arena->used += pixels;
+   if (clear)
+      memset (simg, 0, pixels * sizeof (word_t));
+
+   return simg;
+}
+
+static void
+free_simg (simg_arena_t *arena, word_t *simg)
+/*
+ *  Free the state image 'simg' if it has not been taken from the 'arena'.
+ *
+ *  No return value.
+ */
+{
+   if (!arena || simg < arena->buffer || simg >= arena->buffer + arena->size)
+      fiasco_free (simg);
+}
+
+static void
+reset_arena (simg_arena_t *arena)
+/*
+ *  Recycle the memory of the 'arena' for the next frame. If the
+ *  current frame required more memory than available then the
+ *  arena is enlarged.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'arena' is reset, 'arena->buffer' may be reallocated
+ */
+{
+   if (arena->needed > arena->size)
+   {
+      if (arena->buffer)
+	 fiasco_aligned_free (arena->buffer);
+      arena->size   = arena->needed + arena->needed / 4;
+      arena->buffer = fiasco_aligned_calloc (arena->size, sizeof (word_t));
+   }
+   arena->used = arena->needed = 0;
+}
+
+static image_t *
+alloc_frame (video_t *video, unsigned width, unsigned height, bool_t color,
+	     format_e format, bool_t clear)
+/*
+ *  Frame buffer constructor: use one of the unused frame buffers of
+ *  'video' with the given size and 'format' (cleared if 'clear' is
+ *  TRUE). If there is no such buffer (or 'video' is NULL) then allocate
+ *  a new image.
+ *
+ *  Return value:
+ *	pointer to the frame buffer
+ *
+ *  Side effects:
+ *	the frame buffer is removed from the list of unused buffers
+ */
+{
+   unsigned n;
+
+   if (!color)
+      format = FORMAT_4_4_4;
+   
+   for (n = 0; video && n < video->n_spare; n++)
+   {
+      image_t *frame = video->spare [n];
+
+      if (frame->width == width && frame->height == height
+	  && frame->color == color && frame->format == format)
+      {
+	 video->spare [n] = video->spare [--video->n_spare];
+	 if (clear)
+	 {
+	    color_e band;
+	    
+	    for (band  = first_band (color); band <= last_band (color);
+		 band++)
+	       memset (frame->pixels [band], 0,
+		       (format == FORMAT_4_2_0 && band != Y
+			? (width * height) >> 2 : width * height)
+		       * sizeof (word_t));
+	 }
+	 return frame;
+      }
+   }
+
+   return alloc_image (width, height, color, format);
+}
+
+static image_t *
+clone_frame (video_t *video, image_t *image)
+/*
+ *  Copy constructor of frame buffers: like clone_image () but use the
+ *  unused frame buffers of 'video'.
+ *
+ *  Return value:
+ *	pointer to the new frame buffer
+ */
+{
+   image_t *frame = alloc_frame (video, image->width, image->height,
+				 image->color, image->format, NO);
+   color_e  band;
+   
+   for (band = first_band (frame->color); band <= last_band (frame->color);
+	band++)
+      memcpy (frame->pixels [band], image->pixels [band],
+	      (frame->format == FORMAT_4_2_0 && band != Y
+	       ? (frame->width * frame->height) >> 2
+	       : frame->width * frame->height) * sizeof (word_t));
+
+   return frame;
+}
+
+static void
+release_frame (video_t *video, image_t *frame)
+/*
+ *  Frame buffer destructor: if 'frame' is not referenced elsewhere then
+ *  keep it in the list of unused buffers of 'video', otherwise (or if
+ *  the list is full) discard it.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'frame' is stored in 'video->spare' or discarded
+ */
+{
+   if (frame->reference_count == 1 && video->n_spare < MAX_SPARE_FRAMES)
+      video->spare [video->n_spare++] = frame;
+   else
+      free_image (frame);
 }
 
 static void
 compute_state_images (unsigned max_level, word_t **simg,
-		      const u_word_t *offset, const wfa_t *wfa)
+		      const u_word_t *offset, const wfa_t *wfa,
+		      thread_pool_t *pool)
 /*
  *  Compute all state images of the 'wfa' at level {1, ... , 'max_level'}
  *  which are marked in the array 'simg' (offsets of state images
  *  are given by 'offset').
- *
- *  Warning: Several optimizations are used in this function making 
- *  it difficult to understand.
+ *  The images of a level depend only on the images of the previous
+ *  level and are stored in disjoint blocks, hence the states of each
+ *  level (of all color bands) are distributed among the threads of
+ *  'pool'. If 'pool' is NULL then all images are computed sequentially.
  *
  *  No return value.
  *
@@ -1121,7 +1406,8 @@ compute_state_images (unsigned max_level, word_t **simg,
  *	are computed.
  */
 {
-   unsigned level, state;
+   unsigned   level, state;
+   simg_job_t job;
      
    /*
     *  Copy one-pixel images in case state_image pointer != &final distr.
@@ -1131,370 +1417,361 @@ compute_state_images (unsigned max_level, word_t **simg,
       if (simg [state] != NULL)		/* compute image at level 0 */
 	 *simg [state] = (int) (wfa->final_distribution[state] * 8 + .5) * 2;
 
-   /*
-    *  Compute images of states
-    *  Integer arithmetics are used rather than floating point operations.
-    *  'weight' gives the weight in integer notation
-    *  'src', 'dst', and 'idst' are pointers to the source and
-    *  destination pixels (short or integer format), respectively.
-    *  Short format : one operation per register (16 bit mode). 
-    *  Integer format : two operations per register (32 bit mode). 
-    *  'src_offset', 'dst_offset', and 'dst_offset' give the number of
-    *  pixels which have to be omitted when jumping to the next image row.
-    */
+   job.simg   = simg;
+   job.offset = offset;
+   job.wfa    = wfa;
+   job.state  = fiasco_calloc (wfa->states, sizeof (unsigned));
+   
    for (level = 1; level <= max_level; level++) 
    {
-      unsigned label;
-      unsigned width  = width_of_level (level - 1);
-      unsigned height = height_of_level (level - 1);
+      unsigned pixels;			/* number of pixels to compute */
       
+      job.level  = level;
+      job.states = 0;
       for (state = 1; state < wfa->states; state++)
 	 if (simg [state + level * wfa->states] != NULL)
-	    for (label = 0; label < MAXLABELS; label++)
-	       if (isedge (wfa->into [state][label][0]))
-	       {
-		  unsigned  edge;
-		  int       domain;
-		  word_t   *range;	/* address of current range */
-		  bool_t    prediction_used; /* ND prediction found ? */
-
-		  /*
-		   *  Compute address of range image
-		   */
-		  if (level & 1)	/* split vertically */
-		  {
-		     range = simg [state + level * wfa->states]
-			     + label * (height_of_level (level - 1)
-					* offset [state
-						 + level * wfa->states]);
-		  }
-		  else			/* split horizontally */
-		  {
-		     range = simg [state + level * wfa->states]
-			     + label * width_of_level (level - 1);
-		  }
+	    job.state [job.states++] = state;
 
-		  /*
-		   *  Generate the state images by adding the corresponding 
-		   *  weighted state images:
-		   *  subimage [label] =
-		   *       weight_1 * image_1 + ... + weight_n * image_n
-		   */
-		  if (!ischild (domain = wfa->tree[state][label]))
-		     prediction_used = NO;
-		  else
-		  {
-		     unsigned  y;
-		     word_t   *src;
-		     word_t   *dst;
-		     unsigned  src_offset;
-		     unsigned  dst_offset;
+      pixels    = job.states * size_of_level (level);
+      job.tasks = min (min (job.states, pixels / MIN_PIXELS_PER_TASK),
+		       thread_pool_size (pool) * TASKS_PER_THREAD);
+      job.tasks = max (job.tasks, 1);
 
-		     prediction_used = YES;
-		     /*
-		      *  Copy child image
-		      */
-		     src        = simg [domain + (level - 1) * wfa->states];
-		     src_offset = offset [domain + (level - 1) * wfa->states] ;
-		     dst        = range;
-		     dst_offset	= offset [state + level * wfa->states];
-		     for (y = height; y; y--)
-		     {
-			memcpy (dst, src, width * sizeof (word_t));
-			src += src_offset;
-			dst += dst_offset;
-		     }
-		  }
+      run_tasks (pool, job.tasks, compute_state_images_task, &job);
+   }
 
-		  if (!prediction_used
-		      && isedge (domain = wfa->into[state][label][0]))
-		  {
-		     /*
-		      *  If prediction is not used then the range is
-		      *  filled with the first domain. No addition is needed.
-		      */
-		     edge = 0;
-		     if (domain != 0)
-		     {
-			int	  weight;
-			word_t 	 *src;
-			unsigned  src_offset;
-
-			src        = simg [domain + ((level - 1)
-						     * wfa->states)];
-			src_offset = offset [domain + ((level - 1)
-						       * wfa->states)] - width;
-			weight     = wfa->int_weight [state][label][edge];
-			
-			if (width == 1)	/* can't add two-pixels in a row */
-			{
-			   word_t   *dst;
-			   unsigned  dst_offset;
-			   
-			   dst        = range;
-			   dst_offset = offset [state + level * wfa->states]
-					- width;
+   fiasco_free (job.state);
+}
+
+static void
+compute_state_images_task (void *data, unsigned task)
+/*
+ *  Compute the state images of the level given by the job 'data'.
+ *  The list of states is split into contiguous parts, 'task' gives the
+ *  part to compute.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	state images of the states of part 'task' are computed.
+ */
+{
+   const simg_job_t *job  = (const simg_job_t *) data;
+   unsigned	     from = task * job->states / job->tasks;
+   unsigned	     to   = (task + 1) * job->states / job->tasks;
+
+   for (; from < to; from++)
+      compute_state_image (job->state [from], job->level, job->simg,
+			   job->offset, job->wfa);
+}
+
+static void
+compute_state_image (unsigned state, unsigned level, word_t **simg,
+		     const u_word_t *offset, const wfa_t *wfa)
+/*
+ *  Compute the image of 'state' at 'level' from the state images at
+ *  'level' - 1 (see compute_state_images ()).
+ *
+ *  Warning: Several optimizations are used in this function making 
+ *  it difficult to understand.
+ *
+ *  Integer arithmetics are used rather than floating point operations.
+ *  'weight' gives the weight in integer notation
+ *  'src', 'dst', and 'idst' are pointers to the source and
+ *  destination pixels (short or integer format), respectively.
+ *  Weighted state images are added row by row with the
+ *  kernels scale_words () and add_scaled_words ().
+ *  Short format : one operation per register (16 bit mode). 
+ *  Integer format : two operations per register (32 bit mode). 
+ *  'src_offset', 'dst_offset', and 'dst_offset' give the number of
+ *  pixels which have to be omitted when jumping to the next image row.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	image 'simg' ['state' + 'level' * 'wfa->states'] is computed.
+ */
+{
+   unsigned label;
+   unsigned width  = width_of_level (level - 1);
+   unsigned height = height_of_level (level - 1);
+      
+   for (label = 0; label < MAXLABELS; label++)
+      if (isedge (wfa->into [state][label][0]))
+      {
+	 unsigned  edge;
+	 int       domain;
+	 word_t   *range;	/* address of current range */
+	 bool_t    prediction_used; /* ND prediction found ? */
+
+	 /*
+	  *  Compute address of range image
+	  */
+	 if (level & 1)	/* split vertically */
+	 {
+	    range = simg [state + level * wfa->states]
+		    + label * (height_of_level (level - 1)
+			       * offset [state
+					+ level * wfa->states]);
+	 }
+	 else			/* split horizontally */
+	 {
+	    range = simg [state + level * wfa->states]
+		    + label * width_of_level (level - 1);
+	 }
+
+	 /*
+	  *  Generate the state images by adding the corresponding 
+	  *  weighted state images:
+	  *  subimage [label] =
+	  *       weight_1 * image_1 + ... + weight_n * image_n
+	  */
+	 if (!ischild (domain = wfa->tree[state][label]))
+	    prediction_used = NO;
+	 else
+	 {
+	    unsigned  y;
+	    word_t   *src;
+	    word_t   *dst;
+	    unsigned  src_offset;
+	    unsigned  dst_offset;
+
+	    prediction_used = YES;
+	    /*
+	     *  Copy child image
+	     */
+	    src        = simg [domain + (level - 1) * wfa->states];
+	    src_offset = offset [domain + (level - 1) * wfa->states] ;
+	    dst        = range;
+	    dst_offset	= offset [state + level * wfa->states];
+	    for (y = height; y; y--)
+	    {
+	       memcpy (dst, src, width * sizeof (word_t));
+	       src += src_offset;
+	       dst += dst_offset;
+	    }
+	 }
+
+	 if (!prediction_used
+	     && isedge (domain = wfa->into[state][label][0]))
+	 {
+	    /*
+	     *  If prediction is not used then the range is
+	     *  filled with the first domain. No addition is needed.
+	     */
+	    edge = 0;
+	    if (domain != 0)
+	    {
+	       int	  weight;
+	       word_t 	 *src;
+	       unsigned  src_offset;
+
+	       src        = simg [domain + ((level - 1)
+					    * wfa->states)];
+	       src_offset = offset [domain + ((level - 1)
+					      * wfa->states)] - width;
+	       weight     = wfa->int_weight [state][label][edge];
+
+	       if (width == 1)	/* can't add two-pixels in a row */
+	       {
+		  word_t   *dst;
+		  unsigned  dst_offset;
+
+		  dst        = range;
+		  dst_offset = offset [state + level * wfa->states]
+			       - width;
 #ifdef HAVE_SIGNED_SHIFT
-			   *dst++ = ((weight * (int) *src++) >> 10) << 1;
+		  *dst++ = ((weight * (int) *src++) >> 10) << 1;
 #else 					/* not HAVE_SIGNED_SHIFT */
-			   *dst++ = ((weight * (int) *src++) / 1024) * 2;
-#endif /* not HAVE_SIGNED_SHIFT */
-			   if (height == 2) 
-			   {
-			      src += src_offset;
-			      dst += dst_offset;
-#ifdef HAVE_SIGNED_SHIFT
-			      *dst++ = ((weight * (int) *src++) >> 10) << 1;
-#else /* not HAVE_SIGNED_SHIFT */
-			      *dst++ = ((weight * (int) *src++) / 1024) * 2;
+		  *dst++ = ((weight * (int) *src++) / 1024) * 2;
 #endif /* not HAVE_SIGNED_SHIFT */
-			   }
-			}
-			else
-			{
-			   unsigned  y;
-			   int 	    *idst;
-			   unsigned  idst_offset;
-			   
-			   idst        = (int *) range;
-			   idst_offset = (offset [state + level * wfa->states]
-					  - width) / 2;
-			   for (y = height; y; y--)
-			   {
-			      int *comp_dst = idst + (width >> 1);
-			      
-			      for (; idst != comp_dst; )
- 			      {
-				 int tmp; /* temp. value of adjacent pixels */
+		  if (height == 2) 
+		  {
+		     src += src_offset;
+		     dst += dst_offset;
 #ifdef HAVE_SIGNED_SHIFT
-#	ifndef WORDS_BIGENDIAN
-                                 tmp = (((weight * (int) src [1]) >> 10) << 17)
-				       | (((weight * (int) src [0]) >> 9)
-					  & 0xfffe);
-#	else /* not WORDS_BIGENDIAN */
-                                 tmp = (((weight * (int) src [0]) >> 10) << 17)
-				       | (((weight * (int) src [1]) >> 9)
-					  & 0xfffe);
-#	endif /* not WORDS_BIGENDIAN */
+		     *dst++ = ((weight * (int) *src++) >> 10) << 1;
 #else /* not HAVE_SIGNED_SHIFT */
-#	ifndef WORDS_BIGENDIAN
-                                 tmp = (((weight * (int) src [1]) / 1024)
-					* 131072)
-				       | (((weight * (int) src [0])/ 512)
-					  & 0xfffe);
-#	else /* not WORDS_BIGENDIAN */
-                                 tmp = (((weight * (int) src [0]) / 1024)
-					* 131072)
-				       | (((weight * (int) src [1]) / 512)
-					  & 0xfffe);
-#	endif /* not WORDS_BIGENDIAN */
+		     *dst++ = ((weight * (int) *src++) / 1024) * 2;
 #endif /* not HAVE_SIGNED_SHIFT */
-				 src    +=  2;
-				 *idst++ = tmp & 0xfffefffe;
-			      }
-			      src  += src_offset;
-			      idst += idst_offset;
-			   }
-			}
-		     }
-		     else
-		     {
-			int weight = (int) (wfa->weight[state][label][edge]
-					    * wfa->final_distribution[0]
-					    * 8 + .5) * 2;
-			/*
-			 *  Range needs domain 0
-			 *  (the constant function f(x, y) = 1),
-			 *  hence a faster algorithm is used.
-			 */
-			if (width == 1)	/* can't add two-pixels in a row */
-			{
-			   word_t   *dst;
-			   unsigned  dst_offset;
-			   
-			   dst        = range;
-			   dst_offset = offset [state + level * wfa->states]
-					- width;
-			   
-			   *dst++ = weight;
-			   if (height == 2)
-			   {
-			      dst += dst_offset;
-			      *dst++ = weight;
-			   }
-			}
-			else
-			{
-			   unsigned  x, y;
-			   int 	    *idst;
-			   unsigned  idst_offset;
-			   
-			   weight      = (weight * 65536) | (weight & 0xffff);
-			   idst	       = (int *) range;
-			   idst_offset = offset [state + level * wfa->states]
-					 / 2;
-			   for (x = width >> 1; x; x--)
-			      *idst++ = weight & 0xfffefffe;
-			   idst += (offset [state + level * wfa->states]
-				    - width) / 2;
-
-			   for (y = height - 1; y; y--)
-			   {
-			      memcpy (idst, idst - idst_offset,
-				      width * sizeof (word_t));
-			      idst += idst_offset;
-			   }
-			}
-		     }
-		     edge = 1;
 		  }
-		  else
-		     edge = 0;
-		  
-		  /*
-		   *  Add remaining weighted domain images to current range
-		   */
-		  for (; isedge (domain = wfa->into[state][label][edge]);
-		       edge++)
+	       }
+	       else
+	       {
+		  word_t   *dst        = range;
+		  unsigned  dst_offset = offset [state + level * wfa->states];
+		  unsigned  y;
+
+		  for (y = height; y; y--)
 		  {
-		     if (domain != 0)
-		     {
-			word_t 	 *src;
-			unsigned  src_offset;
-			int	  weight;
-
-			src        = simg [domain + (level - 1) * wfa->states];
-			src_offset = offset [domain + ((level - 1)
-						       * wfa->states)] - width;
-			weight     = wfa->int_weight [state][label][edge];
-			
-			if (width == 1)	/* can't add two-pixels in a row */
-			{
-			   word_t   *dst;
-			   unsigned  dst_offset;
-			   
-			   dst        = range;
-			   dst_offset = offset [state + level * wfa->states]
-					- width;
+		     scale_words (dst, src, weight, width);
+		     src += width + src_offset;
+		     dst += dst_offset;
+		  }
+	       }
+	    }
+	    else
+	    {
+	       int weight = (int) (wfa->weight[state][label][edge]
+				   * wfa->final_distribution[0]
+				   * 8 + .5) * 2;
+	       /*
+		*  Range needs domain 0
+		*  (the constant function f(x, y) = 1),
+		*  hence a faster algorithm is used.
+		*/
+	       if (width == 1)	/* can't add two-pixels in a row */
+	       {
+		  word_t   *dst;
+		  unsigned  dst_offset;
+
+		  dst        = range;
+		  dst_offset = offset [state + level * wfa->states]
+			       - width;
+
+		  *dst++ = weight;
+		  if (height == 2)
+		  {
+		     dst += dst_offset;
+		     *dst++ = weight;
+		  }
+	       }
+	       else
+	       {
+		  unsigned  x, y;
+		  int 	    *idst;
+		  unsigned  idst_offset;
+
+		  weight      = (weight * 65536) | (weight & 0xffff);
+		  idst	       = (int *) range;
+		  idst_offset = offset [state + level * wfa->states]
+				/ 2;
+		  for (x = width >> 1; x; x--)
+		     *idst++ = weight & 0xfffefffe;
+		  idst += (offset [state + level * wfa->states]
+			   - width) / 2;
+
+		  for (y = height - 1; y; y--)
+		  {
+		     memcpy (idst, idst - idst_offset,
+			     width * sizeof (word_t));
+		     idst += idst_offset;
+		  }
+	       }
+	    }
+	    edge = 1;
+	 }
+	 else
+	    edge = 0;
+
+	 /*
+	  *  Add remaining weighted domain images to current range
+	  */
+	 for (; isedge (domain = wfa->into[state][label][edge]);
+	      edge++)
+	 {
+	    if (domain != 0)
+	    {
+	       word_t 	 *src;
+	       unsigned  src_offset;
+	       int	  weight;
+
+	       src        = simg [domain + (level - 1) * wfa->states];
+	       src_offset = offset [domain + ((level - 1)
+					      * wfa->states)] - width;
+	       weight     = wfa->int_weight [state][label][edge];
+
+	       if (width == 1)	/* can't add two-pixels in a row */
+	       {
+		  word_t   *dst;
+		  unsigned  dst_offset;
+
+		  dst        = range;
+		  dst_offset = offset [state + level * wfa->states]
+			       - width;
 
 #ifdef HAVE_SIGNED_SHIFT
-			   *dst++ += ((weight * (int) *src++) >> 10) << 1;
-#else /* not HAVE_SIGNED_SHIFT */
-			   *dst++ += ((weight * (int) *src++) / 1024) * 2;
-#endif /* not HAVE_SIGNED_SHIFT */
-			   if (height == 2) 
-			   {
-			      src += src_offset;
-			      dst += dst_offset;
-#ifdef HAVE_SIGNED_SHIFT
-			      *dst++ += ((weight * (int) *src++) >> 10) << 1;
+		  *dst++ += ((weight * (int) *src++) >> 10) << 1;
 #else /* not HAVE_SIGNED_SHIFT */
-			      *dst++ += ((weight * (int) *src++) / 1024) * 2;
+		  *dst++ += ((weight * (int) *src++) / 1024) * 2;
 #endif /* not HAVE_SIGNED_SHIFT */
-			   }
-			}
-			else
-			{
-			   int 	    *idst;
-			   unsigned  idst_offset;
-			   unsigned  y;
-			   
-			   idst        = (int *) range;
-			   idst_offset = (offset [state + level * wfa->states]
-					  - width) / 2;
-			   
-			   for (y = height; y; y--)
-			   {
-			      int *comp_dst = idst + (width >> 1);
-			      
-			      for (; idst != comp_dst;)
- 			      {
-				 int tmp; /* temp. value of adjacent pixels */
+		  if (height == 2) 
+		  {
+		     src += src_offset;
+		     dst += dst_offset;
 #ifdef HAVE_SIGNED_SHIFT
-#	ifndef WORDS_BIGENDIAN
-                                 tmp = (((weight * (int) src [1]) >> 10) << 17)
-				       | (((weight * (int) src [0]) >> 9)
-					  & 0xfffe);
-#	else /* not WORDS_BIGENDIAN */
-                                 tmp = (((weight * (int)src [0]) >> 10) << 17)
-				       | (((weight * (int)src [1]) >> 9)
-					  & 0xfffe);
-#	endif /* not WORDS_BIGENDIAN */
+		     *dst++ += ((weight * (int) *src++) >> 10) << 1;
 #else /* not HAVE_SIGNED_SHIFT */
-#	ifndef WORDS_BIGENDIAN
-                                 tmp = (((weight * (int) src [1]) / 1024)
-					* 131072)
-				       | (((weight * (int) src [0])/ 512)
-					  & 0xfffe);
-#	else /* not WORDS_BIGENDIAN */
-                                 tmp = (((weight * (int) src [0]) / 1024)
-					* 131072)
-				       | (((weight * (int) src [1])/ 512)
-					  & 0xfffe);
-#	endif /* not WORDS_BIGENDIAN */
+		     *dst++ += ((weight * (int) *src++) / 1024) * 2;
 #endif /* not HAVE_SIGNED_SHIFT */
-				 src +=  2;
-				 *idst = (*idst + tmp) & 0xfffefffe;
-				 idst++;
-			      }
-			      src  += src_offset;
-			      idst += idst_offset;
-			   }
-			}
-		     }
-		     else
+		  }
+	       }
+	       else
+	       {
+		  word_t   *dst        = range;
+		  unsigned  dst_offset = offset [state + level * wfa->states];
+		  unsigned  y;
+
+		  for (y = height; y; y--)
+		  {
+		     add_scaled_words (dst, src, weight, width);
+		     src += width + src_offset;
+		     dst += dst_offset;
+		  }
+	       }
+	    }
+	    else
+	    {
+	       int weight = (int) (wfa->weight[state][label][edge]
+				   * wfa->final_distribution[0]
+				   * 8 + .5) * 2;
+	       /*
+		*  Range needs domain 0
+		*  (the constant function f(x, y) = 1),
+		*  hence a faster algorithm is used.
+		*/
+	       if (width == 1)	/* can't add two-pixels in a row */
+	       {
+		  word_t   *dst;
+		  unsigned  dst_offset;
+
+		  dst        = range;
+		  dst_offset = offset [state + level * wfa->states]
+			       - width;
+
+		  *dst++ += weight;
+		  if (height == 2)
+		  {
+		     dst    += dst_offset;
+		     *dst++ += weight;
+		  }
+	       }
+	       else
+	       {
+		  int 	    *idst;
+		  unsigned  idst_offset;
+		  unsigned  y;
+
+		  weight      = (weight * 65536) | (weight & 0xffff);
+		  idst	       = (int *) range;
+		  idst_offset = (offset [state + level * wfa->states]
+				 - width) /2;
+
+		  for (y = height; y; y--)
+		  {
+		     int *comp_dst = idst + (width >> 1);
+
+		     for (; idst != comp_dst; )
 		     {
-			int weight = (int) (wfa->weight[state][label][edge]
-					    * wfa->final_distribution[0]
-					    * 8 + .5) * 2;
-			/*
-			 *  Range needs domain 0
-			 *  (the constant function f(x, y) = 1),
-			 *  hence a faster algorithm is used.
-			 */
-			if (width == 1)	/* can't add two-pixels in a row */
-			{
-			   word_t   *dst;
-			   unsigned  dst_offset;
-			   
-			   dst        = range;
-			   dst_offset = offset [state + level * wfa->states]
-					- width;
-			   
-			   *dst++ += weight;
-			   if (height == 2)
-			   {
-			      dst    += dst_offset;
-			      *dst++ += weight;
-			   }
-			}
-			else
-			{
-			   int 	    *idst;
-			   unsigned  idst_offset;
-			   unsigned  y;
-			   
-			   weight      = (weight * 65536) | (weight & 0xffff);
-			   idst	       = (int *) range;
-			   idst_offset = (offset [state + level * wfa->states]
-					  - width) /2;
-			   
-			   for (y = height; y; y--)
-			   {
-			      int *comp_dst = idst + (width >> 1);
-			      
-			      for (; idst != comp_dst; )
-			      {
-				 *idst = (*idst + weight) & 0xfffefffe;
-                                 idst++;
-			      }
-			      idst += idst_offset;
-			   }
-			}
+			*idst = (*idst + weight) & 0xfffefffe;
+			idst++;
 		     }
+		     idst += idst_offset;
 		  }
-	       } 
-   }
+	       }
+	    }
+	 }
+      }
 }
 
 static word_t *
@@ -20,6 +20,22 @@
 #include "types.h"
 #include "image.h"
 #include "wfa.h"
+#include "thread-pool.h"
+#include "pipeline.h"
+
+#define MAX_SPARE_FRAMES 4		/* number of recycled frame buffers */
+
+typedef struct simg_arena
+/*
+ *  Memory of the intermediate state images. The block is reused by all
+ *  frames of a video and grows if a frame requires more memory.
+ */
+{
+   word_t   *buffer;			/* memory block or NULL */
+   size_t    size;			/* size of 'buffer' (in pixels) */
+   size_t    used;			/* pixels used by current frame */
+   size_t    needed;			/* pixels requested by current frame */
+} simg_arena_t;
 
 typedef struct video
 {
@@ -33,6 +49,12 @@ typedef struct video
    wfa_t    *wfa;			/* current wfa */
    wfa_t    *wfa_future;		/* future wfa */
    wfa_t    *wfa_past;			/* past wfa */
+   wfa_t    *wfa_last;			/* wfa of the previous frame */
+   thread_pool_t *pool;			/* threads of the decoder or NULL */
+   pipeline_t *pipeline;		/* parser of next frames or NULL */
+   image_t  *spare [MAX_SPARE_FRAMES];	/* unused frame buffers */
+   unsigned  n_spare;			/* number of unused frame buffers */
+   simg_arena_t arena;			/* memory of state images */
 } video_t;
 
 typedef struct dectimer
@@ -54,7 +76,8 @@ get_next_frame (bool_t store_wfa, int enlarge_factor,
 		wfa_t *orig_wfa, bitfile_t *input);
 image_t *
 decode_image (unsigned orig_width, unsigned orig_height, format_e format,
-	      unsigned *dec_timer, const wfa_t *wfa);
+	      unsigned *dec_timer, const wfa_t *wfa, thread_pool_t *pool,
+	      video_t *video);
 word_t *
 decode_range (unsigned range_state, unsigned range_label, unsigned range_level,
 	      word_t **domain, wfa_t *wfa);
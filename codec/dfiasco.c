@@ -37,13 +37,19 @@
   
 *****************************************************************************/
 
+static fiasco_decoder_t *
+new_decoder (bitfile_t *input, const fiasco_d_options_t *options);
 static dfiasco_t *
 cast_dfiasco (fiasco_decoder_t *dfiasco);
 static void
 free_dfiasco (dfiasco_t *dfiasco);
 static dfiasco_t *
 alloc_dfiasco (wfa_t *wfa, video_t *video, bitfile_t *input,
-	       int enlarge_factor, int smoothing, format_e image_format);
+	       mosaic_t *mosaic, int enlarge_factor, int smoothing,
+	       format_e image_format, unsigned threads);
+static image_t *
+get_mosaic_region (dfiasco_t *dfiasco, unsigned x0, unsigned y0,
+		   unsigned width, unsigned height, format_e format);
 
 /*****************************************************************************
 
@@ -56,86 +62,46 @@ fiasco_decoder_new (const char *filename, const fiasco_d_options_t *options)
 {
    try
    {
-      bitfile_t        	 *input;	/* pointer to WFA FIASCO stream */
-      wfa_t            	 *wfa;		/* wfa structure */
-      video_t          	 *video;	/* information about decoder state */
-      const d_options_t  *dop;		/* decoder additional options */
-      dfiasco_t	       	 *dfiasco;	/* decoder internal state */
-      fiasco_decoder_t 	 *decoder;	/* public interface to decoder */
-      fiasco_d_options_t *default_options = NULL;
-
-      if (options)
-      {
-	 dop = cast_d_options ((fiasco_d_options_t *) options);
-	 if (!dop)
-	    return NULL;
-      }
-      else
-      {
-	 default_options = fiasco_d_options_new ();
-	 dop 		 = cast_d_options (default_options);
-      }
-      
-      wfa   = alloc_wfa (NO);
-      video = alloc_video (NO);
-      input = open_wfa (filename, wfa->wfainfo);
-      read_basis (wfa->wfainfo->basis_name, wfa);
-
-      decoder 	       	   = fiasco_calloc (1, sizeof (fiasco_decoder_t));
-      decoder->delete  	   = fiasco_decoder_delete;
-      decoder->write_frame = fiasco_decoder_write_frame;
-      decoder->get_frame   = fiasco_decoder_get_frame;
-      decoder->get_length  = fiasco_decoder_get_length;
-      decoder->get_rate    = fiasco_decoder_get_rate;
-      decoder->get_width   = fiasco_decoder_get_width;
-      decoder->get_height  = fiasco_decoder_get_height;
-      decoder->get_title   = fiasco_decoder_get_title;
-      decoder->get_comment = fiasco_decoder_get_comment;
-      decoder->is_color    = fiasco_decoder_is_color;
-
-      decoder->private = dfiasco
-		       = alloc_dfiasco (wfa, video, input,
-					dop->magnification,
-					dop->smoothing,
-					dop->image_format);
-   
-      if (default_options)
-	 fiasco_d_options_delete (default_options);
-      if (dfiasco->enlarge_factor >= 0)
-      {
-	 int 	       n;
-	 unsigned long pixels = wfa->wfainfo->width * wfa->wfainfo->height;
+      return new_decoder (open_bitfile (filename, "FIASCO_DATA", READ_ACCESS),
+			  options);
+   }
+   catch
+   {
+      return NULL;
+   }
+}
 
-	 for (n = 1; n <= (int) dfiasco->enlarge_factor; n++)
-	 {
-	    if (pixels << (n << 1) > 2048 * 2048)
-	    {
-	       set_error (_("Magnifaction factor `%d' is too large. "
-			    "Maximium value is %d."),
-			  dfiasco->enlarge_factor, max (0, n - 1));
-	       fiasco_decoder_delete (decoder);
-	       return NULL;
-	    }
-	 }
-      }
-      else
-      {
-	 int n;
+fiasco_decoder_t *
+fiasco_decoder_new_from_memory (const void *data, size_t size,
+				const fiasco_d_options_t *options)
+{
+   if (!data)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "data");
+      return NULL;
+   }
+   try
+   {
+      return new_decoder (open_memory_bitfile (data, size), options);
+   }
+   catch
+   {
+      return NULL;
+   }
+}
 
-	 for (n = 0; n <= (int) - dfiasco->enlarge_factor; n++)
-	 {
-	    if (wfa->wfainfo->width >> n < 32
-		|| wfa->wfainfo->height >> n < 32)
-	    {
-	       set_error (_("Magnifaction factor `%d' is too small. "
-			    "Minimum value is %d."),
-			  dfiasco->enlarge_factor, - max (0, n - 1));
-	       fiasco_decoder_delete (decoder);
-	       return NULL;
-	    }
-	 }
-      }
-      return (fiasco_decoder_t *) decoder;
+fiasco_decoder_t *
+fiasco_decoder_new_from_callback (fiasco_read_f read, void *data,
+				  const fiasco_d_options_t *options)
+{
+   if (!read)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "read");
+      return NULL;
+   }
+   try
+   {
+      return new_decoder (open_callback_bitfile (read, NULL, data), options);
    }
    catch
    {
@@ -155,11 +121,25 @@ fiasco_decoder_write_frame (fiasco_decoder_t *decoder,
    {
       try
       {
-	 image_t *frame = get_next_frame (NO, dfiasco->enlarge_factor,
-					  dfiasco->smoothing, NULL,
-					  FORMAT_4_4_4, dfiasco->video, NULL,
-					  dfiasco->wfa, dfiasco->input);
-	 write_image (filename, frame);
+	 if (dfiasco->mosaic)
+	 {
+	    image_t *frame
+	       = get_mosaic_region (dfiasco, 0, 0,
+				    fiasco_decoder_get_width (decoder),
+				    fiasco_decoder_get_height (decoder),
+				    FORMAT_4_4_4);
+	    write_image (filename, frame);
+	    free_image (frame);
+	 }
+	 else
+	 {
+	    image_t *frame = get_next_frame (NO, dfiasco->enlarge_factor,
+					     dfiasco->smoothing, NULL,
+					     FORMAT_4_4_4, dfiasco->video,
+					     NULL, dfiasco->wfa,
+					     dfiasco->input);
+	    write_image (filename, frame);
+	 }
       }
       catch
       {
@@ -181,13 +161,22 @@ fiasco_decoder_get_frame (fiasco_decoder_t *decoder)
       try
       {
 	 fiasco_image_t *image = fiasco_calloc (1, sizeof (fiasco_image_t));
-	 image_t 	*frame = get_next_frame (NO, dfiasco->enlarge_factor,
-						 dfiasco->smoothing, NULL,
-						 dfiasco->image_format,
-						 dfiasco->video, NULL,
-						 dfiasco->wfa, dfiasco->input);
-
-	 frame->reference_count++;	/* for motion compensation */
+	 image_t 	*frame;
+
+	 if (dfiasco->mosaic)
+	    frame = get_mosaic_region (dfiasco, 0, 0,
+				       fiasco_decoder_get_width (decoder),
+				       fiasco_decoder_get_height (decoder),
+				       dfiasco->image_format);
+	 else
+	 {
+	    frame = get_next_frame (NO, dfiasco->enlarge_factor,
+				    dfiasco->smoothing, NULL,
+				    dfiasco->image_format,
+				    dfiasco->video, NULL,
+				    dfiasco->wfa, dfiasco->input);
+	    frame->reference_count++;	/* for motion compensation */
+	 }
 	 image->private    = frame;
 	 image->delete     = fiasco_image_delete;
 	 image->get_width  = fiasco_image_get_width;
@@ -203,6 +192,208 @@ fiasco_decoder_get_frame (fiasco_decoder_t *decoder)
    }
 }
 
+int
+fiasco_decoder_get_frame_into (fiasco_decoder_t *decoder,
+			       unsigned char *buffer, unsigned stride,
+			       fiasco_layout_e layout)
+{
+   dfiasco_t *dfiasco = cast_dfiasco (decoder);
+   unsigned   width;			/* minimum row size of 'buffer' */
+   
+   if (!dfiasco)
+      return 0;
+   if (!buffer)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "buffer");
+      return 0;
+   }
+   if (!(width = layout_row_size (fiasco_decoder_get_width (decoder),
+				  layout)))
+   {
+      set_error (_("Pixel layout %d is not defined."), layout);
+      return 0;
+   }
+   if (!stride)
+      stride = width;
+   else if (stride < width || (layout == FIASCO_YUV_420 && (stride & 1)))
+   {
+      set_error (_("Row size %d of the buffer is not valid."), stride);
+      return 0;
+   }
+   
+   try
+   {
+      if (dfiasco->mosaic)
+      {
+	 image_t *frame
+	    = get_mosaic_region (dfiasco, 0, 0,
+				 fiasco_decoder_get_width (decoder),
+				 fiasco_decoder_get_height (decoder),
+				 dfiasco->image_format);
+	 export_image (frame, buffer, stride, layout);
+	 free_image (frame);
+      }
+      else
+      {
+	 image_t *frame = get_next_frame (NO, dfiasco->enlarge_factor,
+					  dfiasco->smoothing, NULL,
+					  dfiasco->image_format,
+					  dfiasco->video, NULL,
+					  dfiasco->wfa, dfiasco->input);
+	 export_image (frame, buffer, stride, layout);
+      }
+   }
+   catch
+   {
+      return 0;
+   }
+   return 1;
+}
+
+fiasco_image_t *
+fiasco_decoder_get_region (fiasco_decoder_t *decoder,
+			   unsigned x0, unsigned y0,
+			   unsigned width, unsigned height)
+{
+   dfiasco_t *dfiasco = cast_dfiasco (decoder);
+   
+   if (!dfiasco)
+      return NULL;
+   else if (!dfiasco->mosaic)
+   {
+      set_error (_("Regions can be decoded only from FIASCO mosaics."));
+      return NULL;
+   }
+   else if (!width || !height
+	    || x0 + width > fiasco_decoder_get_width (decoder)
+	    || y0 + height > fiasco_decoder_get_height (decoder)
+	    || ((x0 | y0 | width | height) & 1))
+   {
+      set_error (_("Region %dx%d+%d+%d is not inside of the image or "
+		   "not aligned to even coordinates."), width, height, x0, y0);
+      return NULL;
+   }
+   else
+   {
+      try
+      {
+	 fiasco_image_t *image = fiasco_calloc (1, sizeof (fiasco_image_t));
+
+	 image->private    = get_mosaic_region (dfiasco, x0, y0,
+						width, height,
+						dfiasco->image_format);
+	 image->delete     = fiasco_image_delete;
+	 image->get_width  = fiasco_image_get_width;
+	 image->get_height = fiasco_image_get_height;
+	 image->is_color   = fiasco_image_is_color;
+	 
+	 return image;
+      }
+      catch
+      {
+	 return NULL;
+      }
+   }
+}
+
+int
+fiasco_decoder_seek (fiasco_decoder_t *decoder, unsigned frame)
+{
+   dfiasco_t *dfiasco = cast_dfiasco (decoder);
+   
+   if (!dfiasco)
+      return 0;
+   else if (frame >= fiasco_decoder_get_length (decoder))
+   {
+      set_error (_("Frame %d is not part of the FIASCO stream."), frame);
+      return 0;
+   }
+   else if (dfiasco->mosaic)		/* single frame */
+      return 1;
+   else
+   {
+      try
+      {
+	 frame_index_t *index;
+	 video_t       *video = dfiasco->video;
+	 unsigned	n, i;
+
+	 /*
+	  *  Stop the parser thread and go back to the first frame
+	  *  which has not been decoded yet
+	  */
+	 if (video->pipeline)
+	 {
+	    if (!bitfile_reopenable (dfiasco->input))
+	       error ("Bitfile %s doesn't support random access.",
+		      dfiasco->input->filename);
+	    seek_bitfile (dfiasco->input, free_pipeline (video->pipeline));
+	    video->pipeline = NULL;
+	 }
+
+	 if (!dfiasco->index)
+	    dfiasco->index = read_frame_index (dfiasco->first_frame,
+					       dfiasco->wfa, dfiasco->input);
+	 index = dfiasco->index;
+	 
+	 /*
+	  *  Find 'frame' and the preceding intra frame in stream order
+	  */
+	 for (n = 0; n < index->frames && index->number [n] != frame; n++)
+	    ;
+	 for (i = min (n, index->frames - 1);
+	      i > 0 && index->type [i] != I_FRAME; i--)
+	    ;
+	 if (n == index->frames || index->type [i] != I_FRAME)
+	 {
+	    set_error (_("No intra frame precedes frame %d."), frame);
+	    return 0;
+	 }
+
+	 /*
+	  *  Restart decoding at the intra frame unless it has been
+	  *  passed already and 'frame' is not yet displayed.
+	  *  B-frames following the intra frame may precede it in display
+	  *  order, hence decoding restarts with the smallest display
+	  *  number of the remaining frames.
+	  */
+	 if (video->display > frame
+	     || bits_processed (dfiasco->input) < index->offset [i])
+	 {
+	    unsigned display = index->number [i];
+	    
+	    for (n = i; n < index->frames; n++)
+	       display = min (display, index->number [n]);
+
+	    free_video (video);
+	    video = dfiasco->video = alloc_video (NO);
+	    video->pool    = dfiasco->pool;
+	    video->display = display;
+	    seek_bitfile (dfiasco->input, index->offset [i]);
+	 }
+
+	 if (dfiasco->pipeline)		/* restart parser thread */
+	 {
+	    unsigned position = bits_processed (dfiasco->input);
+	    
+	    for (n = 0; n < index->frames && index->offset [n] < position; n++)
+	       ;
+	    video->pipeline = alloc_pipeline (dfiasco->wfa, dfiasco->input,
+					      index->frames - n);
+	 }
+	 while (video->display < frame)
+	    get_next_frame (NO, dfiasco->enlarge_factor, dfiasco->smoothing,
+			    NULL, dfiasco->image_format, video, NULL,
+			    dfiasco->wfa, dfiasco->input);
+      }
+      catch
+      {
+	 return 0;
+      }
+      return 1;
+   }
+}
+
 unsigned
 fiasco_decoder_get_length (fiasco_decoder_t *decoder)
 {
@@ -308,9 +499,15 @@ fiasco_decoder_delete (fiasco_decoder_t *decoder)
    
    try
    {
+      free_video (dfiasco->video);	/* stops parser thread */
       free_wfa (dfiasco->wfa);
-      free_video (dfiasco->video);
-      close_bitfile (dfiasco->input);
+      if (dfiasco->input)
+	 close_bitfile (dfiasco->input);
+      if (dfiasco->mosaic)
+	 close_mosaic (dfiasco->mosaic);
+      free_thread_pool (dfiasco->pool);
+      if (dfiasco->index)
+	 free_frame_index (dfiasco->index);
       strcpy (dfiasco->id, " ");
       fiasco_free (decoder);
    }
@@ -328,12 +525,133 @@ fiasco_decoder_delete (fiasco_decoder_t *decoder)
   
 *****************************************************************************/
 
+static fiasco_decoder_t *
+new_decoder (bitfile_t *input, const fiasco_d_options_t *options)
+/*
+ *  Decoder constructor:
+ *  Initialize the decoder of the FIASCO image, sequence or mosaic
+ *  given by the stream 'input' with the given 'options'.
+ *
+ *  Return value:
+ *	pointer to the new decoder, or NULL if 'options' are invalid
+ *
+ *  Side effects:
+ *	'input' is closed when the decoder is deleted
+ */
+{
+   mosaic_t	      *mosaic = NULL;	/* tiles of a FIASCO mosaic */
+   wfa_t	      *wfa;		/* wfa structure */
+   video_t	      *video;		/* state of the video decoder */
+   const d_options_t  *dop;		/* decoder additional options */
+   dfiasco_t	      *dfiasco;		/* decoder internal state */
+   fiasco_decoder_t   *decoder;		/* public interface to decoder */
+   fiasco_d_options_t *default_options = NULL;
+
+   if (options)
+   {
+      dop = cast_d_options ((fiasco_d_options_t *) options);
+      if (!dop)
+      {
+	 close_bitfile (input);
+	 return NULL;
+      }
+   }
+   else
+   {
+      default_options = fiasco_d_options_new ();
+      dop 	      = cast_d_options (default_options);
+   }
+
+   wfa   = alloc_wfa (NO);
+   video = alloc_video (NO);
+   if (is_mosaic (input))
+   {
+      mosaic = open_mosaic (input, wfa->wfainfo);
+      input  = NULL;
+   }
+   else
+   {
+      read_wfa_header (input, wfa->wfainfo);
+      read_basis (wfa->wfainfo->basis_name, wfa);
+   }
+
+   decoder 	        = fiasco_calloc (1, sizeof (fiasco_decoder_t));
+   decoder->delete      = fiasco_decoder_delete;
+   decoder->write_frame = fiasco_decoder_write_frame;
+   decoder->get_frame   = fiasco_decoder_get_frame;
+   decoder->get_length  = fiasco_decoder_get_length;
+   decoder->get_rate    = fiasco_decoder_get_rate;
+   decoder->get_width   = fiasco_decoder_get_width;
+   decoder->get_height  = fiasco_decoder_get_height;
+   decoder->get_title   = fiasco_decoder_get_title;
+   decoder->get_comment = fiasco_decoder_get_comment;
+   decoder->is_color    = fiasco_decoder_is_color;
+   decoder->get_region  = fiasco_decoder_get_region;
+   decoder->seek        = fiasco_decoder_seek;
+   decoder->get_frame_into = fiasco_decoder_get_frame_into;
+
+   decoder->private = dfiasco
+		    = alloc_dfiasco (wfa, video, input, mosaic,
+				     dop->magnification,
+				     dop->smoothing,
+				     dop->image_format,
+				     dop->threads);
+
+   if (default_options)
+      fiasco_d_options_delete (default_options);
+   if (dfiasco->enlarge_factor >= 0)
+   {
+      int 	       n;
+      unsigned long pixels = wfa->wfainfo->width * wfa->wfainfo->height;
+
+      for (n = 1; n <= (int) dfiasco->enlarge_factor; n++)
+      {
+	 if (pixels << (n << 1) > 2048 * 2048)
+	 {
+	    set_error (_("Magnifaction factor `%d' is too large. "
+			 "Maximium value is %d."),
+		       dfiasco->enlarge_factor, max (0, n - 1));
+	    fiasco_decoder_delete (decoder);
+	    return NULL;
+	 }
+      }
+   }
+   else if (mosaic)
+   {
+      set_error (_("Size of FIASCO mosaics can't be reduced."));
+      fiasco_decoder_delete (decoder);
+      return NULL;
+   }
+   else
+   {
+      int n;
+
+      for (n = 0; n <= (int) - dfiasco->enlarge_factor; n++)
+      {
+	 if (wfa->wfainfo->width >> n < 32
+	     || wfa->wfainfo->height >> n < 32)
+	 {
+	    set_error (_("Magnifaction factor `%d' is too small. "
+			 "Minimum value is %d."),
+		       dfiasco->enlarge_factor, - max (0, n - 1));
+	    fiasco_decoder_delete (decoder);
+	    return NULL;
+	 }
+      }
+   }
+   return (fiasco_decoder_t *) decoder;
+}
+
 static dfiasco_t *
 alloc_dfiasco (wfa_t *wfa, video_t *video, bitfile_t *input,
-	       int enlarge_factor, int smoothing, format_e image_format)
+	       mosaic_t *mosaic, int enlarge_factor, int smoothing,
+	       format_e image_format, unsigned threads)
 /*
  *  FIASCO decoder constructor:
  *  Initialize decoder structure.
+ *  Either 'input' or 'mosaic' gives the FIASCO stream(s) to decode.
+ *  If more than one thread is used, then the frames of a video are
+ *  parsed by a separate thread while the current frame is decoded.
  *
  *  Return value:
  *	pointer to the new decoder structure
@@ -349,10 +667,43 @@ alloc_dfiasco (wfa_t *wfa, video_t *video, bitfile_t *input,
    dfiasco->enlarge_factor = enlarge_factor;
    dfiasco->smoothing  	   = smoothing;
    dfiasco->image_format   = image_format;
+   dfiasco->mosaic         = mosaic;
+   dfiasco->pool           = alloc_thread_pool (threads);
+   dfiasco->video->pool    = dfiasco->pool;
+   dfiasco->first_frame    = input ? bits_processed (input) : 0;
+   dfiasco->index          = NULL;
+   /*
+    *  The number of frames of an open ended stream is unknown until
+    *  the end marker is read, unless the frames can be located in
+    *  advance.
+    */
+   if (input && !wfa->wfainfo->frames && bitfile_reopenable (input))
+      dfiasco->index = read_frame_index (dfiasco->first_frame, wfa, input);
+   dfiasco->pipeline       = input && wfa->wfainfo->frames > 1
+			     && thread_pool_size (dfiasco->pool) > 1;
+   if (dfiasco->pipeline)
+      dfiasco->video->pipeline = alloc_pipeline (wfa, input,
+						 wfa->wfainfo->frames);
    
    return dfiasco;
 }
 
+static image_t *
+get_mosaic_region (dfiasco_t *dfiasco, unsigned x0, unsigned y0,
+		   unsigned width, unsigned height, format_e format)
+/*
+ *  Decode the region ('x0', 'y0', 'width', 'height') of the mosaic
+ *  of 'dfiasco' using the given color 'format'.
+ *
+ *  Return value:
+ *	pointer to decoded region
+ */
+{
+   return decode_mosaic (dfiasco->mosaic, x0, y0, width, height,
+			 dfiasco->enlarge_factor, dfiasco->smoothing,
+			 format, dfiasco->pool);
+}
+
 static void
 free_dfiasco (dfiasco_t *dfiasco)
 /*
@@ -22,6 +22,8 @@
 #include "decoder.h"
 #include "image.h"
 #include "wfa.h"
+#include "mosaic.h"
+#include "thread-pool.h"
 
 typedef struct dfiasco
 {
@@ -32,6 +34,11 @@ typedef struct dfiasco
    int	      enlarge_factor;
    int        smoothing;
    format_e   image_format;
+   mosaic_t  *mosaic;			/* NULL: single FIASCO stream */
+   thread_pool_t *pool;
+   unsigned   first_frame;		/* bit offset of the first frame */
+   frame_index_t *index;		/* positions of frames or NULL */
+   bool_t     pipeline;			/* parse frames in a separate thread */
 } dfiasco_t;
 
 #endif /* not _DFIASCO_H */
@@ -20,6 +20,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
@@ -161,6 +165,8 @@ alloc_uniform_domain_pool (unsigned max_domains, unsigned max_edges,
 static void
 init_matrix_probabilities (void);
 static void
+compute_matrix_probabilities (void);
+static void
 default_chroma (unsigned max_domains, const wfa_t *wfa, void *model);
 static bool_t
 default_append (unsigned new_state, unsigned level,
@@ -468,7 +474,11 @@ qac_chroma (unsigned max_domains, const wfa_t *wfa, void *model)
 {
    qac_model_t *qac_model = (qac_model_t *) model; /* probability model */
    
-   if (max_domains < qac_model->n)	/* choose most probable domains */
+   /*
+    *  The chroma domains are the most probable domains of the luminance
+    *  (see compute_hits ()), even if the domain pool is smaller than
+    *  'max_domains': the decoder can't refer to other states.
+    */
    {
       word_t   *domains;
       unsigned  n, new, old;
@@ -856,7 +866,9 @@ rle_chroma (unsigned max_domains, const wfa_t *wfa, void *model)
 {
    rle_model_t *rle_model = (rle_model_t *) model; /* probability model */
    
-   if (max_domains < rle_model->n)	/* choose most probable domains */
+   /*
+    *  Choose the most probable domains, see qac_chroma ()
+    */
    {
       unsigned  n;
       word_t   *states  = fiasco_calloc (max_domains, sizeof (word_t));
@@ -969,6 +981,32 @@ default_chroma (unsigned max_domains, const wfa_t *wfa, void *model)
 
 static void
 init_matrix_probabilities (void)
+/*
+ *  Initialize the information contents of matrix element '0' and '1'
+ *  (see compute_matrix_probabilities ()). The tables are computed only
+ *  once, even if several coders call this function at the same time.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	local arrays matrix_0 and matrix_1 are initialized if not already done.
+ */
+{
+#if HAVE_PTHREAD_H
+   static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+   pthread_once (&once, compute_matrix_probabilities);
+#else /* not HAVE_PTHREAD_H */
+   if (matrix_0 == NULL || matrix_1 == NULL)
+      compute_matrix_probabilities ();
+#endif /* not HAVE_PTHREAD_H */
+
+   if (matrix_0 == NULL || matrix_1 == NULL)
+      error ("Out of memory!");
+}
+
+static void
+compute_matrix_probabilities (void)
 /*
  *  Compute the information contents of matrix element '0' and '1' for
  *  each possible probability index 0, ... ,  1023. These values are
@@ -978,22 +1016,30 @@ init_matrix_probabilities (void)
  *  No return value.
  *
  *  Side effects:
- *	local arrays matrix_0 and matrix_1 are initialized if not already done.
+ *	local arrays matrix_0 and matrix_1 are initialized, they remain
+ *	NULL if memory is exhausted
  */
 {
-   if (matrix_0 == NULL || matrix_1 == NULL)
-   {
-      unsigned index;			
-      unsigned n, exp;
+   unsigned index;			
+   unsigned n, exp;
+   real_t   *m0, *m1;
       
-      matrix_0 = fiasco_calloc (1 << (MAX_PROB + 1), sizeof (real_t));
-      matrix_1 = fiasco_calloc (1 << (MAX_PROB + 1), sizeof (real_t));
-   
-      for (index = 0, n = MIN_PROB; n <= MAX_PROB; n++)
-	 for (exp = 0; exp < (unsigned) 1 << n; exp++, index++)
-	 {
-	    matrix_1 [index] = -log2 (1 / (real_t) (1 << n));
-	    matrix_0 [index] = -log2 (1 - 1 / (real_t) (1 << n));
-	 }
+   m0 = calloc (1 << (MAX_PROB + 1), sizeof (real_t));
+   m1 = calloc (1 << (MAX_PROB + 1), sizeof (real_t));
+   if (!m0 || !m1)
+   {
+      free (m0);
+      free (m1);
+      return;
    }
+   
+   for (index = 0, n = MIN_PROB; n <= MAX_PROB; n++)
+      for (exp = 0; exp < (unsigned) 1 << n; exp++, index++)
+      {
+	 m1 [index] = -log2 (1 / (real_t) (1 << n));
+	 m0 [index] = -log2 (1 - 1 / (real_t) (1 << n));
+      }
+
+   matrix_0 = m0;
+   matrix_1 = m1;
 }
@@ -22,7 +22,38 @@
 
 #include "cwfa.h"
 #include "control.h"
+#include "vector.h"
 #include "ip.h"
+#include "thread-pool.h"
+
+/*****************************************************************************
+
+				local variables
+  
+*****************************************************************************/
+
+typedef struct ip_job
+/*
+ *  Inner products of one 'level', shared by the tasks which compute
+ *  them for disjoint ranges of states.
+ */
+{
+   unsigned	image;			/* range image */
+   unsigned	address;		/* address of range image */
+   unsigned	level;			/* level of inner products */
+   unsigned	n;			/* number of range images */
+   unsigned	from;			/* first state */
+   unsigned	to;			/* last state */
+   unsigned	states;			/* number of states to split */
+   unsigned	tasks;			/* number of parallel tasks */
+   const wfa_t *wfa;
+   coding_t    *c;
+} ip_job_t;
+
+/*
+ *  Don't split the states into parts smaller than this
+ */
+#define MIN_STATES_PER_TASK 256
 
 /*****************************************************************************
 
@@ -30,6 +61,15 @@
   
 *****************************************************************************/
 
+static void
+ip_images_state_task (void *data, unsigned task);
+static void
+ip_states_state_task (void *data, unsigned task);
+static real_t
+ip_state_state (unsigned state1, unsigned state2, unsigned level,
+		const wfa_t *wfa, const coding_t *c);
+static unsigned
+ip_tasks (unsigned states, const coding_t *c);
 static real_t 
 standard_ip_image_state (unsigned address, unsigned level, unsigned domain,
 			 const coding_t *c);
@@ -77,6 +117,7 @@ compute_ip_images_state (unsigned image, unsigned address, unsigned level,
  *  Compute the inner products between all states
  *  'from', ... , 'wfa->max_states' and the range images 'image'
  *  (and childs) up to given level.
+ *  The states are distributed among the threads of 'c->pool'.
  *
  *  No return value.
  *
@@ -84,9 +125,9 @@ compute_ip_images_state (unsigned image, unsigned address, unsigned level,
  *	inner product tables 'c->ip_images_states' are updated
  */ 
 {
-   if (level > c->options.images_level) 
+   if (level > c->options.images_level && from < wfa->states) 
    {
-      unsigned state, label;
+      ip_job_t job;
 
       if (level > c->options.images_level + 1)	/* recursive computation */
 	 compute_ip_images_state (MAXLABELS * image + 1, address * MAXLABELS,
@@ -95,61 +136,17 @@ compute_ip_images_state (unsigned image, unsigned address, unsigned level,
       /*
        *  Compute inner product <f, Phi_i>
        */
-      for (label = 0; label < MAXLABELS; label++)
-	 for (state = from; state < wfa->states; state++)
-	    if (need_image (state, wfa))
-	    {
-	       unsigned  edge, count;
-	       int     	 domain;
-	       real_t 	*dst, *src;
-	       
-	       if (ischild (domain = wfa->tree [state][label]))
-	       {
-		  if (level > c->options.images_level + 1)
-		  {
-		     dst = c->ip_images_state [state] + image;
-		     src = c->ip_images_state [domain]
-			   + image * MAXLABELS + label + 1;
-		     for (count = n; count; count--, src += MAXLABELS)
-			*dst++ += *src;
-		  }
-		  else
-		  {
-		     unsigned newadr = address * MAXLABELS + label;
-		     
-		     dst = c->ip_images_state [state] + image;
-		     
-		     for (count = n; count; count--, newadr += MAXLABELS)
-			*dst++ += standard_ip_image_state (newadr, level - 1,
-							   domain, c);
-		  }
-	       }
-	       for (edge = 0; isedge (domain = wfa->into [state][label][edge]);
-		    edge++)
-	       {
-		  real_t weight = wfa->weight [state][label][edge];
-		  
-		  if (level > c->options.images_level + 1)
-		  {
-		     dst = c->ip_images_state [state] + image;
-		     src = c->ip_images_state [domain]
-			   + image * MAXLABELS + label + 1;
-		     for (count = n; count; count--, src += MAXLABELS)
-			*dst++ += *src * weight;
-		  }
-		  else
-		  {
-		     unsigned newadr = address * MAXLABELS + label;
-
-		     dst = c->ip_images_state [state] + image;
-		     
-		     for (count = n; count; count--, newadr += MAXLABELS)
-			*dst++ += weight *
-				  standard_ip_image_state (newadr, level - 1,
-							   domain, c);
-		  }
-	       }
-	    }
+      job.image   = image;
+      job.address = address;
+      job.level   = level;
+      job.n       = n;
+      job.from    = from;
+      job.to      = wfa->states - 1;
+      job.states  = wfa->states - from;
+      job.tasks   = ip_tasks (job.states, c);
+      job.wfa     = wfa;
+      job.c       = c;
+      run_tasks (c->pool, job.tasks, ip_images_state_task, &job);
    }
 }
 
@@ -187,6 +184,7 @@ compute_ip_states_state (unsigned from, unsigned to,
 /*
  *  Computes the inner products between the current state 'state1' and the
  *  old states 0,...,'state1'-1
+ *  The old states are distributed among the threads of 'c->pool'.
  *
  *  No return value.
  *
@@ -195,7 +193,14 @@ compute_ip_states_state (unsigned from, unsigned to,
  */ 
 {
    unsigned level;
-   unsigned state1, state2;
+   ip_job_t job;
+
+   job.from   = from;
+   job.to     = to;
+   job.states = to + 1;
+   job.tasks  = ip_tasks (job.states, c);
+   job.wfa    = wfa;
+   job.c      = c;
 
    /*
     *  Compute inner product <Phi_state1, Phi_state2>
@@ -203,60 +208,10 @@ compute_ip_states_state (unsigned from, unsigned to,
 
    for (level = c->options.images_level + 1;
 	level <= c->options.lc_max_level; level++)
-      for (state1 = from; state1 <= to; state1++)
-	 for (state2 = 0; state2 <= state1; state2++) 
-	    if (need_image (state2, wfa))
-	    {
-	       unsigned	label;
-	       real_t	ip = 0;
-	       
-	       for (label = 0; label < MAXLABELS; label++)
-	       {
-		  int	   domain1, domain2;
-		  unsigned edge1, edge2;
-		  real_t   sum, weight2;
-		  
-		  if (ischild (domain1 = wfa->tree [state1][label]))
-		  {
-		     sum = 0;
-		     if (ischild (domain2 = wfa->tree [state2][label]))
-			sum = get_ip_state_state (domain1, domain2,
-						  level - 1, c);
-		     
-		     for (edge2 = 0;
-			  isedge (domain2 = wfa->into [state2][label][edge2]);
-			  edge2++)
-		     {
-			weight2 = wfa->weight [state2][label][edge2];
-			sum += weight2 * get_ip_state_state (domain1, domain2,
-							     level - 1, c);
-		     }
-		     ip += sum;
-		  }
-		  for (edge1 = 0;
-		       isedge (domain1 = wfa->into [state1][label][edge1]);
-		       edge1++)
-		  {
-		     real_t weight1 = wfa->weight [state1][label][edge1];
-		     
-		     sum = 0;
-		     if (ischild (domain2 = wfa->tree [state2][label]))
-			sum = get_ip_state_state (domain1, domain2,
-						  level - 1, c);
-		     
-		     for (edge2 = 0;
-			  isedge (domain2 = wfa->into [state2][label][edge2]);
-			  edge2++)
-		     {
-			weight2 = wfa->weight [state2][label][edge2];
-			sum += weight2 * get_ip_state_state (domain1, domain2,
-							     level - 1, c);
-		     }
-		     ip += weight1 * sum;
-		  }
-	       }
-	       c->ip_states_state [state1][level][state2] = ip;
-	    }
+   {
+      job.level = level;
+      run_tasks (c->pool, job.tasks, ip_states_state_task, &job);
+   }
 }
 
 /*****************************************************************************
@@ -278,8 +233,7 @@ standard_ip_image_state (unsigned address, unsigned level, unsigned domain,
  *	computed inner product
  */
 {
-   unsigned i;
-   real_t   ip = 0, *imageptr, *stateptr;
+   real_t *imageptr, *stateptr;
 
    if (level > c->options.images_level)
       error ("Level %d not supported.", level);
@@ -288,10 +242,7 @@ standard_ip_image_state (unsigned address, unsigned level, unsigned domain,
 
    stateptr = c->images_of_state [domain] + address_of_level (level);
    
-   for (i = size_of_level (level); i; i--)
-      ip += *imageptr++ * *stateptr++;
-
-   return ip;
+   return dot_product (imageptr, stateptr, size_of_level (level));
 }
 
 static real_t 
@@ -307,8 +258,7 @@ standard_ip_state_state (unsigned domain1, unsigned domain2, unsigned level,
  *	computed inner product
  */
 {
-   unsigned i;
-   real_t   ip = 0, *state1ptr, *state2ptr;
+   real_t *state1ptr, *state2ptr;
 
    if (level > c->options.images_level)
       error ("Level %d not supported.", level);
@@ -316,9 +266,175 @@ standard_ip_state_state (unsigned domain1, unsigned domain2, unsigned level,
    state1ptr = c->images_of_state [domain1] + address_of_level (level);
    state2ptr = c->images_of_state [domain2] + address_of_level (level);
    
-   for (i = size_of_level (level); i; i--)
-      ip += *state1ptr++ * *state2ptr++;
+   return dot_product (state1ptr, state2ptr, size_of_level (level));
+}
+
+static void
+ip_images_state_task (void *data, unsigned task)
+/*
+ *  Compute the inner products of level 'data'->level between the
+ *  range images and the states of part 'task' of 'data'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	inner product tables 'c->ip_images_states' are updated
+ */
+{
+   const ip_job_t *job   = (const ip_job_t *) data;
+   const wfa_t	  *wfa   = job->wfa;
+   coding_t	  *c     = job->c;
+   unsigned	   first = job->from + task * job->states / job->tasks;
+   unsigned	   last  = job->from + (task + 1) * job->states / job->tasks;
+   unsigned	   state, label;
+
+   for (state = first; state < last; state++)
+      if (need_image (state, wfa))
+	 for (label = 0; label < MAXLABELS; label++)
+	 {
+	    unsigned  edge, count;
+	    int	      domain;
+	    real_t   *dst, *src;
+	       
+	    if (ischild (domain = wfa->tree [state][label]))
+	    {
+	       if (job->level > c->options.images_level + 1)
+	       {
+		  dst = c->ip_images_state [state] + job->image;
+		  src = c->ip_images_state [domain]
+			+ job->image * MAXLABELS + label + 1;
+		  for (count = job->n; count; count--, src += MAXLABELS)
+		     *dst++ += *src;
+	       }
+	       else
+	       {
+		  unsigned newadr = job->address * MAXLABELS + label;
+		     
+		  dst = c->ip_images_state [state] + job->image;
+		     
+		  for (count = job->n; count; count--, newadr += MAXLABELS)
+		     *dst++ += standard_ip_image_state (newadr, job->level - 1,
+							domain, c);
+	       }
+	    }
+	    for (edge = 0; isedge (domain = wfa->into [state][label][edge]);
+		 edge++)
+	    {
+	       real_t weight = wfa->weight [state][label][edge];
+		  
+	       if (job->level > c->options.images_level + 1)
+	       {
+		  dst = c->ip_images_state [state] + job->image;
+		  src = c->ip_images_state [domain]
+			+ job->image * MAXLABELS + label + 1;
+		  for (count = job->n; count; count--, src += MAXLABELS)
+		     *dst++ += *src * weight;
+	       }
+	       else
+	       {
+		  unsigned newadr = job->address * MAXLABELS + label;
+
+		  dst = c->ip_images_state [state] + job->image;
+		     
+		  for (count = job->n; count; count--, newadr += MAXLABELS)
+		     *dst++ += weight *
+			       standard_ip_image_state (newadr, job->level - 1,
+							domain, c);
+	       }
+	    }
+	 }
+}
+
+static void
+ip_states_state_task (void *data, unsigned task)
+/*
+ *  Compute the inner products of level 'data'->level between the
+ *  states 'data'->from, ... , 'data'->to and the old states of part
+ *  'task' of 'data'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	inner product tables 'c->ip_states_state' are computed.
+ */
+{
+   const ip_job_t *job   = (const ip_job_t *) data;
+   unsigned	   first = task * job->states / job->tasks;
+   unsigned	   last  = (task + 1) * job->states / job->tasks;
+   unsigned	   state1, state2;
+
+   for (state2 = first; state2 < last; state2++)
+      if (need_image (state2, job->wfa))
+	 for (state1 = max (job->from, state2); state1 <= job->to; state1++)
+	    job->c->ip_states_state [state1][job->level][state2]
+	       = ip_state_state (state1, state2, job->level, job->wfa, job->c);
+}
+
+static real_t
+ip_state_state (unsigned state1, unsigned state2, unsigned level,
+		const wfa_t *wfa, const coding_t *c)
+/*
+ *  Compute the inner product <Phi_state1, Phi_state2> at given 'level'
+ *  from the inner products of the next lower level.
+ *
+ *  Return value:
+ *	computed inner product
+ */
+{
+   unsigned label;
+   real_t   ip = 0;
+	       
+   for (label = 0; label < MAXLABELS; label++)
+   {
+      int      domain1, domain2;
+      unsigned edge1, edge2;
+      real_t   sum, weight2;
+		  
+      if (ischild (domain1 = wfa->tree [state1][label]))
+      {
+	 sum = 0;
+	 if (ischild (domain2 = wfa->tree [state2][label]))
+	    sum = get_ip_state_state (domain1, domain2, level - 1, c);
+		     
+	 for (edge2 = 0; isedge (domain2 = wfa->into [state2][label][edge2]);
+	      edge2++)
+	 {
+	    weight2 = wfa->weight [state2][label][edge2];
+	    sum += weight2 * get_ip_state_state (domain1, domain2,
+						 level - 1, c);
+	 }
+	 ip += sum;
+      }
+      for (edge1 = 0; isedge (domain1 = wfa->into [state1][label][edge1]);
+	   edge1++)
+      {
+	 real_t weight1 = wfa->weight [state1][label][edge1];
+		     
+	 sum = 0;
+	 if (ischild (domain2 = wfa->tree [state2][label]))
+	    sum = get_ip_state_state (domain1, domain2, level - 1, c);
+		     
+	 for (edge2 = 0; isedge (domain2 = wfa->into [state2][label][edge2]);
+	      edge2++)
+	 {
+	    weight2 = wfa->weight [state2][label][edge2];
+	    sum += weight2 * get_ip_state_state (domain1, domain2,
+						 level - 1, c);
+	 }
+	 ip += weight1 * sum;
+      }
+   }
 
    return ip;
 }
 
+static unsigned
+ip_tasks (unsigned states, const coding_t *c)
+/*
+ *  Return value:
+ *	number of tasks to compute the inner products of 'states' states
+ */
+{
+   return min (thread_pool_size (c->pool),
+	       max (1, states / MIN_STATES_PER_TASK));
+}
@@ -0,0 +1,589 @@
+/*
+ *  mosaic.c:		Containers of independently coded image tiles
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "misc.h"
+#include "wfalib.h"
+#include "read.h"
+#include "decoder.h"
+#include "coder.h"
+#include "mosaic.h"
+
+/*****************************************************************************
+
+				local variables
+
+*****************************************************************************/
+
+/*
+ *  A mosaic container has the following layout:
+ *
+ *  string		|"MOSAIC" and newline
+ *  rice code		|container format release
+ *  rice code		|width, height of the image
+ *  rice code		|width, height of a regular tile
+ *  bit			|color image
+ *  byte alignment	|
+ *  32 bit integers	|byte offsets of the tiles (row by row) and the
+ *			|size of the container
+ *  FIASCO streams	|one still image stream per tile
+ */
+
+typedef struct mosaic_job
+/*
+ *  Tiles of a mosaic, shared by the tasks which encode or decode them.
+ */
+{
+   const mosaic_t    *mosaic;
+   unsigned	     *tile;		/* tile of each task */
+   image_t	     *image;		/* image to encode or decoded region */
+   FILE		    **stream;		/* coded stream of each tile */
+   float	      quality;		/* coder: compression quality */
+   const c_options_t *options;		/* coder: options of every tile */
+   unsigned	      x0, y0;		/* decoder: origin of region */
+   int		      enlarge_factor;	/* decoder: magnification */
+   int		      smoothing;	/* decoder: smoothing percentage */
+   format_e	      format;		/* decoder: 4:4:4 or 4:2:0 */
+} mosaic_job_t;
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static void
+encode_tile (void *data, unsigned task);
+static void
+decode_tile (void *data, unsigned task);
+static void
+compute_geometry (mosaic_t *mosaic);
+static void
+locate_tile (const mosaic_t *mosaic, unsigned tile,
+	     unsigned *x, unsigned *y, unsigned *width, unsigned *height);
+static void
+copy_region (const image_t *src, unsigned src_x, unsigned src_y,
+	     image_t *dst, unsigned dst_x, unsigned dst_y,
+	     unsigned width, unsigned height);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+void
+mosaic_coder (image_t *image, bitfile_t *output, float quality,
+	      const c_options_t *options)
+/*
+ *  Split 'image' into tiles of size 'options->mosaic_width' x
+ *  'options->mosaic_height' and encode every tile as a separate FIASCO
+ *  stream with the given 'quality'. The tiles are distributed among
+ *  'options->threads' threads. The mosaic container is written to
+ *  stream 'output'.
+ *
+ *  No return value.
+ */
+{
+   mosaic_t	  mosaic;
+   mosaic_job_t	  job;
+   c_options_t	  tile_options;
+   thread_pool_t *pool;
+   unsigned	  tiles, tile;
+   bool_t	  failed = NO;		/* a tile coder failed */
+   env_t	  saved_env;		/* jump buffer of the caller */
+
+   memset (&mosaic, 0, sizeof (mosaic_t));
+   mosaic.width       = image->width;
+   mosaic.height      = image->height;
+   mosaic.color       = image->color;
+   mosaic.tile_width  = options->mosaic_width;
+   mosaic.tile_height = options->mosaic_height;
+   compute_geometry (&mosaic);
+   tiles = mosaic.columns * mosaic.rows;
+
+   /*
+    *  If several tiles are encoded in parallel then each tile coder
+    *  runs in a single thread and without progress meter.
+    */
+   tile_options               = *options;
+   tile_options.mosaic_width  = 0;
+   tile_options.mosaic_height = 0;
+   if (tiles > 1)
+   {
+      tile_options.threads        = 1;
+      tile_options.progress_meter = FIASCO_PROGRESS_NONE;
+   }
+
+   debug_message ("Encoding %dx%d mosaic of %dx%d tiles.",
+		  mosaic.columns, mosaic.rows,
+		  mosaic.tile_width, mosaic.tile_height);
+
+   job.mosaic  = &mosaic;
+   job.tile    = NULL;
+   job.image   = image;
+   job.stream  = fiasco_calloc (tiles, sizeof (FILE *));
+   job.quality = quality;
+   job.options = &tile_options;
+
+   /*
+    *  If a tile can't be encoded then remove the temporary files of
+    *  the other tiles before the error is passed to the caller.
+    */
+   pool = alloc_thread_pool (options->threads);
+   save_env (saved_env);
+   try
+   {
+      run_tasks (pool, tiles, encode_tile, &job);
+   }
+   catch
+   {
+      failed = YES;
+   }
+   restore_env (saved_env);
+   free_thread_pool (pool);
+   if (failed)
+   {
+      for (tile = 0; tile < tiles; tile++)
+	 if (job.stream [tile])
+	    fclose (job.stream [tile]);
+      fiasco_free (job.stream);
+      raise_error ();
+   }
+
+   /*
+    *  Write header
+    */
+   {
+      const unsigned  rice_k = 8;	/* parameter of Rice Code */
+      const char     *text;
+      unsigned long   offset;
+
+      for (text = FIASCO_MOSAIC_MAGIC; *text; text++)
+	 put_bits (output, *text, 8);
+      put_bits (output, '\n', 8);
+      write_rice_code (FIASCO_MOSAIC_RELEASE, rice_k, output);
+      write_rice_code (mosaic.width, rice_k, output);
+      write_rice_code (mosaic.height, rice_k, output);
+      write_rice_code (mosaic.tile_width, rice_k, output);
+      write_rice_code (mosaic.tile_height, rice_k, output);
+      put_bit (output, mosaic.color ? 1 : 0);
+      OUTPUT_BYTE_ALIGN (output);
+
+      offset = bits_processed (output) / 8 + (tiles + 1) * 4;
+      for (tile = 0; tile <= tiles; tile++)
+      {
+	 put_bits (output, offset >> 16, 16);
+	 put_bits (output, offset & 0xffff, 16);
+	 if (tile < tiles)
+	    offset += ftell (job.stream [tile]);
+      }
+   }
+
+   /*
+    *  Append the streams of the tiles
+    */
+   for (tile = 0; tile < tiles; tile++)
+   {
+      int byte;
+
+      rewind (job.stream [tile]);
+      while ((byte = getc (job.stream [tile])) != EOF)
+	 put_bits (output, byte, 8);
+      fclose (job.stream [tile]);
+   }
+
+   fiasco_free (job.stream);
+}
+
+bool_t
+is_mosaic (bitfile_t *input)
+/*
+ *  Check whether the stream 'input' is a mosaic container. Streams
+ *  which can't be opened a second time (e.g., standard input) are
+ *  never considered as mosaic since the tiles are accessed randomly.
+ *
+ *  Return value:
+ *	YES if 'input' starts with the mosaic magic number
+ *	NO  otherwise
+ *
+ *  Side effects:
+ *	'input' is positioned at the beginning of the stream
+ */
+{
+   const char *text;
+   bool_t      mosaic = YES;
+
+   if (!bitfile_reopenable (input)
+       || bitfile_length (input) < (strlen (FIASCO_MOSAIC_MAGIC) + 1) * 8)
+      return NO;
+
+   for (text = FIASCO_MOSAIC_MAGIC; *text && mosaic; text++)
+      if (get_bits (input, 8) != (unsigned) *text)
+	 mosaic = NO;
+   if (mosaic && get_bits (input, 8) != '\n')
+      mosaic = NO;
+   seek_bitfile (input, 0);
+
+   return mosaic;
+}
+
+mosaic_t *
+open_mosaic (bitfile_t *input, wfa_info_t *wi)
+/*
+ *  Mosaic constructor:
+ *  Read the header of the mosaic container 'input'. The tiles are
+ *  decoded from separate copies of the stream given by reopen_bitfile ().
+ *
+ *  Return value:
+ *	pointer to the new mosaic structure
+ *
+ *  Side effects:
+ *	the header of the first tile is copied to 'wi', image size and
+ *	number of frames are replaced by the values of the mosaic
+ *	'input' is closed by close_mosaic ()
+ */
+{
+   mosaic_t   *mosaic   = fiasco_calloc (1, sizeof (mosaic_t));
+   const char *filename = input->filename;
+   unsigned    tiles, tile;
+
+   mosaic->input = input;
+
+   {
+      const unsigned  rice_k = 8;	/* parameter of Rice Code */
+      const char     *text;
+      unsigned	      release;
+
+      for (text = FIASCO_MOSAIC_MAGIC; *text; text++)
+	 if (get_bits (input, 8) != (unsigned) *text)
+	    error ("Input file %s is not a valid FIASCO mosaic!", filename);
+      get_bits (input, 8);		/* fetch newline */
+
+      release = read_rice_code (rice_k, input);
+      if (release > FIASCO_MOSAIC_RELEASE)
+	 error ("Can't decode FIASCO mosaics of format release `%d'."
+		"\nCurrent mosaic format release is `%d'.", release,
+		FIASCO_MOSAIC_RELEASE);
+      mosaic->width       = read_rice_code (rice_k, input);
+      mosaic->height      = read_rice_code (rice_k, input);
+      mosaic->tile_width  = read_rice_code (rice_k, input);
+      mosaic->tile_height = read_rice_code (rice_k, input);
+      mosaic->color       = get_bit (input) ? YES : NO;
+      INPUT_BYTE_ALIGN (input);
+   }
+
+   if (mosaic->width < 32 || mosaic->height < 32
+       || mosaic->tile_width < 32 || mosaic->tile_height < 32)
+      error ("Input file %s is not a valid FIASCO mosaic!", filename);
+   compute_geometry (mosaic);
+   tiles = mosaic->columns * mosaic->rows;
+
+   mosaic->offset = fiasco_calloc (tiles + 1, sizeof (unsigned long));
+   for (tile = 0; tile <= tiles; tile++)
+   {
+      mosaic->offset [tile]  = (unsigned long) get_bits (input, 16) << 16;
+      mosaic->offset [tile] |= get_bits (input, 16);
+      if (tile && mosaic->offset [tile] <= mosaic->offset [tile - 1])
+	 error ("Offset table of FIASCO mosaic %s is corrupted.", filename);
+   }
+
+   /*
+    *  Title, comment and coding parameters are taken from the first tile
+    */
+   seek_bitfile (input, mosaic->offset [0] * 8);
+   read_wfa_header (input, wi);
+   wi->width  = mosaic->width;
+   wi->height = mosaic->height;
+   wi->color  = mosaic->color;
+   wi->frames = 1;
+
+   return mosaic;
+}
+
+void
+close_mosaic (mosaic_t *mosaic)
+/*
+ *  Mosaic destructor:
+ *  Close the container stream and free memory of 'mosaic' struct.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	structure 'mosaic' is discarded.
+ */
+{
+   close_bitfile (mosaic->input);
+   fiasco_free (mosaic->offset);
+   fiasco_free (mosaic);
+}
+
+image_t *
+decode_mosaic (const mosaic_t *mosaic, unsigned x0, unsigned y0,
+	       unsigned width, unsigned height, int enlarge_factor,
+	       int smoothing, format_e format, thread_pool_t *pool)
+/*
+ *  Decode the region ('x0', 'y0', 'width', 'height') of the image
+ *  given by 'mosaic'. The coordinates refer to the image which is
+ *  enlarged by 2^'enlarge_factor' and have to be even numbers.
+ *  Only the tiles covering the region are decoded, they are
+ *  distributed among the threads of 'pool'.
+ *  'smoothing' and 'format' are passed to the decoder of each tile.
+ *
+ *  Return value:
+ *	pointer to decoded region
+ */
+{
+   mosaic_job_t job;
+   unsigned	tiles, tile;
+   bool_t	failed = NO;		/* a tile decoder failed */
+   env_t	saved_env;		/* jump buffer of the caller */
+
+   assert (enlarge_factor >= 0);
+
+   job.mosaic         = mosaic;
+   job.tile           = fiasco_calloc (mosaic->columns * mosaic->rows,
+				       sizeof (unsigned));
+   job.image          = alloc_image (width, height, mosaic->color, format);
+   job.stream         = NULL;
+   job.x0             = x0;
+   job.y0             = y0;
+   job.enlarge_factor = enlarge_factor;
+   job.smoothing      = smoothing;
+   job.format         = format;
+
+   for (tiles = 0, tile = 0; tile < mosaic->columns * mosaic->rows; tile++)
+   {
+      unsigned x, y, w, h;
+
+      locate_tile (mosaic, tile, &x, &y, &w, &h);
+      x <<= enlarge_factor;
+      y <<= enlarge_factor;
+      w <<= enlarge_factor;
+      h <<= enlarge_factor;
+      if (x < x0 + width && x + w > x0 && y < y0 + height && y + h > y0)
+	 job.tile [tiles++] = tile;
+   }
+
+   save_env (saved_env);
+   try
+   {
+      run_tasks (pool, tiles, decode_tile, &job);
+   }
+   catch
+   {
+      failed = YES;
+   }
+   restore_env (saved_env);
+   fiasco_free (job.tile);
+   if (failed)
+   {
+      free_image (job.image);
+      raise_error ();
+   }
+
+   return job.image;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static void
+encode_tile (void *data, unsigned task)
+/*
+ *  Encode tile 'task' of the mosaic 'data' to a temporary file.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the temporary file is stored in 'data'->stream ['task'], it is
+ *	kept open if the coder fails
+ */
+{
+   mosaic_job_t *job    = (mosaic_job_t *) data;
+   image_t	*tile;
+   bitfile_t	*output;
+   unsigned	 x, y, width, height;
+   bool_t	 failed = NO;		/* the coder failed */
+   env_t	 saved_env;		/* jump buffer of the caller */
+
+   locate_tile (job->mosaic, task, &x, &y, &width, &height);
+   tile = alloc_image (width, height, job->image->color, FORMAT_4_4_4);
+   copy_region (job->image, x, y, tile, 0, 0, width, height);
+
+   if (!(job->stream [task] = tmpfile ()))
+   {
+      free_image (tile);
+      error ("Can't create temporary file.\n%s", get_system_error ());
+   }
+   output = attach_bitfile (job->stream [task], "(tile)", WRITE_ACCESS);
+
+   save_env (saved_env);
+   try
+   {
+      image_coder (tile, output, job->quality, job->options);
+   }
+   catch
+   {
+      failed = YES;
+   }
+   restore_env (saved_env);
+
+   detach_bitfile (output);
+   free_image (tile);
+   if (failed)
+      raise_error ();
+}
+
+static void
+decode_tile (void *data, unsigned task)
+/*
+ *  Decode tile 'data'->tile ['task'] of the mosaic 'data' and copy
+ *  the pixels inside the decoded region.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	pixels of 'data'->image are set
+ */
+{
+   mosaic_job_t	  *job    = (mosaic_job_t *) data;
+   const mosaic_t *mosaic = job->mosaic;
+   unsigned	   tile   = job->tile [task];
+   int		   e      = job->enlarge_factor;
+   bitfile_t	  *input  = reopen_bitfile (mosaic->input);
+   wfa_t	  *wfa    = alloc_wfa (NO);
+   video_t	  *video  = alloc_video (NO);
+   unsigned	   x, y, width, height;
+   bool_t	   failed = NO;		/* the decoder failed */
+   env_t	   saved_env;		/* jump buffer of the caller */
+
+   locate_tile (mosaic, tile, &x, &y, &width, &height);
+
+   save_env (saved_env);
+   try
+   {
+      image_t *frame;
+
+      seek_bitfile (input, mosaic->offset [tile] * 8);
+      read_wfa_header (input, wfa->wfainfo);
+      if (wfa->wfainfo->width != width || wfa->wfainfo->height != height
+	  || wfa->wfainfo->color != mosaic->color)
+	 error ("Tile %d of FIASCO mosaic %s is corrupted.",
+		tile, mosaic->input->filename);
+      read_basis (wfa->wfainfo->basis_name, wfa);
+      frame = get_next_frame (NO, e, job->smoothing, NULL, job->format,
+			      video, NULL, wfa, input);
+
+      /*
+       *  Copy the intersection of tile and region
+       */
+      {
+	 unsigned x1 = max (x << e, job->x0);
+	 unsigned y1 = max (y << e, job->y0);
+	 unsigned x2 = min ((x + width) << e, job->x0 + job->image->width);
+	 unsigned y2 = min ((y + height) << e, job->y0 + job->image->height);
+
+	 copy_region (frame, x1 - (x << e), y1 - (y << e),
+		      job->image, x1 - job->x0, y1 - job->y0, x2 - x1, y2 - y1);
+      }
+   }
+   catch
+   {
+      failed = YES;
+   }
+   restore_env (saved_env);
+
+   close_bitfile (input);
+   free_video (video);
+   free_wfa (wfa);
+   if (failed)
+      raise_error ();
+}
+
+static void
+compute_geometry (mosaic_t *mosaic)
+/*
+ *  Compute number of tile columns and rows of 'mosaic'. If the image
+ *  size is not a multiple of the tile size then the remaining pixels
+ *  are added to the last column and row, respectively.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'mosaic->columns' and 'mosaic->rows' are set
+ */
+{
+   mosaic->columns = max (1, mosaic->width / mosaic->tile_width);
+   mosaic->rows    = max (1, mosaic->height / mosaic->tile_height);
+}
+
+static void
+locate_tile (const mosaic_t *mosaic, unsigned tile,
+	     unsigned *x, unsigned *y, unsigned *width, unsigned *height)
+/*
+ *  Compute position and size of 'tile' of 'mosaic'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'*x', '*y', '*width' and '*height' are set
+ */
+{
+   unsigned column = tile % mosaic->columns;
+   unsigned row    = tile / mosaic->columns;
+
+   *x      = column * mosaic->tile_width;
+   *y      = row * mosaic->tile_height;
+   *width  = column + 1 < mosaic->columns
+	     ? mosaic->tile_width : mosaic->width - *x;
+   *height = row + 1 < mosaic->rows
+	     ? mosaic->tile_height : mosaic->height - *y;
+}
+
+static void
+copy_region (const image_t *src, unsigned src_x, unsigned src_y,
+	     image_t *dst, unsigned dst_x, unsigned dst_y,
+	     unsigned width, unsigned height)
+/*
+ *  Copy the region ('src_x', 'src_y', 'width', 'height') of image 'src'
+ *  to position ('dst_x', 'dst_y') of image 'dst'. Both images have to
+ *  use the same format, all coordinates have to be even numbers.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	pixels of 'dst' are modified
+ */
+{
+   color_e band;
+
+   for (band = first_band (src->color); band <= last_band (src->color);
+	band++)
+   {
+      unsigned shift = (src->format == FORMAT_4_2_0 && band != Y) ? 1 : 0;
+      unsigned y;
+
+      for (y = 0; y < height >> shift; y++)
+	 memcpy (dst->pixels [band] + ((dst_y >> shift) + y)
+		 * (dst->width >> shift) + (dst_x >> shift),
+		 src->pixels [band] + ((src_y >> shift) + y)
+		 * (src->width >> shift) + (src_x >> shift),
+		 (width >> shift) * sizeof (word_t));
+   }
+}
@@ -0,0 +1,50 @@
+/*
+ *  mosaic.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _MOSAIC_H
+#define _MOSAIC_H
+
+#include "types.h"
+#include "image.h"
+#include "bit-io.h"
+#include "wfa.h"
+#include "options.h"
+#include "thread-pool.h"
+
+typedef struct mosaic
+/*
+ *  Container of independently coded image tiles. The tiles of the last
+ *  column and row take up the remaining pixels of the image.
+ */
+{
+   bitfile_t	 *input;		/* stream of the container */
+   unsigned	  width;		/* width of the image */
+   unsigned	  height;		/* height of the image */
+   bool_t	  color;		/* color or grayscale image */
+   unsigned	  tile_width;		/* width of a regular tile */
+   unsigned	  tile_height;		/* height of a regular tile */
+   unsigned	  columns;		/* number of tile columns */
+   unsigned	  rows;			/* number of tile rows */
+   unsigned long *offset;		/* byte offsets of the tile streams,
+					   'offset [tiles]' is the size */
+} mosaic_t;
+
+void
+mosaic_coder (image_t *image, bitfile_t *output, float quality,
+	      const c_options_t *options);
+bool_t
+is_mosaic (bitfile_t *input);
+mosaic_t *
+open_mosaic (bitfile_t *input, wfa_info_t *wi);
+void
+close_mosaic (mosaic_t *mosaic);
+image_t *
+decode_mosaic (const mosaic_t *mosaic, unsigned x0, unsigned y0,
+	       unsigned width, unsigned height, int enlarge_factor,
+	       int smoothing, format_e format, thread_pool_t *pool);
+
+#endif /* not _MOSAIC_H */
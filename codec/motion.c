@@ -17,16 +17,39 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
 
 #include "image.h"
 #include "misc.h"
+#include "vector.h"
 #include "motion.h"
 
+/*****************************************************************************
+
+				local variables
+  
+*****************************************************************************/
+
+static int *clipping = NULL;		/* clipping table of chroma bands */
+
+/*****************************************************************************
+
+				prototypes
+  
+*****************************************************************************/
+
+static void
+init_clipping_table (void);
+
 /*****************************************************************************
 
 				public code
@@ -66,124 +89,62 @@ restore_mc (int enlarge_factor, image_t *image, const image_t *past,
       for (label = 0; label < MAXLABELS; label++)
 	 if (wfa->mv_tree[state][label].type != NONE)
 	 {
-	    color_e band;
+	    color_e  band;
 	    unsigned level  = wfa->level_of_state [state] - 1;
 	    unsigned width  = width_of_level (level);
 	    unsigned height = height_of_level (level);
-	    unsigned offset = image->width - width;
+	    const mv_t *mv  = &wfa->mv_tree [state][label];
 	    
-	    switch (wfa->mv_tree [state][label].type)
+	    for (band  = first_band (image->color);
+		 band <= last_band (image->color); band++)
 	    {
-	       case FORWARD:
-		  for (band  = first_band (image->color);
-		       band <= last_band (image->color); band++)
-		  {
-		     extract_mc_block (mcblock1, FX (width), FX (height),
-				       past->pixels [band], FX (past->width),
-				       wfa->wfainfo->half_pixel,
-				       FX (wfa->x [state][label]),
-				       FX (wfa->y [state][label]),
-				       FX (wfa->mv_tree [state][label].fx),
-				       FX (wfa->mv_tree [state][label].fy));
-		     {
-			word_t   *mc1;	/* current pixel in MC block */
-			word_t 	 *orig;	/* current pixel in original image */
-			unsigned  x, y;	/* pixel coordinates */
-			
-			mc1  = mcblock1;
-			orig = (word_t *) image->pixels [band]
-			       + FX (wfa->x[state][label])
-			       + FX (wfa->y[state][label]) * FX (image->width);
-		     
-			for (y = FX (height); y; y--)
-			{
-			   for (x = FX (width); x; x--)
-			      *orig++ += *mc1++;
+	       const word_t *mc1 = NULL; /* current row of MC block 1 */
+	       const word_t *mc2 = NULL; /* current row of MC block 2 */
+	       unsigned	     stride1 = 0;	/* row offsets of MC blocks */
+	       unsigned	     stride2 = 0;
+	       word_t	    *orig;	/* current row of original image */
+	       unsigned	     y;		/* current row */
 
-			   orig += FX (offset);
-			}
-		     }
-		  }
+	       if (mv->type == FORWARD || mv->type == INTERPOLATED)
+		  mc1 = get_mc_block (mcblock1, FX (width), FX (height),
+				      past->pixels [band], FX (past->width),
+				      wfa->wfainfo->half_pixel,
+				      FX (wfa->x [state][label]),
+				      FX (wfa->y [state][label]),
+				      FX (mv->fx), FX (mv->fy), &stride1);
+	       if (mv->type == BACKWARD || mv->type == INTERPOLATED)
+		  mc2 = get_mc_block (mcblock2, FX (width), FX (height),
+				      future->pixels [band],
+				      FX (future->width),
+				      wfa->wfainfo->half_pixel,
+				      FX (wfa->x [state][label]),
+				      FX (wfa->y [state][label]),
+				      FX (mv->bx), FX (mv->by), &stride2);
+	       if (!mc1)		/* backward prediction */
+	       {
+		  mc1     = mc2;
+		  stride1 = stride2;
+		  mc2     = NULL;
+	       }
+	       if (!mc1)
 		  break;
-	       case BACKWARD:
-		  for (band  = first_band (image->color);
-		       band <= last_band (image->color); band++)
-		  {
-		     extract_mc_block (mcblock1, FX (width), FX (height),
-				       future->pixels [band],
-				       FX (future->width),
-				       wfa->wfainfo->half_pixel,
-				       FX (wfa->x [state][label]),
-				       FX (wfa->y [state][label]),
-				       FX (wfa->mv_tree [state][label].bx),
-				       FX (wfa->mv_tree [state][label].by));
-		     {
-			word_t   *mc1;	/* current pixel in MC block 1 */
-			word_t   *orig;	/* current pixel in original image */
-			unsigned  x, y;	/* pixel coordinates */
-			
-			mc1  = mcblock1;
-			orig = (word_t *) image->pixels [band]
-			       + FX (wfa->x[state][label])
-			       + FX (wfa->y[state][label]) * FX (image->width);
-		     
-			for (y = FX (height); y; y--)
-			{
-			   for (x = FX (width); x; x--)
-			      *orig++ += *mc1++;
-
-			   orig += FX (offset);
-			}
-		     }
-		  }
-		  break;
-	       case INTERPOLATED:
-		  for (band  = first_band (image->color);
-		       band <= last_band (image->color); band++)
+	       
+	       orig = (word_t *) image->pixels [band]
+		      + FX (wfa->x[state][label])
+		      + FX (wfa->y[state][label]) * FX (image->width);
+	       
+	       for (y = FX (height); y; y--)
+	       {
+		  if (mc2)
 		  {
-		     extract_mc_block (mcblock1, FX (width), FX (height),
-				       past->pixels [band], FX (past->width),
-				       wfa->wfainfo->half_pixel,
-				       FX (wfa->x[state][label]),
-				       FX (wfa->y[state][label]),
-				       FX (wfa->mv_tree[state][label].fx),
-				       FX (wfa->mv_tree[state][label].fy));
-		     extract_mc_block (mcblock2, FX (width), FX (height),
-				       future->pixels [band],
-				       FX (future->width),
-				       wfa->wfainfo->half_pixel,
-				       FX (wfa->x[state][label]),
-				       FX (wfa->y[state][label]),
-				       FX (wfa->mv_tree[state][label].bx),
-				       FX (wfa->mv_tree[state][label].by));
-		     {
-			word_t   *mc1;	/* current pixel in MC block 1 */
-			word_t   *mc2;	/* current pixel in MC block 1 */
-			word_t   *orig;	/* current pixel in original image */
-			unsigned  x, y;	/* pixel coordinates */
-			
-			mc1  = mcblock1;
-			mc2  = mcblock2;
-			orig = (word_t *) image->pixels [band]
-			       + FX (wfa->x[state][label])
-			       + FX (wfa->y[state][label]) * FX (image->width);
-			
-			for (y = FX (height); y; y--)
-			{
-			   for (x = FX (width); x; x--)
-#ifdef HAVE_SIGNED_SHIFT
-			      *orig++ += (*mc1++ + *mc2++) >> 1;
-#else /* not HAVE_SIGNED_SHIFT */
-			   *orig++ += (*mc1++ + *mc2++) / 2;
-#endif /* not HAVE_SIGNED_SHIFT */
-
-			   orig += FX (offset);
-			}
-		     }
+		     add_mean_words (orig, mc1, mc2, FX (width));
+		     mc2 += stride2;
 		  }
-		  break;
-	       default:
-		  break;
+		  else
+		     add_words (orig, mc1, FX (width));
+		  mc1  += stride1;
+		  orig += FX (image->width);
+	       }
 	    }
 	 }
 
@@ -191,22 +152,20 @@ restore_mc (int enlarge_factor, image_t *image, const image_t *past,
    {
       unsigned	  n;
       word_t	 *ptr;
-      static int *clipping = NULL;
       unsigned	  shift    = image->format == FORMAT_4_2_0 ? 2 : 0;
 
-      if (!clipping)			/* initialize clipping table */
+#if HAVE_PTHREAD_H
       {
-	 int i;
-	    
-	 clipping = fiasco_calloc (256 * 3, sizeof (int));
-	 for (i = -128; i < 128; i++)
-	    clipping [256 + i + 128] = i;
-	 for (i = 0; i < 256; i++)
-	    clipping [i] = clipping [256];
-	 for (i = 512; i < 512 + 256; i++)
-	    clipping [i] = clipping [511];
-	 clipping += 256 + 128;
+	 static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	 pthread_once (&once, init_clipping_table);
       }
+#else /* not HAVE_PTHREAD_H */
+      if (!clipping)			/* initialize clipping table */
+	 init_clipping_table ();
+#endif /* not HAVE_PTHREAD_H */
+      if (!clipping)
+	 error ("Out of memory!");
 	 
       ptr = image->pixels [Cb];
       for (n = (image->width * image->height) >> shift; n; n--, ptr++)
@@ -228,16 +187,55 @@ restore_mc (int enlarge_factor, image_t *image, const image_t *past,
    fiasco_free (mcblock2);
 }
 
+const word_t *
+get_mc_block (word_t *mcblock, unsigned width, unsigned height,
+	      const word_t *reference, unsigned ref_width, bool_t half_pixel,
+	      unsigned xo, unsigned yo, int mx, int my, unsigned *stride)
+/*
+ *  Get motion compensation image of size 'width'x'height' from
+ *  'reference' image (width is given by 'ref_width') like
+ *  extract_mc_block (). Blocks at full pixel positions are not copied
+ *  but taken directly from 'reference', otherwise the block is
+ *  interpolated in 'mcblock'.
+ *
+ *  Return value:
+ *	pointer to the first pixel of the block
+ *
+ *  Side effects:
+ *	'stride' is set to the offset between two rows of the block
+ */
+{
+   if (!half_pixel || ((mx | my) & 1) == 0)
+   {
+      if (half_pixel)
+      {
+	 mx /= 2;
+	 my /= 2;
+      }
+      *stride = ref_width;
+      return reference + ((int) yo + my) * (int) ref_width + (int) xo + mx;
+   }
+   else
+   {
+      extract_mc_block (mcblock, width, height, reference, ref_width,
+			half_pixel, xo, yo, mx, my);
+      *stride = width;
+      return mcblock;
+   }
+}
+
 void
 extract_mc_block (word_t *mcblock, unsigned width, unsigned height,
 		  const word_t *reference, unsigned ref_width,
 		  bool_t half_pixel, unsigned xo, unsigned yo,
-		  unsigned mx, unsigned my)
+		  int mx, int my)
 /*
  *  Extract motion compensation image 'mcblock' of size 'width'x'height'
  *  from 'reference' image (width is given by 'ref_width').
  *  Coordinates of reference block are given by ('xo' + 'mx', 'yo' + 'my').
- *  Use 'half_pixel' precision if specified.
+ *  Use 'half_pixel' precision if specified, then odd components of
+ *  ('mx', 'my') address the pixel between floor (mx / 2) and
+ *  floor (mx / 2) + 1.
  *
  *  No return value.
  *
@@ -250,7 +248,8 @@ extract_mc_block (word_t *mcblock, unsigned width, unsigned height,
       const word_t *rblock;		/* pointer to reference image */
       unsigned	    y;			/* current row */
       
-      rblock  = reference + (yo + my) * ref_width + (xo + mx);
+      rblock  = reference + ((int) yo + my) * (int) ref_width
+		+ (int) xo + mx;
       for (y = height; y; y--) 
       {
 	 memcpy (mcblock, rblock, width * sizeof (word_t));
@@ -268,7 +267,8 @@ extract_mc_block (word_t *mcblock, unsigned width, unsigned height,
       const word_t *rxblock;		/* pointer to next column */
       const word_t *rxyblock;		/* pointer to next column & row */
    
-      rblock   = reference + (yo + my / 2) * ref_width + (xo + mx / 2);
+      rblock   = reference + ((int) yo + (my - (my & 1)) / 2) * (int) ref_width
+		 + (int) xo + (mx - (mx & 1)) / 2;
       ryblock  = rblock + ref_width;	/* pixel in next row */
       rxblock  = rblock + 1;		/* pixel in next column */
       rxyblock = ryblock + 1;		/* pixel in next row & column */
@@ -332,3 +332,36 @@ extract_mc_block (word_t *mcblock, unsigned width, unsigned height,
       }
    }
 }
+
+/*****************************************************************************
+
+				private code
+  
+*****************************************************************************/
+
+static void
+init_clipping_table (void)
+/*
+ *  Initialize the clipping table of the chroma bands.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	local array 'clipping' is initialized, it remains NULL if memory
+ *	is exhausted
+ */
+{
+   int  i;
+   int *table = calloc (256 * 3, sizeof (int));
+   
+   if (!table)
+      return;
+   for (i = -128; i < 128; i++)
+      table [256 + i + 128] = i;
+   for (i = 0; i < 256; i++)
+      table [i] = table [256];
+   for (i = 512; i < 512 + 256; i++)
+      table [i] = table [511];
+
+   clipping = table + 256 + 128;
+}
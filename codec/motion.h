@@ -29,7 +29,11 @@ void
 extract_mc_block (word_t *mcblock, unsigned width, unsigned height,
 		  const word_t *reference, unsigned ref_width,
 		  bool_t half_pixel, unsigned xo, unsigned yo,
-		  unsigned mx, unsigned my);
+		  int mx, int my);
+const word_t *
+get_mc_block (word_t *mcblock, unsigned width, unsigned height,
+	      const word_t *reference, unsigned ref_width, bool_t half_pixel,
+	      unsigned xo, unsigned yo, int mx, int my, unsigned *stride);
 
 #endif /* not _MOTION_H */
 
@@ -28,8 +28,10 @@
 #include "cwfa.h"
 #include "image.h"
 #include "mwfa.h"
+#include "wfalib.h"
 
 #include "motion.h"
+#include "vector.h"
 
 /*****************************************************************************
 
@@ -51,6 +53,18 @@ unsigned mv_code_table [33][2] =
 
 static const unsigned local_range = 6;
 
+/*
+ *  Offsets of the large and small diamond search patterns
+ */
+static const int large_diamond [8][2] =
+{
+   {0, -2}, {1, -1}, {2, 0}, {1, 1}, {0, 2}, {-1, 1}, {-2, 0}, {-1, -1}
+};
+static const int small_diamond [4][2] =
+{
+   {0, -1}, {1, 0}, {0, 1}, {-1, 0}
+};
+
 /*****************************************************************************
 
 				prototypes
@@ -62,19 +76,40 @@ get_mcpe (word_t *mcpe, const image_t *original,
 	  unsigned x0, unsigned y0, unsigned width, unsigned height,
 	  const word_t *mcblock1, const word_t *mcblock2);
 static real_t
-mcpe_norm (const image_t *original, unsigned x0, unsigned y0, unsigned width,
-	   unsigned height, const word_t *mcblock1, const word_t *mcblock2);
+mc_norm (const image_t *original, unsigned x0, unsigned y0, unsigned width,
+	 unsigned height, const word_t *block1, const word_t *block2);
+static const word_t *
+mc_block (word_t *const *plane, unsigned ref_width, unsigned x0, unsigned y0,
+	  int mx, int my, bool_t half_pixel);
+static void
+compute_mc_planes (word_t **plane, const image_t *reference,
+		   bool_t half_pixel);
+static void
+free_mc_planes (word_t **plane);
 static real_t 
 find_best_mv (real_t price, const image_t *original, const image_t *reference,
 	      unsigned x0, unsigned y0, unsigned width, unsigned height,
-	      real_t *bits, int *mx, int *my, const real_t *mc_norms,
-	      const wfa_info_t *wi, const motion_t *mt);
+	      unsigned level, mc_type_e direction, real_t *bits, int *mx,
+	      int *my, const wfa_info_t *wi, motion_t *mt);
+static real_t
+fast_search (real_t price, const image_t *reference, unsigned x0,
+	     unsigned y0, unsigned width, unsigned height, unsigned level,
+	     mc_type_e direction, int *mx, int *my, const wfa_info_t *wi,
+	     motion_t *mt);
+static real_t
+mv_costs (real_t price, real_t limit, const image_t *reference,
+	  unsigned x0, unsigned y0, unsigned width, unsigned height,
+	  int mx, int my, const wfa_info_t *wi, const motion_t *mt);
+static image_t *
+subsample_image (const image_t *image);
 static real_t
 find_second_mv (real_t price, const image_t *original,
-		const image_t *reference, const word_t *mcblock1,
+		word_t *const *plane, const word_t *mcblock1,
 		unsigned xr, unsigned yr, unsigned width, unsigned height,
 		real_t *bits, int *mx, int *my, const wfa_info_t *wi,
 		const motion_t *mt);
+static unsigned
+mv_component_bits (int value, unsigned f_code);
 
 /*****************************************************************************
 
@@ -83,17 +118,19 @@ find_second_mv (real_t price, const image_t *original,
 *****************************************************************************/
 
 motion_t *
-alloc_motion (const wfa_info_t *wi)
+alloc_motion (const wfa_info_t *wi, fiasco_mv_search_e search)
 /*
  *  Motion structure constructor.
  *  Allocate memory for the motion structure and
  *  fill in default values specified by 'wi'.
+ *  Motion vectors are determined with the given 'search' strategy.
  *
  *  Return value:
  *	pointer to the new option structure or NULL on error
  */
 {
    int	     dx;			/* motion vector coordinate */
+   unsigned  f_code = motion_vector_f_code (wi);
    unsigned  level;
    unsigned range_size = wi->half_pixel
 			 ? square (wi->search_range)
@@ -103,6 +140,7 @@ alloc_motion (const wfa_info_t *wi)
    mt->original = NULL;
    mt->past     = NULL;
    mt->future   = NULL;
+   mt->search   = search;
    mt->xbits 	= fiasco_calloc (2 * wi->search_range, sizeof (real_t));
    mt->ybits 	= fiasco_calloc (2 * wi->search_range, sizeof (real_t));
 
@@ -110,7 +148,7 @@ alloc_motion (const wfa_info_t *wi)
    {
       mt->xbits [dx + wi->search_range]
 	 = mt->ybits [dx + wi->search_range]
-	 = mv_code_table [dx + wi->search_range][1];
+	 = mv_component_bits (dx, f_code);
    }
    
    mt->mc_forward_norms = fiasco_calloc (MAXLEVEL, sizeof (real_t *));
@@ -150,9 +188,62 @@ free_motion (motion_t *mt)
    }
    fiasco_free (mt->mc_forward_norms);
    fiasco_free (mt->mc_backward_norms);
+   if (mt->original_half)
+      free_image (mt->original_half);
+   if (mt->past_half)
+      free_image (mt->past_half);
+   if (mt->future_half)
+      free_image (mt->future_half);
+   free_mc_planes (mt->past_plane);
+   free_mc_planes (mt->future_plane);
    fiasco_free (mt);
 }
 
+void
+prepare_motion_search (motion_t *mt, const wfa_info_t *wi)
+/*
+ *  Prepare the motion vector search of the next frame:
+ *  forget the motion vectors of the last frame, interpolate the half
+ *  pixel samples of the reference frames (if 'wi->half_pixel' is set)
+ *  and generate the subsampled images of the pyramid search.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'mt->forward_mv', 'mt->backward_mv' are reset,
+ *	'mt->past_plane', 'mt->future_plane' are computed,
+ *	'mt->original_half', 'mt->past_half', 'mt->future_half' are
+ *	computed (pyramid search)
+ */
+{
+   memset (mt->forward_mv, 0, sizeof (mt->forward_mv));
+   memset (mt->backward_mv, 0, sizeof (mt->backward_mv));
+
+   if (mt->original_half)
+      free_image (mt->original_half);
+   if (mt->past_half)
+      free_image (mt->past_half);
+   if (mt->future_half)
+      free_image (mt->future_half);
+   mt->original_half = mt->past_half = mt->future_half = NULL;
+
+   free_mc_planes (mt->past_plane);
+   free_mc_planes (mt->future_plane);
+   if (mt->past)
+      compute_mc_planes (mt->past_plane, mt->past, wi->half_pixel);
+   if (mt->future)
+      compute_mc_planes (mt->future_plane, mt->future, wi->half_pixel);
+   
+   if (mt->search == FIASCO_MV_SEARCH_PYRAMID)
+   {
+      mt->original_half = subsample_image (mt->original);
+      if (mt->past)
+	 mt->past_half = subsample_image (mt->past);
+      if (mt->future)
+	 mt->future_half = subsample_image (mt->future);
+   }
+}
+
 void
 subtract_mc (image_t *image, const image_t *past, const image_t *future,
 	     const wfa_t *wfa)
@@ -301,7 +392,7 @@ subtract_mc (image_t *image, const image_t *past, const image_t *future,
 
 void
 find_P_frame_mc (word_t *mcpe, real_t price, range_t *range,
-		 const wfa_info_t *wi, const motion_t *mt)
+		 const wfa_info_t *wi, motion_t *mt)
 /*
  *  Determine best motion vector for P-frame.
  *
@@ -324,8 +415,8 @@ find_P_frame_mc (word_t *mcpe, real_t price, range_t *range,
     *  Find best matching forward prediction
     */
    find_best_mv (price, mt->original, mt->past, range->x, range->y,
-		 width, height, &range->mv_coord_bits, &range->mv.fx,
-		 &range->mv.fy, mt->mc_forward_norms [range->level], wi, mt);
+		 width, height, range->level, FORWARD, &range->mv_coord_bits,
+		 &range->mv.fx, &range->mv.fy, wi, mt);
 
    /*
     *  Compute MCPE
@@ -341,7 +432,7 @@ find_P_frame_mc (word_t *mcpe, real_t price, range_t *range,
 
 void
 find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
-		 const wfa_info_t *wi, const motion_t *mt)
+		 const wfa_info_t *wi, motion_t *mt)
 /*
  *  Determines best motion compensation for B-frame.
  *  Steps:
@@ -381,8 +472,8 @@ find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
     */
    forward_costs = find_best_mv (price, mt->original, mt->past,
 				 range->x, range->y, width, height,
-				 &forward_bits, &fx, &fy,
-				 mt->mc_forward_norms [range->level], wi, mt)
+				 range->level, FORWARD, &forward_bits,
+				 &fx, &fy, wi, mt)
 		   + 3 * price; /* code 000 */
 
    /*
@@ -390,8 +481,8 @@ find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
     */
    backward_costs = find_best_mv (price, mt->original, mt->future,
 				  range->x, range->y, width, height,
-				  &backward_bits, &bx, &by,
-				  mt->mc_backward_norms [range->level], wi, mt)
+				  range->level, BACKWARD, &backward_bits,
+				  &bx, &by, wi, mt)
 		    + 3 * price; /* code 001 */
 
    /*
@@ -407,28 +498,26 @@ find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
       /*
        *  Alternative 1: keep forward mv and vary backward mv locally
        */
-      extract_mc_block (mcblock1, width, height, mt->past->pixels [GRAY],
-			mt->past->width, wi->half_pixel,
-			range->x, range->y, fx, fy);
-
       ibx = bx;				/* start with backward coordinates */
       iby = by;
-      icosts1 = find_second_mv (price, mt->original, mt->future,
-				mcblock1, range->x, range->y, width, height,
+      icosts1 = find_second_mv (price, mt->original, mt->future_plane,
+				mc_block (mt->past_plane, mt->past->width,
+					  range->x, range->y, fx, fy,
+					  wi->half_pixel),
+				range->x, range->y, width, height,
 				&ibackward_bits, &ibx, &iby, wi, mt)
 		+ (forward_bits + 2) * price; /* code 01 */
 
       /*
        *  Alternative 2: Keep backward mv and vary forward mv locally
        */
-      extract_mc_block (mcblock1, width, height, mt->future->pixels [GRAY],
-			mt->future->width, wi->half_pixel,
-			range->x, range->y, bx, by);
-
       ifx = fx;
       ify = fy;
-      icosts2 = find_second_mv (price, mt->original, mt->past,
-				mcblock1, range->x, range->y, width, height,
+      icosts2 = find_second_mv (price, mt->original, mt->past_plane,
+				mc_block (mt->future_plane, mt->future->width,
+					  range->x, range->y, bx, by,
+					  wi->half_pixel),
+				range->x, range->y, width, height,
 				&iforward_bits, &ifx, &ify, wi, mt)
 		+ (backward_bits + 2) * price; /* code 01 */
       
@@ -462,14 +551,14 @@ find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
       iby = by;
       interp_bits = forward_bits + backward_bits;
 
-      extract_mc_block (mcblock1, width, height, mt->past->pixels [GRAY],
-			mt->past->width, wi->half_pixel,
-			range->x, range->y, fx, fy);
-      extract_mc_block (mcblock2, width, height, mt->future->pixels [GRAY],
-			mt->future->width, wi->half_pixel,
-			range->x, range->y, bx, by);
-      interp_costs = mcpe_norm (mt->original, range->x, range->y,
-				width, height, mcblock1, mcblock2)
+      interp_costs = mc_norm (mt->original, range->x, range->y,
+			      width, height,
+			      mc_block (mt->past_plane, mt->past->width,
+					range->x, range->y, fx, fy,
+					wi->half_pixel),
+			      mc_block (mt->future_plane, mt->future->width,
+					range->x, range->y, bx, by,
+					wi->half_pixel))
 		     + (interp_bits + 2) * price; /* code 01 */
    }
 
@@ -546,8 +635,10 @@ void
 fill_norms_table (unsigned x0, unsigned y0, unsigned level,
 		  const wfa_info_t *wi, motion_t *mt)
 /*
- *  Compute norms of difference images for all possible displacements
- *  in 'mc_forward_norm' and 'mc_backward_norm'.
+ *  Compute norms of difference images for all possible full pixel
+ *  displacements in 'mc_forward_norm' and 'mc_backward_norm'.
+ *  Pyramid search uses the displacements of the subsampled images,
+ *  diamond search doesn't need the tables.
  *
  *  No return value.
  *
@@ -556,49 +647,62 @@ fill_norms_table (unsigned x0, unsigned y0, unsigned level,
  *	'mt->mc_forward_norms' are computed 
  */
 {
-   int	     mx, my;			/* coordinates of motion vector */
-   unsigned  sr;			/* mv search range +-'sr' pixels */
-   unsigned  index   = 0;		/* index of motion vector */
-   unsigned  width   = width_of_level (level);
-   unsigned  height  = height_of_level (level);
-   word_t   *mcblock = fiasco_calloc (width * height, sizeof (word_t));
-
+   int	          mx, my;		/* coordinates of motion vector */
+   unsigned       sr;			/* mv search range +-'sr' pixels */
+   unsigned       index   = 0;		/* index of motion vector */
+   unsigned       width   = width_of_level (level);
+   unsigned       height  = height_of_level (level);
+   const image_t *original     = mt->original;
+   word_t *const *past_plane   = mt->past_plane;
+   word_t *const *future_plane = mt->future_plane;
+   word_t        *half_plane [2][4];	/* samples of subsampled frames */
+
+   if (mt->search == FIASCO_MV_SEARCH_DIAMOND)
+      return;
+   
    sr = wi->half_pixel ? wi->search_range / 2 :  wi->search_range;
+
+   if (mt->search == FIASCO_MV_SEARCH_PYRAMID)
+   {
+      memset (half_plane, 0, sizeof (half_plane));
+      half_plane [0][0] = mt->past_half->pixels [GRAY];
+      if (mt->future_half)
+	 half_plane [1][0] = mt->future_half->pixels [GRAY];
+      original     = mt->original_half;
+      past_plane   = half_plane [0];
+      future_plane = half_plane [1];
+      x0          /= 2;
+      y0          /= 2;
+      width        = max (1U, width / 2);
+      height       = max (1U, height / 2);
+      sr          /= 2;
+   }
    
    for (my = -sr; my < (int) sr; my++)
       for (mx = -sr; mx < (int) sr; mx++, index++)
       {
 	  if ((int) x0 + mx < 0 ||	/* block outside visible area */
-	      x0 + mx + width > mt->original->width || 
+	      x0 + mx + width > original->width || 
 	      (int) y0 + my < 0 ||
-	      y0 + my + height > mt->original->height)
+	      y0 + my + height > original->height)
 	  {
 	     mt->mc_forward_norms [level][index]  = 0.0;
 	     mt->mc_backward_norms [level][index] = 0.0;
 	  }
 	  else
 	  {
-	     extract_mc_block (mcblock, width, height, mt->past->pixels [GRAY],
-			       mt->past->width, wi->half_pixel,
-			       x0, y0, mx, my);
 	     mt->mc_forward_norms [level][index]
-		= mcpe_norm (mt->original, x0, y0, width, height,
-			     mcblock, NULL);
+		= mc_norm (original, x0, y0, width, height,
+			   mc_block (past_plane, original->width,
+				     x0, y0, mx, my, NO), NULL);
 
 	     if (mt->frame_type == B_FRAME)
-	     {
-		extract_mc_block (mcblock, width, height,
-				  mt->future->pixels [GRAY],
-				  mt->future->width, wi->half_pixel,
-				  x0, y0, mx, my);
 		mt->mc_backward_norms[level][index]
-		   = mcpe_norm (mt->original, x0, y0, width, height,
-				mcblock, NULL); 
-	     }
+		   = mc_norm (original, x0, y0, width, height,
+			      mc_block (future_plane, original->width,
+					x0, y0, mx, my, NO), NULL);
 	  }
        }
-
-   fiasco_free (mcblock);
 }
 
 /*****************************************************************************
@@ -656,41 +760,148 @@ get_mcpe (word_t *mcpe, const image_t *original, unsigned x0, unsigned y0,
 }
 
 static real_t
-mcpe_norm (const image_t *original, unsigned x0, unsigned y0, unsigned width,
-	   unsigned height, const word_t *mcblock1, const word_t *mcblock2)
+mc_norm (const image_t *original, unsigned x0, unsigned y0, unsigned width,
+	 unsigned height, const word_t *block1, const word_t *block2)
 /*
  *  Compute norm of motion compensation prediction error.
  *  Coordinates of 'original' block are given by ('x0', 'y0')
- *  and 'width', 'height'.
- *  Reference blocks are stored in 'mcimage1' and 'mcimage2'.
+ *  and 'width', 'height'. The reference is either 'block1' or
+ *  ('block1' + 'block2') / 2 (if 'block2' != NULL). Both reference
+ *  blocks are stored in frames of the same width as 'original'.
  *
  *  Return value:
  *	square of norm of difference image
  */
 {
-   unsigned  n;
-   real_t    norm = 0;
-   word_t   *mcpe = fiasco_calloc (width * height, sizeof (word_t));
-   word_t   *ptr  = mcpe;
+   const word_t *oblock = original->pixels [GRAY] + y0 * original->width + x0;
+   real_t	 norm   = 0;
+   unsigned	 y;
    
-   get_mcpe (mcpe, original, x0, y0, width, height, mcblock1, mcblock2);
-
-   for (n = height * width; n; n--, ptr++) 
-      norm += square (*ptr / 16);
-   
-   fiasco_free (mcpe);
+   for (y = height; y; y--)
+   {
+      if (block2)
+      {
+	 norm   += squared_mean_error_words (oblock, block1, block2, width);
+	 block2 += original->width;
+      }
+      else
+	 norm += squared_error_words (oblock, block1, width);
+      block1 += original->width;
+      oblock += original->width;
+   }
    
    return norm;
 }
 
+static const word_t *
+mc_block (word_t *const *plane, unsigned ref_width, unsigned x0, unsigned y0,
+	  int mx, int my, bool_t half_pixel)
+/*
+ *  Locate the motion compensation block of the block ('x0', 'y0') and
+ *  the motion vector ('mx', 'my') in the samples 'plane' of a
+ *  reference frame (width is given by 'ref_width'). Use 'half_pixel'
+ *  precision if specified.
+ *
+ *  Return value:
+ *	pointer to the upper left pixel of the block
+ */
+{
+   if (half_pixel)
+   {
+      unsigned type = (mx & 1) + 2 * (my & 1); /* x, y, xy half pixel */
+
+      return plane [type] + ((int) y0 + (my - (my & 1)) / 2) * (int) ref_width
+	     + (int) x0 + (mx - (mx & 1)) / 2;
+   }
+   else
+      return plane [0] + ((int) y0 + my) * (int) ref_width + (int) x0 + mx;
+}
+
+static void
+compute_mc_planes (word_t **plane, const image_t *reference,
+		   bool_t half_pixel)
+/*
+ *  Compute the samples of the luminance band of the frame 'reference'
+ *  used by motion compensation: 'plane' [0] are the pixels of
+ *  'reference'. If 'half_pixel' is set then the half pixel samples
+ *  between a pixel and its right, lower and lower right neighbors are
+ *  interpolated like in extract_mc_block () and stored in 'plane' [1],
+ *  [2], and [3]. The last row and column repeat the pixels of
+ *  'reference'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'plane' [1], [2], [3] are allocated if 'half_pixel' is set
+ */
+{
+   unsigned	 width  = reference->width;
+   unsigned	 height = reference->height;
+   const word_t *src	= reference->pixels [GRAY];
+   unsigned	 x, y;
+
+   plane [0] = reference->pixels [GRAY];
+   if (!half_pixel)
+      return;
+
+   for (x = 1; x < 4; x++)
+      plane [x] = fiasco_calloc (width * height, sizeof (word_t));
+   
+   for (y = 0; y < height; y++)
+   {
+      const word_t *row  = src + y * width;
+      const word_t *next = y + 1 < height ? row + width : row;
+      word_t	   *xp   = plane [1] + y * width;
+      word_t	   *yp   = plane [2] + y * width;
+      word_t	   *xyp  = plane [3] + y * width;
+      
+      for (x = 0; x < width; x++)
+      {
+	 unsigned r = x + 1 < width ? x + 1 : x;
+	 
+#ifdef HAVE_SIGNED_SHIFT
+	 xp [x]  = (row [x] + row [r]) >> 1;
+	 yp [x]  = (row [x] + next [x]) >> 1;
+	 xyp [x] = (row [x] + row [r] + next [x] + next [r]) >> 2;
+#else /* not HAVE_SIGNED_SHIFT */
+	 xp [x]  = (row [x] + row [r]) / 2;
+	 yp [x]  = (row [x] + next [x]) / 2;
+	 xyp [x] = (row [x] + row [r] + next [x] + next [r]) / 4;
+#endif /* not HAVE_SIGNED_SHIFT */
+      }
+   }
+}
+
+static void
+free_mc_planes (word_t **plane)
+/*
+ *  Discard the half pixel samples of 'plane' computed by
+ *  compute_mc_planes ().
+ *
+ *  No return value.
+ */
+{
+   unsigned n;
+
+   for (n = 1; n < 4; n++)
+      if (plane [n])
+      {
+	 fiasco_free (plane [n]);
+	 plane [n] = NULL;
+      }
+   plane [0] = NULL;
+}
+
 static real_t 
 find_best_mv (real_t price, const image_t *original, const image_t *reference,
 	      unsigned x0, unsigned y0, unsigned width, unsigned height,
-	      real_t *bits, int *mx, int *my, const real_t *mc_norms,
-	      const wfa_info_t *wi, const motion_t *mt)
+	      unsigned level, mc_type_e direction, real_t *bits, int *mx,
+	      int *my, const wfa_info_t *wi, motion_t *mt)
 /*
  *  Find best matching motion vector in image 'reference' to predict
  *  the block ('x0', 'y0') of size 'width'x'height in image 'original'.
+ *  The block is located on the given 'level', 'direction' is FORWARD
+ *  if 'reference' is the past frame and BACKWARD otherwise.
  *
  *  Return values:
  *	prediction costs
@@ -713,31 +924,46 @@ find_best_mv (real_t price, const image_t *original, const image_t *reference,
     *  Find best fitting motion vector:
     *  Use exhaustive search in the interval x,y +- sr (no halfpixel accuracy)
     *					  or x,y +- sr/2  (halfpixel accuracy)
+    *  or one of the fast search strategies.
     */
    sr 	    = wi->half_pixel ? wi->search_range / 2 :  wi->search_range;
    bitshift = (wi->half_pixel ? 2 : 1);	/* bit0 reserved for halfpixel pred. */
-   
-   for (index = 0, y = -sr; y < (int) sr; y++)
-      for (x = -sr; x < (int) sr; x++, index++)
-	 if ((int) x0 + x >= 0 && (int) y0 + y >= 0 &&	
-	     x0 + x + width  <= original->width && 
-	     y0 + y + height <= original->height)
-	 {
-	    /*
-	     *  Block is inside visible area.
-	     *  Compare current costs with 'mincosts'
-	     */
-	    costs = mc_norms [index]
-		    + (mt->xbits [(x + sr) * bitshift]
-		       + mt->ybits [(y + sr) * bitshift]) * price;
-
-	     if (costs < mincosts)
-	     {
-		mincosts = costs;
-		*mx      = x * bitshift;
-		*my      = y * bitshift;
-	     }
-	 }
+
+   if (mt->search == FIASCO_MV_SEARCH_EXHAUSTIVE)
+   {
+      const real_t *mc_norms = direction == FORWARD
+			       ? mt->mc_forward_norms [level]
+			       : mt->mc_backward_norms [level];
+      
+      for (index = 0, y = -sr; y < (int) sr; y++)
+	 for (x = -sr; x < (int) sr; x++, index++)
+	    if ((int) x0 + x >= 0 && (int) y0 + y >= 0 &&	
+		x0 + x + width  <= original->width && 
+		y0 + y + height <= original->height)
+	    {
+	       /*
+		*  Block is inside visible area.
+		*  Compare current costs with 'mincosts'
+		*/
+	       costs = mc_norms [index]
+		       + (mt->xbits [(x + sr) * bitshift]
+			  + mt->ybits [(y + sr) * bitshift]) * price;
+
+	       if (costs < mincosts)
+	       {
+		  mincosts = costs;
+		  *mx      = x * bitshift;
+		  *my      = y * bitshift;
+	       }
+	    }
+   }
+   else
+   {
+      mincosts = fast_search (price, reference, x0, y0, width, height,
+			      level, direction, mx, my, wi, mt);
+      *mx *= bitshift;
+      *my *= bitshift;
+   }
 
    /*
     *  Halfpixel prediction:
@@ -745,9 +971,10 @@ find_best_mv (real_t price, const image_t *original, const image_t *reference,
     */
    if (wi->half_pixel)
    {
-      int	rx, ry;			/* halfpixel refinement */
-      unsigned	bestrx, bestry;		/* coordinates of best mv */
-      word_t   *mcblock = fiasco_calloc (width * height, sizeof (word_t));
+      int	     rx, ry;		/* halfpixel refinement */
+      unsigned	     bestrx, bestry;	/* coordinates of best mv */
+      word_t *const *plane = direction == FORWARD
+			     ? mt->past_plane : mt->future_plane;
       
       bestrx = bestry = 0;
       for (rx = -1; rx <= 1; rx++)
@@ -770,12 +997,9 @@ find_best_mv (real_t price, const image_t *original, const image_t *reference,
 	    /*
 	     *  Compute costs of new motion compensation
 	     */
-	    extract_mc_block (mcblock, width, height,
-			      reference->pixels [GRAY],
-			      reference->width, wi->half_pixel,
-			      x0, y0, *mx + rx, *my + ry);
-	    costs = mcpe_norm (mt->original, x0, y0, width, height, mcblock,
-			       NULL)
+	    costs = mc_norm (mt->original, x0, y0, width, height,
+			     mc_block (plane, reference->width, x0, y0,
+				       *mx + rx, *my + ry, YES), NULL)
 		    + (mt->xbits [*mx + rx + sr * bitshift]
 		       + mt->ybits [*my + ry + sr * bitshift]) * price;
 	    if (costs < mincosts)
@@ -788,8 +1012,6 @@ find_best_mv (real_t price, const image_t *original, const image_t *reference,
 
       *mx += bestrx;
       *my += bestry;
-
-      fiasco_free (mcblock);
    } /* halfpixel */
 	     
    *bits = mt->xbits [*mx + sr * bitshift] + mt->ybits [*my + sr * bitshift];
@@ -797,15 +1019,236 @@ find_best_mv (real_t price, const image_t *original, const image_t *reference,
    return mincosts;
 }
 
+static real_t
+fast_search (real_t price, const image_t *reference, unsigned x0,
+	     unsigned y0, unsigned width, unsigned height, unsigned level,
+	     mc_type_e direction, int *mx, int *my, const wfa_info_t *wi,
+	     motion_t *mt)
+/*
+ *  Fast search of the full pixel motion vector in image 'reference'
+ *  to predict the block ('x0', 'y0') of size 'width'x'height' on the
+ *  given 'level' of the current frame. Candidates are the zero vector
+ *  and the vectors found last in the given 'direction' on the same
+ *  level (neighboring block), the parent and the child level. Pyramid
+ *  search adds the best vector of the subsampled images. The best
+ *  candidate is refined with the large (diamond search only) and the
+ *  small diamond pattern. The search terminates as soon as the mean
+ *  prediction error of a pixel is negligible.
+ *
+ *  Return value:
+ *	prediction costs
+ *
+ *  Side effects:
+ *	'mx', 'my'	coordinates of full pixel motion vector
+ *	'mt->forward_mv' or 'mt->backward_mv' of 'level' is updated
+ */
+{
+   int	    (*last)[2]  = direction == FORWARD
+			  ? mt->forward_mv : mt->backward_mv;
+   int	      candidate [5][2];		/* start vectors of the search */
+   unsigned   candidates = 0;		/* number of start vectors */
+   real_t     negligible = width * height; /* costs of a perfect match */
+   real_t     mincosts	 = MAXCOSTS;	/* best costs so far */
+   unsigned   step;			/* large or small diamond */
+   unsigned   n;
+
+   candidate [candidates][0]   = 0;
+   candidate [candidates++][1] = 0;
+   candidate [candidates][0]   = last [level][0];
+   candidate [candidates++][1] = last [level][1];
+   if (level + 1 < MAXLEVEL)
+   {
+      candidate [candidates][0]   = last [level + 1][0];
+      candidate [candidates++][1] = last [level + 1][1];
+   }
+   if (level > 0)
+   {
+      candidate [candidates][0]   = last [level - 1][0];
+      candidate [candidates++][1] = last [level - 1][1];
+   }
+   
+   if (mt->search == FIASCO_MV_SEARCH_PYRAMID)
+   {
+      /*
+       *  Coarse search: norms of the subsampled images have been
+       *  computed by fill_norms_table (), each norm covers a quarter of
+       *  the pixels of the block.
+       */
+      const real_t  *norms    = direction == FORWARD
+				? mt->mc_forward_norms [level]
+				: mt->mc_backward_norms [level];
+      const image_t *half     = mt->original_half;
+      unsigned	     sr	      = wi->half_pixel
+				? wi->search_range / 2 : wi->search_range;
+      unsigned	     bitshift = wi->half_pixel ? 2 : 1;
+      unsigned	     xh	      = x0 / 2;
+      unsigned	     yh	      = y0 / 2;
+      unsigned	     wh	      = max (1U, width / 2);
+      unsigned	     hh	      = max (1U, height / 2);
+      unsigned	     index    = 0;
+      real_t	     best     = MAXCOSTS;
+      int	     x, y;
+
+      for (y = - (int) (sr / 2); y < (int) (sr / 2); y++)
+	 for (x = - (int) (sr / 2); x < (int) (sr / 2); x++, index++)
+	    if ((int) xh + x >= 0 && (int) yh + y >= 0
+		&& xh + x + wh <= half->width && yh + y + hh <= half->height)
+	    {
+	       real_t costs = 4 * norms [index]
+			      + (mt->xbits [(2 * x + sr) * bitshift]
+				 + mt->ybits [(2 * y + sr) * bitshift])
+			      * price;
+
+	       if (costs < best)
+	       {
+		  best			    = costs;
+		  candidate [candidates][0] = 2 * x;
+		  candidate [candidates][1] = 2 * y;
+	       }
+	    }
+      if (best < MAXCOSTS)
+	 candidates++;
+   }
+
+   *mx = *my = 0;
+   for (n = 0; n < candidates; n++)
+   {
+      real_t costs = mv_costs (price, mincosts, reference, x0, y0,
+			       width, height, candidate [n][0],
+			       candidate [n][1], wi, mt);
+      if (costs < mincosts)
+      {
+	 mincosts = costs;
+	 *mx	  = candidate [n][0];
+	 *my	  = candidate [n][1];
+      }
+   }
+
+   for (step = mt->search == FIASCO_MV_SEARCH_DIAMOND ? 0 : 1;
+	step < 2 && mincosts >= negligible; step++)
+   {
+      const int (*pattern)[2] = step ? small_diamond : large_diamond;
+      unsigned	  points      = step ? 4 : 8;
+      bool_t	  moved;		/* center of pattern has moved */
+
+      do
+      {
+	 int x = *mx;			/* center of pattern */
+	 int y = *my;
+	 
+	 moved = NO;
+	 for (n = 0; n < points; n++)
+	 {
+	    real_t costs = mv_costs (price, mincosts, reference, x0, y0,
+				     width, height, x + pattern [n][0],
+				     y + pattern [n][1], wi, mt);
+	    if (costs < mincosts)
+	    {
+	       mincosts = costs;
+	       *mx	= x + pattern [n][0];
+	       *my	= y + pattern [n][1];
+	       moved	= YES;
+	    }
+	 }
+      } while (moved && mincosts >= negligible);
+   }
+
+   last [level][0] = *mx;
+   last [level][1] = *my;
+   
+   return mincosts;
+}
+
+static real_t
+mv_costs (real_t price, real_t limit, const image_t *reference,
+	  unsigned x0, unsigned y0, unsigned width, unsigned height,
+	  int mx, int my, const wfa_info_t *wi, const motion_t *mt)
+/*
+ *  Compute the costs of the full pixel motion vector ('mx', 'my') in
+ *  image 'reference' to predict the block ('x0', 'y0') of size
+ *  'width'x'height' of the current frame: norm of the prediction
+ *  error plus the bits of the vector. The computation is aborted as
+ *  soon as the costs exceed 'limit'.
+ *
+ *  Return value:
+ *	prediction costs,
+ *	MAXCOSTS if the vector is out of range or the costs exceed 'limit'
+ */
+{
+   unsigned	 sr	  = wi->half_pixel
+			    ? wi->search_range / 2 : wi->search_range;
+   unsigned	 bitshift = wi->half_pixel ? 2 : 1;
+   const image_t *original = mt->original;
+   const word_t *oblock;		/* pointer to original block */
+   const word_t *rblock;		/* pointer to reference block */
+   real_t	 costs;
+   unsigned	 y;
+
+   if (mx < - (int) sr || mx >= (int) sr || my < - (int) sr
+       || my >= (int) sr || (int) x0 + mx < 0 || (int) y0 + my < 0
+       || x0 + mx + width > original->width
+       || y0 + my + height > original->height)
+      return MAXCOSTS;
+   
+   costs  = (mt->xbits [(mx + sr) * bitshift]
+	     + mt->ybits [(my + sr) * bitshift]) * price;
+   oblock = original->pixels [GRAY] + y0 * original->width + x0;
+   rblock = reference->pixels [GRAY] + (y0 + my) * reference->width
+	    + x0 + mx;
+   for (y = height; y && costs < limit; y--)
+   {
+      costs  += squared_error_words (oblock, rblock, width);
+      oblock += original->width;
+      rblock += reference->width;
+   }
+   
+   return costs < limit ? costs : MAXCOSTS;
+}
+
+static image_t *
+subsample_image (const image_t *image)
+/*
+ *  Subsample the luminance band of 'image' by a factor of two in both
+ *  directions, each pixel is the mean of a 2x2 block.
+ *
+ *  Return value:
+ *	pointer to the new grayscale image
+ */
+{
+   unsigned  width  = max (1U, image->width / 2);
+   unsigned  height = max (1U, image->height / 2);
+   image_t  *half   = alloc_image (width, height, NO, FORMAT_4_4_4);
+   word_t   *dst    = half->pixels [GRAY];
+   unsigned  x, y;
+
+   for (y = 0; y < height; y++)
+   {
+      const word_t *src = image->pixels [GRAY]
+			  + min (2 * y, image->height - 1) * image->width;
+      const word_t *next = image->height > 1 ? src + image->width : src;
+      
+      for (x = 0; x < width; x++)
+      {
+	 unsigned x1 = min (2 * x + 1, image->width - 1);
+
+	 *dst++ = (src [2 * x] + src [x1] + next [2 * x] + next [x1]) / 4;
+      }
+   }
+   
+   return half;
+}
+
 static real_t
 find_second_mv (real_t price, const image_t *original,
-		const image_t *reference, const word_t *mcblock1,
+		word_t *const *plane, const word_t *mcblock1,
 		unsigned xr, unsigned yr, unsigned width, unsigned height,
 		real_t *bits, int *mx, int *my, const wfa_info_t *wi,
 		const motion_t *mt)
 /*
  *  Search local area (*mx,*my) for best additional mv.
- *  Overwrite mt->tmpblock.
+ *  'mcblock1' is the first reference block (in a frame of the same
+ *  width as 'original'), the second one is taken from the samples
+ *  'plane' of the other reference frame.
  *  TODO check sr = search_range
  *
  *  Return values:
@@ -821,7 +1264,6 @@ find_second_mv (real_t price, const image_t *original,
    int       x, y;			/* coordinates of motion vector */
    int       y0, y1, x0, x1;		/* start/end coord. of search range */
    unsigned  bitshift;			/* half_pixel coordinates multiplier */
-   word_t   *mcblock2 = fiasco_calloc (width * height, sizeof (word_t));
 
    sr = wi->search_range;
 
@@ -852,12 +1294,9 @@ find_second_mv (real_t price, const image_t *original,
 	     yr * bitshift + y > (original->height - height) * bitshift)
 	    continue;
 	 
-	 extract_mc_block (mcblock2, width, height,
-			   reference->pixels [GRAY], reference->width,
-			   wi->half_pixel, x0, y0, x, y);
-
-	 costs  = mcpe_norm (mt->original, x0, y0, width, height,
-			     mcblock1, mcblock2)
+	 costs  = mc_norm (mt->original, xr, yr, width, height, mcblock1,
+			   mc_block (plane, original->width, xr, yr, x, y,
+				     wi->half_pixel))
 		  + (mt->xbits [x + sr] + mt->ybits [y + sr]) * price;
 	 
 	 if (costs < mincosts)
@@ -870,7 +1309,23 @@ find_second_mv (real_t price, const image_t *original,
 
    *bits = mt->xbits [*mx + sr] + mt->ybits [*my + sr];
 
-   fiasco_free (mcblock2);
-
    return mincosts;
 }
+
+static unsigned
+mv_component_bits (int value, unsigned f_code)
+/*
+ *  Return value:
+ *	number of bits of the motion vector component 'value'
+ *	(see write_mv () in output/mc.c)
+ */
+{
+   if (f_code == 1 || value == 0)
+      return mv_code_table [value + 16][1];
+   else
+   {
+      unsigned magnitude = ((value < 0 ? -value : value) - 1) >> (f_code - 1);
+
+      return mv_code_table [16 + magnitude + 1][1] + f_code - 1;
+   }
+}
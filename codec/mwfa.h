@@ -28,17 +28,19 @@ fill_norms_table (unsigned x0, unsigned y0, unsigned level,
 		  const wfa_info_t *wi, motion_t *mt);
 void
 find_B_frame_mc (word_t *mcpe, real_t price, range_t *range,
-		 const wfa_info_t *wi, const motion_t *mt);
+		 const wfa_info_t *wi, motion_t *mt);
 void
 find_P_frame_mc (word_t *mcpe, real_t price, range_t *range,
-		 const wfa_info_t *wi, const motion_t *mt);
+		 const wfa_info_t *wi, motion_t *mt);
 void
 subtract_mc (image_t *image, const image_t *past, const image_t *future,
 	     const wfa_t *wfa);
 void
 free_motion (motion_t *mt);
 motion_t *
-alloc_motion (const wfa_info_t *wi);
+alloc_motion (const wfa_info_t *wi, fiasco_mv_search_e search);
+void
+prepare_motion_search (motion_t *mt, const wfa_info_t *wi);
 
 #endif /* not _MWFA_H */
 
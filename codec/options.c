@@ -27,6 +27,7 @@
 #include "wfa.h"
 #include "misc.h"
 #include "bit-io.h"
+#include "thread-pool.h"
 #include "fiasco.h"
 #include "options.h"
 
@@ -57,6 +58,11 @@ fiasco_c_options_new (void)
    public->set_smoothing      = fiasco_c_options_set_smoothing;
    public->set_title   	      = fiasco_c_options_set_title;
    public->set_comment        = fiasco_c_options_set_comment;
+   public->set_threads        = fiasco_c_options_set_threads;
+   public->set_mosaic         = fiasco_c_options_set_mosaic;
+   public->set_frame_index    = fiasco_c_options_set_frame_index;
+   public->set_motion_search  = fiasco_c_options_set_motion_search;
+   public->set_search_range   = fiasco_c_options_set_search_range;
    
    strcpy (options->id, "COFIASCO");
 
@@ -97,12 +103,17 @@ fiasco_c_options_new (void)
    options->half_pixel_prediction = NO;
    options->cross_B_search 	  = YES;
    options->B_as_past_ref 	  = YES;
+   options->motion_search 	  = FIASCO_MV_SEARCH_EXHAUSTIVE;
    options->check_for_underflow   = NO;
    options->check_for_overflow 	  = NO;
    options->second_domain_block   = NO;
    options->full_search 	  = NO;
    options->progress_meter 	  = FIASCO_PROGRESS_NONE;
    options->smoothing 	 	  = 70;
+   options->threads 	 	  = 1;
+   options->mosaic_width 	  = 0;
+   options->mosaic_height 	  = 0;
+   options->frame_index 	  = NO;
    options->comment 		  = strdup ("");
    options->title 		  = strdup ("");
    
@@ -679,6 +690,167 @@ fiasco_c_options_set_title (fiasco_c_options_t *options, const char *title)
    }
 }
 
+int
+fiasco_c_options_set_threads (fiasco_c_options_t *options, unsigned threads)
+/*
+ *  Set number of 'threads' used by the coder. If 'threads' is zero then
+ *  use one thread per online processor.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   c_options_t *this = (c_options_t *) cast_c_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   else if (threads > MAXTHREADS)
+   {
+      set_error (_("Number of threads must be in the range [0, %d]."),
+		 MAXTHREADS);
+      return 0;
+   }
+   else
+   {
+      this->threads = threads;
+      return 1;
+   }
+}
+
+int
+fiasco_c_options_set_mosaic (fiasco_c_options_t *options,
+			     unsigned tile_width, unsigned tile_height)
+/*
+ *  Split still images into tiles of size 'tile_width' x 'tile_height'
+ *  which are coded as independent FIASCO streams of a mosaic
+ *  container. If both values are zero then write a single stream.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   c_options_t *this = (c_options_t *) cast_c_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   else if ((tile_width || tile_height)
+	    && (tile_width < 32 || tile_height < 32
+		|| (tile_width & 1) || (tile_height & 1)))
+   {
+      set_error (_("Width and height of mosaic tiles have to be "
+		   "even numbers of at least 32 pixels."));
+      return 0;
+   }
+   else
+   {
+      this->mosaic_width  = tile_width;
+      this->mosaic_height = tile_height;
+      return 1;
+   }
+}
+
+int
+fiasco_c_options_set_frame_index (fiasco_c_options_t *options,
+				  int frame_index)
+/*
+ *  If 'frame_index' is not 0 then append an index of the positions
+ *  of the frames to video streams. The index allows decoders to seek
+ *  to arbitrary frames without decoding all preceding frames.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   c_options_t *this = (c_options_t *) cast_c_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   else
+   {
+      this->frame_index = frame_index ? YES : NO;
+      return 1;
+   }
+}
+
+int
+fiasco_c_options_set_motion_search (fiasco_c_options_t *options,
+				    fiasco_mv_search_e search)
+/*
+ *  Set motion vector 'search' strategy of the video coder. Exhaustive
+ *  search tests every vector of the search range, pyramid search
+ *  tests every vector in subsampled frames and refines the best one,
+ *  diamond search starts at the vectors of neighboring blocks. Both
+ *  fast strategies are considerably faster, but may find worse
+ *  vectors than exhaustive search.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   c_options_t *this = (c_options_t *) cast_c_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   switch (search)
+   {
+      case FIASCO_MV_SEARCH_EXHAUSTIVE:
+      case FIASCO_MV_SEARCH_PYRAMID:
+      case FIASCO_MV_SEARCH_DIAMOND:
+	 this->motion_search = search;
+	 break;
+      default:
+	 set_error (_("Invalid motion vector search `%d' specified "
+		      "(valid values are 0, 1, or 2)."), search);
+	 return 0;
+   }
+   return 1;
+}
+
+int
+fiasco_c_options_set_search_range (fiasco_c_options_t *options,
+				   unsigned search_range)
+/*
+ *  Set the 'search_range' of the video coder: motion vector components
+ *  are in the interval [-'search_range', 'search_range' - 1] (in units
+ *  of half pixels if half pixel prediction is used). Search ranges
+ *  above 16 require file format release 3.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   c_options_t *this = (c_options_t *) cast_c_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   else if (search_range < 2 || search_range > 128)
+   {
+      set_error (_("Invalid search range `%d' specified "
+		   "(valid values are 2, ..., 128)."), search_range);
+      return 0;
+   }
+   else
+   {
+      this->search_range = search_range;
+      return 1;
+   }
+}
+
 c_options_t *
 cast_c_options (fiasco_c_options_t *options)
 /*
@@ -732,6 +904,7 @@ fiasco_d_options_new (void)
    public->set_smoothing      = fiasco_d_options_set_smoothing;
    public->set_magnification  = fiasco_d_options_set_magnification;
    public->set_4_2_0_format   = fiasco_d_options_set_4_2_0_format;
+   public->set_threads        = fiasco_d_options_set_threads;
    
    strcpy (options->id, "DOFIASCO");
 
@@ -741,6 +914,7 @@ fiasco_d_options_new (void)
    options->smoothing 	  = 70;
    options->magnification = 0;
    options->image_format  = FORMAT_4_4_4;
+   options->threads       = 1;
    
    return public;
 }
@@ -845,6 +1019,36 @@ fiasco_d_options_set_4_2_0_format (fiasco_d_options_t *options, int format)
    }
 }
 
+int
+fiasco_d_options_set_threads (fiasco_d_options_t *options, unsigned threads)
+/*
+ *  Set number of 'threads' used by the decoder. If 'threads' is zero then
+ *  use one thread per online processor.
+ *  
+ *  Return value:
+ *	1 on success
+ *	0 otherwise
+ */
+{
+   d_options_t *this = (d_options_t *) cast_d_options (options);
+
+   if (!this)
+   {
+      return 0;
+   }
+   else if (threads > MAXTHREADS)
+   {
+      set_error (_("Number of threads must be in the range [0, %d]."),
+		 MAXTHREADS);
+      return 0;
+   }
+   else
+   {
+      this->threads = threads;
+      return 1;
+   }
+}
+
 d_options_t *
 cast_d_options (fiasco_d_options_t *options)
 /*
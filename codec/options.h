@@ -54,6 +54,7 @@ typedef struct c_options
    bool_t    	       half_pixel_prediction;
    bool_t    	       cross_B_search;
    bool_t    	       B_as_past_ref;
+   fiasco_mv_search_e  motion_search;
    bool_t    	       check_for_underflow;
    bool_t    	       check_for_overflow;
    bool_t    	       second_domain_block;
@@ -62,6 +63,10 @@ typedef struct c_options
    char 	      *title;
    char 	      *comment;
    unsigned    	       smoothing;
+   unsigned    	       threads;
+   unsigned    	       mosaic_width;
+   unsigned    	       mosaic_height;
+   bool_t    	       frame_index;
 } c_options_t;
 
 typedef struct d_options
@@ -70,6 +75,7 @@ typedef struct d_options
    unsigned smoothing;
    unsigned magnification;
    format_e image_format;
+   unsigned threads;
 } d_options_t;
 
 c_options_t *
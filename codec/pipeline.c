@@ -0,0 +1,365 @@
+/*
+ *  pipeline.c:		Parsing of video frames ahead of decoding
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  A parser thread reads the WFA of the next frame(s) of a video while
+ *  the decoder reconstructs the current frame. The parsed WFAs are
+ *  stored in a ring of PIPELINE_DEPTH buffers, the decoder takes them
+ *  in stream order and returns each buffer after the frame has been
+ *  decoded. Errors of the parser are raised when the decoder asks for
+ *  the broken frame, i.e., all frames before are still available.
+ *  Without thread support the frames are parsed on demand.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#if HAVE_PTHREAD_H && HAVE_THREAD_LOCAL && HAVE_SETJMP_H
+#	define USE_THREADS 1
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H && HAVE_THREAD_LOCAL && HAVE_SETJMP_H */
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "fiasco.h"
+#include "misc.h"
+#include "wfalib.h"
+#include "read.h"
+#include "pipeline.h"
+
+/*****************************************************************************
+
+				local variables
+
+*****************************************************************************/
+
+struct pipeline
+/*
+ *  Buffers 'next', ..., 'next' + 'ready' - 1 (modulo PIPELINE_DEPTH)
+ *  contain parsed frames, in total 'used' buffers are either parsed
+ *  or taken by the decoder. All members below 'threaded' are
+ *  protected by 'lock'.
+ */
+{
+   wfa_t	  *wfa [PIPELINE_DEPTH]; /* ring of WFA buffers */
+   unsigned	   number [PIPELINE_DEPTH]; /* display numbers of frames */
+   unsigned	   offset [PIPELINE_DEPTH]; /* stream positions of frames */
+   bitfile_t	  *input;		/* FIASCO stream */
+   bool_t	   threaded;		/* parser thread is running */
+#if USE_THREADS
+   pthread_t	   parser;		/* parser thread */
+   pthread_mutex_t lock;		/* protects the ring */
+   pthread_cond_t  parsed;		/* signals a new frame or an error */
+   pthread_cond_t  returned;		/* signals a free buffer or 'quit' */
+#endif /* USE_THREADS */
+   unsigned	   next;		/* next buffer for the decoder */
+   unsigned	   ready;		/* number of parsed buffers */
+   unsigned	   used;		/* number of non-free buffers */
+   unsigned	   frames;		/* number of frames left to parse */
+   unsigned	   position;		/* stream position of next frame */
+   bool_t	   quit;		/* terminate parser thread */
+   char		  *error_message;	/* error of the parser or NULL */
+};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static wfa_t *
+alloc_buffer (const wfa_t *wfa);
+static void
+free_buffer (wfa_t *wfa);
+#if USE_THREADS
+static void *
+parser_main (void *arg);
+#endif /* USE_THREADS */
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+pipeline_t *
+alloc_pipeline (const wfa_t *wfa, bitfile_t *input, unsigned frames)
+/*
+ *  Pipeline constructor.
+ *  Start a thread that parses the next #'frames' frames of the stream
+ *  'input'. 'wfa' is the constant part of the WFA used by all frames
+ *  (header and basis), each buffer of the pipeline gets a copy of it.
+ *
+ *  Return value:
+ *	pointer to the new pipeline structure
+ */
+{
+   pipeline_t *pipeline = fiasco_calloc (1, sizeof (pipeline_t));
+   unsigned    n;
+
+   assert (wfa && input);
+
+   for (n = 0; n < PIPELINE_DEPTH; n++)
+      pipeline->wfa [n] = alloc_buffer (wfa);
+   pipeline->input    = input;
+   pipeline->frames   = frames;
+   pipeline->position = bits_processed (input);
+   pipeline->threaded = NO;
+
+#if USE_THREADS
+   pthread_mutex_init (&pipeline->lock, NULL);
+   pthread_cond_init (&pipeline->parsed, NULL);
+   pthread_cond_init (&pipeline->returned, NULL);
+   if (pthread_create (&pipeline->parser, NULL, parser_main, pipeline))
+      warning ("Can't create parser thread, frames are parsed on demand.");
+   else
+      pipeline->threaded = YES;
+#endif /* USE_THREADS */
+
+   return pipeline;
+}
+
+unsigned
+free_pipeline (pipeline_t *pipeline)
+/*
+ *  Pipeline destructor.
+ *  Stop the parser thread and free memory of 'pipeline'. Frames which
+ *  have been parsed but not yet taken by pipeline_get_wfa () are
+ *  discarded.
+ *
+ *  Return value:
+ *	stream position (in bits) of the first discarded frame, i.e.,
+ *	decoding continues at this position after seek_bitfile ()
+ *
+ *  Side effects:
+ *	structure 'pipeline' is discarded.
+ */
+{
+   unsigned position;
+   unsigned n;
+
+#if USE_THREADS
+   if (pipeline->threaded)
+   {
+      pthread_mutex_lock (&pipeline->lock);
+      pipeline->quit = YES;
+      pthread_cond_broadcast (&pipeline->returned);
+      pthread_mutex_unlock (&pipeline->lock);
+      pthread_join (pipeline->parser, NULL);
+   }
+   pthread_cond_destroy (&pipeline->returned);
+   pthread_cond_destroy (&pipeline->parsed);
+   pthread_mutex_destroy (&pipeline->lock);
+#endif /* USE_THREADS */
+
+   position = pipeline->ready
+	      ? pipeline->offset [pipeline->next] : pipeline->position;
+
+   for (n = 0; n < PIPELINE_DEPTH; n++)
+      free_buffer (pipeline->wfa [n]);
+   if (pipeline->error_message)
+      fiasco_free (pipeline->error_message);
+   fiasco_free (pipeline);
+
+   return position;
+}
+
+wfa_t *
+pipeline_get_wfa (pipeline_t *pipeline, unsigned *frame_number)
+/*
+ *  Get the WFA of the next frame of the 'pipeline', wait until the
+ *  parser thread has read it. The WFA has to be returned with
+ *  pipeline_put_wfa () when the frame is decoded.
+ *
+ *  Return value:
+ *	pointer to WFA of next frame
+ *
+ *  Side effects:
+ *	display number of the frame is stored in 'frame_number'
+ */
+{
+   wfa_t *wfa = NULL;
+
+#if USE_THREADS
+   if (pipeline->threaded)
+   {
+      char *message = NULL;
+
+      pthread_mutex_lock (&pipeline->lock);
+      while (!pipeline->ready && pipeline->frames
+	     && !pipeline->error_message)
+	 pthread_cond_wait (&pipeline->parsed, &pipeline->lock);
+      if (pipeline->ready)
+      {
+	 wfa           = pipeline->wfa [pipeline->next];
+	 *frame_number = pipeline->number [pipeline->next];
+	 pipeline->next = (pipeline->next + 1) % PIPELINE_DEPTH;
+	 pipeline->ready--;
+      }
+      else if (pipeline->error_message)
+	 message = strdup (pipeline->error_message);
+      pthread_mutex_unlock (&pipeline->lock);
+
+      if (message)
+      {
+	 char text [MAXSTRLEN];
+
+	 strncpy (text, message, MAXSTRLEN - 1);
+	 text [MAXSTRLEN - 1] = 0;
+	 fiasco_free (message);
+	 error ("%s", text);
+      }
+      if (!wfa)
+	 error ("No more frames in stream %s.", pipeline->input->filename);
+      return wfa;
+   }
+#endif /* USE_THREADS */
+
+   if (!pipeline->frames)
+      error ("No more frames in stream %s.", pipeline->input->filename);
+   wfa           = pipeline->wfa [0];
+   *frame_number = read_next_wfa (wfa, pipeline->input);
+   pipeline->frames--;
+   pipeline->position = bits_processed (pipeline->input);
+
+   return wfa;
+}
+
+void
+pipeline_put_wfa (pipeline_t *pipeline, wfa_t *wfa)
+/*
+ *  Return the WFA buffer 'wfa' taken by pipeline_get_wfa () to the
+ *  'pipeline'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the states of the frame are removed from 'wfa',
+ *	the parser may reuse the buffer
+ */
+{
+   remove_states (wfa->basis_states, wfa);
+
+#if USE_THREADS
+   if (pipeline->threaded)
+   {
+      pthread_mutex_lock (&pipeline->lock);
+      pipeline->used--;
+      pthread_cond_signal (&pipeline->returned);
+      pthread_mutex_unlock (&pipeline->lock);
+   }
+#endif /* USE_THREADS */
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static wfa_t *
+alloc_buffer (const wfa_t *wfa)
+/*
+ *  Allocate a WFA buffer and initialize it with a copy of 'wfa'.
+ *  The strings of the header information are shared with 'wfa'.
+ *
+ *  Return value:
+ *	pointer to the new WFA
+ */
+{
+   wfa_t *buffer = alloc_wfa (NO);
+
+   fiasco_free (buffer->wfainfo->title);
+   fiasco_free (buffer->wfainfo->comment);
+   copy_wfa (buffer, wfa);
+
+   return buffer;
+}
+
+static void
+free_buffer (wfa_t *wfa)
+/*
+ *  Free the WFA buffer 'wfa', the shared strings of the header
+ *  information are kept.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'wfa' struct is discarded.
+ */
+{
+   wfa->wfainfo->wfa_name   = NULL;
+   wfa->wfainfo->basis_name = NULL;
+   wfa->wfainfo->title      = NULL;
+   wfa->wfainfo->comment    = NULL;
+   free_wfa (wfa);
+}
+
+#if USE_THREADS
+
+static void *
+parser_main (void *arg)
+/*
+ *  Main loop of the parser thread: read the frames of the stream of
+ *  the pipeline 'arg' as long as free buffers are available.
+ *
+ *  Return value:
+ *	NULL
+ */
+{
+   pipeline_t *pipeline = (pipeline_t *) arg;
+
+   pthread_mutex_lock (&pipeline->lock);
+   for (;;)
+   {
+      unsigned buffer;			/* buffer of next frame */
+      unsigned number = 0;		/* display number of next frame */
+      bool_t   failed = NO;
+
+      while (!pipeline->quit && pipeline->frames
+	     && pipeline->used == PIPELINE_DEPTH)
+	 pthread_cond_wait (&pipeline->returned, &pipeline->lock);
+      if (pipeline->quit || !pipeline->frames)
+	 break;
+      buffer = (pipeline->next + pipeline->ready) % PIPELINE_DEPTH;
+      pthread_mutex_unlock (&pipeline->lock);
+
+      try
+      {
+	 number = read_next_wfa (pipeline->wfa [buffer], pipeline->input);
+      }
+      catch
+      {
+	 failed = YES;
+      }
+
+      pthread_mutex_lock (&pipeline->lock);
+      if (failed)
+      {
+	 pipeline->error_message = strdup (fiasco_get_error_message ());
+	 pthread_cond_broadcast (&pipeline->parsed);
+	 break;
+      }
+      pipeline->number [buffer] = number;
+      pipeline->offset [buffer] = pipeline->position;
+      pipeline->position        = bits_processed (pipeline->input);
+      pipeline->frames--;
+      pipeline->ready++;
+      pipeline->used++;
+      pthread_cond_broadcast (&pipeline->parsed);
+   }
+   pthread_cond_broadcast (&pipeline->parsed);
+   pthread_mutex_unlock (&pipeline->lock);
+
+   return NULL;
+}
+
+#endif /* USE_THREADS */
@@ -0,0 +1,28 @@
+/*
+ *  pipeline.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include "types.h"
+#include "bit-io.h"
+#include "wfa.h"
+
+#define PIPELINE_DEPTH 2		/* number of WFA buffers */
+
+typedef struct pipeline pipeline_t;
+
+pipeline_t *
+alloc_pipeline (const wfa_t *wfa, bitfile_t *input, unsigned frames);
+unsigned
+free_pipeline (pipeline_t *pipeline);
+wfa_t *
+pipeline_get_wfa (pipeline_t *pipeline, unsigned *frame_number);
+void
+pipeline_put_wfa (pipeline_t *pipeline, wfa_t *wfa);
+
+#endif /* not _PIPELINE_H */
@@ -162,7 +162,7 @@ predict_range (real_t max_costs, real_t price, range_t *range, wfa_t *wfa,
 	    if (sd->ip_states_state [level] != NULL)
 	       fiasco_free (sd->ip_states_state [level]);
 	 if (sd->images_of_state != NULL)
-	    fiasco_free (sd->images_of_state);
+	    free_state_image (sd->images_of_state);
 	 if (sd->inner_products != NULL)
 	    fiasco_free (sd->inner_products);
       }
@@ -293,7 +293,7 @@ mc_prediction (real_t max_costs, real_t price, unsigned band, int y_state,
       unsigned  state;
       real_t  	mvt, mvc;
       
-      c->pixels = fiasco_calloc (width * height, sizeof (real_t));
+      c->pixels = fiasco_aligned_calloc (width * height, sizeof (real_t));
       cut_to_bintree (c->pixels, mcpe, width, height, 0, 0, width, height);
    
       /*
@@ -358,7 +358,7 @@ mc_prediction (real_t max_costs, real_t price, unsigned band, int y_state,
 	    fiasco_free (c->ip_images_state[state]);
 	    c->ip_images_state[state] = ipi [state];
 	 }
-      fiasco_free (c->pixels);
+      fiasco_aligned_free (c->pixels);
    }
    else
       costs = MAXCOSTS;
@@ -420,7 +420,8 @@ nd_prediction (real_t max_costs, real_t price, unsigned band, int y_state,
 	 real_t w = - lrange.weight [0] * c->images_of_state [0][0];
 		     
 	 src = c->pixels + range->address * size_of_level (range->level); 
-	 dst = c->pixels = pixels = fiasco_calloc (width * height, sizeof (real_t));
+	 dst = c->pixels = pixels = fiasco_aligned_calloc (width * height,
+							   sizeof (real_t));
 
 	 for (n = width * height; n; n--)
 	    *dst++ = *src++ + w;
@@ -455,7 +456,7 @@ nd_prediction (real_t max_costs, real_t price, unsigned band, int y_state,
       costs += subdivide (max_costs - costs, band, y_state, &rrange, wfa, c,
 			  NO, YES);
       
-      fiasco_free (pixels);
+      fiasco_aligned_free (pixels);
 
       if (costs < max_costs && ischild (rrange.tree)) /* use prediction */
       {
@@ -588,7 +589,7 @@ restore_state_data (unsigned from, unsigned to, unsigned max_level,
       wfa->domain_type [state]        = sd->domain_type;
       
       if (c->images_of_state [state] != NULL)
-	 fiasco_free (c->images_of_state [state]);
+	 free_state_image (c->images_of_state [state]);
       c->images_of_state [state] = sd->images_of_state;
       if (c->ip_images_state [state] != NULL)
 	 fiasco_free (c->ip_images_state [state]);
@@ -102,10 +102,9 @@ subdivide (real_t max_costs, unsigned band, int y_state, range_t *range,
    range_t   lrange;			/* range of lin. comb. approx. */
    range_t   rrange;			/* range of recursive approx. */
    range_t   child [MAXLABELS];		/* new childs of the current range */
-   static unsigned percent = 0;		/* status of progress meter */
 
    if (wfa->wfainfo->level == range->level)
-      percent = 0;
+      c->percent = 0;
    
    range->into [0] = NO_EDGE;		/* default approximation: empty */
    range->tree     = RANGE;
@@ -328,10 +327,10 @@ subdivide (real_t max_costs, unsigned band, int y_state, range_t *range,
 	 
 	       new_percent = (child[label].global_address + 1) * 100.0
 			     / (1 << (wfa->wfainfo->level - child[label].level));
-	       if (new_percent > percent)
+	       if (new_percent > c->percent)
 	       {
-		  percent = new_percent;
-		  info ("%3d%%  \r", percent);
+		  c->percent = new_percent;
+		  info ("%3d%%  \r", c->percent);
 	       }
 	    }
 	    else if (c->options.progress_meter == FIASCO_PROGRESS_BAR)
@@ -341,7 +340,7 @@ subdivide (real_t max_costs, unsigned band, int y_state, range_t *range,
 	       new_percent = (child[label].global_address + 1) * 50.0
 			     / (1 << (wfa->wfainfo->level
 				      - child[label].level));
-	       for (; new_percent > percent; percent++)
+	       for (; new_percent > c->percent; c->percent++)
 	       {
 		  info ("#");
 	       }
@@ -0,0 +1,1179 @@
+/*
+ *  vector.c:		Vectorized inner product and accumulation kernels
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The inner products of the coder are summed up in LANES independent
+ *  partial sums (element i is added to partial sum i % LANES) which
+ *  are finally combined by a fixed binary tree. Every kernel (plain C,
+ *  SSE2, AVX2, AVX-512) uses exactly the same order of additions,
+ *  hence the generated bitstream does not depend on the instruction
+ *  set of the host. Multiplications and additions are never fused.
+ *
+ *  The integer kernels of the decoder compute the pixels of the state
+ *  images: every 16 bit product weight * pixel is scaled by 2^-10,
+ *  multiplied by two and added modulo 2^16. The SIMD kernels
+ *  take the bits 10, ... , 24 of the products from the low and high
+ *  halves computed by pmullw and pmulhw, hence they produce exactly
+ *  the values of the integer arithmetic in plain C.
+ *
+ *  The motion compensation kernels compare a block of the current
+ *  frame with a block of a reference frame row by row. The error of a
+ *  pixel is (difference / 16)^2, the division rounds towards zero like
+ *  in C. Differences of coder pixels fit into 16 bits, hence every
+ *  kernel computes exactly the same integer sum.
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+#if HAVE_IMMINTRIN_H && (defined (__x86_64__) || defined (__i386__)) \
+    && (defined (__clang__) || (defined (__GNUC__) && __GNUC__ >= 6))
+#	define X86_KERNELS 1
+#	include <immintrin.h>
+#endif
+
+/*
+ *  Keep products and sums separate when compiling the C code as well
+ */
+#if defined (__clang__)
+#	pragma STDC FP_CONTRACT OFF
+#elif defined (__GNUC__)
+#	pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "vector.h"
+
+/*****************************************************************************
+
+				local variables
+
+*****************************************************************************/
+
+#define LANES 16			/* number of partial sums */
+
+/*
+ *  Scaling of the product 'p' of a weight and pixel 'i' of a row.
+ *  If the compiler does not provide arithmetic shifts, the decoder
+ *  rounds the pixel in the lower half of each 32 bit word differently,
+ *  the SIMD kernels are used only with arithmetic shifts.
+ */
+#ifdef HAVE_SIGNED_SHIFT
+#	define scale_word(p, i)	(((p) >> 10) << 1)
+#else  /* not HAVE_SIGNED_SHIFT */
+#	ifndef WORDS_BIGENDIAN
+#		define is_low_half(i)	(((i) & 1) == 0)
+#	else  /* WORDS_BIGENDIAN */
+#		define is_low_half(i)	(((i) & 1) == 1)
+#	endif /* WORDS_BIGENDIAN */
+#	define scale_word(p, i)	(is_low_half (i) ? ((p) / 512) & 0xfffe \
+					 : ((p) / 1024) * 2)
+#endif /* not HAVE_SIGNED_SHIFT */
+
+#if X86_KERNELS && defined (HAVE_SIGNED_SHIFT)
+#	define X86_WORD_KERNELS 1
+#endif
+
+typedef real_t (*dot_product_f) (const real_t *a, const real_t *b,
+				 unsigned n);
+typedef void (*add_scaled_f) (real_t *dst, const real_t *src, real_t weight,
+			      unsigned n);
+typedef void (*scale_words_f) (word_t *dst, const word_t *src, int weight,
+			       unsigned n);
+typedef unsigned (*squared_error_f) (const word_t *a, const word_t *b,
+				     unsigned n);
+typedef unsigned (*squared_mean_error_f) (const word_t *a, const word_t *b,
+					  const word_t *c, unsigned n);
+typedef void (*add_words_f) (word_t *dst, const word_t *src, unsigned n);
+typedef void (*add_mean_words_f) (word_t *dst, const word_t *a,
+				  const word_t *b, unsigned n);
+
+static dot_product_f  dot_product_kernel      = NULL;
+static add_scaled_f   add_scaled_kernel       = NULL;
+static scale_words_f  scale_words_kernel      = NULL;
+static scale_words_f  add_scaled_words_kernel = NULL;
+static squared_error_f      squared_error_kernel      = NULL;
+static squared_mean_error_f squared_mean_error_kernel = NULL;
+static add_words_f          add_words_kernel          = NULL;
+static add_mean_words_f     add_mean_words_kernel     = NULL;
+static const char    *kernel_name             = NULL;
+
+#define ISAS 4				/* number of instruction sets */
+
+static const char *isa_names [ISAS] = {"C", "SSE2", "AVX2", "AVX-512"};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static void
+select_kernels (void);
+static void
+init_kernels (void);
+static bool_t
+isa_supported (unsigned isa);
+static void
+use_kernels (unsigned isa);
+static real_t
+sum_lanes (real_t *lane);
+static real_t
+dot_product_c (const real_t *a, const real_t *b, unsigned n);
+static void
+add_scaled_c (real_t *dst, const real_t *src, real_t weight, unsigned n);
+static void
+scale_words_c (word_t *dst, const word_t *src, int weight, unsigned n);
+static void
+add_scaled_words_c (word_t *dst, const word_t *src, int weight, unsigned n);
+static unsigned
+squared_error_c (const word_t *a, const word_t *b, unsigned n);
+static unsigned
+squared_mean_error_c (const word_t *a, const word_t *b, const word_t *c,
+		      unsigned n);
+static void
+add_words_c (word_t *dst, const word_t *src, unsigned n);
+static void
+add_mean_words_c (word_t *dst, const word_t *a, const word_t *b, unsigned n);
+
+#if X86_KERNELS
+static real_t
+dot_product_sse2 (const real_t *a, const real_t *b, unsigned n);
+static void
+add_scaled_sse2 (real_t *dst, const real_t *src, real_t weight, unsigned n);
+static real_t
+dot_product_avx2 (const real_t *a, const real_t *b, unsigned n);
+static void
+add_scaled_avx2 (real_t *dst, const real_t *src, real_t weight, unsigned n);
+static real_t
+dot_product_avx512 (const real_t *a, const real_t *b, unsigned n);
+static void
+add_scaled_avx512 (real_t *dst, const real_t *src, real_t weight,
+		   unsigned n);
+#endif /* X86_KERNELS */
+
+#if X86_WORD_KERNELS
+static void
+scale_words_sse2 (word_t *dst, const word_t *src, int weight, unsigned n);
+static void
+add_scaled_words_sse2 (word_t *dst, const word_t *src, int weight,
+		       unsigned n);
+static void
+scale_words_avx2 (word_t *dst, const word_t *src, int weight, unsigned n);
+static void
+add_scaled_words_avx2 (word_t *dst, const word_t *src, int weight,
+		       unsigned n);
+static unsigned
+squared_error_sse2 (const word_t *a, const word_t *b, unsigned n);
+static unsigned
+squared_mean_error_sse2 (const word_t *a, const word_t *b, const word_t *c,
+			 unsigned n);
+static void
+add_words_sse2 (word_t *dst, const word_t *src, unsigned n);
+static void
+add_mean_words_sse2 (word_t *dst, const word_t *a, const word_t *b,
+		     unsigned n);
+static unsigned
+squared_error_avx2 (const word_t *a, const word_t *b, unsigned n);
+static unsigned
+squared_mean_error_avx2 (const word_t *a, const word_t *b, const word_t *c,
+			 unsigned n);
+static void
+add_words_avx2 (word_t *dst, const word_t *src, unsigned n);
+static void
+add_mean_words_avx2 (word_t *dst, const word_t *a, const word_t *b,
+		     unsigned n);
+#endif /* X86_WORD_KERNELS */
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+real_t
+dot_product (const real_t *a, const real_t *b, unsigned n)
+/*
+ *  Compute the inner product of the vectors 'a' and 'b'.
+ *  'n' is the number of vector elements.
+ *
+ *  Return value:
+ *	inner product <a, b>
+ */
+{
+   init_kernels ();
+
+   return dot_product_kernel (a, b, n);
+}
+
+void
+add_scaled_vector (real_t *dst, const real_t *src, real_t weight, unsigned n)
+/*
+ *  Add the vector 'src' scaled by 'weight' to the vector 'dst'.
+ *  'n' is the number of vector elements.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	dst [i] += weight * src [i], i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   add_scaled_kernel (dst, src, weight, n);
+}
+
+void
+scale_words (word_t *dst, const word_t *src, int weight, unsigned n)
+/*
+ *  Scale the pixels 'src' by the integer 'weight' (weight 512 is
+ *  one half) and store the result in 'dst'.
+ *  'n' is the number of pixels, 'src' and 'dst' must not overlap.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	dst [i] = ((weight * src [i]) >> 10) << 1, i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   scale_words_kernel (dst, src, weight, n);
+}
+
+void
+add_scaled_words (word_t *dst, const word_t *src, int weight, unsigned n)
+/*
+ *  Add the pixels 'src' scaled by the integer 'weight' to the
+ *  pixels 'dst' (see scale_words ()).
+ *  'n' is the number of pixels, 'src' and 'dst' must not overlap.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	dst [i] += ((weight * src [i]) >> 10) << 1, i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   add_scaled_words_kernel (dst, src, weight, n);
+}
+
+unsigned
+squared_error_words (const word_t *a, const word_t *b, unsigned n)
+/*
+ *  Compute the squared error of the pixels 'a' and 'b' (rows of the
+ *  current and of the reference frame). 'n' is the number of pixels.
+ *
+ *  Return value:
+ *	sum of ((a [i] - b [i]) / 16)^2, i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   return squared_error_kernel (a, b, n);
+}
+
+unsigned
+squared_mean_error_words (const word_t *a, const word_t *b, const word_t *c,
+			  unsigned n)
+/*
+ *  Compute the squared error of the pixels 'a' and the mean of the
+ *  pixels 'b' and 'c' (interpolated prediction).
+ *  'n' is the number of pixels.
+ *
+ *  Return value:
+ *	sum of ((a [i] - (b [i] + c [i]) / 2) / 16)^2, i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   return squared_mean_error_kernel (a, b, c, n);
+}
+
+void
+add_words (word_t *dst, const word_t *src, unsigned n)
+/*
+ *  Add the pixels 'src' to the pixels 'dst'.
+ *  'n' is the number of pixels.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	dst [i] += src [i], i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   add_words_kernel (dst, src, n);
+}
+
+void
+add_mean_words (word_t *dst, const word_t *a, const word_t *b, unsigned n)
+/*
+ *  Add the mean of the pixels 'a' and 'b' to the pixels 'dst'.
+ *  'n' is the number of pixels.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	dst [i] += (a [i] + b [i]) >> 1, i = 0, ... , 'n' - 1
+ */
+{
+   init_kernels ();
+
+   add_mean_words_kernel (dst, a, b, n);
+}
+
+const char *
+vector_kernel_name (void)
+/*
+ *  Return value:
+ *	name of the instruction set used by the vector kernels
+ */
+{
+   init_kernels ();
+
+   return kernel_name;
+}
+
+bool_t
+force_vector_kernels (const char *name)
+/*
+ *  Use the kernels of the instruction set 'name' ("C", "SSE2", "AVX2"
+ *  or "AVX-512") instead of the best kernels of the host processor.
+ *  Meant for tests and benchmarks: must not be called while a coder
+ *  or decoder is running.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO  if 'name' is unknown or not supported by the host processor
+ *
+ *  Side effects:
+ *	all kernel pointers and 'kernel_name' are set
+ */
+{
+   unsigned isa;
+
+   init_kernels ();
+
+   for (isa = 0; isa < ISAS; isa++)
+      if (streq (name, isa_names [isa]))
+      {
+	 if (!isa_supported (isa))
+	    return NO;
+	 use_kernels (isa);
+	 return YES;
+      }
+
+   return NO;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static void
+init_kernels (void)
+/*
+ *  Select the vector kernels on the first call.
+ *
+ *  No return value.
+ */
+{
+#if HAVE_PTHREAD_H
+   static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+   pthread_once (&once, select_kernels);
+#else  /* not HAVE_PTHREAD_H */
+   if (!dot_product_kernel)
+      select_kernels ();
+#endif /* not HAVE_PTHREAD_H */
+}
+
+static void
+select_kernels (void)
+/*
+ *  Choose the kernels for the best instruction set supported by
+ *  the host processor.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	all kernel pointers and 'kernel_name' are set
+ */
+{
+   unsigned isa;
+
+   for (isa = ISAS - 1; isa > 0 && !isa_supported (isa); isa--)
+      ;
+   use_kernels (isa);
+}
+
+static bool_t
+isa_supported (unsigned isa)
+/*
+ *  Check whether the host processor supports the instruction set
+ *  'isa_names'['isa'].
+ *
+ *  Return value:
+ *	YES if the kernels of 'isa' may be used
+ *	NO  otherwise
+ */
+{
+   if (isa == 0)			/* plain C */
+      return YES;
+#if X86_KERNELS
+   __builtin_cpu_init ();
+   switch (isa)
+   {
+      case 1:
+	 return __builtin_cpu_supports ("sse2") ? YES : NO;
+      case 2:
+	 return __builtin_cpu_supports ("avx2") ? YES : NO;
+      case 3:
+	 return __builtin_cpu_supports ("avx512f") ? YES : NO;
+   }
+#endif /* X86_KERNELS */
+
+   return NO;
+}
+
+static void
+use_kernels (unsigned isa)
+/*
+ *  Use the kernels of the instruction set 'isa_names'['isa'].
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	all kernel pointers and 'kernel_name' are set
+ */
+{
+   dot_product_kernel      = dot_product_c;
+   add_scaled_kernel       = add_scaled_c;
+   scale_words_kernel      = scale_words_c;
+   add_scaled_words_kernel = add_scaled_words_c;
+   squared_error_kernel      = squared_error_c;
+   squared_mean_error_kernel = squared_mean_error_c;
+   add_words_kernel          = add_words_c;
+   add_mean_words_kernel     = add_mean_words_c;
+   kernel_name             = isa_names [isa];
+
+#if X86_KERNELS
+#	if X86_WORD_KERNELS
+   /*
+    *  16 bit multiplications require AVX-512BW, hence the integer
+    *  kernels use at most AVX2
+    */
+   if (isa >= 2)
+   {
+      scale_words_kernel        = scale_words_avx2;
+      add_scaled_words_kernel   = add_scaled_words_avx2;
+      squared_error_kernel      = squared_error_avx2;
+      squared_mean_error_kernel = squared_mean_error_avx2;
+      add_words_kernel          = add_words_avx2;
+      add_mean_words_kernel     = add_mean_words_avx2;
+   }
+   else if (isa == 1)
+   {
+      scale_words_kernel        = scale_words_sse2;
+      add_scaled_words_kernel   = add_scaled_words_sse2;
+      squared_error_kernel      = squared_error_sse2;
+      squared_mean_error_kernel = squared_mean_error_sse2;
+      add_words_kernel          = add_words_sse2;
+      add_mean_words_kernel     = add_mean_words_sse2;
+   }
+#	endif /* X86_WORD_KERNELS */
+   if (isa == 3)
+   {
+      dot_product_kernel = dot_product_avx512;
+      add_scaled_kernel  = add_scaled_avx512;
+   }
+   else if (isa == 2)
+   {
+      dot_product_kernel = dot_product_avx2;
+      add_scaled_kernel  = add_scaled_avx2;
+   }
+   else if (isa == 1)
+   {
+      dot_product_kernel = dot_product_sse2;
+      add_scaled_kernel  = add_scaled_sse2;
+   }
+#endif /* X86_KERNELS */
+}
+
+static real_t
+sum_lanes (real_t *lane)
+/*
+ *  Combine the partial sums 'lane'[] by the binary tree
+ *  lane [i] += lane [i + w], w = LANES / 2, ... , 1.
+ *
+ *  Return value:
+ *	sum of all partial sums
+ *
+ *  Side effects:
+ *	'lane'[] is overwritten
+ */
+{
+   unsigned w, i;
+
+   for (w = LANES / 2; w; w >>= 1)
+      for (i = 0; i < w; i++)
+	 lane [i] += lane [i + w];
+
+   return lane [0];
+}
+
+static real_t
+dot_product_c (const real_t *a, const real_t *b, unsigned n)
+/*
+ *  Reference implementation of dot_product ().
+ */
+{
+   real_t   lane [LANES];		/* partial sums */
+   unsigned i;
+
+   for (i = 0; i < LANES; i++)
+      lane [i] = 0;
+   for (i = 0; i < n; i++)
+      lane [i % LANES] += a [i] * b [i];
+
+   return sum_lanes (lane);
+}
+
+static void
+add_scaled_c (real_t *dst, const real_t *src, real_t weight, unsigned n)
+/*
+ *  Reference implementation of add_scaled_vector ().
+ */
+{
+   for (; n; n--)
+      *dst++ += *src++ * weight;
+}
+
+static void
+scale_words_c (word_t *dst, const word_t *src, int weight, unsigned n)
+/*
+ *  Reference implementation of scale_words ().
+ */
+{
+   unsigned i;
+   
+   for (i = 0; i < n; i++)
+      dst [i] = scale_word (weight * (int) src [i], i);
+}
+
+static void
+add_scaled_words_c (word_t *dst, const word_t *src, int weight, unsigned n)
+/*
+ *  Reference implementation of add_scaled_words ().
+ */
+{
+   unsigned i;
+   
+   for (i = 0; i < n; i++)
+      dst [i] += scale_word (weight * (int) src [i], i);
+}
+
+static unsigned
+squared_error_c (const word_t *a, const word_t *b, unsigned n)
+/*
+ *  Reference implementation of squared_error_words ().
+ */
+{
+   unsigned sum = 0;
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+   {
+      int e = (a [i] - b [i]) / 16;
+
+      sum += e * e;
+   }
+
+   return sum;
+}
+
+static unsigned
+squared_mean_error_c (const word_t *a, const word_t *b, const word_t *c,
+		      unsigned n)
+/*
+ *  Reference implementation of squared_mean_error_words ().
+ */
+{
+   unsigned sum = 0;
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+   {
+      int e = (a [i] - (b [i] + c [i]) / 2) / 16;
+
+      sum += e * e;
+   }
+
+   return sum;
+}
+
+static void
+add_words_c (word_t *dst, const word_t *src, unsigned n)
+/*
+ *  Reference implementation of add_words ().
+ */
+{
+   for (; n; n--)
+      *dst++ += *src++;
+}
+
+static void
+add_mean_words_c (word_t *dst, const word_t *a, const word_t *b, unsigned n)
+/*
+ *  Reference implementation of add_mean_words ().
+ */
+{
+   for (; n; n--)
+#ifdef HAVE_SIGNED_SHIFT
+      *dst++ += (*a++ + *b++) >> 1;
+#else /* not HAVE_SIGNED_SHIFT */
+      *dst++ += (*a++ + *b++) / 2;
+#endif /* not HAVE_SIGNED_SHIFT */
+}
+
+#if X86_KERNELS
+
+/*
+ *  The x86 kernels are compiled for the particular instruction set only,
+ *  they are never called unless select_kernels () has checked that the
+ *  host supports it. Elements which do not fill a whole block of LANES
+ *  values are added to the stored partial sums in plain C.
+ */
+
+__attribute__ ((target ("sse2")))
+static real_t
+dot_product_sse2 (const real_t *a, const real_t *b, unsigned n)
+{
+   __m128   s0 = _mm_setzero_ps (), s1 = _mm_setzero_ps ();
+   __m128   s2 = _mm_setzero_ps (), s3 = _mm_setzero_ps ();
+   unsigned i;
+
+   for (i = 0; i + LANES <= n; i += LANES)
+   {
+      s0 = _mm_add_ps (s0, _mm_mul_ps (_mm_loadu_ps (a + i),
+				       _mm_loadu_ps (b + i)));
+      s1 = _mm_add_ps (s1, _mm_mul_ps (_mm_loadu_ps (a + i + 4),
+				       _mm_loadu_ps (b + i + 4)));
+      s2 = _mm_add_ps (s2, _mm_mul_ps (_mm_loadu_ps (a + i + 8),
+				       _mm_loadu_ps (b + i + 8)));
+      s3 = _mm_add_ps (s3, _mm_mul_ps (_mm_loadu_ps (a + i + 12),
+				       _mm_loadu_ps (b + i + 12)));
+   }
+   if (i < n)
+   {
+      real_t lane [LANES];
+
+      _mm_storeu_ps (lane, s0);
+      _mm_storeu_ps (lane + 4, s1);
+      _mm_storeu_ps (lane + 8, s2);
+      _mm_storeu_ps (lane + 12, s3);
+      for (; i < n; i++)
+	 lane [i % LANES] += a [i] * b [i];
+      return sum_lanes (lane);
+   }
+   s0 = _mm_add_ps (_mm_add_ps (s0, s2), _mm_add_ps (s1, s3));
+   s0 = _mm_add_ps (s0, _mm_movehl_ps (s0, s0));
+   s0 = _mm_add_ss (s0, _mm_shuffle_ps (s0, s0, _MM_SHUFFLE (1, 1, 1, 1)));
+
+   return _mm_cvtss_f32 (s0);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+add_scaled_sse2 (real_t *dst, const real_t *src, real_t weight, unsigned n)
+{
+   __m128   w = _mm_set1_ps (weight);
+   unsigned i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+      _mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i),
+					  _mm_mul_ps (_mm_loadu_ps (src + i),
+						      w)));
+   add_scaled_c (dst + i, src + i, weight, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static real_t
+dot_product_avx2 (const real_t *a, const real_t *b, unsigned n)
+{
+   __m256   s0 = _mm256_setzero_ps (), s1 = _mm256_setzero_ps ();
+   __m128   s;
+   unsigned i;
+
+   for (i = 0; i + LANES <= n; i += LANES)
+   {
+      s0 = _mm256_add_ps (s0, _mm256_mul_ps (_mm256_loadu_ps (a + i),
+					     _mm256_loadu_ps (b + i)));
+      s1 = _mm256_add_ps (s1, _mm256_mul_ps (_mm256_loadu_ps (a + i + 8),
+					     _mm256_loadu_ps (b + i + 8)));
+   }
+   if (i < n)
+   {
+      real_t lane [LANES];
+
+      _mm256_storeu_ps (lane, s0);
+      _mm256_storeu_ps (lane + 8, s1);
+      for (; i < n; i++)
+	 lane [i % LANES] += a [i] * b [i];
+      return sum_lanes (lane);
+   }
+   s0 = _mm256_add_ps (s0, s1);
+   s  = _mm_add_ps (_mm256_castps256_ps128 (s0),
+		    _mm256_extractf128_ps (s0, 1));
+   s  = _mm_add_ps (s, _mm_movehl_ps (s, s));
+   s  = _mm_add_ss (s, _mm_shuffle_ps (s, s, _MM_SHUFFLE (1, 1, 1, 1)));
+
+   return _mm_cvtss_f32 (s);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+add_scaled_avx2 (real_t *dst, const real_t *src, real_t weight, unsigned n)
+{
+   __m256   w = _mm256_set1_ps (weight);
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      _mm256_storeu_ps (dst + i,
+			_mm256_add_ps (_mm256_loadu_ps (dst + i),
+				       _mm256_mul_ps (_mm256_loadu_ps (src + i),
+						      w)));
+   add_scaled_c (dst + i, src + i, weight, n - i);
+}
+
+__attribute__ ((target ("avx512f")))
+static real_t
+dot_product_avx512 (const real_t *a, const real_t *b, unsigned n)
+{
+   __m512   s0 = _mm512_setzero_ps ();
+   __m256   s1;
+   __m128   s;
+   unsigned i;
+
+   for (i = 0; i + LANES <= n; i += LANES)
+      s0 = _mm512_add_ps (s0, _mm512_mul_ps (_mm512_loadu_ps (a + i),
+					     _mm512_loadu_ps (b + i)));
+   if (i < n)
+   {
+      real_t lane [LANES];
+
+      _mm512_storeu_ps (lane, s0);
+      for (; i < n; i++)
+	 lane [i % LANES] += a [i] * b [i];
+      return sum_lanes (lane);
+   }
+   s1 = _mm256_add_ps (_mm512_castps512_ps256 (s0),
+		       _mm256_castpd_ps (_mm512_extractf64x4_pd
+					 (_mm512_castps_pd (s0), 1)));
+   s  = _mm_add_ps (_mm256_castps256_ps128 (s1),
+		    _mm256_extractf128_ps (s1, 1));
+   s  = _mm_add_ps (s, _mm_movehl_ps (s, s));
+   s  = _mm_add_ss (s, _mm_shuffle_ps (s, s, _MM_SHUFFLE (1, 1, 1, 1)));
+
+   return _mm_cvtss_f32 (s);
+}
+
+__attribute__ ((target ("avx512f")))
+static void
+add_scaled_avx512 (real_t *dst, const real_t *src, real_t weight, unsigned n)
+{
+   __m512   w = _mm512_set1_ps (weight);
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      _mm512_storeu_ps (dst + i,
+			_mm512_add_ps (_mm512_loadu_ps (dst + i),
+				       _mm512_mul_ps (_mm512_loadu_ps (src + i),
+						      w)));
+   add_scaled_c (dst + i, src + i, weight, n - i);
+}
+
+#endif /* X86_KERNELS */
+
+#if X86_WORD_KERNELS
+
+/*
+ *  ((weight * src) >> 10) << 1 (modulo 2^16) consists of the bits
+ *  10, ... , 15 of the low half and the bits 0, ... , 8 of the high half
+ *  of the 32 bit product.
+ */
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+scale_sse2 (__m128i src, __m128i weight)
+{
+   __m128i lo = _mm_mullo_epi16 (src, weight);
+   __m128i hi = _mm_mulhi_epi16 (src, weight);
+
+   return _mm_or_si128 (_mm_slli_epi16 (hi, 7),
+			_mm_slli_epi16 (_mm_srli_epi16 (lo, 10), 1));
+}
+
+__attribute__ ((target ("sse2")))
+static void
+scale_words_sse2 (word_t *dst, const word_t *src, int weight, unsigned n)
+{
+   __m128i  w = _mm_set1_epi16 (weight);
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			scale_sse2 (_mm_loadu_si128 ((const __m128i *)
+						     (src + i)), w));
+   scale_words_c (dst + i, src + i, weight, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+add_scaled_words_sse2 (word_t *dst, const word_t *src, int weight,
+		       unsigned n)
+{
+   __m128i  w = _mm_set1_epi16 (weight);
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi16 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       scale_sse2 (_mm_loadu_si128
+						   ((const __m128i *)
+						    (src + i)), w)));
+   add_scaled_words_c (dst + i, src + i, weight, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+scale_avx2 (__m256i src, __m256i weight)
+{
+   __m256i lo = _mm256_mullo_epi16 (src, weight);
+   __m256i hi = _mm256_mulhi_epi16 (src, weight);
+
+   return _mm256_or_si256 (_mm256_slli_epi16 (hi, 7),
+			   _mm256_slli_epi16 (_mm256_srli_epi16 (lo, 10), 1));
+}
+
+__attribute__ ((target ("avx2")))
+static void
+scale_words_avx2 (word_t *dst, const word_t *src, int weight, unsigned n)
+{
+   __m256i  w = _mm256_set1_epi16 (weight);
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      _mm256_storeu_si256 ((__m256i *) (dst + i),
+			   scale_avx2 (_mm256_loadu_si256 ((const __m256i *)
+							   (src + i)), w));
+   scale_words_sse2 (dst + i, src + i, weight, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+add_scaled_words_avx2 (word_t *dst, const word_t *src, int weight,
+		       unsigned n)
+{
+   __m256i  w = _mm256_set1_epi16 (weight);
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      _mm256_storeu_si256 ((__m256i *) (dst + i),
+			   _mm256_add_epi16 (_mm256_loadu_si256 ((__m256i *)
+								 (dst + i)),
+					     scale_avx2 (_mm256_loadu_si256
+							 ((const __m256i *)
+							  (src + i)), w)));
+   add_scaled_words_sse2 (dst + i, src + i, weight, n - i);
+}
+
+/*
+ *  The mean (a + b) >> 1 is computed as (a >> 1) + (b >> 1) + (a & b & 1)
+ *  which can't overflow. The error kernels round quotients towards zero
+ *  by adding divisor - 1 to negative dividends before the shift.
+ *  The AVX2 kernels process the remaining eight pixels of short rows
+ *  with inlined 128 bit steps: calling the SSE2 kernels from AVX2 code
+ *  stalls at every switch between VEX and legacy encoded instructions.
+ */
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+mean_sse2 (__m128i a, __m128i b)
+{
+   return _mm_add_epi16 (_mm_add_epi16 (_mm_srai_epi16 (a, 1),
+					_mm_srai_epi16 (b, 1)),
+			 _mm_and_si128 (_mm_and_si128 (a, b),
+					_mm_set1_epi16 (1)));
+}
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+squared_error_step_sse2 (__m128i sum, __m128i a, __m128i b)
+{
+   __m128i d = _mm_sub_epi16 (a, b);
+
+   d = _mm_srai_epi16 (_mm_add_epi16 (d, _mm_and_si128 (_mm_srai_epi16 (d, 15),
+							_mm_set1_epi16 (15))),
+		       4);
+
+   return _mm_add_epi32 (sum, _mm_madd_epi16 (d, d));
+}
+
+__attribute__ ((target ("sse2")))
+static inline unsigned
+sum_epi32_sse2 (__m128i s)
+{
+   s = _mm_add_epi32 (s, _mm_shuffle_epi32 (s, _MM_SHUFFLE (1, 0, 3, 2)));
+   s = _mm_add_epi32 (s, _mm_shuffle_epi32 (s, _MM_SHUFFLE (2, 3, 0, 1)));
+
+   return _mm_cvtsi128_si32 (s);
+}
+
+__attribute__ ((target ("sse2")))
+static unsigned
+squared_error_sse2 (const word_t *a, const word_t *b, unsigned n)
+{
+   __m128i  s = _mm_setzero_si128 ();
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      s = squared_error_step_sse2 (s, _mm_loadu_si128 ((const __m128i *)
+						       (a + i)),
+				   _mm_loadu_si128 ((const __m128i *)
+						    (b + i)));
+
+   return sum_epi32_sse2 (s) + squared_error_c (a + i, b + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+squared_mean_error_step_sse2 (__m128i sum, const word_t *a, const word_t *b,
+			      const word_t *c)
+{
+   __m128i x = _mm_loadu_si128 ((const __m128i *) b);
+   __m128i y = _mm_loadu_si128 ((const __m128i *) c);
+   __m128i m = mean_sse2 (x, y);	/* floor ((b + c) / 2) */
+
+   /*
+    *  (b + c) / 2 rounds towards zero: add one to negative odd sums
+    */
+   m = _mm_add_epi16 (m, _mm_and_si128 (_mm_and_si128 (_mm_xor_si128 (x, y),
+						       _mm_srai_epi16 (m, 15)),
+					_mm_set1_epi16 (1)));
+
+   return squared_error_step_sse2 (sum, _mm_loadu_si128 ((const __m128i *) a),
+				   m);
+}
+
+__attribute__ ((target ("sse2")))
+static unsigned
+squared_mean_error_sse2 (const word_t *a, const word_t *b, const word_t *c,
+			 unsigned n)
+{
+   __m128i  s = _mm_setzero_si128 ();
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      s = squared_mean_error_step_sse2 (s, a + i, b + i, c + i);
+
+   return sum_epi32_sse2 (s)
+	  + squared_mean_error_c (a + i, b + i, c + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+add_words_sse2 (word_t *dst, const word_t *src, unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi16 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       _mm_loadu_si128 ((const __m128i *)
+							(src + i))));
+   add_words_c (dst + i, src + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+add_mean_words_sse2 (word_t *dst, const word_t *a, const word_t *b,
+		     unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi16 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       mean_sse2 (_mm_loadu_si128
+						  ((const __m128i *) (a + i)),
+						  _mm_loadu_si128
+						  ((const __m128i *) (b + i)))));
+   add_mean_words_c (dst + i, a + i, b + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+mean_avx2 (__m256i a, __m256i b)
+{
+   return _mm256_add_epi16 (_mm256_add_epi16 (_mm256_srai_epi16 (a, 1),
+					      _mm256_srai_epi16 (b, 1)),
+			    _mm256_and_si256 (_mm256_and_si256 (a, b),
+					      _mm256_set1_epi16 (1)));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+squared_error_step_avx2 (__m256i sum, __m256i a, __m256i b)
+{
+   __m256i d = _mm256_sub_epi16 (a, b);
+
+   d = _mm256_srai_epi16 (_mm256_add_epi16 (d, _mm256_and_si256
+					    (_mm256_srai_epi16 (d, 15),
+					     _mm256_set1_epi16 (15))),
+			  4);
+
+   return _mm256_add_epi32 (sum, _mm256_madd_epi16 (d, d));
+}
+
+__attribute__ ((target ("avx2")))
+static inline unsigned
+sum_epi32_avx2 (__m256i s)
+{
+   __m128i h = _mm_add_epi32 (_mm256_castsi256_si128 (s),
+			      _mm256_extracti128_si256 (s, 1));
+
+   h = _mm_add_epi32 (h, _mm_shuffle_epi32 (h, _MM_SHUFFLE (1, 0, 3, 2)));
+   h = _mm_add_epi32 (h, _mm_shuffle_epi32 (h, _MM_SHUFFLE (2, 3, 0, 1)));
+
+   return _mm_cvtsi128_si32 (h);
+}
+
+__attribute__ ((target ("avx2")))
+static unsigned
+squared_error_avx2 (const word_t *a, const word_t *b, unsigned n)
+{
+   __m256i  s = _mm256_setzero_si256 ();
+   __m128i  h = _mm_setzero_si128 ();
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      s = squared_error_step_avx2 (s, _mm256_loadu_si256 ((const __m256i *)
+							  (a + i)),
+				   _mm256_loadu_si256 ((const __m256i *)
+						       (b + i)));
+   if (i + 8 <= n)
+   {
+      h  = squared_error_step_sse2 (h, _mm_loadu_si128 ((const __m128i *)
+							(a + i)),
+				    _mm_loadu_si128 ((const __m128i *)
+						     (b + i)));
+      i += 8;
+   }
+
+   return sum_epi32_avx2 (s) + sum_epi32_sse2 (h)
+	  + squared_error_c (a + i, b + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static unsigned
+squared_mean_error_avx2 (const word_t *a, const word_t *b, const word_t *c,
+			 unsigned n)
+{
+   __m256i  s = _mm256_setzero_si256 ();
+   __m128i  h = _mm_setzero_si128 ();
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+   {
+      __m256i x = _mm256_loadu_si256 ((const __m256i *) (b + i));
+      __m256i y = _mm256_loadu_si256 ((const __m256i *) (c + i));
+      __m256i m = mean_avx2 (x, y);
+
+      m = _mm256_add_epi16 (m, _mm256_and_si256
+			    (_mm256_and_si256 (_mm256_xor_si256 (x, y),
+					       _mm256_srai_epi16 (m, 15)),
+			     _mm256_set1_epi16 (1)));
+      s = squared_error_step_avx2 (s, _mm256_loadu_si256 ((const __m256i *)
+							  (a + i)), m);
+   }
+
+   if (i + 8 <= n)
+   {
+      h  = squared_mean_error_step_sse2 (h, a + i, b + i, c + i);
+      i += 8;
+   }
+
+   return sum_epi32_avx2 (s) + sum_epi32_sse2 (h)
+	  + squared_mean_error_c (a + i, b + i, c + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+add_words_avx2 (word_t *dst, const word_t *src, unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      _mm256_storeu_si256 ((__m256i *) (dst + i),
+			   _mm256_add_epi16 (_mm256_loadu_si256 ((__m256i *)
+								 (dst + i)),
+					     _mm256_loadu_si256
+					     ((const __m256i *) (src + i))));
+   if (i + 8 <= n)
+   {
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi16 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       _mm_loadu_si128 ((const __m128i *)
+							(src + i))));
+      i += 8;
+   }
+   add_words_c (dst + i, src + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+add_mean_words_avx2 (word_t *dst, const word_t *a, const word_t *b,
+		     unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+      _mm256_storeu_si256 ((__m256i *) (dst + i),
+			   _mm256_add_epi16 (_mm256_loadu_si256 ((__m256i *)
+								 (dst + i)),
+					     mean_avx2 (_mm256_loadu_si256
+							((const __m256i *)
+							 (a + i)),
+							_mm256_loadu_si256
+							((const __m256i *)
+							 (b + i)))));
+   if (i + 8 <= n)
+   {
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi16 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       mean_sse2 (_mm_loadu_si128
+						  ((const __m128i *) (a + i)),
+						  _mm_loadu_si128
+						  ((const __m128i *) (b + i)))));
+      i += 8;
+   }
+   add_mean_words_c (dst + i, a + i, b + i, n - i);
+}
+
+#endif /* X86_WORD_KERNELS */
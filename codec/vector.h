@@ -0,0 +1,35 @@
+/*
+ *  vector.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _VECTOR_H
+#define _VECTOR_H
+
+#include "types.h"
+
+real_t
+dot_product (const real_t *a, const real_t *b, unsigned n);
+void
+add_scaled_vector (real_t *dst, const real_t *src, real_t weight, unsigned n);
+void
+scale_words (word_t *dst, const word_t *src, int weight, unsigned n);
+void
+add_scaled_words (word_t *dst, const word_t *src, int weight, unsigned n);
+unsigned
+squared_error_words (const word_t *a, const word_t *b, unsigned n);
+unsigned
+squared_mean_error_words (const word_t *a, const word_t *b, const word_t *c,
+			  unsigned n);
+void
+add_words (word_t *dst, const word_t *src, unsigned n);
+void
+add_mean_words (word_t *dst, const word_t *a, const word_t *b, unsigned n);
+const char *
+vector_kernel_name (void);
+bool_t
+force_vector_kernels (const char *name);
+
+#endif /* not _VECTOR_H */
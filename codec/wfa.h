@@ -22,9 +22,13 @@
 #define MAXLABELS 2			/* only bintree supported anymore */
 #define MAXLEVEL  22 
 
-#define FIASCO_BINFILE_RELEASE   2
+#define FIASCO_BINFILE_RELEASE   3 /* 3: search range above 16 */
 #define FIASCO_MAGIC	         "FIASCO" /* FIASCO magic number */
 #define FIASCO_BASIS_MAGIC       "Fiasco" /* FIASCO initial basis */
+#define FIASCO_MOSAIC_RELEASE    1
+#define FIASCO_MOSAIC_MAGIC      "MOSAIC" /* container of FIASCO tiles */
+#define FIASCO_INDEX_MAGIC       "FIDX"	  /* frame index of a stream */
+#define FIASCO_INDEX_MAX_BITS    0xffffffffULL /* 32 bit offsets of index */
 
 #define NO_EDGE		-1
 #define RANGE		-1
@@ -98,6 +102,8 @@ typedef struct wfa_info
    rpf_t    *d_rpf;			/* Delta reduced precision format */
    rpf_t    *d_dc_rpf;			/* Delta DC reduced precision format */
    unsigned  frames;			/* number of frames in the video */
+   bool_t    open_ended;		/* number of frames was unknown when
+					   the header has been written */
    unsigned  fps;			/* number of frames per second */
    unsigned  p_min_level;		/* min. level of prediction */
    unsigned  p_max_level;		/* max. level of prediction */
@@ -109,6 +115,20 @@ typedef struct wfa_info
    unsigned  release;			/* FIASCO file format release */
 } wfa_info_t;
 
+typedef struct frame_index
+/*
+ *  Position of the frames of a FIASCO stream (in stream order)
+ */
+{
+   unsigned	 frames;		/* number of frames */
+   unsigned	 size;			/* number of allocated entries */
+   unsigned	*offset;		/* bit offset of each frame, the
+					   last element is the end of the
+					   last frame */
+   frame_type_e	*type;			/* frame type of each frame */
+   unsigned	*number;		/* display number of each frame */
+} frame_index_t;
+
 typedef struct wfa
 /*
  *  Used to store all informations and data structures of a WFA
@@ -151,6 +151,102 @@ free_wfa (wfa_t *wfa)
    fiasco_free (wfa);
 }
 
+frame_index_t *
+alloc_frame_index (unsigned frames)
+/*
+ *  Frame index constructor:
+ *  Allocate an empty index for at most 'frames' frames.
+ *
+ *  Return value:
+ *	pointer to the new frame index
+ */
+{
+   frame_index_t *index = fiasco_calloc (1, sizeof (frame_index_t));
+
+   index->frames = 0;
+   index->size	 = frames + 1;
+   index->offset = fiasco_calloc (index->size, sizeof (unsigned));
+   index->type   = fiasco_calloc (index->size, sizeof (frame_type_e));
+   index->number = fiasco_calloc (index->size, sizeof (unsigned));
+
+   return index;
+}
+
+void
+append_frame_index (frame_index_t *index, unsigned offset,
+		    frame_type_e type, unsigned number)
+/*
+ *  Append the frame 'number' of given 'type' which starts at bit 'offset'
+ *  to the frame 'index'. The index grows if the number of frames
+ *  was not known when it has been allocated.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'index->frames' is incremented
+ */
+{
+   if (index->frames + 1 >= index->size)
+   {
+      unsigned	    size   = index->size * 2;
+      unsigned	   *offset = realloc (index->offset, size * sizeof (unsigned));
+      frame_type_e *type   = realloc (index->type, size * sizeof (frame_type_e));
+      unsigned	   *nr     = realloc (index->number, size * sizeof (unsigned));
+
+      if (!offset || !type || !nr)
+	 error ("Out of memory.");
+      index->offset = offset;
+      index->type   = type;
+      index->number = nr;
+      index->size   = size;
+   }
+   index->offset [index->frames] = offset;
+   index->type [index->frames]	 = type;
+   index->number [index->frames] = number;
+   index->frames++;
+   index->offset [index->frames] = 0;	/* end of last frame is unknown */
+}
+
+void
+free_frame_index (frame_index_t *index)
+/*
+ *  Frame index destructor:
+ *  Free memory of given 'index'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'index' struct is discarded.
+ */
+{
+   fiasco_free (index->offset);
+   fiasco_free (index->type);
+   fiasco_free (index->number);
+   fiasco_free (index);
+}
+
+unsigned
+motion_vector_f_code (const wfa_info_t *wi)
+/*
+ *  Compute the MPEG 'f_code' of the motion vector components of a video
+ *  with parameters 'wi': the VLC of a component covers the interval
+ *  [-16, 16], each f_code above 1 doubles this interval by appending
+ *  'f_code' - 1 bits to the VLC. File format releases up to 2 support
+ *  only f_code 1, i.e., a search range of at most 16.
+ *
+ *  Return value:
+ *	smallest f_code which covers the search range of 'wi'
+ */
+{
+   unsigned f_code = 1;
+
+   if (wi->release > 2)
+      while ((16U << (f_code - 1)) < wi->search_range)
+	 f_code++;
+
+   return f_code;
+}
+
 real_t 
 compute_final_distribution (unsigned state, const wfa_t *wfa)
 /*
@@ -301,6 +397,8 @@ remove_states (unsigned from, wfa_t *wfa)
 	 wfa->mv_tree [state][label].fy   = 0;
 	 wfa->mv_tree [state][label].bx   = 0;
 	 wfa->mv_tree [state][label].by   = 0;
+	 if (wfa->y_column)
+	    wfa->y_column [state][label]  = 0;
       }
       wfa->domain_type [state] = 0;
       wfa->delta_state [state] = FALSE;
@@ -59,6 +59,15 @@ wfa_t *
 alloc_wfa (bool_t coding);
 void
 free_wfa (wfa_t *wfa);
+frame_index_t *
+alloc_frame_index (unsigned frames);
+void
+append_frame_index (frame_index_t *index, unsigned offset,
+		    frame_type_e type, unsigned number);
+void
+free_frame_index (frame_index_t *index);
+unsigned
+motion_vector_f_code (const wfa_info_t *wi);
 bool_t
 locate_delta_images (wfa_t *wfa);
 
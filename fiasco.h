@@ -41,6 +41,8 @@
 #ifndef _FIASCO_H
 #define _FIASCO_H 1
 
+#include <stddef.h>
+
 __BEGIN_DECLS
 
 /****************************************************************************
@@ -95,6 +97,49 @@ typedef enum {FIASCO_PROGRESS_NONE,
 	      FIASCO_PROGRESS_BAR,
 	      FIASCO_PROGRESS_PERCENT} fiasco_progress_e;
 
+/*
+ *  Motion vector search strategy of the video coder
+ *  FIASCO_MV_SEARCH_EXHAUSTIVE: test every vector of the search range
+ *  FIASCO_MV_SEARCH_PYRAMID:    exhaustive search in subsampled frames,
+ *                               refinement in full size frames
+ *  FIASCO_MV_SEARCH_DIAMOND:    diamond search starting at the vectors of
+ *                               neighboring blocks
+ */
+typedef enum {FIASCO_MV_SEARCH_EXHAUSTIVE,
+	      FIASCO_MV_SEARCH_PYRAMID,
+	      FIASCO_MV_SEARCH_DIAMOND} fiasco_mv_search_e;
+
+/*
+ *  Pixel layout of images stored in caller provided buffers
+ *  FIASCO_YUV_420: 8 bit planes Y, Cb, Cr, chroma planes subsampled 2x2
+ *  FIASCO_YUV_444: 8 bit planes Y, Cb, Cr of full size
+ *  FIASCO_RGB_24:  packed pixels R, G, B
+ *  FIASCO_RGBA_32: packed pixels R, G, B, A (A = 255)
+ *  FIASCO_GRAY_8:  8 bit plane Y
+ */
+typedef enum {FIASCO_YUV_420,
+	      FIASCO_YUV_444,
+	      FIASCO_RGB_24,
+	      FIASCO_RGBA_32,
+	      FIASCO_GRAY_8} fiasco_layout_e;
+
+/*
+ *  Callbacks to read or write a FIASCO stream:
+ *  transfer up to 'size' bytes from or to 'buffer', 'data' is the
+ *  user data given when creating the decoder or coder.
+ *  Return the number of bytes transferred, zero indicates end of file
+ *  or an error.
+ */
+typedef size_t (*fiasco_read_f) (void *data, void *buffer, size_t size);
+typedef size_t (*fiasco_write_f) (void *data, const void *buffer,
+				  size_t size);
+/*
+ *  Callback to reposition a FIASCO stream which is written by a coder:
+ *  continue writing at byte 'offset' of the stream. Return 1 on
+ *  success and 0 if the stream doesn't support random access.
+ */
+typedef int (*fiasco_seek_f) (void *data, unsigned long offset);
+
 /*
  * Class to encapsulate FIASCO images.
  */
@@ -123,9 +168,29 @@ typedef struct fiasco_decoder
    const char *		(*get_title)	 (struct fiasco_decoder *decoder);
    const char *		(*get_comment)	 (struct fiasco_decoder *decoder);
    int			(*is_color)	 (struct fiasco_decoder *decoder);
+   fiasco_image_t *	(*get_region)    (struct fiasco_decoder *decoder,
+					  unsigned x0, unsigned y0,
+					  unsigned width, unsigned height);
+   int			(*seek)		 (struct fiasco_decoder *decoder,
+					  unsigned frame);
+   int			(*get_frame_into) (struct fiasco_decoder *decoder,
+					   unsigned char *buffer,
+					   unsigned stride,
+					   fiasco_layout_e layout);
    void *private;
 } fiasco_decoder_t;
 
+/*
+ * Class to store internal state of incremental coder.
+ */
+typedef struct fiasco_encoder
+{
+   int (*push_frame) (struct fiasco_encoder *encoder,
+		      const fiasco_image_t *image);
+   int (*finish)     (struct fiasco_encoder *encoder);
+   void *private;
+} fiasco_encoder_t;
+
 /*
  * Class to encapsulate advanced coder options.
  */
@@ -170,6 +235,17 @@ typedef struct fiasco_c_options
 			      const char *comment);
    int (*set_title)          (struct fiasco_c_options *options,
 			      const char *title);
+   int (*set_threads)        (struct fiasco_c_options *options,
+			      unsigned threads);
+   int (*set_mosaic)         (struct fiasco_c_options *options,
+			      unsigned tile_width,
+			      unsigned tile_height);
+   int (*set_frame_index)    (struct fiasco_c_options *options,
+			      int frame_index);
+   int (*set_motion_search)  (struct fiasco_c_options *options,
+			      fiasco_mv_search_e search);
+   int (*set_search_range)   (struct fiasco_c_options *options,
+			      unsigned search_range);
    void *private;
 } fiasco_c_options_t;
 
@@ -185,6 +261,8 @@ typedef struct fiasco_d_options
 			      int level);
    int (*set_4_2_0_format)   (struct fiasco_d_options *options,
 			      int format);
+   int (*set_threads)        (struct fiasco_d_options *options,
+			      unsigned threads);
    void *private;
 } fiasco_d_options_t;
 
@@ -206,7 +284,7 @@ typedef struct fiasco_renderer
 		       miscellaneous functions
 ****************************************************************************/
   
-/* Get last error message of FIASCO library */
+/* Get last error message of FIASCO library (of the calling thread) */
 const char *fiasco_get_error_message (void);
 
 /* Set verbosity of FIASCO library */
@@ -223,6 +301,16 @@ fiasco_verbosity_e fiasco_get_verbosity (void);
 fiasco_decoder_t *fiasco_decoder_new (const char *filename,
 				      const fiasco_d_options_t *options);
 
+/* Decode FIASCO image or sequence stored in memory */
+fiasco_decoder_t *
+fiasco_decoder_new_from_memory (const void *data, size_t size,
+				const fiasco_d_options_t *options);
+
+/* Decode FIASCO image or sequence provided by callback 'read' */
+fiasco_decoder_t *
+fiasco_decoder_new_from_callback (fiasco_read_f read, void *data,
+				  const fiasco_d_options_t *options);
+
 /* Flush and discard FIASCO decoder */
 int fiasco_decoder_delete (fiasco_decoder_t *decoder);
 
@@ -233,6 +321,19 @@ int fiasco_decoder_write_frame (fiasco_decoder_t *decoder,
 /* Decode next FIASCO frame to FIASCO image structure */
 fiasco_image_t *fiasco_decoder_get_frame (fiasco_decoder_t *decoder);
 
+/* Decode next FIASCO frame to 'buffer' using the pixel 'layout' */
+int fiasco_decoder_get_frame_into (fiasco_decoder_t *decoder,
+				   unsigned char *buffer, unsigned stride,
+				   fiasco_layout_e layout);
+
+/* Decode region of FIASCO mosaic to FIASCO image structure */
+fiasco_image_t *fiasco_decoder_get_region (fiasco_decoder_t *decoder,
+					   unsigned x0, unsigned y0,
+					   unsigned width, unsigned height);
+
+/* Continue decoding of FIASCO sequence with given display 'frame' */
+int fiasco_decoder_seek (fiasco_decoder_t *decoder, unsigned frame);
+
 /* Get width of FIASCO image or sequence */
 unsigned fiasco_decoder_get_width (fiasco_decoder_t *decoder);
 
@@ -245,7 +346,7 @@ int fiasco_decoder_is_color (fiasco_decoder_t *decoder);
 /* Get frame rate of FIASCO sequence */
 unsigned fiasco_decoder_get_rate (fiasco_decoder_t *decoder);
 
-/* Get number of frames of FIASCO file */
+/* Get number of frames of FIASCO file (0 if still unknown) */
 unsigned fiasco_decoder_get_length (fiasco_decoder_t *decoder);
 
 /* Get title of FIASCO file */
@@ -263,6 +364,18 @@ fiasco_decoder_get_comment (fiasco_decoder_t *decoder);
 /* Read FIASCO image (raw ppm or pgm format) */
 fiasco_image_t * fiasco_image_new (const char *filename);
 
+/* Create FIASCO image from the pixels in 'buffer' using the 'layout' */
+fiasco_image_t *
+fiasco_image_new_from_buffer (const unsigned char *buffer,
+			      unsigned width, unsigned height,
+			      unsigned stride, fiasco_layout_e layout);
+
+/* Create FIASCO image which uses the given Y, Cb, Cr planes (no copy) */
+fiasco_image_t *
+fiasco_image_new_from_planes (short *y, short *cb, short *cr,
+			      unsigned width, unsigned height,
+			      int chroma_420);
+
 /* Discard FIASCO image */
 void fiasco_image_delete (fiasco_image_t *image); 
 
@@ -305,6 +418,33 @@ int fiasco_coder (char const * const *inputname,
 		  float quality,
 		  const fiasco_c_options_t *options);
 
+/* Encode image or sequence by FIASCO into a new block of memory */
+int fiasco_coder_to_memory (char const * const *inputname,
+			    void **buffer, size_t *size,
+			    float quality,
+			    const fiasco_c_options_t *options);
+
+/* Encode image or sequence by FIASCO, output is passed to 'write' */
+int fiasco_coder_to_callback (char const * const *inputname,
+			      fiasco_write_f write, void *data,
+			      float quality,
+			      const fiasco_c_options_t *options);
+
+/* Create incremental coder of a sequence, output is passed to 'write',
+   'frames' = 0: number of frames is unknown */
+fiasco_encoder_t *
+fiasco_encoder_new (unsigned width, unsigned height, int color,
+		    unsigned frames, float quality,
+		    const fiasco_c_options_t *options,
+		    fiasco_write_f write, fiasco_seek_f seek, void *data);
+
+/* Encode next frame of the sequence */
+int fiasco_encoder_push_frame (fiasco_encoder_t *encoder,
+			       const fiasco_image_t *image);
+
+/* Flush and discard incremental coder */
+int fiasco_encoder_finish (fiasco_encoder_t *encoder);
+
 /****************************************************************************
 		 coder options functions
 ****************************************************************************/
@@ -397,6 +537,27 @@ int fiasco_c_options_set_comment (fiasco_c_options_t *options,
 int fiasco_c_options_set_title (fiasco_c_options_t *options,
 				const char *title);
 
+/*  Set number of threads used by the coder */
+int fiasco_c_options_set_threads (fiasco_c_options_t *options,
+				  unsigned threads);
+
+/*  Split still images into independently coded tiles */
+int fiasco_c_options_set_mosaic (fiasco_c_options_t *options,
+				 unsigned tile_width,
+				 unsigned tile_height);
+
+/*  Append index of frame positions to FIASCO video streams */
+int fiasco_c_options_set_frame_index (fiasco_c_options_t *options,
+				      int frame_index);
+
+/*  Set motion vector search strategy of the video coder */
+int fiasco_c_options_set_motion_search (fiasco_c_options_t *options,
+					fiasco_mv_search_e search);
+
+/*  Set motion vector search range of the video coder */
+int fiasco_c_options_set_search_range (fiasco_c_options_t *options,
+				       unsigned search_range);
+
 /****************************************************************************
 		 decoder options functions
 ****************************************************************************/
@@ -420,6 +581,10 @@ int fiasco_d_options_set_magnification (fiasco_d_options_t *options,
 int fiasco_d_options_set_4_2_0_format (fiasco_d_options_t *options,
 				     int format);
 
+/*  Set number of threads used by the decoder */
+int fiasco_d_options_set_threads (fiasco_d_options_t *options,
+				  unsigned threads);
+
 __END_DECLS
 
 #endif /* not _FIASCO_H */
@@ -17,6 +17,12 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
@@ -24,6 +30,7 @@
 #include "wfa.h"
 #include "bit-io.h"
 #include "misc.h"
+#include "wfalib.h"
 
 #include "mc.h"
 
@@ -45,13 +52,19 @@ static int mv_code_table [33][2] =
   
 *****************************************************************************/
 
-typedef struct huff_node 
+#define MV_CODE_BITS 11			/* length of the longest codeword */
+
+typedef struct mv_lookup
+/*
+ *  Entry of the lookup table which is indexed by the next MV_CODE_BITS
+ *  bits of the stream.
+ */
 {
-   int		     code_index;	/* leaf if index >= 0 */
-   struct huff_node *left;		/* follow if '0' bit read */
-   struct huff_node *right;		/* follow if '1' bit read */
-   int		     index_set [34];
-} huff_node_t;
+   signed char value;			/* decoded vector component */
+   byte_t      length;			/* codeword length, 0: invalid code */
+} mv_lookup_t;
+
+static mv_lookup_t mv_lookup [1 << MV_CODE_BITS];
 
 /*****************************************************************************
 
@@ -65,11 +78,9 @@ decode_mc_tree (frame_type_e frame_type, unsigned max_state,
 static void
 decode_mc_coords (unsigned max_state, wfa_t *wfa, bitfile_t *input);
 static int
-get_mv (int f_code, huff_node_t *hn, bitfile_t *input);
-static huff_node_t *
-create_huff_tree (void);
+get_mv (int f_code, bitfile_t *input);
 static void
-create_huff_node (huff_node_t *hn, int bits_processed);
+init_mv_lookup (void);
 
 /*****************************************************************************
 
@@ -214,11 +225,20 @@ decode_mc_coords (unsigned max_state, wfa_t *wfa, bitfile_t *input)
    unsigned	       label;		/* current label */
    unsigned	       state;		/* current state */
    mv_t		      *mv;		/* current motion vector */
-   static huff_node_t *huff_mv_root = NULL; /* root of huffman tree */
+   int		       f_code;		/* f_code of the components */
  
-   if (huff_mv_root == NULL)
-      huff_mv_root = create_huff_tree ();
-   
+#if HAVE_PTHREAD_H
+   {
+      static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+      pthread_once (&once, init_mv_lookup);
+   }
+#else /* not HAVE_PTHREAD_H */
+   if (!mv_lookup [(1 << MV_CODE_BITS) - 1].length) /* codeword '1' */
+      init_mv_lookup ();
+#endif /* not HAVE_PTHREAD_H */
+
+   f_code = motion_vector_f_code (wfa->wfainfo);
    for (state = wfa->basis_states; state < max_state; state++)
       for (label = 0; label < MAXLABELS; label++)
       {
@@ -228,18 +248,18 @@ decode_mc_coords (unsigned max_state, wfa_t *wfa, bitfile_t *input)
 	    case NONE:
 	       break;
 	    case FORWARD:
-	       mv->fx = get_mv (1, huff_mv_root, input);
-	       mv->fy = get_mv (1, huff_mv_root, input);
+	       mv->fx = get_mv (f_code, input);
+	       mv->fy = get_mv (f_code, input);
 	       break;	    
 	    case BACKWARD:	    
-	       mv->bx = get_mv (1, huff_mv_root, input);
-	       mv->by = get_mv (1, huff_mv_root, input);
+	       mv->bx = get_mv (f_code, input);
+	       mv->by = get_mv (f_code, input);
 	       break;	    
 	    case INTERPOLATED:   
-	       mv->fx = get_mv (1, huff_mv_root, input);
-	       mv->fy = get_mv (1, huff_mv_root, input);
-	       mv->bx = get_mv (1, huff_mv_root, input);
-	       mv->by = get_mv (1, huff_mv_root, input);
+	       mv->fx = get_mv (f_code, input);
+	       mv->fy = get_mv (f_code, input);
+	       mv->bx = get_mv (f_code, input);
+	       mv->by = get_mv (f_code, input);
 	       break;
 	 }
       }
@@ -248,24 +268,19 @@ decode_mc_coords (unsigned max_state, wfa_t *wfa, bitfile_t *input)
 }
  
 static int
-get_mv (int f_code, huff_node_t *hn, bitfile_t *input)
+get_mv (int f_code, bitfile_t *input)
 /* 
  *  Decode next motion vector component in bitstream 
- *  by traversing the huffman tree.
+ *  by looking up the next MV_CODE_BITS bits in the table 'mv_lookup'.
  */
 {
-   int vlc_code, vlc_code_magnitude, residual, diffvec;
+   int		vlc_code, vlc_code_magnitude, residual, diffvec;
+   mv_lookup_t *entry = mv_lookup + peek_bits (input, MV_CODE_BITS);
 
-   while (hn->code_index < 0)
-   {
-      if (hn->code_index == -2)
-	 error ("wrong huffman code !");
-      if (get_bit (input))
-	 hn = hn->right;
-      else
-	 hn = hn->left;
-   }
-   vlc_code = hn->code_index - 16;
+   if (!entry->length)
+      error ("wrong huffman code !");
+   get_bits (input, entry->length);
+   vlc_code = entry->value;
    if (vlc_code == 0 || f_code == 1) 
       return vlc_code;
 
@@ -279,66 +294,31 @@ get_mv (int f_code, huff_node_t *hn, bitfile_t *input)
    return vlc_code > 0 ? diffvec : - diffvec;
 }
 
-static huff_node_t *
-create_huff_tree (void)
-/*
- *  Construct huffman tree from code table
- */
-{
-   unsigned	i;
-   huff_node_t *huff_root = fiasco_calloc (1, sizeof (huff_node_t));
-   
-   /*
-    *  The nodes' index set contains indices of all codewords that are
-    *  still decodable by traversing further down from the node.
-    *  (The root node has the full index set.)
-    */
-
-   for (i = 0; i < 33; i++)
-      huff_root->index_set [i] = i;
-   huff_root->index_set [i] = -1;	/* end marker */
-
-   create_huff_node (huff_root, 0);
-
-   return huff_root;
-}
-
 static void
-create_huff_node (huff_node_t *hn, int bits_processed)
+init_mv_lookup (void)
 /*
- *  Create one node in the huffman tree
+ *  Construct the lookup table of the motion vector components, which is
+ *  shared by all decoders: each codeword of 'mv_code_table' fills all
+ *  entries which start with the codeword.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'mv_lookup' is filled
  */
 {
-   int lind = 0;			/* next index of left huff_node */
-   int rind = 0;			/* next index of right huff_node */
-   int code_len, i, ind;
+   unsigned i;
 
-   hn->code_index = -1;
-   if (hn->index_set [0] < 0)		/* empty index set ? */
+   for (i = 0; i < 33; i++)
    {
-      hn->code_index = -2;		/* error */
-      return;
-   }
-   hn->left  = fiasco_calloc (1, sizeof (huff_node_t));
-   hn->right = fiasco_calloc (1, sizeof (huff_node_t));
+      unsigned shift = MV_CODE_BITS - mv_code_table [i][1];
+      unsigned first = mv_code_table [i][0] << shift;
+      unsigned n;
 
-   for (i = 0; (ind = hn->index_set[i]) >= 0; i++)
-   {
-      code_len = mv_code_table[ind][1];
-      if (code_len == bits_processed)	/* generate leaf */
+      for (n = 0; n < 1U << shift; n++)
       {
-	 hn->code_index = ind;
-	 fiasco_free (hn->left); 
-	 fiasco_free (hn->right);
-	 return;
+	 mv_lookup [first + n].value  = i - 16;
+	 mv_lookup [first + n].length = mv_code_table [i][1];
       }
-      if (mv_code_table[ind][0] & (1 << (code_len - 1 - bits_processed)))
-	 hn->right->index_set[rind++] = ind;
-      else
-	 hn->left->index_set[lind++] = ind;
    }
-   hn->right->index_set[rind] = -1;	/* set end markers */
-   hn->left->index_set[lind]  = -1;
-   create_huff_node (hn->left, bits_processed + 1);
-   create_huff_node (hn->right, bits_processed + 1);
 }
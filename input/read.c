@@ -47,6 +47,10 @@
 static void
 read_tiling (tiling_t *tiling, unsigned image_width, unsigned image_height,
 	     unsigned image_level, bitfile_t *input);
+static bool_t
+read_index_chunk (unsigned frames, frame_index_t *index, bitfile_t *input);
+static unsigned
+section_length (unsigned *start, const bitfile_t *input);
 
 /*****************************************************************************
 
@@ -71,21 +75,59 @@ open_wfa (const char *filename, wfa_info_t *wi)
    
    assert (filename && wi);
    
+   if (!(input = open_bitfile (filename, "FIASCO_DATA", READ_ACCESS)))
+      file_error (filename);
+   read_wfa_header (input, wi);
+
+   return input;
+}
+
+void
+read_wfa_header (bitfile_t *input, wfa_info_t *wi)
+/*
+ *  Read header information of the WFA stream starting at the current
+ *  position of 'input'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	The values of the header are copied to 'wfainfo'.
+ *	'input' is positioned at the first WFA frame.
+ */
+{
+   const char *filename = input->filename;
+   
+   assert (input && wi);
+   
    wi->wfa_name = strdup (filename);
 
    /*
-    *  Check whether 'filename' is a regular WFA file
+    *  Check whether 'input' is a regular WFA stream
     */
    {
-      unsigned 	n;
-      char     *str;
+      const char *str;
+      const char *mosaic = FIASCO_MOSAIC_MAGIC;
       
-      if (!(input = open_bitfile (filename, "FIASCO_DATA", READ_ACCESS)))
-	 file_error (filename);
-   
-      for (str = FIASCO_MAGIC, n = strlen (FIASCO_MAGIC); n; n--)
-	 if (get_bits (input, 8) != (unsigned) *str++)
-	    error ("Input file %s is not a valid FIASCO file!", filename);
+      for (str = FIASCO_MAGIC; *str; str++)
+      {
+	 unsigned byte = get_bits (input, 8);
+
+	 if (byte == (unsigned) *str)
+	    continue;
+	 /*
+	  *  Mosaics (see is_mosaic ()) are only detected on streams
+	  *  with random access, report them instead of garbage
+	  */
+	 while (str == FIASCO_MAGIC && byte == (unsigned) *mosaic)
+	 {
+	    if (!*++mosaic)
+	       error ("Input file %s is a FIASCO mosaic. Mosaics can be "
+		      "decoded only from files with random access "
+		      "(not from standard input or a pipe).", filename);
+	    byte = get_bits (input, 8);
+	 }
+	 error ("Input file %s is not a valid FIASCO file!", filename);
+      }
       get_bits (input, 8);		/* fetch newline */
    }
    
@@ -158,6 +200,7 @@ open_wfa (const char *filename, wfa_info_t *wi)
       wi->p_min_level       = read_rice_code (rice_k, input);
       wi->p_max_level       = read_rice_code (rice_k, input);
       wi->frames            = read_rice_code (rice_k, input);
+      wi->open_ended	    = wi->frames ? NO : YES;
       wi->smoothing	    = read_rice_code (rice_k, input);
 
       /*
@@ -202,7 +245,7 @@ open_wfa (const char *filename, wfa_info_t *wi)
 				      wi->dc_rpf->range_e);
       }
 
-      if (wi->frames > 1)		/* motion compensation stuff */
+      if (wi->frames > 1 || wi->open_ended) /* motion compensation stuff */
       {
 	 wi->fps           = read_rice_code (rice_k, input);
 	 wi->search_range  = read_rice_code (rice_k, input);
@@ -212,8 +255,13 @@ open_wfa (const char *filename, wfa_info_t *wi)
    }
    
    INPUT_BYTE_ALIGN (input);
-
-   return input;
+   /*
+    *  The number of frames of an open ended stream is zero if the coder
+    *  could not store it, then the stream is terminated by an end marker
+    *  (see write_end_marker ()).
+    */
+   if (wi->open_ended)
+      wi->frames = get_bits (input, 32);
 }
 
 void
@@ -348,18 +396,58 @@ read_next_wfa (wfa_t *wfa, bitfile_t *input)
  *  WFA header information has to be already present in the 'wfainfo' struct.
  *  (i.e. open_wfa must be called first!)
  *  
- *  No return value.
+ *  Return value:
+ *	display number of the frame
  *
  *  Side effects:
  *	wfa->into, wfa->weights, wfa->final_distribution, wfa->states
  *	wfa->x, wfa->y, wfa->level_of_state, wfa->domain_type
  *      mt->type, mt->number are filled with the values of the WFA file.
+ *	wfa->states is zero at the end marker (see parse_next_wfa ()).
+ */
+{
+   unsigned frame_number = parse_next_wfa (wfa, NULL, input);
+
+   /*
+    *  Compute final distribution of all states
+    */
+   {
+      unsigned state;
+   
+      for (state = wfa->basis_states; state <= wfa->states; state++)
+	 wfa->final_distribution[state]
+	    = compute_final_distribution (state, wfa);
+   }
+
+   return frame_number;
+}
+
+unsigned
+parse_next_wfa (wfa_t *wfa, frame_bits_t *bits, bitfile_t *input)
+/*
+ *  Parse next WFA frame of the WFA stream 'input', i.e., read all
+ *  sections of the frame but don't compute the final distribution
+ *  which is required to decode the frame (see read_next_wfa ()).
+ *  If 'bits' is not NULL then store the number of bits of each section.
+ *  If the frame header is the end marker of a stream with an unknown
+ *  number of frames (see write_end_marker ()) then 'wfa'->states is
+ *  set to zero and no other section is read.
+ *  
+ *  Return value:
+ *	display number of the frame
+ *
+ *  Side effects:
+ *	the WFA sections of 'wfa' are filled with the values of the
+ *	WFA file, 'bits' is filled
  */
 {
    tiling_t tiling;			/* tiling information */
    unsigned frame_number;		/* current frame number */
+   unsigned start;			/* start of current section */
    
    assert (wfa && input);
+
+   start = bits_processed (input);
    
    /*
     *  Frame header information
@@ -376,6 +464,10 @@ read_next_wfa (wfa_t *wfa, bitfile_t *input)
    {
       INPUT_BYTE_ALIGN (input);
    }
+   if (bits)
+      bits->header = section_length (&start, input);
+   if (!wfa->states)			/* end marker */
+      return frame_number;
    
    /*
     *  Read image tiling info 
@@ -387,8 +479,12 @@ read_next_wfa (wfa_t *wfa, bitfile_t *input)
       tiling.exponent = 0;
    
    INPUT_BYTE_ALIGN (input);
+   if (bits)
+      bits->tiling = section_length (&start, input);
 
    read_tree (wfa, &tiling, input);
+   if (bits)
+      bits->tree = section_length (&start, input);
 
    /*
     *  Compute domain pool.
@@ -420,9 +516,13 @@ read_next_wfa (wfa_t *wfa, bitfile_t *input)
 
    if (get_bit (input))			/* nondeterministic prediction used */
       read_nd (wfa, input);
+   if (bits)
+      bits->nd = section_length (&start, input);
 
    if (wfa->frame_type != I_FRAME)	/* motion compensation used */
       read_mc (wfa->frame_type, wfa, input);
+   if (bits)
+      bits->mc = section_length (&start, input);
 
    locate_delta_images (wfa);
    
@@ -432,22 +532,74 @@ read_next_wfa (wfa_t *wfa, bitfile_t *input)
    {
       unsigned edges = read_matrices (wfa, input); 
 
+      if (bits)
+	 bits->matrices = section_length (&start, input);
       if (edges)
 	 read_weights (edges, wfa, input);
+      if (bits)
+	 bits->weights = section_length (&start, input);
    }
 
-   /*
-    *  Compute final distribution of all states
-    */
+   return frame_number;
+}
+
+frame_index_t *
+read_frame_index (unsigned first_frame, wfa_t *wfa, bitfile_t *input)
+/*
+ *  Locate the frames of the WFA stream 'input'. The header of the
+ *  stream has to be present in 'wfa'->wfainfo, the first frame starts
+ *  at bit 'first_frame' of 'input'. The positions are taken from the
+ *  frame index of the stream. If the stream has no valid index then
+ *  all frames are read (but not decoded). If the number of frames is
+ *  unknown (zero) then the frames are counted.
+ *
+ *  Return value:
+ *	pointer to the frame index
+ *
+ *  Side effects:
+ *	the input position of 'input' is restored,
+ *	'wfa'->wfainfo->frames is set to the number of frames
+ */
+{
+   unsigned	  position = bits_processed (input);
+   unsigned	  frames   = wfa->wfainfo->frames;
+   frame_index_t *index    = alloc_frame_index (frames);
+
+   if (!read_index_chunk (frames, index, input))
    {
-      unsigned state;
-   
-      for (state = wfa->basis_states; state <= wfa->states; state++)
-	 wfa->final_distribution[state]
-	    = compute_final_distribution (state, wfa);
+      wfa_t *scan = alloc_wfa (NO);	/* frames are parsed into a copy */
+
+      fiasco_free (scan->wfainfo->title);
+      fiasco_free (scan->wfainfo->comment);
+      copy_wfa (scan, wfa);
+      seek_bitfile (input, first_frame);
+      for (index->frames = 0; !frames || index->frames < frames;)
+      {
+	 unsigned offset = bits_processed (input);
+	 unsigned number = parse_next_wfa (scan, NULL, input);
+
+	 if (!scan->states)		/* end marker */
+	 {
+	    index->offset [index->frames] = offset;
+	    break;
+	 }
+	 append_frame_index (index, offset, scan->frame_type, number);
+	 remove_states (scan->basis_states, scan);
+      }
+      if (frames)
+	 index->offset [frames] = bits_processed (input);
+      scan->wfainfo->wfa_name   = NULL; /* strings are shared with 'wfa' */
+      scan->wfainfo->basis_name = NULL;
+      scan->wfainfo->title      = NULL;
+      scan->wfainfo->comment    = NULL;
+      free_wfa (scan);
    }
+   seek_bitfile (input, position);
+   if (!index->frames)
+      error ("Input stream contains no frames.");
+   wfa->wfainfo->frames = index->frames;
 
-   return frame_number;
+   return index;
 }
 
 /*****************************************************************************
@@ -494,3 +646,82 @@ read_tiling (tiling_t *tiling, unsigned image_width, unsigned image_height,
 		      tiling->exponent, get_bit (input) ? YES : NO);
    }
 }
+
+static bool_t
+read_index_chunk (unsigned frames, frame_index_t *index, bitfile_t *input)
+/*
+ *  Read the index of the 'frames' frames which is appended to the
+ *  stream 'input' (see write_frame_index ()). The index consists of
+ *  magic number and number of frames (8 bytes), the 9 byte entries,
+ *  end of the last frame (4 bytes) and offset and magic number of
+ *  the index (8 bytes). If 'frames' is zero then the number of
+ *  frames is taken from the index.
+ *
+ *  Return value:
+ *	YES if a valid index has been stored in 'index'
+ *	NO otherwise
+ */
+{
+   unsigned long long bits = bitfile_length (input); /* bits of stream */
+   unsigned	      length;		/* bytes of stream */
+   unsigned	      start;		/* byte offset of index */
+   unsigned	      n;		/* counter */
+   const char	     *text;		/* next character to compare */
+
+   if (bits > FIASCO_INDEX_MAX_BITS)	/* offsets would not fit */
+      return NO;
+   length = bits / 8;
+   if (length < 20)
+      return NO;
+
+   seek_bitfile (input, (length - 8) * 8);
+   start = get_bits (input, 32);
+   for (text = FIASCO_INDEX_MAGIC; *text; text++)
+      if (get_bits (input, 8) != (unsigned) *text)
+	 return NO;
+   if (start > length - 20)
+      return NO;
+
+   seek_bitfile (input, start * 8);
+   for (text = FIASCO_INDEX_MAGIC; *text; text++)
+      if (get_bits (input, 8) != (unsigned) *text)
+	 return NO;
+   n = get_bits (input, 32);
+   if ((frames && n != frames) || !n || n > (length - start - 20) / 9
+       || start + 20 + 9 * n != length)
+      return NO;
+   frames = n;
+   for (n = 0; n < frames; n++)
+   {
+      unsigned	   offset = get_bits (input, 32);
+      frame_type_e type   = get_bits (input, 8);
+      unsigned	   number = get_bits (input, 32);
+
+      if (type > B_FRAME || number >= frames
+	  || (n && offset <= index->offset [n - 1]))
+	 return NO;
+      append_frame_index (index, offset, type, number);
+   }
+   index->offset [frames] = get_bits (input, 32);
+   if (index->offset [frames] > start * 8)
+      return NO;
+
+   return YES;
+}
+
+static unsigned
+section_length (unsigned *start, const bitfile_t *input)
+/*
+ *  Return value:
+ *	number of bits of 'input' read since bit '*start'
+ *
+ *  Side effects:
+ *	'*start' is set to the current position of 'input'
+ */
+{
+   unsigned length = bits_processed (input) - *start;
+
+   *start = bits_processed (input);
+
+   return length;
+}
@@ -20,12 +20,32 @@
 #include "wfa.h"
 #include "bit-io.h"
 
+typedef struct frame_bits
+/*
+ *  Number of bits of the sections of a WFA frame
+ */
+{
+   unsigned header;			/* frame header */
+   unsigned tiling;			/* image tiling */
+   unsigned tree;			/* bintree partitioning */
+   unsigned nd;				/* nondeterministic prediction */
+   unsigned mc;				/* motion compensation */
+   unsigned matrices;			/* indices of linear combinations */
+   unsigned weights;			/* weights of linear combinations */
+} frame_bits_t;
+
 bitfile_t *
 open_wfa (const char *filename, wfa_info_t *wfainfo);
 void
+read_wfa_header (bitfile_t *input, wfa_info_t *wfainfo);
+void
 read_basis (const char *filename, wfa_t *wfa);
 unsigned
 read_next_wfa (wfa_t *wfa, bitfile_t *input);
+unsigned
+parse_next_wfa (wfa_t *wfa, frame_bits_t *bits, bitfile_t *input);
+frame_index_t *
+read_frame_index (unsigned first_frame, wfa_t *wfa, bitfile_t *input);
 
 #endif /* not _READ_H */
 
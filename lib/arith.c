@@ -24,6 +24,51 @@
 #include "misc.h"
 #include "arith.h"
 
+/******************************************************************************
+
+				local variables
+  
+******************************************************************************/
+
+/*
+ *  Number of leading zero bits of a byte, used by equal_bits ().
+ */
+const unsigned char leading_zeros [256] =
+{
+   8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
+   3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+   2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+   2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*****************************************************************************
+
+				prototypes
+  
+*****************************************************************************/
+
+static void
+init_totals (unsigned *totals, unsigned symbols, const unsigned *counts);
+static unsigned
+cumulative (const unsigned *totals, unsigned symbol);
+static unsigned
+find_symbol (const unsigned *totals, unsigned symbols, unsigned count);
+static void
+update_totals (unsigned *totals, unsigned symbols, unsigned symbol,
+	       unsigned scaling);
+
 /******************************************************************************
 
 				public code
@@ -105,7 +150,7 @@ encode_symbol (unsigned symbol, arith_t *arith, model_t *model)
    u_word_t   high_count;		/* upper bound of 'symbol' interval */
    u_word_t   scale;			/* range of all 'm' symbol intervals */
    unsigned   range;			/* range of current interval */
-   unsigned   index;			/* index of probability model */
+   unsigned  *totals;			/* probability model to use */
    u_word_t   low;			/* start of the current code range  */
    u_word_t   high;			/* end of the current code range    */
    u_word_t   underflow;		/* number of underflow bits pending */
@@ -123,36 +168,18 @@ encode_symbol (unsigned symbol, arith_t *arith, model_t *model)
 
    assert (high > low);
    
+   /*
+    *  Select the probability model of the current context and
+    *  shift 'symbol' into the context. See alloc_model() for more details.
+    */
+   totals = model->totals + model->context * (model->symbols + 1);
    if (model->order > 0)		/* order-'n' model*/
-   {
-      unsigned power;			/* multiplicator */
-      unsigned i;
-
-      /*
-       *  Compute index of the probability model to use.
-       *  See init_model() for more details.
-       */
-      power = 1;			/* multiplicator */
-      index = 0;			/* address of prob. model */
-	 
-      for (i = 0; i < model->order; i++) /* genarate a M-nary number */
-      {
-	 index += model->context [i] * power;	
-	 power *= model->symbols;
-      }
-
-      index *= model->symbols + 1;	/* we need space for M + 1 elements */
+      model->context = model->context / model->symbols
+		       + symbol * model->power;
 
-      for (i = 0; i < model->order - 1; i++)
-	 model->context [i] = model->context [i + 1];
-      model->context [i] = symbol;
-   }
-   else
-      index = 0;
-
-   scale      = model->totals [index + model->symbols];
-   low_count  = model->totals [index + symbol];
-   high_count = model->totals [index + symbol + 1];
+   scale      = cumulative (totals, model->symbols);
+   low_count  = cumulative (totals, symbol);
+   high_count = cumulative (totals, symbol + 1);
 
    /*
     *  Compute the new interval depending on the input 'symbol'.
@@ -164,24 +191,7 @@ encode_symbol (unsigned symbol, arith_t *arith, model_t *model)
    RESCALE_OUTPUT_INTERVAL;
    
    if (model->scale > 0)		/* adaptive model */
-   {
-      unsigned i;
-
-      /*
-       *  Update probability model
-       */
-      for (i = symbol + 1; i <= model->symbols; i++)
-	 model->totals [index + i]++;
-      if (model->totals [index + model->symbols] > model->scale) /* scaling */
-      {
-	 for (i = 1; i <= model->symbols; i++)
-	 {
-	    model->totals [index + i] >>= 1;
-	    if (model->totals [index + i] <= model->totals [index + i - 1])
-	       model->totals [index + i] = model->totals [index + i - 1] + 1;
-	 }
-      }
-   }
+      update_totals (totals, model->symbols, symbol, model->scale);
 
    /*
     *  Store interval values
@@ -207,7 +217,7 @@ encode_array (bitfile_t *output, const unsigned *data, const unsigned *context,
  *  No return value.
  */
 {
-   u_word_t **totals;			/* probability model */
+   unsigned **totals;			/* probability model */
 
    if (!n_context)
       n_context = 1;			/* always use one context */
@@ -218,19 +228,14 @@ encode_array (bitfile_t *output, const unsigned *data, const unsigned *context,
    /*
     *  Allocate probability models, start with uniform distribution
     */
-   totals = fiasco_calloc (n_context, sizeof (u_word_t *));
+   totals = fiasco_calloc (n_context, sizeof (unsigned *));
    {
       unsigned c;
       
       for (c = 0; c < n_context; c++)
       {
-	 unsigned i;
-      
-	 totals [c]    = fiasco_calloc (c_symbols [c] + 1, sizeof (u_word_t));
-	 totals [c][0] = 0;
-      
-	 for (i = 0; i < c_symbols [c]; i++)
-	    totals [c][i + 1] = totals [c][i] + 1;
+	 totals [c] = fiasco_calloc (c_symbols [c] + 1, sizeof (unsigned));
+	 init_totals (totals [c], c_symbols [c], NULL);
       }
    }
 
@@ -255,9 +260,9 @@ encode_array (bitfile_t *output, const unsigned *data, const unsigned *context,
 	 d = data [n];
 	 c = n_context > 1 ? context [n] : 0; 
       
-	 scale	    = totals [c][c_symbols [c]];
-	 low_count  = totals [c][d];
-	 high_count = totals [c][d + 1];
+	 scale	    = cumulative (totals [c], c_symbols [c]);
+	 low_count  = cumulative (totals [c], d);
+	 high_count = cumulative (totals [c], d + 1);
 
 	 /*
 	  * Rescale high and low for the new symbol.
@@ -270,20 +275,7 @@ encode_array (bitfile_t *output, const unsigned *data, const unsigned *context,
 	 /*
 	  *  Update probability models
 	  */
-	 {
-	    unsigned i;
-
-	    for (i = d + 1; i < c_symbols [c] + 1; i++)
-	       totals [c][i]++;
-	 
-	    if (totals [c][c_symbols [c]] > scaling) /* scaling */
-	       for (i = 1; i < c_symbols [c] + 1; i++)
-	       {
-		  totals [c][i] >>= 1;
-		  if (totals [c][i] <= totals [c][i - 1])
-		     totals [c][i] = totals [c][i - 1] + 1;
-	       }
-	 }
+	 update_totals (totals [c], c_symbols [c], d, scaling);
       }
       /*
        *  Flush arithmetic encoder
@@ -366,7 +358,7 @@ decode_symbol (arith_t *arith, model_t *model)
 {
    unsigned   range;			/* range of current interval */
    unsigned   count;			/* value in the current interval */
-   unsigned   index;			/* index of probability model */
+   unsigned  *totals;			/* probability model to use */
    unsigned   symbol;			/* decoded symbol */
    u_word_t   scale;			/* range of all 'm' symbol intervals */
    u_word_t   low;			/* start of the current code range  */
@@ -386,45 +378,16 @@ decode_symbol (arith_t *arith, model_t *model)
 
    assert (high > low);
    
-   if (model->order > 0)		/* order-'n' model */
-   {
-      unsigned power;			/* multiplicator */
-      unsigned i;
-      
-      /*
-       *  Compute index of the probability model to use.
-       *  See init_model() for more details.
-       */
-      power = 1;			/* multiplicator */
-      index = 0;			/* address of prob. model */
-	 
-      for (i = 0; i < model->order; i++) /* genarate a m-nary number */
-      {
-	 index += model->context[i] * power;	
-	 power *= model->symbols;
-      }
+   totals = model->totals + model->context * (model->symbols + 1);
 
-      index *= model->symbols + 1;	/* we need space for m + 1 elements */
-   }
-   else
-      index = 0;
-
-   scale = model->totals [index + model->symbols];
-   range = (high - low) + 1;
-   count = ((code - low + 1) * scale - 1) / range;
-
-   for (symbol = model->symbols; count < model->totals [index + symbol];
-	symbol--)
-      ;
+   scale  = cumulative (totals, model->symbols);
+   range  = (high - low) + 1;
+   count  = ((code - low + 1) * scale - 1) / range;
+   symbol = find_symbol (totals, model->symbols, count);
 
    if (model->order > 0)		/* order-'n' model */
-   {
-      unsigned i;
-      
-      for (i = 0; i < model->order - 1; i++)
-	 model->context [i] = model->context [i + 1];
-      model->context [i] = symbol;
-   }
+      model->context = model->context / model->symbols
+		       + symbol * model->power;
 
    /*
     *  Compute interval boundaries
@@ -433,8 +396,8 @@ decode_symbol (arith_t *arith, model_t *model)
       u_word_t low_count;		/* lower bound of 'symbol' interval */
       u_word_t high_count;		/* upper bound of 'symbol' interval */
       
-      low_count  = model->totals [index + symbol];
-      high_count = model->totals [index + symbol + 1];
+      low_count  = cumulative (totals, symbol);
+      high_count = cumulative (totals, symbol + 1);
       high       = low + (u_word_t) ((range * high_count) / scale - 1 );
       low        = low + (u_word_t) ((range * low_count) / scale );
    }
@@ -442,24 +405,7 @@ decode_symbol (arith_t *arith, model_t *model)
    RESCALE_INPUT_INTERVAL;
    
    if (model->scale > 0)		/* adaptive model */
-   {
-      unsigned i;
-
-      /*
-       *  Update probability model
-       */
-      for (i = symbol + 1; i <= model->symbols; i++)
-	 model->totals [index + i]++;
-      if (model->totals [index + model->symbols] > model->scale) /* scaling */
-      {
-	 for (i = 1; i <= model->symbols; i++)
-	 {
-	    model->totals [index + i] >>= 1;
-	    if (model->totals [index + i] <= model->totals [index + i - 1])
-	       model->totals [index + i] = model->totals [index + i - 1] + 1;
-	 }
-      }
-   }
+      update_totals (totals, model->symbols, symbol, model->scale);
    
    /*
     *  Store interval values
@@ -487,7 +433,7 @@ decode_array (bitfile_t *input, const unsigned *context,
  */
 {
    unsigned  *data;			/* array to store decoded symbols */
-   u_word_t **totals;			/* probability model */
+   unsigned **totals;			/* probability model */
    
    if (n_context < 1)
       n_context = 1;			/* always use one context */
@@ -499,19 +445,14 @@ decode_array (bitfile_t *input, const unsigned *context,
    /*
     *  Allocate probability models, start with uniform distribution
     */
-   totals = fiasco_calloc (n_context, sizeof (u_word_t *));
+   totals = fiasco_calloc (n_context, sizeof (unsigned *));
    {
       unsigned c;
       
       for (c = 0; c < n_context; c++)
       {
-	 unsigned i;
-      
-	 totals [c]    = fiasco_calloc (c_symbols [c] + 1, sizeof (u_word_t));
-	 totals [c][0] = 0;
-      
-	 for (i = 0; i < c_symbols [c]; i++)
-	    totals [c][i + 1] = totals [c][i] + 1;
+	 totals [c] = fiasco_calloc (c_symbols [c] + 1, sizeof (unsigned));
+	 init_totals (totals [c], c_symbols [c], NULL);
       }
    }
 
@@ -537,14 +478,13 @@ decode_array (bitfile_t *input, const unsigned *context,
 	 c = n_context > 1 ? context [n] : 0; 
 
 	 assert (high > low);
-	 scale = totals [c][c_symbols [c]];
+	 scale = cumulative (totals [c], c_symbols [c]);
 	 range = (high - low) + 1;
 	 count = (((code - low) + 1 ) * scale - 1) / range;
       
-	 for (d = c_symbols [c]; count < totals [c][d]; d--) /* next symbol */
-	    ;
-	 low_count  = totals [c][d];
-	 high_count = totals [c][d + 1];
+	 d 	    = find_symbol (totals [c], c_symbols [c], count);
+	 low_count  = cumulative (totals [c], d);
+	 high_count = cumulative (totals [c], d + 1);
 
 	 high = low + (u_word_t) ((range * high_count) / scale - 1 );
 	 low  = low + (u_word_t) ((range * low_count) / scale );
@@ -553,20 +493,7 @@ decode_array (bitfile_t *input, const unsigned *context,
 	 /*
 	  *  Updata probability models
 	  */
-	 {
-	    unsigned i;
-
-	    for (i = d + 1; i < c_symbols [c] + 1; i++)
-	       totals [c][i]++;
-	 
-	    if (totals [c][c_symbols [c]] > scaling) /* scaling */
-	       for (i = 1; i < c_symbols [c] + 1; i++)
-	       {
-		  totals [c][i] >>= 1;
-		  if (totals [c][i] <= totals [c][i - 1])
-		     totals [c][i] = totals [c][i - 1] + 1;
-	       }
-	 }
+	 update_totals (totals [c], c_symbols [c], d, scaling);
 	 data [n] = d;
       }
       INPUT_BYTE_ALIGN (input);
@@ -608,8 +535,6 @@ alloc_model (unsigned m, unsigned scale, unsigned n, unsigned *totals)
 {
    model_t  *model;			/* new probability model */
    unsigned  num;			/* number of contexts to allocate */
-   bool_t    cont;			/* continue flag */
-   bool_t    dec;			/* next order flag */
    unsigned  i;
 
    /*
@@ -619,67 +544,25 @@ alloc_model (unsigned m, unsigned scale, unsigned n, unsigned *totals)
    model->symbols = m;
    model->scale   = scale;
    model->order   = n;
-   model->context = n > 0 ? fiasco_calloc (n, sizeof (unsigned)) : NULL;
+   model->context = 0;			/* start with context 0,0, .. ,0 */
    /*
     *  Allocate memory for the probabilty model.
     *  Each of the m^n different contexts requires its own probability model.
+    *  Let "context_1 context_2 ... context_n symbol" be the current input
+    *  stream then the number of the context is given by:
+    *  context = context_1 * M^0 + context_2 * M^1 + ... + context_n * M^(n-1)
+    *  i.e., the next context is context / M + symbol * M^(n-1).
     */
    for (num = 1, i = 0; i < model->order; i++)
       num *= model->symbols;
+   model->power = n > 0 ? num / model->symbols : 0;
 
    model->totals = fiasco_calloc (num * (model->symbols + 1), sizeof (unsigned));
 
-   for (i = 0; i < model->order; i++)
-      model->context[i] = 0;		/* start with context 0,0, .. ,0 */
-   cont = YES;
-   while (cont)				/* repeat while context != M ... M */
-   {
-      int	power;			/* multiplicator */
-      int	index;			/* index of probability model */
-      /*
-       *  There are m^n different contexts:
-       *  Let "context_1 context_2 ... context_n symbol" be the current input
-       *  stream then the index of the probability model is given by:
-       *  index = context_1 * M^0 + context_2 * M^1 + ... + context_n * M^(n-1)
-       */
-      power = 1;			/* multiplicator */
-      index = 0;			/* address of prob. model */
-	 
-      for (i = 0; i < model->order; i++)	/* genarate a m-nary number */
-      {
-	 index += model->context[i] * power;	
-	 power *= model->symbols;
-      }
-
-      index *= model->symbols + 1;	/* size of each model is m + 1 */
-
-      model->totals [index + 0] = 0;	/* always zero */
-	 
-      for (i = 1; i <= model->symbols; i++) /* prob of each symbol is 1/m or
-					       as given in totals */
-	 model->totals[index + i] = model->totals [index + i - 1]
-				    + (totals ? totals [i - 1] : 1);
-
-      if (model->order == 0)		/* order-0 model */
-	 cont = NO;
-      else				/* try next context */
-	 for (i = model->order - 1, dec = YES; dec; i--)
-	 {
-	    dec = NO;
-	    model->context[i]++;
-	    if (model->context[i] >= model->symbols) 
-	    {
-	       /* change previous context */
-	       model->context[i] = 0;
-	       if (i > 0)		/* there's still a context remaining */
-		  dec = YES;
-	       else
-		  cont = NO;		/* all context models initilized */
-	    }
-	 }
-   }
-   for (i = 0; i < model->order; i++)
-      model->context[i] = 0;		/* start with context 0,0, .. ,0 */
+   for (i = 0; i < num; i++)		/* prob of each symbol is 1/m or
+					   as given in totals */
+      init_totals (model->totals + i * (model->symbols + 1), model->symbols,
+		   totals);
 
    return model;
 }
@@ -698,11 +581,123 @@ free_model (model_t *model)
 {
    if (model != NULL)
    {
-      if (model->context != NULL)
-	 fiasco_free (model->context);
       fiasco_free (model->totals);
       fiasco_free (model);
    }
    else
       warning ("Can't free model <NULL>.");
 }
+
+/*****************************************************************************
+
+				private code
+  
+*****************************************************************************/
+
+/*
+ *  The symbol counts of a probability model are stored in a Fenwick tree
+ *  (binary indexed tree) 'totals' [1, ... , 'symbols'], 'totals' [0] is
+ *  always zero. Element i holds the sum of the counts of the symbols
+ *  i - lsb (i), ... , i - 1, hence the cumulative count of a symbol is
+ *  obtained and updated in O(log 'symbols') steps.
+ */
+
+static void
+init_totals (unsigned *totals, unsigned symbols, const unsigned *counts)
+/*
+ *  Initialize the tree 'totals' of an alphabet of size 'symbols'.
+ *  If 'counts' is not NULL then use the given counts of the symbols,
+ *  otherwise start with uniform distribution.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'totals' [0, ... , 'symbols'] are initialized
+ */
+{
+   unsigned i;
+
+   totals [0] = 0;
+   for (i = 1; i <= symbols; i++)
+      totals [i] = counts ? counts [i - 1] : 1;
+   for (i = 1; i <= symbols; i++)	/* add counts to parent nodes */
+   {
+      unsigned parent = i + (i & -i);
+
+      if (parent <= symbols)
+	 totals [parent] += totals [i];
+   }
+}
+
+static unsigned
+cumulative (const unsigned *totals, unsigned symbol)
+/*
+ *  Return value:
+ *	sum of the counts of the symbols 0, ... , 'symbol' - 1
+ */
+{
+   unsigned sum = 0;
+
+   for (; symbol; symbol &= symbol - 1)
+      sum += totals [symbol];
+
+   return sum;
+}
+
+static unsigned
+find_symbol (const unsigned *totals, unsigned symbols, unsigned count)
+/*
+ *  Search the symbol whose interval contains the value 'count'.
+ *
+ *  Return value:
+ *	largest symbol s with cumulative ('totals', s) <= 'count'
+ */
+{
+   unsigned symbol = 0;
+   unsigned step;
+
+   for (step = 1; step * 2 <= symbols; step <<= 1)
+      ;
+   for (; step; step >>= 1)
+      if (symbol + step <= symbols && totals [symbol + step] <= count)
+      {
+	 symbol += step;
+	 count  -= totals [symbol];
+      }
+
+   return symbol;
+}
+
+static void
+update_totals (unsigned *totals, unsigned symbols, unsigned symbol,
+	       unsigned scaling)
+/*
+ *  Increment the count of the given 'symbol'. If the sum of all counts
+ *  exceeds 'scaling' then the cumulative counts are halved (the count
+ *  of every symbol stays at least 1).
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'totals' are updated
+ */
+{
+   unsigned i;
+
+   for (i = symbol + 1; i <= symbols; i += i & -i)
+      totals [i]++;
+
+   if (cumulative (totals, symbols) > scaling)
+   {
+      for (i = 1; i <= symbols; i++)	/* tree -> cumulative counts */
+	 totals [i] += totals [i & (i - 1)];
+      for (i = 1; i <= symbols; i++)
+      {
+	 totals [i] >>= 1;
+	 if (totals [i] <= totals [i - 1])
+	    totals [i] = totals [i - 1] + 1;
+      }
+      for (i = symbols; i > 0; i--)	/* cumulative counts -> tree */
+	 totals [i] -= totals [i & (i - 1)];
+   }
+}
@@ -23,8 +23,9 @@ typedef struct model
    unsigned  symbols;			/* number of symbols in the alphabet */
    unsigned  scale;			/* if totals > scale rescale totals */
    unsigned  order;			/* order of the probability model */
-   unsigned *context;			/* context of the model */
-   unsigned *totals;			/* the totals */
+   unsigned  context;			/* number of the current context */
+   unsigned  power;			/* symbols ^ (order - 1) */
+   unsigned *totals;			/* the totals (Fenwick trees) */
 } model_t;
 
 typedef struct arith
@@ -39,6 +40,8 @@ typedef struct arith
 enum interval {LOW = 0x0000, FIRST_QUARTER = 0x4000, HALF = 0x8000,
 	       THIRD_QUARTER = 0xc000, HIGH = 0xffff};
 
+extern const unsigned char leading_zeros [256];
+
 arith_t *
 alloc_encoder (bitfile_t *file);
 void
@@ -64,59 +67,87 @@ alloc_model (unsigned m, unsigned scale, unsigned n, unsigned *totals);
 void
 free_model (model_t *model);
 
-#define RESCALE_INPUT_INTERVAL  for (;;)                                      \
-                                   if ((high >= HALF) && (low < HALF) &&      \
-                                      ((low & FIRST_QUARTER) != FIRST_QUARTER \
-				       || (high & FIRST_QUARTER) != 0))       \
-                                   {                                          \
-                                      break;                                  \
-                                   }                                          \
-                                   else if ((high < HALF) || (low >= HALF))   \
-                                   {                                          \
-                                      low  <<= 1;                             \
-                                      high <<= 1;                             \
-                                      high  |= 1;                             \
-                                      code <<= 1;                             \
-                                      code  += get_bit (input);               \
-                                   }                                          \
-                                   else                                       \
-                                   {                                          \
-                                      code  ^= FIRST_QUARTER;                 \
-                                      low   &= FIRST_QUARTER - 1;             \
-                                      low  <<= 1;                             \
-                                      high <<= 1;                             \
-                                      high  |= HALF + 1;                      \
-                                      code <<= 1;                             \
-                                      code  += get_bit (input);               \
-                                   }                                          
-        								   
-#define RESCALE_OUTPUT_INTERVAL  for (;;)                                     \
-                                 {                                            \
-                                    if (high < HALF)                          \
-                                    {                                         \
-                                       put_bit (output, 0);                   \
-                                       for (; underflow; underflow--)         \
-                                          put_bit (output, 1);                \
-                                    }                                         \
-                                    else if (low >= HALF)                     \
-                                    {                                         \
-                                       put_bit (output, 1);                   \
-                                       for (; underflow; underflow--)         \
-                                          put_bit (output, 0);                \
-                                    }                                         \
-                                    else if (high < THIRD_QUARTER &&          \
-                                             low >= FIRST_QUARTER)            \
-                                    {                                         \
-                                       underflow++;                           \
-                                       high |= FIRST_QUARTER;                 \
-                                       low  &= FIRST_QUARTER - 1;             \
-                                    }                                         \
-                                    else                                      \
-                                       break;                                 \
-                                    high <<= 1;                               \
-                                    high  |= 1;                               \
-                                    low  <<= 1;                               \
-                                 }                                             
-					 
+static inline unsigned
+equal_bits (unsigned low, unsigned high)
+/*
+ *  Return value:
+ *	number of leading bits the 16 bit values 'low' and 'high'
+ *	have in common
+ */
+{
+   unsigned diff = (low ^ high) & 0xffff;
+
+   return diff > 0xff ? leading_zeros [diff >> 8] : 8 + leading_zeros [diff];
+}
+
+static inline unsigned
+underflow_bits (unsigned low, unsigned high)
+/*
+ *  Count the underflow scalings of the interval ['low', 'high']
+ *  (FIRST_QUARTER <= low < HALF <= high < THIRD_QUARTER), i.e. the
+ *  number of leading bits below the MSB where 'low' is 1 and 'high' is 0.
+ *
+ *  Return value:
+ *	number of underflow bits (at most 15)
+ */
+{
+   return equal_bits ((low & ~high) << 1, 0xffff);
+}
+
+/*
+ *  Rescale the current code range [low, high] after a symbol has been
+ *  coded. All leading bits low and high have in common and all pending
+ *  underflow bits are shifted out at once. The results are bit
+ *  identical to shifting one bit per iteration.
+ */
+
+#define RESCALE_INPUT_INTERVAL                                                \
+   do                                                                         \
+   {                                                                          \
+      unsigned shift = equal_bits (low, high); /* E1/E2 scalings */           \
+                                                                              \
+      if (shift)                                                              \
+      {                                                                       \
+         low  = (unsigned) low << shift;                                      \
+         high = ((unsigned) high << shift) | ((1U << shift) - 1);             \
+         code = ((unsigned) code << shift) | get_bits (input, shift);         \
+      }                                                                       \
+      shift = underflow_bits (low, high); /* E3 scalings */                   \
+      if (shift)                                                              \
+      {                                                                       \
+         low  = ((unsigned) low << shift) & (HALF - 1);                       \
+         high = ((unsigned) high << shift) | HALF | ((1U << shift) - 1);      \
+         code = (((unsigned) code << shift) ^ HALF)                           \
+                | get_bits (input, shift);                                    \
+      }                                                                       \
+   } while (0)
+
+#define RESCALE_OUTPUT_INTERVAL                                               \
+   do                                                                         \
+   {                                                                          \
+      unsigned shift = equal_bits (low, high); /* E1/E2 scalings */           \
+                                                                              \
+      if (shift)                                                              \
+      {                                                                       \
+         unsigned bit = low >> 15;                                            \
+                                                                              \
+         put_bit (output, bit);                                               \
+         for (; underflow > 16; underflow -= 16)                              \
+            put_bits (output, bit ? 0 : 0xffff, 16);                          \
+         put_bits (output, bit ? 0 : 0xffff, underflow);                      \
+         underflow = 0;                                                       \
+         put_bits (output, low >> (16 - shift), shift - 1);                   \
+         low  = (unsigned) low << shift;                                      \
+         high = ((unsigned) high << shift) | ((1U << shift) - 1);             \
+      }                                                                       \
+      shift = underflow_bits (low, high); /* E3 scalings */                   \
+      if (shift)                                                              \
+      {                                                                       \
+         underflow += shift;                                                  \
+         low  = ((unsigned) low << shift) & (HALF - 1);                       \
+         high = ((unsigned) high << shift) | HALF | ((1U << shift) - 1);      \
+      }                                                                       \
+   } while (0)
+
 #endif /* not _ARITH_H */
 
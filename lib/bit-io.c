@@ -19,6 +19,13 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if HAVE_MMAP && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H
+#	define USE_MMAP 1
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#endif /* HAVE_MMAP && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H */
+
 #include "macros.h"
 #include "types.h"
 #include "error.h"
@@ -34,10 +41,32 @@
 
 static const unsigned BUFFER_SIZE = 16350;
 
-static const unsigned mask[] = {0x0001, 0x0002, 0x0004, 0x0008,
-				0x0010, 0x0020, 0x0040, 0x0080,
-				0x0100, 0x0200, 0x0400, 0x0800,
-				0x1000, 0x2000, 0x4000, 0x8000};
+/*****************************************************************************
+
+				prototypes
+  
+*****************************************************************************/
+
+static bitfile_t *
+alloc_bitfile (stream_e stream, const char *filename, openmode_e mode);
+static void
+free_bitfile (bitfile_t *bitfile);
+static void
+flush_bitfile (bitfile_t *bitfile);
+static size_t
+fill_buffer (bitfile_t *bitfile);
+static size_t
+write_buffer (bitfile_t *bitfile, size_t bytes);
+static long
+get_position (const bitfile_t *bitfile);
+static bool_t
+set_position (bitfile_t *bitfile, long position);
+static long
+stream_origin (const bitfile_t *bitfile);
+#if USE_MMAP
+static void *
+map_file (FILE *file, size_t *size);
+#endif /* USE_MMAP */
 
 /*****************************************************************************
 
@@ -152,155 +181,217 @@ open_bitfile (const char *filename, const char *env_var, openmode_e mode)
  *  Try to open file 'filename' for buffered bit oriented access with mode
  *  'mode'. Scan the current directory first and then cycle through the path
  *  given in the environment variable 'env_var', if set.
+ *  Regular files are mapped into memory for reading, if possible.
  *
  *  Return value:
  *	Pointer to open bitfile on success,
  *      otherwise the program is terminated.
  */
 {
-   bitfile_t *bitfile = fiasco_calloc (1, sizeof (bitfile_t));
-   
-   bitfile->file = open_file (filename, env_var, mode);
+   FILE	     *file = open_file (filename, env_var, mode);
+   bitfile_t *bitfile;
 
-   if (bitfile->file == NULL)
+   if (file == NULL)
       file_error (filename);
 
-   if (mode == READ_ACCESS)
+#if USE_MMAP
+   if (mode == READ_ACCESS && file != stdin)
    {
-      bitfile->bytepos  = 0;
-      bitfile->bitpos   = 0;
-      bitfile->mode     = mode;
-      bitfile->filename = filename ? strdup (filename) : strdup ("(stdin)");
-   }
-   else if (mode == WRITE_ACCESS)
-   {
-      bitfile->bytepos  = BUFFER_SIZE - 1;
-      bitfile->bitpos   = 8;
-      bitfile->mode     = mode;
-      bitfile->filename = filename ? strdup (filename) : strdup ("(stdout)");
+      size_t  size;
+      void   *memory = map_file (file, &size);
+
+      if (memory)
+      {
+	 fclose (file);
+	 bitfile	  = alloc_bitfile (MAPPED_STREAM, filename, mode);
+	 bitfile->memory  = memory;
+	 bitfile->size    = size;
+	 bitfile->env_var = env_var;
+
+	 return bitfile;
+      }
    }
-   else
-      error ("Unknow file access mode '%d'.", mode);
-   
-   bitfile->bits_processed = 0;
-   bitfile->buffer         = fiasco_calloc (BUFFER_SIZE, sizeof (byte_t));
-   bitfile->ptr            = bitfile->buffer;
+#endif /* USE_MMAP */
+
+   bitfile	    = attach_bitfile (file, filename, mode);
+   bitfile->env_var = env_var;
 
    return bitfile;
 }
 
-bool_t
-get_bit (bitfile_t *bitfile)
+bitfile_t *
+attach_bitfile (FILE *file, const char *filename, openmode_e mode)
 /*
- *  Get one bit from the given stream 'bitfile'.
+ *  Bitfile constructor:
+ *  Use the open stream 'file' for buffered bit oriented access with mode
+ *  'mode'. 'filename' is the name of the stream used in error messages.
  *
  *  Return value:
- *	 1	H bit
- *	 0	L bit
- *
- *  Side effects:
- *	Buffer of 'bitfile' is modified accordingly.
+ *	Pointer to open bitfile
  */
 {
-   assert (bitfile);
+   bitfile_t *bitfile = alloc_bitfile (FILE_STREAM, filename, mode);
    
-   if (!bitfile->bitpos--)		/* use next byte ? */
-   {
-      bitfile->ptr++;
-      if (!bitfile->bytepos--)		/* no more bytes left in the buffer? */
-      {
-	 /*
-	  *  Fill buffer with new data
-	  */
-	 int bytes = fread (bitfile->buffer, sizeof (byte_t),
-			    BUFFER_SIZE, bitfile->file) - 1;
-	 if (bytes < 0)			/* Error or EOF */
-	    error ("Can't read next bit from bitfile %s.", bitfile->filename);
-	 else
-	    bitfile->bytepos = bytes;
+   bitfile->file = file;
 
-	 bitfile->ptr = bitfile->buffer;
-      }
-      bitfile->bitpos = 7;
-   }
+   return bitfile;
+}
+
+bitfile_t *
+open_memory_bitfile (const void *memory, size_t size)
+/*
+ *  Bitfile constructor:
+ *  Use the block of 'size' bytes at 'memory' for bit oriented reading.
+ *  The bytes are not copied, hence 'memory' has to remain valid until
+ *  the bitfile is closed.
+ *
+ *  Return value:
+ *	Pointer to open bitfile
+ */
+{
+   bitfile_t *bitfile = alloc_bitfile (MEMORY_STREAM, "(memory)",
+				       READ_ACCESS);
 
-   bitfile->bits_processed++;
+   bitfile->memory = (byte_t *) memory;
+   bitfile->size   = size;
 
-   return *bitfile->ptr & mask [bitfile->bitpos] ? 1 : 0;
+   return bitfile;
 }
 
-unsigned int
-get_bits (bitfile_t *bitfile, unsigned bits)
+bitfile_t *
+open_growable_bitfile (void)
 /*
- *  Get #'bits' bits from the given stream 'bitfile'.
+ *  Bitfile constructor:
+ *  Open a buffer in memory for bit oriented writing. The buffer grows
+ *  as needed, its contents are obtained by detach_growable_bitfile ().
  *
  *  Return value:
- *	composed integer value
+ *	Pointer to open bitfile
+ */
+{
+   return alloc_bitfile (GROWABLE_STREAM, "(memory)", WRITE_ACCESS);
+}
+
+bitfile_t *
+open_callback_bitfile (read_func_t read, write_func_t write, void *data)
+/*
+ *  Bitfile constructor:
+ *  Use callback 'read' (if not NULL) for bit oriented reading or
+ *  callback 'write' for bit oriented writing. Both functions get the
+ *  argument 'data', a buffer and its size in bytes and return the number
+ *  of bytes transferred. A return value of zero indicates end of file
+ *  or an error.
  *
- *  Side effects:
- *	Buffer of 'bitfile' is modified.
+ *  Return value:
+ *	Pointer to open bitfile
  */
 {
-   unsigned value = 0;			/* input value */
+   bitfile_t *bitfile = alloc_bitfile (CALLBACK_STREAM, "(callback)",
+				       read ? READ_ACCESS : WRITE_ACCESS);
+
+   assert (read || write);
    
-   while (bits--)
-      value = (unsigned) (value << 1) | get_bit (bitfile);
+   bitfile->read  = read;
+   bitfile->write = write;
+   bitfile->data  = data;
 
-   return value;
+   return bitfile;
+}
+
+bitfile_t *
+reopen_bitfile (const bitfile_t *bitfile)
+/*
+ *  Bitfile constructor:
+ *  Open the stream of the input 'bitfile' a second time. Both bitfiles
+ *  can be read independently, e.g., by different threads. The new
+ *  bitfile starts at the beginning of the stream and has to be closed
+ *  before 'bitfile'.
+ *
+ *  Return value:
+ *	Pointer to open bitfile
+ */
+{
+   bitfile_t *copy = NULL;
+   
+   assert (bitfile && bitfile->mode == READ_ACCESS);
+
+   if (bitfile->stream == MAPPED_STREAM || bitfile->stream == MEMORY_STREAM)
+   {
+      copy = open_memory_bitfile (bitfile->memory, bitfile->size);
+      fiasco_free (copy->filename);
+      copy->filename = strdup (bitfile->filename);
+   }
+   else if (bitfile->stream == FILE_STREAM && bitfile->file != stdin)
+      copy = open_bitfile (bitfile->filename, bitfile->env_var, READ_ACCESS);
+   else
+      error ("Bitfile %s can't be opened twice.", bitfile->filename);
+
+   return copy;
 }
 
 void
-put_bit (bitfile_t *bitfile, unsigned value)
-/*     
- *  Put the bit 'value' to the bitfile buffer.
- *  The buffer is written to the file 'bitfile->file' if the number of
- *  buffer bytes exceeds 'BUFFER_SIZE'.
+fill_bitbuffer (bitfile_t *bitfile, unsigned bits)
+/*
+ *  Refill the bit buffer of the input stream 'bitfile' with whole bytes
+ *  until it contains more than 55 bits (or the end of the stream is
+ *  reached). At most 32 bits can be requested at once.
  *
  *  No return value.
  *
  *  Side effects:
- *	Buffer of 'bitfile' is modified.
+ *	If less than 'bits' bits are left in the stream then the
+ *	program is terminated.
  */
 {
-   assert (bitfile);
-   
-   if (!bitfile->bitpos--)		/* use next byte ? */
+   assert (bitfile && bitfile->mode == READ_ACCESS && bits <= 32);
+
+   while (bitfile->bitcount <= 55)
    {
-      bitfile->ptr++;
-      if (!bitfile->bytepos--)		/* no more bytes left ? */
+      unsigned n;			/* number of bytes to shift in */
+      
+      if (!bitfile->bytepos)		/* no more bytes left in the buffer? */
       {
 	 /*
-	  *  Write buffer to disk and fill buffer with zeros
+	  *  Fill buffer with new data
 	  */
-	 if (fwrite (bitfile->buffer, sizeof (byte_t),
-		     BUFFER_SIZE, bitfile->file) != BUFFER_SIZE)
-	    error ("Can't write next bit of bitfile %s!", bitfile->filename);
-	 memset (bitfile->buffer, 0, BUFFER_SIZE);
-	 bitfile->bytepos = BUFFER_SIZE - 1;
-	 bitfile->ptr     = bitfile->buffer;
+	 if (!(bitfile->bytepos = fill_buffer (bitfile))) /* Error or EOF */
+	    break;
       }
-      bitfile->bitpos = 7;
+      n = min ((63 - bitfile->bitcount) >> 3, bitfile->bytepos);
+      bitfile->bytepos  -= n;
+      bitfile->bitcount += n << 3;
+      while (n--)
+	 bitfile->bitbuffer = (bitfile->bitbuffer << 8) | *bitfile->ptr++;
    }
-   
-   if (value)
-      *bitfile->ptr |= mask [bitfile->bitpos];
 
-   bitfile->bits_processed++;
+   if (bitfile->bitcount < bits)
+      error ("Can't read next bit from bitfile %s.", bitfile->filename);
 }
 
 void
-put_bits (bitfile_t *bitfile, unsigned value, unsigned bits)
+flush_bitbuffer (bitfile_t *bitfile)
 /*     
- *  Put #'bits' bits of integer 'value' to the bitfile buffer 'bitfile'.
+ *  Move the complete bytes of the bit buffer of the output stream
+ *  'bitfile' to the byte buffer. The byte buffer is written to the
+ *  stream of 'bitfile' if it contains 'BUFFER_SIZE' bytes.
  *
  *  No return value.
- *
- *  Side effects:
- *	Buffer of 'bitfile' is modified.
  */
 {
-   while (bits--)
-      put_bit (bitfile, value & mask [bits]);
+   assert (bitfile && bitfile->mode == WRITE_ACCESS);
+   
+   while (bitfile->bitcount >= 8)
+   {
+      bitfile->bitcount -= 8;
+      *bitfile->ptr++    = (byte_t) (bitfile->bitbuffer >> bitfile->bitcount);
+      if (!--bitfile->bytepos)		/* no more bytes left ? */
+      {
+	 if (write_buffer (bitfile, BUFFER_SIZE) != BUFFER_SIZE)
+	    error ("Can't write next bit of bitfile %s!", bitfile->filename);
+	 bitfile->bytepos = BUFFER_SIZE;
+	 bitfile->ptr     = bitfile->buffer;
+      }
+   }
 }
 
 void
@@ -316,29 +407,415 @@ close_bitfile (bitfile_t *bitfile)
  *	Structure 'bitfile' is discarded.
  */
 {
+   FILE *file;
+   
+   assert (bitfile);
+   
+   if ((file = detach_bitfile (bitfile)))
+      fclose (file);
+}
+
+FILE *
+detach_bitfile (bitfile_t *bitfile)
+/*
+ *  Bitfile destructor:
+ *  If 'bitfile->mode' == WRITE_ACCESS write bit buffer to disk.
+ *  The underlying stream is not closed.
+ *
+ *  Return value:
+ *	stream of 'bitfile' (NULL if 'bitfile' is not attached to a file)
+ *
+ *  Side effects:
+ *	Structure 'bitfile' is discarded.
+ */
+{
+   FILE *file;
+   
    assert (bitfile);
    
+   flush_bitfile (bitfile);
+#if USE_MMAP
+   if (bitfile->stream == MAPPED_STREAM)
+      munmap (bitfile->memory, bitfile->size);
+#endif /* USE_MMAP */
+   if (bitfile->stream == GROWABLE_STREAM && bitfile->memory)
+      free (bitfile->memory);
+   file = bitfile->file;
+   free_bitfile (bitfile);
+
+   return file;
+}
+
+void *
+detach_growable_bitfile (bitfile_t *bitfile, size_t *size)
+/*
+ *  Bitfile destructor:
+ *  Write bit buffer of the growable output 'bitfile' to memory.
+ *
+ *  Return value:
+ *	block of memory containing the stream of 'bitfile'
+ *	(has to be released with free ())
+ *
+ *  Side effects:
+ *	'size' is set to the number of bytes of the stream
+ *	Structure 'bitfile' is discarded.
+ */
+{
+   void *memory;
+   
+   assert (bitfile && bitfile->stream == GROWABLE_STREAM && size);
+   
+   flush_bitfile (bitfile);
+   memory = bitfile->memory;
+   *size  = bitfile->position;
+   free_bitfile (bitfile);
+
+   return memory;
+}
+
+unsigned
+bits_processed (const bitfile_t *bitfile)
+/*
+ *  Return value:
+ *	Number of bits processed up to now (modulo 2^32)
+ */
+{
+   return bitfile->bits_processed;
+}
+
+void
+seek_bitfile (bitfile_t *bitfile, unsigned bits)
+/*
+ *  Move the input position of 'bitfile' to bit number 'bits' of the
+ *  stream, bits are counted in the same way as by bits_processed ().
+ *  The underlying stream has to support random access.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	Buffer of 'bitfile' is discarded and refilled.
+ */
+{
+   long origin = stream_origin (bitfile);
+   
+   if (!set_position (bitfile, origin + bits / 8))
+      error ("Can't seek to bit %d of bitfile %s.", bits, bitfile->filename);
+
+   bitfile->bytepos        = 0;
+   bitfile->bitcount       = 0;
+   bitfile->ptr            = bitfile->buffer;
+   bitfile->bits_processed = bits - bits % 8;
+
+   get_bits (bitfile, bits % 8);
+}
+
+unsigned long long
+bitfile_length (const bitfile_t *bitfile)
+/*
+ *  Return value:
+ *	Number of bits of the input stream 'bitfile' (from the first bit
+ *	of the stream up to the end of the file)
+ */
+{
+   long origin = stream_origin (bitfile);
+   long end    = 0;
+
+   if (bitfile->stream == FILE_STREAM)
+   {
+      long position = ftell (bitfile->file);
+
+      if (fseek (bitfile->file, 0, SEEK_END)
+	  || (end = ftell (bitfile->file)) < 0
+	  || fseek (bitfile->file, position, SEEK_SET))
+	 error ("Can't determine length of bitfile %s.", bitfile->filename);
+   }
+   else
+      end = bitfile->size;
+
+   return (unsigned long long) (end - origin) * 8;
+}
+
+bool_t
+bitfile_reopenable (const bitfile_t *bitfile)
+/*
+ *  Return value:
+ *	YES if the input stream 'bitfile' supports random access and
+ *	    can be opened a second time by reopen_bitfile ()
+ *	NO  otherwise (e.g., standard input or callbacks)
+ */
+{
+   return bitfile->mode == READ_ACCESS && get_position (bitfile) >= 0
+	  && !(bitfile->stream == FILE_STREAM && bitfile->file == stdin);
+}
+
+/*****************************************************************************
+
+				private code
+  
+*****************************************************************************/
+
+static bitfile_t *
+alloc_bitfile (stream_e stream, const char *filename, openmode_e mode)
+/*
+ *  Allocate bitfile structure of type 'stream' with access mode 'mode'.
+ *  Only files, callbacks and output buffers need an I/O buffer, the
+ *  input buffer of memory streams is the memory block itself.
+ *
+ *  Return value:
+ *	Pointer to new bitfile
+ */
+{
+   bitfile_t *bitfile = fiasco_calloc (1, sizeof (bitfile_t));
+   
+   bitfile->stream = stream;
+
+   if (mode == READ_ACCESS)
+   {
+      bitfile->bytepos  = 0;
+      bitfile->mode     = mode;
+      bitfile->filename = filename ? strdup (filename) : strdup ("(stdin)");
+   }
+   else if (mode == WRITE_ACCESS)
+   {
+      bitfile->bytepos  = BUFFER_SIZE;
+      bitfile->mode     = mode;
+      bitfile->filename = filename ? strdup (filename) : strdup ("(stdout)");
+   }
+   else
+      error ("Unknow file access mode '%d'.", mode);
+   
+   bitfile->bitbuffer      = 0;
+   bitfile->bitcount       = 0;
+   bitfile->bits_processed = 0;
+   if (stream != MAPPED_STREAM && stream != MEMORY_STREAM)
+      bitfile->buffer = fiasco_calloc (BUFFER_SIZE, sizeof (byte_t));
+   bitfile->ptr = bitfile->buffer;
+
+   return bitfile;
+}
+
+static void
+free_bitfile (bitfile_t *bitfile)
+/*
+ *  Free memory of 'bitfile', the underlying stream is not closed.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	Structure 'bitfile' is discarded.
+ */
+{
+   if (bitfile->buffer)
+      fiasco_free (bitfile->buffer);
+   fiasco_free (bitfile->filename);
+   fiasco_free (bitfile);
+}
+
+static void
+flush_bitfile (bitfile_t *bitfile)
+/*
+ *  If 'bitfile->mode' == WRITE_ACCESS write remaining bytes of the
+ *  bit buffer to the stream.
+ *
+ *  No return value.
+ */
+{
    if (bitfile->mode == WRITE_ACCESS)
    {
-      unsigned bytes = fwrite (bitfile->buffer, sizeof (byte_t),
-			       BUFFER_SIZE - bitfile->bytepos, bitfile->file);
+      unsigned bytes;
+
+      if (bitfile->bitcount % 8)	/* fill last byte with zeros */
+	 put_bits (bitfile, 0, 8 - bitfile->bitcount % 8);
+      flush_bitbuffer (bitfile);
+      bytes = write_buffer (bitfile, BUFFER_SIZE - bitfile->bytepos);
       if (bytes != BUFFER_SIZE - bitfile->bytepos)
 	 error ("Can't write remaining %d bytes of bitfile "
 		"(only %d bytes written)!",
 		BUFFER_SIZE - bitfile->bytepos, bytes);
    }
-   fclose (bitfile->file);
-   fiasco_free (bitfile->buffer);
-   fiasco_free (bitfile->filename);
-   fiasco_free (bitfile);
 }
 
-unsigned
-bits_processed (const bitfile_t *bitfile)
+static size_t
+fill_buffer (bitfile_t *bitfile)
 /*
+ *  Fetch the next block of bytes of the input stream 'bitfile'.
+ *  Memory streams are read directly without copying the data.
+ *
  *  Return value:
- *	Number of bits processed up to now
+ *	number of bytes available (0 at end of file or on errors)
+ *
+ *  Side effects:
+ *	'bitfile->ptr' points to the first byte of the block
  */
 {
-   return bitfile->bits_processed;
+   size_t bytes;
+   
+   switch (bitfile->stream)
+   {
+      case MAPPED_STREAM:
+      case MEMORY_STREAM:
+	 bytes = min (bitfile->size - bitfile->position, BUFFER_SIZE);
+	 bitfile->ptr       = bitfile->memory + bitfile->position;
+	 bitfile->position += bytes;
+	 return bytes;
+      case CALLBACK_STREAM:
+	 for (bytes = 0; bytes < BUFFER_SIZE; )
+	 {
+	    size_t n = bitfile->read (bitfile->data, bitfile->buffer + bytes,
+				      BUFFER_SIZE - bytes);
+	    if (!n)
+	       break;
+	    bytes += n;
+	 }
+	 bitfile->ptr = bitfile->buffer;
+	 return bytes;
+      default:
+	 bitfile->ptr = bitfile->buffer;
+	 return fread (bitfile->buffer, sizeof (byte_t), BUFFER_SIZE,
+		       bitfile->file);
+   }
+}
+
+static size_t
+write_buffer (bitfile_t *bitfile, size_t bytes)
+/*
+ *  Write the first 'bytes' bytes of the buffer of 'bitfile' to the
+ *  output stream. Growable streams are enlarged if required.
+ *
+ *  Return value:
+ *	number of bytes written
+ */
+{
+   switch (bitfile->stream)
+   {
+      case GROWABLE_STREAM:
+	 if (bitfile->position + bytes > bitfile->size)
+	 {
+	    size_t  size   = max (bitfile->size * 2, bitfile->position + bytes);
+	    byte_t *memory = realloc (bitfile->memory, size);
+
+	    if (!memory)
+	       error ("Out of memory!");
+	    bitfile->memory = memory;
+	    bitfile->size   = size;
+	 }
+	 memcpy (bitfile->memory + bitfile->position, bitfile->buffer, bytes);
+	 bitfile->position += bytes;
+	 return bytes;
+      case CALLBACK_STREAM:
+      {
+	 size_t written, n;
+
+	 for (written = 0; written < bytes; written += n)
+	    if (!(n = bitfile->write (bitfile->data, bitfile->buffer + written,
+				      bytes - written)))
+	       break;
+	 return written;
+      }
+      default:
+	 return fwrite (bitfile->buffer, sizeof (byte_t), bytes,
+			bitfile->file);
+   }
+}
+
+static long
+get_position (const bitfile_t *bitfile)
+/*
+ *  Return value:
+ *	current position of the stream of 'bitfile', i.e., the offset of
+ *	the byte following the buffer contents, or -1 if the stream
+ *	doesn't support random access
+ */
+{
+   switch (bitfile->stream)
+   {
+      case MAPPED_STREAM:
+      case MEMORY_STREAM:
+	 return bitfile->position;
+      case FILE_STREAM:
+	 return ftell (bitfile->file);
+      default:
+	 return -1;
+   }
+}
+
+static bool_t
+set_position (bitfile_t *bitfile, long position)
+/*
+ *  Set position of the input stream of 'bitfile' to byte 'position'.
+ *
+ *  Return value:
+ *	YES on success
+ *	NO  otherwise
+ */
+{
+   switch (bitfile->stream)
+   {
+      case MAPPED_STREAM:
+      case MEMORY_STREAM:
+	 if (position < 0 || (size_t) position > bitfile->size)
+	    return NO;
+	 bitfile->position = position;
+	 return YES;
+      case FILE_STREAM:
+	 return fseek (bitfile->file, position, SEEK_SET) ? NO : YES;
+      default:
+	 return NO;
+   }
+}
+
+static long
+stream_origin (const bitfile_t *bitfile)
+/*
+ *  Compute the position of the first bit of the input stream 'bitfile'
+ *  in the underlying file: the file position is located behind the
+ *  buffered bytes, the bytes moved to the bit buffer are counted by
+ *  'bits_processed' and 'bitcount'.
+ *
+ *  Return value:
+ *	file offset of the stream
+ */
+{
+   long position = get_position (bitfile);
+
+   if (bitfile->mode != READ_ACCESS || position < 0)
+      error ("Bitfile %s doesn't support random access.", bitfile->filename);
+
+   return position - bitfile->bytepos
+	  - (bitfile->bits_processed + bitfile->bitcount) / 8;
+}
+
+#if USE_MMAP
+
+static void *
+map_file (FILE *file, size_t *size)
+/*
+ *  Map the regular file 'file' into memory.
+ *
+ *  Return value:
+ *	pointer to the mapped file contents, or NULL if the file can't
+ *	be mapped (e.g., pipes, terminals or empty files)
+ *
+ *  Side effects:
+ *	'size' is set to the number of bytes of the file
+ */
+{
+   struct stat  status;
+   void	       *memory;
+
+   if (fstat (fileno (file), &status) || !S_ISREG (status.st_mode)
+       || status.st_size <= 0 || (off_t) (size_t) status.st_size
+       != status.st_size)
+      return NULL;
+
+   memory = mmap (NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+		  fileno (file), 0);
+   if (memory == MAP_FAILED)
+      return NULL;
+
+   *size = status.st_size;
+   
+   return memory;
 }
+
+#endif /* USE_MMAP */
@@ -20,20 +20,45 @@
 #include <stdio.h>
 #include "types.h"
 
-#define OUTPUT_BYTE_ALIGN(bfile) while ((bfile)->bitpos) put_bit (bfile, 0);
-#define INPUT_BYTE_ALIGN(bfile)  while ((bfile)->bitpos) get_bit (bfile);
+#define OUTPUT_BYTE_ALIGN(bfile) \
+	put_bits (bfile, 0, (8 - (bfile)->bits_processed % 8) % 8);
+#define INPUT_BYTE_ALIGN(bfile) \
+	get_bits (bfile, (bfile)->bitcount % 8);
 
 typedef enum {READ_ACCESS, WRITE_ACCESS} openmode_e;
+typedef enum {FILE_STREAM, MAPPED_STREAM, MEMORY_STREAM,
+	      GROWABLE_STREAM, CALLBACK_STREAM} stream_e;
+
+typedef unsigned long long bitbuffer_t;	/* at least 64 bits */
+
+typedef size_t (*read_func_t) (void *data, void *buffer, size_t size);
+typedef size_t (*write_func_t) (void *data, const void *buffer, size_t size);
 
 typedef struct bitfile
+/*
+ *  Bit oriented access to a stream. The bytes are either transferred
+ *  from and to a file, a block of memory (read only, mmap'ed file or
+ *  growable output buffer), or user defined callback functions.
+ */
 {
+   stream_e    stream;			/* type of underlying stream */
    FILE	      *file;			/* associated filepointer */
+   byte_t     *memory;			/* memory block or NULL */
+   size_t      size;			/* size of memory block */
+   size_t      position;		/* current position in memory block */
+   read_func_t read;			/* read callback */
+   write_func_t write;			/* write callback */
+   void	      *data;			/* argument of callbacks */
+   const char *env_var;			/* search path of file */
    char	      *filename;		/* corresponding filename */
    byte_t     *buffer;			/* stream buffer */
    byte_t     *ptr;			/* pointer to current buffer pos */
-   unsigned    bytepos;			/* current I/O byte */
-   unsigned    bitpos;			/* current I/O bit */
-   unsigned    bits_processed;		/* number of bits already processed */
+   unsigned    bytepos;			/* bytes left in (input) buffer,
+					   free bytes of (output) buffer */
+   bitbuffer_t bitbuffer;		/* bits read ahead or not yet
+					   written, the last bit is LSB */
+   unsigned    bitcount;		/* number of bits in 'bitbuffer' */
+   unsigned long long bits_processed;	/* number of bits already processed */
    openmode_e  mode;			/* access mode */
 } bitfile_t;
 
@@ -41,18 +66,125 @@ FILE *
 open_file (const char *filename, const char *env_var, openmode_e mode);
 bitfile_t *
 open_bitfile (const char *filename, const char *env_var, openmode_e mode);
+bitfile_t *
+attach_bitfile (FILE *file, const char *filename, openmode_e mode);
+bitfile_t *
+open_memory_bitfile (const void *memory, size_t size);
+bitfile_t *
+open_growable_bitfile (void);
+bitfile_t *
+open_callback_bitfile (read_func_t read, write_func_t write, void *data);
+bitfile_t *
+reopen_bitfile (const bitfile_t *bitfile);
 void
-put_bit (bitfile_t *bitfile, unsigned value);
+fill_bitbuffer (bitfile_t *bitfile, unsigned bits);
 void
-put_bits (bitfile_t *bitfile, unsigned value, unsigned bits);
-bool_t
-get_bit (bitfile_t *bitfile);
-unsigned 
-get_bits (bitfile_t *bitfile, unsigned bits);
+flush_bitbuffer (bitfile_t *bitfile);
 void
 close_bitfile (bitfile_t *bitfile);
+FILE *
+detach_bitfile (bitfile_t *bitfile);
+void *
+detach_growable_bitfile (bitfile_t *bitfile, size_t *size);
 unsigned
 bits_processed (const bitfile_t *bitfile);
+void
+seek_bitfile (bitfile_t *bitfile, unsigned bits);
+unsigned long long
+bitfile_length (const bitfile_t *bitfile);
+bool_t
+bitfile_reopenable (const bitfile_t *bitfile);
+
+/*
+ *  Fast paths of the bit oriented I/O, the functions above are called
+ *  only if the bit buffer has to be refilled or flushed.
+ */
+
+static inline bool_t
+get_bit (bitfile_t *bitfile)
+/*
+ *  Get one bit from the given stream 'bitfile'.
+ *
+ *  Return value:
+ *	 1	H bit
+ *	 0	L bit
+ */
+{
+   if (!bitfile->bitcount)
+      fill_bitbuffer (bitfile, 1);
+   bitfile->bitcount--;
+   bitfile->bits_processed++;
+
+   return (bool_t) ((bitfile->bitbuffer >> bitfile->bitcount) & 1);
+}
+
+static inline unsigned
+get_bits (bitfile_t *bitfile, unsigned bits)
+/*
+ *  Get #'bits' bits from the given stream 'bitfile'.
+ *  At most 32 bits can be read at once.
+ *
+ *  Return value:
+ *	composed integer value
+ */
+{
+   if (bitfile->bitcount < bits)
+      fill_bitbuffer (bitfile, bits);
+   bitfile->bitcount       -= bits;
+   bitfile->bits_processed += bits;
+
+   return (unsigned) (bitfile->bitbuffer >> bitfile->bitcount)
+	  & (unsigned) (((bitbuffer_t) 1 << bits) - 1);
+}
+
+static inline unsigned
+peek_bits (bitfile_t *bitfile, unsigned bits)
+/*
+ *  Look ahead #'bits' bits of the given stream 'bitfile' without
+ *  consuming them. At most 32 bits can be peeked at once. If the stream
+ *  ends before then the missing bits are filled with zeros.
+ *
+ *  Return value:
+ *	composed integer value
+ */
+{
+   if (bitfile->bitcount < bits)
+      fill_bitbuffer (bitfile, 0);
+   if (bitfile->bitcount < bits)	/* end of stream */
+      return (unsigned) (bitfile->bitbuffer << (bits - bitfile->bitcount))
+	     & (unsigned) (((bitbuffer_t) 1 << bits) - 1);
+   
+   return (unsigned) (bitfile->bitbuffer >> (bitfile->bitcount - bits))
+	  & (unsigned) (((bitbuffer_t) 1 << bits) - 1);
+}
+
+static inline void
+put_bits (bitfile_t *bitfile, unsigned value, unsigned bits)
+/*     
+ *  Put #'bits' bits of integer 'value' to the bitfile buffer 'bitfile'.
+ *  At most 32 bits can be written at once.
+ *
+ *  No return value.
+ */
+{
+   bitfile->bitbuffer = (bitfile->bitbuffer << bits)
+			| (value & (unsigned) (((bitbuffer_t) 1 << bits) - 1));
+   bitfile->bitcount       += bits;
+   bitfile->bits_processed += bits;
+   if (bitfile->bitcount > 32)
+      flush_bitbuffer (bitfile);
+}
+
+static inline void
+put_bit (bitfile_t *bitfile, unsigned value)
+/*     
+ *  Put the bit 'value' to the bitfile buffer 'bitfile'.
+ *
+ *  No return value.
+ */
+{
+   put_bits (bitfile, value ? 1 : 0, 1);
+}
 
 #endif /* not _BIT_IO_H */
 
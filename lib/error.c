@@ -46,10 +46,10 @@
 *****************************************************************************/
 
 static fiasco_verbosity_e  verboselevel  = FIASCO_SOME_VERBOSITY;
-static char 	      	  *error_message = NULL;
+static THREAD_LOCAL char  *error_message = NULL; /* per thread */
 
 #if HAVE_SETJMP_H
-jmp_buf env;
+THREAD_LOCAL jmp_buf env;		/* per thread */
 #endif /* HAVE_SETJMP_H */
 
 /*****************************************************************************
@@ -99,7 +99,7 @@ set_error (const char *format, ...)
 
    if (error_message)
       fiasco_free (error_message);
-   error_message = fiasco_calloc (len, sizeof (char));
+   error_message = fiasco_calloc (len + 1, sizeof (char));
    
 #if HAVE_VPRINTF
    vsprintf (error_message, format, args);
@@ -158,7 +158,7 @@ error (const char *format, ...)
 
    if (error_message)
       fiasco_free (error_message);
-   error_message = fiasco_calloc (len, sizeof (char));
+   error_message = fiasco_calloc (len + 1, sizeof (char));
    
 #if HAVE_VPRINTF
    vsprintf (error_message, format, args);
@@ -179,7 +179,8 @@ const char *
 fiasco_get_error_message (void)
 /*
  *  Return value:
- *	Last error message of FIASCO library.
+ *	Last error message of FIASCO library that has been
+ *	raised by the calling thread.
  */
 {
    return error_message ? error_message : "";
@@ -204,6 +205,22 @@ file_error (const char *filename)
    error ("File `%s': I/O Error - %s.", filename, get_system_error ());
 }
 
+void
+raise_error (void)
+/*
+ *  Raise the current error of the calling thread once more, e.g.,
+ *  after the resources of a failed 'try' block have been released.
+ *
+ *  No return value.
+ */
+{
+   char text [MAXSTRLEN];		/* error() discards the old message */
+
+   strncpy (text, error_message ? error_message : "", MAXSTRLEN - 1);
+   text [MAXSTRLEN - 1] = 0;
+   error ("%s", text);
+}
+
 void 
 warning (const char *format, ...)
 /*
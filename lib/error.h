@@ -25,6 +25,8 @@ error (const char *format, ...);
 void
 file_error (const char *filename);
 void
+raise_error (void);
+void
 message (const char *format, ...);
 void 
 debug_message (const char *format, ...);
@@ -35,9 +37,20 @@ info (const char *format, ...);
 const char *
 get_system_error (void);
 
+/*
+ *  Error message and jump buffer of the 'try' and 'catch' macros are
+ *  local to the calling thread (if supported by the compiler). Hence,
+ *  several threads may use the FIASCO library at the same time.
+ */
+#if HAVE_THREAD_LOCAL
+#	define THREAD_LOCAL		__thread
+#else /* not HAVE_THREAD_LOCAL */
+#	define THREAD_LOCAL		/* empty */
+#endif /* not HAVE_THREAD_LOCAL */
+
 #if HAVE_SETJMP_H
 #	include <setjmp.h>
-extern jmp_buf	env;
+extern THREAD_LOCAL jmp_buf env;
 #endif /* HAVE_SETJMP_H */
 
 #if HAVE_SETJMP_H
@@ -48,6 +61,21 @@ extern jmp_buf	env;
 #	define catch			else
 #endif /* HAVE_SETJMP_H */
 
+/*
+ *  A function which catches errors inside of another 'try' block has
+ *  to save the jump buffer of the outer block and restore it before
+ *  the error is raised again (see raise_error ()).
+ */
+#if HAVE_SETJMP_H
+typedef jmp_buf env_t;
+#	define save_env(saved)		memcpy ((saved), env, sizeof (jmp_buf))
+#	define restore_env(saved)	memcpy (env, (saved), sizeof (jmp_buf))
+#else /* not HAVE_SETJMP_H */
+typedef int env_t;
+#	define save_env(saved)		((void) (saved))
+#	define restore_env(saved)	((void) (saved))
+#endif /* not HAVE_SETJMP_H */
+
 #if HAVE_ASSERT_H
 #	include <assert.h>
 #else /* not HAVE_ASSERT_H */
@@ -14,10 +14,41 @@
  *  $State: Exp $
  */
 
+/*
+ *  Raw images are read and written in strips of rows with a single
+ *  call of fread () or fwrite (). The pixels of a strip are converted
+ *  by kernels which process whole rows, the SIMD kernels compute
+ *  exactly the values of the plain C code: the RGB -> YCbCr
+ *  conversion uses the same double precision operations (products
+ *  and sums are never fused) in several lanes, the YCbCr -> RGB
+ *  conversion looks up the same chroma tables.
+ */
+
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+#if HAVE_IMMINTRIN_H && (defined (__x86_64__) || defined (__i386__)) \
+    && (defined (__clang__) || (defined (__GNUC__) && __GNUC__ >= 6)) \
+    && defined (HAVE_SIGNED_SHIFT)
+#	define X86_KERNELS 1
+#	include <immintrin.h>
+#endif
+
+/*
+ *  Keep products and sums separate when compiling the C code as well
+ */
+#if defined (__clang__)
+#	pragma STDC FP_CONTRACT OFF
+#elif defined (__GNUC__)
+#	pragma GCC optimize ("fp-contract=off")
+#endif
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
@@ -32,21 +63,86 @@
   
 *****************************************************************************/
 
+static const int APGM_FORMAT = 'P' * 256 + '2';
+static const int APPM_FORMAT = 'P' * 256 + '3';
 static const int RPGM_FORMAT = 'P' * 256 + '5';
 static const int RPPM_FORMAT = 'P' * 256 + '6';
 
+#define STRIP_SIZE (256 * 1024)	/* bytes of raw pixels per strip */
+
+typedef void (*bytes_to_words_f) (word_t *dst, const unsigned char *src,
+				  unsigned n);
+typedef void (*words_to_bytes_f) (unsigned char *dst, const word_t *src,
+				  unsigned n);
+typedef void (*rgb_to_ycbcr_f) (word_t *lu, word_t *cb, word_t *cr,
+				const unsigned char *src, unsigned bytes,
+				unsigned n);
+typedef void (*ycbcr_to_rgb_f) (unsigned char *dst, unsigned bytes,
+				const word_t *lu, const word_t *cb,
+				const word_t *cr, unsigned n);
+
+static bytes_to_words_f bytes_to_words = NULL;
+static words_to_bytes_f words_to_bytes = NULL;
+static rgb_to_ycbcr_f   rgb_to_ycbcr   = NULL;
+static ycbcr_to_rgb_f   ycbcr_to_rgb   = NULL;
+
 /*****************************************************************************
 
 				prototypes
   
 *****************************************************************************/
 
+static FILE *
+open_pnm (const char *image_name, unsigned *width, unsigned *height,
+	  bool_t *color, unsigned *maxval, bool_t *ascii);
+static void
+read_samples (FILE *input, const char *image_name, unsigned char *buffer,
+	      unsigned n, unsigned maxval, bool_t ascii);
 static void
 init_chroma_tables (void);
 static void
-gray_write (const image_t *image, FILE *output);
+compute_chroma_tables (void);
+static void
+init_kernels (void);
+static void
+select_kernels (void);
+static void
+bytes_to_words_c (word_t *dst, const unsigned char *src, unsigned n);
 static void
-color_write (const image_t *image, FILE *output);
+words_to_bytes_c (unsigned char *dst, const word_t *src, unsigned n);
+static void
+rgb_to_ycbcr_c (word_t *lu, word_t *cb, word_t *cr,
+		const unsigned char *src, unsigned bytes, unsigned n);
+static void
+ycbcr_to_rgb_c (unsigned char *dst, unsigned bytes, const word_t *lu,
+		const word_t *cb, const word_t *cr, unsigned n);
+#if X86_KERNELS
+static void
+bytes_to_words_sse2 (word_t *dst, const unsigned char *src, unsigned n);
+static void
+words_to_bytes_sse2 (unsigned char *dst, const word_t *src, unsigned n);
+static void
+rgb_to_ycbcr_avx2 (word_t *lu, word_t *cb, word_t *cr,
+		   const unsigned char *src, unsigned bytes, unsigned n);
+static void
+ycbcr_to_rgb_avx2 (unsigned char *dst, unsigned bytes, const word_t *lu,
+		   const word_t *cb, const word_t *cr, unsigned n);
+#endif /* X86_KERNELS */
+static void
+export_planar (const image_t *image, unsigned char *buffer, unsigned stride,
+	       format_e format);
+static void
+export_rgb (const image_t *image, unsigned char *buffer, unsigned stride,
+	    unsigned bytes);
+static void
+export_gray (const image_t *image, unsigned char *buffer, unsigned stride);
+static void
+import_planar (image_t *image, const unsigned char *buffer, unsigned stride);
+static void
+import_rgb (image_t *image, const unsigned char *buffer, unsigned stride,
+	    unsigned bytes);
+static fiasco_image_t *
+new_fiasco_image (image_t *image);
 
 /*****************************************************************************
 
@@ -69,15 +165,62 @@ fiasco_image_new (const char *filename)
 {
    try
    {
-      fiasco_image_t *image = fiasco_calloc (1, sizeof (fiasco_image_t));
+      return new_fiasco_image (read_image (filename));
+   }
+   catch
+   {
+      return NULL;
+   }
+}
 
-      image->private 	= read_image (filename);
-      image->delete  	= fiasco_image_delete;
-      image->get_width  = fiasco_image_get_width;
-      image->get_height = fiasco_image_get_height;
-      image->is_color  	= fiasco_image_is_color;
+fiasco_image_t *
+fiasco_image_new_from_buffer (const unsigned char *buffer,
+			      unsigned width, unsigned height,
+			      unsigned stride, fiasco_layout_e layout)
+/*
+ *  FIASCO image constructor.
+ *  Allocate memory for the FIASCO image structure and convert the
+ *  'width' x 'height' pixels stored in 'buffer' using the pixel
+ *  'layout' (see export_image ()). Rows of the buffer start every
+ *  'stride' bytes, 'stride' = 0 selects rows without padding.
+ *  FIASCO_GRAY_8 yields a grayscale image, all other layouts yield a
+ *  color image (in 4:2:0 format if 'layout' is FIASCO_YUV_420).
+ *
+ *  Return value:
+ *	pointer to the new image structure
+ *	or NULL in case of an error
+ */
+{
+   unsigned row_size = layout_row_size (width, layout);
+   
+   if (!buffer)
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."), "buffer");
+      return NULL;
+   }
+   if (!width || !height || (width & 1) || (height & 1))
+   {
+      set_error (_("Width and height of images must be "
+		   "positive even numbers."));
+      return NULL;
+   }
+   if (!row_size)
+   {
+      set_error (_("Pixel layout %d is not defined."), layout);
+      return NULL;
+   }
+   if (!stride)
+      stride = row_size;
+   else if (stride < row_size || (layout == FIASCO_YUV_420 && (stride & 1)))
+   {
+      set_error (_("Row size %d of the buffer is not valid."), stride);
+      return NULL;
+   }
 
-      return image;
+   try
+   {
+      return new_fiasco_image (import_image (buffer, width, height, stride,
+					     layout));
    }
    catch
    {
@@ -85,6 +228,56 @@ fiasco_image_new (const char *filename)
    }
 }
 
+fiasco_image_t *
+fiasco_image_new_from_planes (short *y, short *cb, short *cr,
+			      unsigned width, unsigned height,
+			      int chroma_420)
+/*
+ *  FIASCO image constructor.
+ *  Create a FIASCO image of size 'width' x 'height' which uses the
+ *  planes 'y', 'cb' and 'cr' of the caller without copying them. Rows
+ *  are stored without padding, each sample is given by 16 * (v - 128)
+ *  where v is the 8 bit value of the sample. If 'cb' and 'cr' are NULL
+ *  then a grayscale image is created. If 'chroma_420' is set then the
+ *  chroma planes are of size 'width' / 2 x 'height' / 2.
+ *  The planes are not released when the image is deleted, hence they
+ *  have to stay valid as long as the image is used.
+ *
+ *  Return value:
+ *	pointer to the new image structure
+ *	or NULL in case of an error
+ */
+{
+   image_t *image;
+
+   if (!y || (!cb != !cr))
+   {
+      set_error (_("Parameter `%s' not defined (NULL)."),
+		 !y ? "y" : (!cb ? "cb" : "cr"));
+      return NULL;
+   }
+   if (!width || !height || (width & 1) || (height & 1))
+   {
+      set_error (_("Width and height of images must be "
+		   "positive even numbers."));
+      return NULL;
+   }
+
+   image		  = fiasco_calloc (1, sizeof (image_t));
+   image->width		  = width;
+   image->height	  = height;
+   image->color		  = cb ? YES : NO;
+   image->format	  = cb && chroma_420 ? FORMAT_4_2_0 : FORMAT_4_4_4;
+   image->reference_count = 1;
+   image->external	  = YES;
+   image->pixels [Y]	  = y;
+   image->pixels [Cb]	  = cb;
+   image->pixels [Cr]	  = cr;
+   strcpy (image->id, "IFIASCO");
+
+   return new_fiasco_image (image);
+}
+
 void
 fiasco_image_delete (fiasco_image_t *image)
 /*
@@ -131,7 +324,7 @@ fiasco_image_get_height (fiasco_image_t *image)
    if (!this)
       return 0;
    else
-      return this->width;
+      return this->height;
 }
 
 int
@@ -244,6 +437,65 @@ clone_image (image_t *image)
    return new;
 }
 
+image_t *
+convert_image (image_t *image, format_e format)
+/*
+ *  Copy constructor:
+ *  Construct new image by copying the given `image' and converting the
+ *  chroma bands to the pixel 'format'. Chroma bands are subsampled by
+ *  averaging 2x2 pixels or upsampled by pixel replication.
+ *
+ *  Return value:
+ *	pointer to the new image structure.
+ */
+{
+   image_t *new;
+   color_e  band;
+   unsigned x, y;
+   
+   if (!image->color || image->format == format)
+      return clone_image (image);
+
+   new = alloc_image (image->width, image->height, YES, format);
+   memcpy (new->pixels [Y], image->pixels [Y],
+	   new->width * new->height * sizeof (word_t));
+
+   for (band = Cb; band <= Cr; band++)
+   {
+      const word_t *src = image->pixels [band];
+      word_t	   *dst = new->pixels [band];
+      
+      if (format == FORMAT_4_4_4)	/* 4:2:0 -> 4:4:4 */
+      {
+	 for (y = 0; y < new->height; y++, dst += new->width)
+	 {
+	    const word_t *row = src + (y >> 1) * (new->width >> 1);
+	    
+	    for (x = 0; x < new->width; x++)
+	       dst [x] = row [x >> 1];
+	 }
+      }
+      else				/* 4:4:4 -> 4:2:0 */
+      {
+	 for (y = 0; y < new->height >> 1; y++, src += 2 * new->width,
+		 dst += new->width >> 1)
+	    for (x = 0; x < new->width >> 1; x++)
+	    {
+	       int sum = src [2 * x] + src [2 * x + 1]
+			 + src [2 * x + new->width]
+			 + src [2 * x + 1 + new->width];
+#ifdef HAVE_SIGNED_SHIFT
+	       dst [x] = sum >> 2;
+#else /* not HAVE_SIGNED_SHIFT */
+	       dst [x] = sum / 4;
+#endif /* not HAVE_SIGNED_SHIFT */
+	    }
+      }
+   }
+
+   return new;
+}
+
 void
 free_image (image_t *image)
 /*
@@ -264,10 +516,11 @@ free_image (image_t *image)
       {
 	 color_e band;
 
-	 for (band  = first_band (image->color);
-	      band <= last_band (image->color); band++)
-	    if (image->pixels [band])
-	       fiasco_free (image->pixels [band]);
+	 if (!image->external)		/* pixels are owned by the caller */
+	    for (band  = first_band (image->color);
+		 band <= last_band (image->color); band++)
+	       if (image->pixels [band])
+		  fiasco_free (image->pixels [band]);
 	 fiasco_free (image);
       }
    }
@@ -280,7 +533,7 @@ FILE *
 read_pnmheader (const char *image_name, unsigned *width, unsigned *height,
 		bool_t *color)
 /*
- *  Read header of raw PNM image file 'image_name'.
+ *  Read header of PNM image file 'image_name'.
  *  
  *  Return values:
  *	return		File to image stream (pos. at beginning of raw data)
@@ -291,100 +544,57 @@ read_pnmheader (const char *image_name, unsigned *width, unsigned *height,
  *	'*color'	Color image flag
  */
 {
-   FILE	*infile;			/* input stream */
-   int	 magic;				/* magic number */
-   int   dummy;
-   
-   assert (width && height && color);
+   unsigned maxval;			/* maximum sample value */
+   bool_t   ascii;			/* plain PNM format */
    
-   infile = open_file (image_name, "FIASCO_IMAGES", READ_ACCESS);
-   if (infile == NULL)
-      file_error (image_name ? image_name : "stdin");
-
-   magic  = fgetc (infile) << 8;
-   magic += fgetc (infile);
-
-   if (magic == RPGM_FORMAT)
-      *color = NO;
-   else if (magic == RPPM_FORMAT)
-      *color = YES;
-   else
-      error ("%s: image format '%c%c' not supported.",
-	     image_name, magic >> 8, magic % 256);
-
-   dummy = read_int (infile);
-   if (dummy < 32)
-      error ("Width of image `%s' has to be at least 32 pixels.");
-   *width = dummy;
-
-   dummy = read_int (infile);
-   if (dummy < 32)
-      error ("Height of image `%s' has to be at least 32 pixels.");
-   *height = dummy;
-
-   dummy = read_int (infile);
-
-   if (fgetc (infile) == EOF)
-      error ("%s: EOF reached, input seems to be truncated!");
-
-   return infile;
+   return open_pnm (image_name, width, height, color, &maxval, &ascii);
 }
 
 image_t *
 read_image (const char *image_name)
 /*
- *  Read image 'image_name'.
+ *  Read image 'image_name'. Raw and plain (ASCII) PGM and PPM
+ *  images are supported, samples with a maximum value other than 255
+ *  (up to 65535) are scaled to 8 bits.
  *  
  *  Return value:
  *	pointer to the image structure.
  */
 {
-   FILE	    *input;			/* input stream */
-   image_t  *image;			/* pointer to new image structure */
-   unsigned  width, height;		/* image size */
-   bool_t    color;			/* color image ? (YES/NO) */
-
-   input = read_pnmheader (image_name, &width, &height, &color);
+   FILE		 *input;		/* input stream */
+   image_t	 *image;		/* pointer to new image structure */
+   unsigned	  width, height;	/* image size */
+   bool_t	  color;		/* color image ? (YES/NO) */
+   unsigned	  maxval;		/* maximum sample value */
+   bool_t	  ascii;		/* plain PNM format */
+   unsigned	  bytes;		/* bytes of a raw pixel */
+   unsigned	  rows;			/* rows of a strip */
+   unsigned char *buffer;		/* raw pixels of current strip */
+   unsigned	  y;			/* current row */
+
+   input = open_pnm (image_name, &width, &height, &color, &maxval, &ascii);
    image = alloc_image (width, height, color, FORMAT_4_4_4);
 
-   if (!color)				/* grayscale image */
-   {
-      word_t   *ptr = image->pixels [GRAY]; /* pointer to pixels */
-      unsigned  n;			/* pixel counter */
-      
-      for (n = 0; n < width * height; n++)
-      {
-	 int gray = getc (input);
-
-	 if (gray == EOF)
-	    file_error (image_name ? image_name : "stdin");
-	 else
-	    *ptr++ = (gray - 128) * 16;
-      }
-   }
-   else
+   init_kernels ();
+   bytes  = (color ? 3 : 1) * (maxval > 255 ? 2 : 1);
+   rows   = max (1, STRIP_SIZE / (bytes * width));
+   buffer = fiasco_calloc (min (rows, height) * width * bytes,
+			   sizeof (unsigned char));
+   
+   for (y = 0; y < height; y += rows)
    {
-      word_t   *lu, *cb, *cr;		/* pointer to pixels of color band */
-      int     	red, green, blue;	/* color values */
-      unsigned  n;			/* pixel counter */
+      unsigned n	= min (rows, height - y) * width; /* pixels of strip */
+      unsigned offset	= y * width;
       
-      lu = image->pixels [Y]; 
-      cb = image->pixels [Cb];
-      cr = image->pixels [Cr];
-      for (n = 0; n < width * height; n++)
-      {
-	 if ((red = getc (input)) == EOF)
-	    file_error (image_name ? image_name : "stdin");
-	 if ((green = getc (input)) == EOF)
-	    file_error (image_name ? image_name : "stdin");
-	 if ((blue = getc (input)) == EOF)
-	    file_error (image_name ? image_name : "stdin");
-	 
-	 *lu++ = (+ 0.2989 * red + 0.5866 * green + 0.1145 * blue - 128) * 16;
-	 *cb++ = (- 0.1687 * red - 0.3312 * green + 0.5000 * blue) * 16;
-	 *cr++ = (+ 0.5000 * red - 0.4183 * green - 0.0816 * blue) * 16;
-      }
+      read_samples (input, image_name, buffer, n * (color ? 3 : 1),
+		    maxval, ascii);
+      if (color)
+	 rgb_to_ycbcr (image->pixels [Y] + offset, image->pixels [Cb] + offset,
+		       image->pixels [Cr] + offset, buffer, 3, n);
+      else
+	 bytes_to_words (image->pixels [GRAY] + offset, buffer, n);
    }
+   fiasco_free (buffer);
    fclose (input);
    
    return image;
@@ -398,7 +608,11 @@ write_image (const char *image_name, const image_t *image)
  *  No return value.
  */
 {
-   FILE	*output;			/* output stream */
+   FILE		 *output;		/* output stream */
+   unsigned	  bytes;		/* bytes of a raw pixel */
+   unsigned	  rows;			/* rows of a strip */
+   unsigned char *buffer;		/* raw pixels of current strip */
+   unsigned	  y;			/* current row */
 
    assert (image && image_name);
    
@@ -415,14 +629,154 @@ write_image (const char *image_name, const image_t *image)
    fprintf (output, "%s\n%d %d\n255\n", image->color ? "P6" : "P5",
 	    image->width, image->height);	
 
-   if (image->color == NO)		/* Grayscale image */
-      gray_write (image, output);
-   else					/* Color image */
-      color_write (image, output);
-
+   if (!init_clipping ())
+      error (fiasco_get_error_message ());
+   if (image->color)
+      init_chroma_tables ();
+   init_kernels ();
+   bytes  = image->color ? 3 : 1;
+   rows   = max (1, STRIP_SIZE / (bytes * image->width));
+   buffer = fiasco_calloc (min (rows, image->height) * image->width * bytes,
+		    sizeof (unsigned char));
+   
+   for (y = 0; y < image->height; y += rows)
+   {
+      unsigned n      = min (rows, image->height - y) * image->width;
+      unsigned offset = y * image->width;
+      
+      if (image->color)
+	 ycbcr_to_rgb (buffer, 3, image->pixels [Y] + offset,
+		       image->pixels [Cb] + offset, image->pixels [Cr] + offset,
+		       n);
+      else
+	 words_to_bytes (buffer, image->pixels [GRAY] + offset, n);
+      if (fwrite (buffer, bytes, n, output) != n)
+	 error ("Can't write pixels of image `%s'.",
+		image_name ? image_name : "stdout");
+   }
+   fiasco_free (buffer);
    fclose (output);
 }
 
+void
+export_image (const image_t *image, unsigned char *buffer, unsigned stride,
+	      fiasco_layout_e layout)
+/*
+ *  Convert the pixels of 'image' to 8 bit values and store them in the
+ *  given 'buffer' using the pixel 'layout'. Rows of the buffer
+ *  start every 'stride' bytes. For planar layouts, 'stride' is the
+ *  row size of the Y plane. The Cb and Cr planes follow the Y plane
+ *  and use the row size 'stride' / 2 (4:2:0) or 'stride' (4:4:4).
+ *  The pixels are clipped and converted in a single pass.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'buffer' is filled with the converted pixels
+ */
+{
+   assert (image && buffer);
+
+   init_kernels ();
+   switch (layout)
+   {
+      case FIASCO_YUV_420:
+	 export_planar (image, buffer, stride, FORMAT_4_2_0);
+	 break;
+      case FIASCO_YUV_444:
+	 export_planar (image, buffer, stride, FORMAT_4_4_4);
+	 break;
+      case FIASCO_RGB_24:
+	 export_rgb (image, buffer, stride, 3);
+	 break;
+      case FIASCO_RGBA_32:
+	 export_rgb (image, buffer, stride, 4);
+	 break;
+      case FIASCO_GRAY_8:
+	 export_gray (image, buffer, stride);
+	 break;
+      default:
+	 error ("Unknown pixel layout %d.", layout);
+   }
+}
+
+image_t *
+import_image (const unsigned char *buffer, unsigned width, unsigned height,
+	      unsigned stride, fiasco_layout_e layout)
+/*
+ *  Image constructor:
+ *  Convert the 'width' x 'height' 8 bit pixels stored in 'buffer' using
+ *  the pixel 'layout' (see export_image ()) to a new image. Rows of
+ *  the buffer start every 'stride' bytes. FIASCO_GRAY_8 yields a
+ *  grayscale image, FIASCO_YUV_420 a color image in 4:2:0 format and
+ *  all other layouts a color image in 4:4:4 format.
+ *
+ *  Return value:
+ *	pointer to the new image structure.
+ */
+{
+   image_t *image;
+
+   assert (buffer);
+
+   init_kernels ();
+   switch (layout)
+   {
+      case FIASCO_YUV_420:
+	 image = alloc_image (width, height, YES, FORMAT_4_2_0);
+	 import_planar (image, buffer, stride);
+	 break;
+      case FIASCO_YUV_444:
+	 image = alloc_image (width, height, YES, FORMAT_4_4_4);
+	 import_planar (image, buffer, stride);
+	 break;
+      case FIASCO_RGB_24:
+	 image = alloc_image (width, height, YES, FORMAT_4_4_4);
+	 import_rgb (image, buffer, stride, 3);
+	 break;
+      case FIASCO_RGBA_32:
+	 image = alloc_image (width, height, YES, FORMAT_4_4_4);
+	 import_rgb (image, buffer, stride, 4);
+	 break;
+      case FIASCO_GRAY_8:
+	 image = alloc_image (width, height, NO, FORMAT_4_4_4);
+	 import_planar (image, buffer, stride);
+	 break;
+      default:
+	 error ("Unknown pixel layout %d.", layout);
+	 image = NULL;
+   }
+
+   return image;
+}
+
+unsigned
+layout_row_size (unsigned width, fiasco_layout_e layout)
+/*
+ *  Compute the minimum row size of a buffer which stores 'width' pixels
+ *  per row using the pixel 'layout'. For planar layouts, this is the
+ *  row size of the Y plane.
+ *
+ *  Return value:
+ *	number of bytes per row
+ *	0 if 'layout' is not defined
+ */
+{
+   switch (layout)
+   {
+      case FIASCO_YUV_420:
+      case FIASCO_YUV_444:
+      case FIASCO_GRAY_8:
+	 return width;
+      case FIASCO_RGB_24:
+	 return 3 * width;
+      case FIASCO_RGBA_32:
+	 return 4 * width;
+      default:
+	 return 0;
+   }
+}
+
 bool_t
 same_image_type (const image_t *img1, const image_t *img2)
 /*
@@ -447,35 +801,114 @@ same_image_type (const image_t *img1, const image_t *img2)
   
 *****************************************************************************/
 
+static FILE *
+open_pnm (const char *image_name, unsigned *width, unsigned *height,
+	  bool_t *color, unsigned *maxval, bool_t *ascii)
+/*
+ *  Open PNM image file 'image_name' and read its header.
+ *  
+ *  Return values:
+ *	return		File to image stream (pos. at beginning of pixels)
+ *
+ *  Side effects:
+ *	'*width'	Width of image
+ *	'*height'	Height of image
+ *	'*color'	Color image flag
+ *	'*maxval'	Maximum sample value
+ *	'*ascii'	Plain (ASCII) PNM flag
+ */
+{
+   FILE	      *infile;			/* input stream */
+   int	       magic;			/* magic number */
+   int	       dummy;
+   const char *name = image_name ? image_name : "stdin";
+   
+   assert (width && height && color && maxval && ascii);
+   
+   infile = open_file (image_name, "FIASCO_IMAGES", READ_ACCESS);
+   if (infile == NULL)
+      file_error (name);
+
+   magic  = fgetc (infile) << 8;
+   magic += fgetc (infile);
+
+   if (magic == RPGM_FORMAT || magic == APGM_FORMAT)
+      *color = NO;
+   else if (magic == RPPM_FORMAT || magic == APPM_FORMAT)
+      *color = YES;
+   else
+      error ("%s: image format '%c%c' not supported.",
+	     name, magic >> 8, magic % 256);
+   *ascii = magic == APGM_FORMAT || magic == APPM_FORMAT;
+
+   dummy = read_int (infile);
+   if (dummy < 32)
+      error ("Width of image `%s' has to be at least 32 pixels.", name);
+   *width = dummy;
+
+   dummy = read_int (infile);
+   if (dummy < 32)
+      error ("Height of image `%s' has to be at least 32 pixels.", name);
+   *height = dummy;
+
+   dummy = read_int (infile);
+   if (dummy < 1 || dummy > 65535)
+      error ("%s: maximum sample value %d not supported.", name, dummy);
+   *maxval = dummy;
+
+   if (fgetc (infile) == EOF)
+      error ("%s: EOF reached, input seems to be truncated!", name);
+
+   return infile;
+}
+
 static void
-gray_write (const image_t *image, FILE *output)
+read_samples (FILE *input, const char *image_name, unsigned char *buffer,
+	      unsigned n, unsigned maxval, bool_t ascii)
 /*
- *  Write grayscale 'image' to 'output' stream.
+ *  Read the next 'n' samples of image 'image_name' from the stream
+ *  'input' and scale them from [0, 'maxval'] to [0, 255]. Plain
+ *  ('ascii') images store decimal numbers, raw images store bytes or
+ *  big endian 16 bit words if 'maxval' > 255. For raw 16 bit samples
+ *  'buffer' has to provide room for 2 * 'n' bytes.
  *
  *  No return value.
+ *
+ *  Side effects:
+ *	'buffer'[] is filled with the 8 bit samples
  */
 {
-   word_t   *pixels;			/* pointer to current pixel */
-   unsigned  n;				/* number of pixels to write */
-   unsigned *gray_clip;			/* clipping table */
-
-   gray_clip  = init_clipping ();	/* mapping of int -> unsigned */
-   if (!gray_clip)
-      error (fiasco_get_error_message ());
-   gray_clip += 128;			/* [-128, 127] -> [0,255] */
+   unsigned i;				/* current sample */
    
-   pixels = image->pixels [GRAY];
-   for (n = image->width * image->height; n; n--)
+   if (ascii)
+      for (i = 0; i < n; i++)
+      {
+	 int value = read_int (input);
+
+	 if (value < 0 || value > (int) maxval)
+	    error ("%s: sample value %d out of range.",
+		   image_name ? image_name : "stdin", value);
+	 buffer [i] = (value * 255 + maxval / 2) / maxval;
+      }
+   else if (maxval > 255)
    {
-      unsigned value;			/* int representation of pixel */
-      
-#ifdef HAVE_SIGNED_SHIFT
-      value = gray_clip [*pixels++ >> 4];
-#else /* not HAVE_SIGNED_SHIFT */
-      value = gray_clip [*pixels++ / 16];
-#endif /* not HAVE_SIGNED_SHIFT */
-      if (putc (value, output) != (int) value)
-	 error ("Can't write image pixel %d.", n);
+      if (fread (buffer, 2, n, input) != n)
+	 file_error (image_name ? image_name : "stdin");
+      for (i = 0; i < n; i++)		/* in place: 2 * i >= i */
+      {
+	 unsigned value = min ((buffer [2 * i] << 8) + buffer [2 * i + 1],
+			       maxval);
+	 
+	 buffer [i] = (value * 255 + maxval / 2) / maxval;
+      }
+   }
+   else
+   {
+      if (fread (buffer, 1, n, input) != n)
+	 file_error (image_name ? image_name : "stdin");
+      if (maxval != 255)
+	 for (i = 0; i < n; i++)
+	    buffer [i] = (min (buffer [i], maxval) * 255 + maxval / 2) / maxval;
    }
 }
 
@@ -488,18 +921,41 @@ static void
 init_chroma_tables (void)
 /*
  *  Chroma tables are used to perform fast YCbCr->RGB color space conversion.
+ *  The tables are computed only once, even if several threads call
+ *  this function at the same time.
+ */
+{
+#if HAVE_PTHREAD_H
+   static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+   pthread_once (&once, compute_chroma_tables);
+#else /* not HAVE_PTHREAD_H */
+   if (Cr_r_tab == NULL || Cr_g_tab == NULL ||
+       Cb_g_tab == NULL || Cb_b_tab == NULL)
+      compute_chroma_tables ();
+#endif /* not HAVE_PTHREAD_H */
+
+   if (Cr_r_tab == NULL)
+      error ("Out of memory!");
+}
+
+static void
+compute_chroma_tables (void)
+/*
+ *  Compute the YCbCr->RGB chroma tables. The tables remain NULL if
+ *  memory is exhausted (this function is called by pthread_once (),
+ *  hence it must not raise an error).
  */
 {
-   int crval, cbval, i;
+   int  crval, cbval, i;
+   int *tables = calloc (4 * 768, sizeof (int));
 
-   if (Cr_r_tab != NULL || Cr_g_tab != NULL ||
-       Cb_g_tab != NULL || Cb_b_tab != NULL)
+   if (!tables)
       return;
-
-   Cr_r_tab = fiasco_calloc (768, sizeof (int));
-   Cr_g_tab = fiasco_calloc (768, sizeof (int));
-   Cb_g_tab = fiasco_calloc (768, sizeof (int));
-   Cb_b_tab = fiasco_calloc (768, sizeof (int));
+   Cr_r_tab = tables;
+   Cr_g_tab = tables + 768;
+   Cb_g_tab = tables + 2 * 768;
+   Cb_b_tab = tables + 3 * 768;
 
    for (i = 256; i < 512; i++)
    {
@@ -532,51 +988,600 @@ init_chroma_tables (void)
 }
 
 static void
-color_write (const image_t *image, FILE *output)
+export_planar (const image_t *image, unsigned char *buffer, unsigned stride,
+	       format_e format)
 /*
- *  Write grayscale 'image' to 'output' stream.
+ *  Store 'image' as 8 bit Y, Cb and Cr planes of the given 'format'
+ *  in 'buffer' (see export_image ()). Chroma bands are subsampled by
+ *  averaging 2x2 pixels or upsampled by pixel replication, grayscale
+ *  images get neutral chroma planes.
  *
  *  No return value.
  */
 {
-   word_t   *yptr, *cbptr, *crptr;	/* pointer to current pixel */
    unsigned *gray_clip;			/* clipping table */
-   unsigned  n;				/* number of pixels to write */
+   unsigned  x, y;			/* current pixel */
+   color_e   band;			/* current color band */
 
    gray_clip = init_clipping ();
    if (!gray_clip)
       error (fiasco_get_error_message ());
-   init_chroma_tables ();
+   gray_clip += 128;			/* [-128, 127] -> [0,255] */
 
-   yptr  = image->pixels [Y];
-   cbptr = image->pixels [Cb];
-   crptr = image->pixels [Cr];
+   for (band = Y; band <= Cr; band++)
+   {
+      unsigned       width  = image->width;  /* size of output band */
+      unsigned       height = image->height;
+      unsigned       offset = stride;	     /* row size of output band */
+      unsigned char *dst    = buffer;
+      const word_t  *src    = image->pixels [band];
+      
+      if (band != Y && format == FORMAT_4_2_0)
+      {
+	 width  >>= 1;
+	 height >>= 1;
+	 offset >>= 1;
+      }
+      if (band != Y)			/* chroma planes follow Y plane */
+	 dst += stride * image->height
+		+ (band == Cr ? offset * height : 0);
+
+      if (band != Y && !image->color)
+	 for (y = 0; y < height; y++)
+	    memset (dst + y * offset, 128, width);
+      else if (band == Y || image->format == format)
+      {
+	 unsigned src_width = band != Y && format == FORMAT_4_2_0
+			      ? image->width >> 1 : image->width;
+	 
+	 for (y = 0; y < height; y++, src += src_width, dst += offset)
+	    words_to_bytes (dst, src, width);
+      }
+      else if (format == FORMAT_4_2_0)	/* 4:4:4 -> 4:2:0 */
+      {
+	 for (y = 0; y < height; y++, src += 2 * image->width, dst += offset)
+	    for (x = 0; x < width; x++)
+	    {
+	       int sum = src [2 * x] + src [2 * x + 1]
+			 + src [2 * x + image->width]
+			 + src [2 * x + 1 + image->width];
+#ifdef HAVE_SIGNED_SHIFT
+	       dst [x] = gray_clip [sum >> 6];
+#else /* not HAVE_SIGNED_SHIFT */
+	       dst [x] = gray_clip [sum / 64];
+#endif /* not HAVE_SIGNED_SHIFT */
+	    }
+      }
+      else				/* 4:2:0 -> 4:4:4 */
+      {
+	 for (y = 0; y < height; y++, dst += offset)
+	 {
+	    const word_t *row = src + (y >> 1) * (image->width >> 1);
+	    
+	    for (x = 0; x < width; x++)
+#ifdef HAVE_SIGNED_SHIFT
+	       dst [x] = gray_clip [row [x >> 1] >> 4];
+#else /* not HAVE_SIGNED_SHIFT */
+	       dst [x] = gray_clip [row [x >> 1] / 16];
+#endif /* not HAVE_SIGNED_SHIFT */
+	 }
+      }
+   }
+}
 
-   for (n = image->width * image->height; n; n--)
+static void
+export_rgb (const image_t *image, unsigned char *buffer, unsigned stride,
+	    unsigned bytes)
+/*
+ *  Store 'image' as packed RGB pixels of #'bytes' bytes in 'buffer'
+ *  (see export_image ()). If 'bytes' is 4 then the fourth byte of
+ *  each pixel is set to 255 (opaque alpha value).
+ *
+ *  No return value.
+ */
+{
+   unsigned *gray_clip;			/* clipping table */
+   unsigned  x, y;			/* current pixel */
+
+   gray_clip = init_clipping ();
+   if (!gray_clip)
+      error (fiasco_get_error_message ());
+   if (image->color)
+      init_chroma_tables ();
+
+   for (y = 0; y < image->height; y++)
    {
-      int yval, cbval, crval;		/* pixel values of different bands */
-      int value;			/* integer value of current pixel */
+      unsigned char *dst   = buffer + y * stride;
+      const word_t  *yptr  = image->pixels [Y] + y * image->width;
+      const word_t  *cbptr = NULL;
+      const word_t  *crptr = NULL;
+      unsigned	     shift = image->format == FORMAT_4_2_0 ? 1 : 0;
       
+      if (image->color && !shift)
+      {
+	 ycbcr_to_rgb (dst, bytes, yptr, image->pixels [Cb] + y * image->width,
+		       image->pixels [Cr] + y * image->width, image->width);
+	 continue;
+      }
+      if (image->color)
+      {
+	 cbptr = image->pixels [Cb] + (y >> shift) * (image->width >> shift);
+	 crptr = image->pixels [Cr] + (y >> shift) * (image->width >> shift);
+      }
+      for (x = 0; x < image->width; x++, dst += bytes)
+      {
+#ifdef HAVE_SIGNED_SHIFT
+	 int yval = (yptr [x] >> 4) + 128;
+#else /* not HAVE_SIGNED_SHIFT */
+	 int yval = yptr [x] / 16 + 128;
+#endif /* not HAVE_SIGNED_SHIFT */
+
+	 if (image->color)
+	 {
 #ifdef HAVE_SIGNED_SHIFT
-      crval = *crptr++ >> 4;
-      cbval = *cbptr++ >> 4;
-      yval  = (*yptr++ >> 4) + 128;
+	    int crval = crptr [x >> shift] >> 4;
+	    int cbval = cbptr [x >> shift] >> 4;
 #else /* not HAVE_SIGNED_SHIFT */
-      crval = *crptr++ / 16;
-      cbval = *cbptr++ / 16;
-      yval  = *yptr++  / 16 + 128;
+	    int crval = crptr [x >> shift] / 16;
+	    int cbval = cbptr [x >> shift] / 16;
 #endif /* not HAVE_SIGNED_SHIFT */
 
-      value = gray_clip [yval + Cr_r_tab [crval]];
-      if (putc (value, output) != value)
-	 error ("Can't write red component of image pixel %d.", n);
+	    dst [0] = gray_clip [yval + Cr_r_tab [crval]];
+	    dst [1] = gray_clip [yval + Cr_g_tab [crval] + Cb_g_tab [cbval]];
+	    dst [2] = gray_clip [yval + Cb_b_tab [cbval]];
+	 }
+	 else
+	    dst [0] = dst [1] = dst [2] = gray_clip [yval];
+	 if (bytes == 4)
+	    dst [3] = 255;
+      }
+   }
+}
+
+static void
+export_gray (const image_t *image, unsigned char *buffer, unsigned stride)
+/*
+ *  Store the luminance band of 'image' as 8 bit plane in 'buffer'
+ *  (see export_image ()).
+ *
+ *  No return value.
+ */
+{
+   const word_t *src = image->pixels [Y];
+   unsigned      y;			/* current row */
+
+   if (!init_clipping ())
+      error (fiasco_get_error_message ());
 
-      value = gray_clip [yval + Cr_g_tab [crval] + Cb_g_tab [cbval]];
-      if (putc (value, output) != value)
-	 error ("Can't write green component of image pixel %d.", n);
+   for (y = 0; y < image->height; y++, src += image->width, buffer += stride)
+      words_to_bytes (buffer, src, image->width);
+}
 
-      value = gray_clip [yval + Cb_b_tab [cbval]];
-      if (putc (value, output) != value)
-	 error ("Can't write blue component of image pixel %d.", n);
+static void
+import_planar (image_t *image, const unsigned char *buffer, unsigned stride)
+/*
+ *  Read the 8 bit Y, Cb and Cr planes of 'image' from 'buffer' (see
+ *  import_image ()). The format of 'image' defines the size of the
+ *  chroma planes, grayscale images read only the Y plane.
+ *
+ *  No return value.
+ */
+{
+   color_e band;			/* current color band */
+   
+   for (band = first_band (image->color); band <= last_band (image->color);
+	band++)
+   {
+      unsigned		   width  = image->width;  /* size of input band */
+      unsigned		   height = image->height;
+      unsigned		   offset = stride;	   /* row size of input band */
+      const unsigned char *src	  = buffer;
+      word_t		  *dst	  = image->pixels [band];
+      unsigned		   y;
+      
+      if (band != Y && image->format == FORMAT_4_2_0)
+      {
+	 width  >>= 1;
+	 height >>= 1;
+	 offset >>= 1;
+      }
+      if (band != Y)			/* chroma planes follow Y plane */
+	 src += stride * image->height
+		+ (band == Cr ? offset * height : 0);
+
+      for (y = 0; y < height; y++, src += offset, dst += width)
+	 bytes_to_words (dst, src, width);
    }
 }
+
+static void
+import_rgb (image_t *image, const unsigned char *buffer, unsigned stride,
+	    unsigned bytes)
+/*
+ *  Read packed RGB pixels of #'bytes' bytes from 'buffer' (see
+ *  import_image ()) and convert them to the Y, Cb and Cr bands of
+ *  'image'. The fourth byte of RGBA pixels is ignored.
+ *
+ *  No return value.
+ */
+{
+   unsigned y;				/* current row */
+
+   for (y = 0; y < image->height; y++)
+   {
+      unsigned offset = y * image->width;
+      
+      rgb_to_ycbcr (image->pixels [Y] + offset, image->pixels [Cb] + offset,
+		    image->pixels [Cr] + offset, buffer + y * stride, bytes,
+		    image->width);
+   }
+}
+
+static void
+init_kernels (void)
+/*
+ *  Select the pixel conversion kernels on the first call.
+ *
+ *  No return value.
+ */
+{
+#if HAVE_PTHREAD_H
+   static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+   pthread_once (&once, select_kernels);
+#else  /* not HAVE_PTHREAD_H */
+   if (!bytes_to_words)
+      select_kernels ();
+#endif /* not HAVE_PTHREAD_H */
+}
+
+static void
+select_kernels (void)
+/*
+ *  Choose the pixel conversion kernels for the best instruction set
+ *  supported by the host processor.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	all kernel pointers are set
+ */
+{
+   bytes_to_words = bytes_to_words_c;
+   words_to_bytes = words_to_bytes_c;
+   rgb_to_ycbcr   = rgb_to_ycbcr_c;
+   ycbcr_to_rgb   = ycbcr_to_rgb_c;
+
+#if X86_KERNELS
+   __builtin_cpu_init ();
+   if (__builtin_cpu_supports ("sse2"))
+   {
+      bytes_to_words = bytes_to_words_sse2;
+      words_to_bytes = words_to_bytes_sse2;
+   }
+   if (__builtin_cpu_supports ("avx2"))
+   {
+      rgb_to_ycbcr = rgb_to_ycbcr_avx2;
+      ycbcr_to_rgb = ycbcr_to_rgb_avx2;
+   }
+#endif /* X86_KERNELS */
+}
+
+static void
+bytes_to_words_c (word_t *dst, const unsigned char *src, unsigned n)
+/*
+ *  Convert the 'n' 8 bit samples 'src'[] to the pixels 'dst'[].
+ *
+ *  No return value.
+ */
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+      dst [i] = (src [i] - 128) * 16;
+}
+
+static void
+words_to_bytes_c (unsigned char *dst, const word_t *src, unsigned n)
+/*
+ *  Clip the 'n' pixels 'src'[] and convert them to the 8 bit samples
+ *  'dst'[]. The clipping table has to be initialized.
+ *
+ *  No return value.
+ */
+{
+   unsigned *gray_clip = init_clipping () + 128; /* [-128, 127] -> [0,255] */
+   unsigned  i;
+
+   for (i = 0; i < n; i++)
+#ifdef HAVE_SIGNED_SHIFT
+      dst [i] = gray_clip [src [i] >> 4];
+#else /* not HAVE_SIGNED_SHIFT */
+      dst [i] = gray_clip [src [i] / 16];
+#endif /* not HAVE_SIGNED_SHIFT */
+}
+
+static void
+rgb_to_ycbcr_c (word_t *lu, word_t *cb, word_t *cr,
+		const unsigned char *src, unsigned bytes, unsigned n)
+/*
+ *  Convert the 'n' packed RGB pixels of #'bytes' bytes 'src'[] to
+ *  the pixels 'lu'[], 'cb'[] and 'cr'[].
+ *
+ *  No return value.
+ */
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++, src += bytes)
+   {
+      int red   = src [0];
+      int green = src [1];
+      int blue  = src [2];
+	 
+      lu [i] = (+ 0.2989 * red + 0.5866 * green + 0.1145 * blue - 128) * 16;
+      cb [i] = (- 0.1687 * red - 0.3312 * green + 0.5000 * blue) * 16;
+      cr [i] = (+ 0.5000 * red - 0.4183 * green - 0.0816 * blue) * 16;
+   }
+}
+
+static void
+ycbcr_to_rgb_c (unsigned char *dst, unsigned bytes, const word_t *lu,
+		const word_t *cb, const word_t *cr, unsigned n)
+/*
+ *  Convert the 'n' pixels 'lu'[], 'cb'[] and 'cr'[] to packed RGB
+ *  pixels of #'bytes' bytes 'dst'[]. If 'bytes' is 4 then the fourth
+ *  byte of each pixel is set to 255. The clipping and chroma tables
+ *  have to be initialized.
+ *
+ *  No return value.
+ */
+{
+   unsigned *gray_clip = init_clipping (); /* clipping table */
+   unsigned  i;
+
+   for (i = 0; i < n; i++, dst += bytes)
+   {
+#ifdef HAVE_SIGNED_SHIFT
+      int crval = cr [i] >> 4;
+      int cbval = cb [i] >> 4;
+      int yval  = (lu [i] >> 4) + 128;
+#else /* not HAVE_SIGNED_SHIFT */
+      int crval = cr [i] / 16;
+      int cbval = cb [i] / 16;
+      int yval  = lu [i] / 16 + 128;
+#endif /* not HAVE_SIGNED_SHIFT */
+
+      dst [0] = gray_clip [yval + Cr_r_tab [crval]];
+      dst [1] = gray_clip [yval + Cr_g_tab [crval] + Cb_g_tab [cbval]];
+      dst [2] = gray_clip [yval + Cb_b_tab [cbval]];
+      if (bytes == 4)
+	 dst [3] = 255;
+   }
+}
+
+#if X86_KERNELS
+
+__attribute__ ((target ("sse2")))
+static void
+bytes_to_words_sse2 (word_t *dst, const unsigned char *src, unsigned n)
+/*
+ *  SSE2 version of bytes_to_words_c ().
+ */
+{
+   const __m128i zero   = _mm_setzero_si128 ();
+   const __m128i offset = _mm_set1_epi16 (128 * 16);
+   unsigned      i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+   {
+      __m128i v  = _mm_loadu_si128 ((const __m128i *) (src + i));
+      __m128i lo = _mm_slli_epi16 (_mm_unpacklo_epi8 (v, zero), 4);
+      __m128i hi = _mm_slli_epi16 (_mm_unpackhi_epi8 (v, zero), 4);
+
+      _mm_storeu_si128 ((__m128i *) (dst + i), _mm_sub_epi16 (lo, offset));
+      _mm_storeu_si128 ((__m128i *) (dst + i + 8), _mm_sub_epi16 (hi, offset));
+   }
+   bytes_to_words_c (dst + i, src + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+words_to_bytes_sse2 (unsigned char *dst, const word_t *src, unsigned n)
+/*
+ *  SSE2 version of words_to_bytes_c (): the saturation of packuswb
+ *  clips the samples like the clipping table.
+ */
+{
+   const __m128i offset = _mm_set1_epi16 (128);
+   unsigned      i;
+
+   for (i = 0; i + 16 <= n; i += 16)
+   {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (src + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (src + i + 8));
+
+      a = _mm_add_epi16 (_mm_srai_epi16 (a, 4), offset);
+      b = _mm_add_epi16 (_mm_srai_epi16 (b, 4), offset);
+      _mm_storeu_si128 ((__m128i *) (dst + i), _mm_packus_epi16 (a, b));
+   }
+   words_to_bytes_c (dst + i, src + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+rgb_to_ycbcr_avx2 (word_t *lu, word_t *cb, word_t *cr,
+		   const unsigned char *src, unsigned bytes, unsigned n)
+/*
+ *  AVX2 version of rgb_to_ycbcr_c (): eight pixels are gathered as
+ *  32 bit words and converted in two halves of four double precision
+ *  lanes. Products and sums are computed in the order of the C code.
+ */
+{
+   const __m256i mask  = _mm256_set1_epi32 (0xff);
+   const __m256i index = _mm256_mullo_epi32 (_mm256_setr_epi32 (0, 1, 2, 3,
+								4, 5, 6, 7),
+					     _mm256_set1_epi32 (bytes));
+   const __m256d sixteen = _mm256_set1_pd (16);
+   unsigned      i;
+
+   /*
+    *  A gather reads four bytes of every pixel: the last pixel of
+    *  RGB rows is left to the C code.
+    */
+   for (i = 0; i + 8 < n; i += 8)
+   {
+      __m256i pixel = _mm256_i32gather_epi32 ((const int *) (src + i * bytes),
+					      index, 1);
+      __m256i red   = _mm256_and_si256 (pixel, mask);
+      __m256i green = _mm256_and_si256 (_mm256_srli_epi32 (pixel, 8), mask);
+      __m256i blue  = _mm256_and_si256 (_mm256_srli_epi32 (pixel, 16), mask);
+      __m128i y [2], u [2], v [2];	/* converted halves */
+      unsigned half;
+
+      for (half = 0; half < 2; half++)
+      {
+	 __m256d r = _mm256_cvtepi32_pd (half
+					 ? _mm256_extracti128_si256 (red, 1)
+					 : _mm256_castsi256_si128 (red));
+	 __m256d g = _mm256_cvtepi32_pd (half
+					 ? _mm256_extracti128_si256 (green, 1)
+					 : _mm256_castsi256_si128 (green));
+	 __m256d b = _mm256_cvtepi32_pd (half
+					 ? _mm256_extracti128_si256 (blue, 1)
+					 : _mm256_castsi256_si128 (blue));
+	 __m256d t;
+
+	 t = _mm256_add_pd (_mm256_mul_pd (_mm256_set1_pd (+ 0.2989), r),
+			    _mm256_mul_pd (_mm256_set1_pd (0.5866), g));
+	 t = _mm256_add_pd (t, _mm256_mul_pd (_mm256_set1_pd (0.1145), b));
+	 t = _mm256_sub_pd (t, _mm256_set1_pd (128));
+	 y [half] = _mm256_cvttpd_epi32 (_mm256_mul_pd (t, sixteen));
+	 
+	 t = _mm256_sub_pd (_mm256_mul_pd (_mm256_set1_pd (- 0.1687), r),
+			    _mm256_mul_pd (_mm256_set1_pd (0.3312), g));
+	 t = _mm256_add_pd (t, _mm256_mul_pd (_mm256_set1_pd (0.5000), b));
+	 u [half] = _mm256_cvttpd_epi32 (_mm256_mul_pd (t, sixteen));
+	 
+	 t = _mm256_sub_pd (_mm256_mul_pd (_mm256_set1_pd (+ 0.5000), r),
+			    _mm256_mul_pd (_mm256_set1_pd (0.4183), g));
+	 t = _mm256_sub_pd (t, _mm256_mul_pd (_mm256_set1_pd (0.0816), b));
+	 v [half] = _mm256_cvttpd_epi32 (_mm256_mul_pd (t, sixteen));
+      }
+      _mm_storeu_si128 ((__m128i *) (lu + i), _mm_packs_epi32 (y [0], y [1]));
+      _mm_storeu_si128 ((__m128i *) (cb + i), _mm_packs_epi32 (u [0], u [1]));
+      _mm_storeu_si128 ((__m128i *) (cr + i), _mm_packs_epi32 (v [0], v [1]));
+   }
+   rgb_to_ycbcr_c (lu + i, cb + i, cr + i, src + i * bytes, bytes, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m128i
+clip_avx2 (__m256i value)
+/*
+ *  Clip the eight 32 bit integers 'value' to [0, 255].
+ *
+ *  Return value:
+ *	eight bytes in the low half
+ */
+{
+   __m128i words = _mm_packus_epi32 (_mm256_castsi256_si128 (value),
+				     _mm256_extracti128_si256 (value, 1));
+
+   return _mm_packus_epi16 (words, words);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+ycbcr_to_rgb_avx2 (unsigned char *dst, unsigned bytes, const word_t *lu,
+		   const word_t *cb, const word_t *cr, unsigned n)
+/*
+ *  AVX2 version of ycbcr_to_rgb_c (): the chroma values are clamped
+ *  to the range of distinct table entries and the table values are
+ *  gathered, saturating packs clip the results like the clipping table.
+ */
+{
+   const __m256i lower = _mm256_set1_epi32 (-128);
+   const __m256i upper = _mm256_set1_epi32 (127);
+   const __m256i half  = _mm256_set1_epi32 (128);
+   const __m128i alpha = _mm_set1_epi8 (-1);
+   /* byte order of eight RGB pixels: red and green from rg, blue from b */
+   const __m128i rg0 = _mm_setr_epi8 (0, 8, -1, 1, 9, -1, 2, 10,
+				      -1, 3, 11, -1, 4, 12, -1, 5);
+   const __m128i b0  = _mm_setr_epi8 (-1, -1, 0, -1, -1, 1, -1, -1,
+				      2, -1, -1, 3, -1, -1, 4, -1);
+   const __m128i rg1 = _mm_setr_epi8 (13, -1, 6, 14, -1, 7, 15, -1,
+				      -1, -1, -1, -1, -1, -1, -1, -1);
+   const __m128i b1  = _mm_setr_epi8 (-1, 5, -1, -1, 6, -1, -1, 7,
+				      -1, -1, -1, -1, -1, -1, -1, -1);
+   unsigned      i;
+
+   for (i = 0; i + 8 <= n; i += 8, dst += 8 * bytes)
+   {
+      __m256i y = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *)
+							   (lu + i)));
+      __m256i u = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *)
+							   (cb + i)));
+      __m256i v = _mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i *)
+							   (cr + i)));
+      __m256i r, g, b;			/* chroma table values */
+      __m128i red, green, blue;		/* eight bytes of each color */
+
+      y = _mm256_add_epi32 (_mm256_srai_epi32 (y, 4), half);
+      u = _mm256_min_epi32 (_mm256_max_epi32 (_mm256_srai_epi32 (u, 4),
+					      lower), upper);
+      v = _mm256_min_epi32 (_mm256_max_epi32 (_mm256_srai_epi32 (v, 4),
+					      lower), upper);
+
+      r = _mm256_i32gather_epi32 (Cr_r_tab, v, 4);
+      g = _mm256_add_epi32 (_mm256_i32gather_epi32 (Cr_g_tab, v, 4),
+			    _mm256_i32gather_epi32 (Cb_g_tab, u, 4));
+      b = _mm256_i32gather_epi32 (Cb_b_tab, u, 4);
+      red   = clip_avx2 (_mm256_add_epi32 (y, r));
+      green = clip_avx2 (_mm256_add_epi32 (y, g));
+      blue  = clip_avx2 (_mm256_add_epi32 (y, b));
+      if (bytes == 4)
+      {
+	 __m128i rg = _mm_unpacklo_epi8 (red, green);
+	 __m128i ba = _mm_unpacklo_epi8 (blue, alpha);
+
+	 _mm_storeu_si128 ((__m128i *) dst, _mm_unpacklo_epi16 (rg, ba));
+	 _mm_storeu_si128 ((__m128i *) (dst + 16),
+			   _mm_unpackhi_epi16 (rg, ba));
+      }
+      else
+      {
+	 __m128i rg = _mm_unpacklo_epi64 (red, green);
+
+	 _mm_storeu_si128 ((__m128i *) dst,
+			   _mm_or_si128 (_mm_shuffle_epi8 (rg, rg0),
+					 _mm_shuffle_epi8 (blue, b0)));
+	 _mm_storel_epi64 ((__m128i *) (dst + 16),
+			   _mm_or_si128 (_mm_shuffle_epi8 (rg, rg1),
+					 _mm_shuffle_epi8 (blue, b1)));
+      }
+   }
+   ycbcr_to_rgb_c (dst, bytes, lu + i, cb + i, cr + i, n - i);
+}
+
+#endif /* X86_KERNELS */
+
+static fiasco_image_t *
+new_fiasco_image (image_t *image)
+/*
+ *  Construct the public FIASCO image structure of 'image'.
+ *
+ *  Return value:
+ *	pointer to the new FIASCO image structure
+ */
+{
+   fiasco_image_t *public = fiasco_calloc (1, sizeof (fiasco_image_t));
+
+   public->private    = image;
+   public->delete     = fiasco_image_delete;
+   public->get_width  = fiasco_image_get_width;
+   public->get_height = fiasco_image_get_height;
+   public->is_color   = fiasco_image_is_color;
+
+   return public;
+}
@@ -35,6 +35,7 @@ typedef struct image
    bool_t    color;			/* Color or grayscale image */
    format_e  format;			/* Pixel format 4:4:4 or 4:2:0 */
    word_t   *pixels [3];		/* Pixels in short format */
+   bool_t    external;			/* Pixels are owned by the caller */
 } image_t;
 
 image_t *
@@ -43,6 +44,8 @@ image_t *
 alloc_image (unsigned width, unsigned height, bool_t color, format_e format);
 image_t *
 clone_image (image_t *image);
+image_t *
+convert_image (image_t *image, format_e format);
 void
 free_image (image_t *image);
 FILE *
@@ -52,6 +55,14 @@ image_t *
 read_image (const char *image_name);
 void
 write_image (const char *image_name, const image_t *image);
+void
+export_image (const image_t *image, unsigned char *buffer, unsigned stride,
+	      fiasco_layout_e layout);
+image_t *
+import_image (const unsigned char *buffer, unsigned width, unsigned height,
+	      unsigned stride, fiasco_layout_e layout);
+unsigned
+layout_row_size (unsigned width, fiasco_layout_e layout);
 bool_t
 same_image_type (const image_t *img1, const image_t *img2);
 
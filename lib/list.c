@@ -151,6 +151,8 @@ list_remove (list_t *list, pos_e pos, void *data)
 	 valueptr = NULL;
       if (!list->tail)			/* 'element' was last node */
 	 list->head = NULL;
+      else
+	 list->tail->next = NULL;
    }
    else					/* pos == HEAD */
    {
@@ -165,6 +167,8 @@ list_remove (list_t *list, pos_e pos, void *data)
 	 valueptr = NULL;
       if (!list->head)			/* 'element' was last node */
 	 list->tail = NULL;
+      else
+	 list->head->prev = NULL;
    }
 
    if (valueptr)			/* copy value of node */
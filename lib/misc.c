@@ -26,6 +26,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
@@ -33,6 +37,14 @@
 #include "bit-io.h"
 #include "misc.h"
 
+/*****************************************************************************
+
+				local variables
+  
+*****************************************************************************/
+
+static unsigned *gray_clip = NULL;	/* clipping array */
+
 /*****************************************************************************
 
 				prototypes
@@ -41,6 +53,8 @@
 
 static void
 remove_comments (FILE *file);
+static void
+alloc_clipping (void);
 
 /*****************************************************************************
 
@@ -84,6 +98,54 @@ fiasco_free (void *ptr)
       warning ("Can't free memory block <NULL>.");
 }
 
+void *
+fiasco_aligned_calloc (size_t n, size_t size)
+/*
+ *  Allocate memory like fiasco_calloc (), but make the block start at
+ *  a multiple of MEMORY_ALIGNMENT bytes so that vector loads of
+ *  consecutive pixel rows do not straddle cache lines.
+ *  The block has to be released with fiasco_aligned_free ().
+ *
+ *  Return value: Pointer to the new block of memory on success,
+ *		  otherwise the program is terminated.
+ */
+{
+   char	*ptr;				/* block returned by calloc () */
+   char	*aligned;			/* aligned start of the block */
+
+   if (n <= 0 || size <= 0)
+      error ("Can't allocate memory for %d items of size %d",
+	     (int) n, (int) size);
+
+   ptr = calloc (1, n * size + MEMORY_ALIGNMENT + sizeof (void *));
+   if (ptr == NULL)
+      error ("Out of memory!");
+
+   /*
+    *  Keep the pointer returned by calloc () right below the aligned block
+    */
+   aligned = ptr + sizeof (void *);
+   aligned += (MEMORY_ALIGNMENT - (unsigned long) aligned % MEMORY_ALIGNMENT)
+	      % MEMORY_ALIGNMENT;
+   ((void **) aligned) [-1] = ptr;
+   
+   return aligned;
+}
+
+void
+fiasco_aligned_free (void *ptr)
+/*
+ *  Free memory block 'ptr' allocated with fiasco_aligned_calloc ().
+ *
+ *  No return value.
+ */
+{
+   if (ptr != NULL)
+      free (((void **) ptr) [-1]);
+   else
+      warning ("Can't free memory block <NULL>.");
+}
+
 unsigned
 prg_timer (clock_t *last_timer, enum action_e action)
 /*
@@ -317,38 +379,58 @@ bits_bin_code (unsigned value, unsigned maxval)
 unsigned *
 init_clipping (void)
 /*
- *  Initialize the clipping tables
+ *  Initialize the clipping tables.
+ *  The table is generated only once, even if several threads
+ *  call this function at the same time.
  *
  *  Return value:
  *	pointer to clipping table
  */
 {
-   static unsigned *gray_clip = NULL;	/* clipping array */
+#if HAVE_PTHREAD_H
+   static pthread_once_t once = PTHREAD_ONCE_INIT;
 
+   pthread_once (&once, alloc_clipping);
+#else /* not HAVE_PTHREAD_H */
    if (gray_clip == NULL)		/* initialize clipping table */
-   {
-      int i;				/* counter */
+      alloc_clipping ();
+#endif /* not HAVE_PTHREAD_H */
 
-      gray_clip  = calloc (256 * 3, sizeof (unsigned));
-      if (!gray_clip)
-      {
-	 set_error (_("Out of memory."));
-	 return NULL;
-      }
-      gray_clip += 256;
-
-      for (i = -256; i < 512; i++)
-	 if (i < 0)
-	    gray_clip [i] = 0;
-	 else if (i > 255)
-	    gray_clip [i] = 255;
-	 else
-	    gray_clip [i] = i;
-   }
+   if (!gray_clip)
+      set_error (_("Out of memory."));
 
    return gray_clip;
 }
 
+static void
+alloc_clipping (void)
+/*
+ *  Allocate and fill the clipping table 'gray_clip'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	'gray_clip' remains NULL if memory is exhausted
+ */
+{
+   unsigned *table = calloc (256 * 3, sizeof (unsigned));
+   int	     i;				/* counter */
+
+   if (!table)
+      return;
+   table += 256;
+
+   for (i = -256; i < 512; i++)
+      if (i < 0)
+	 table [i] = 0;
+      else if (i > 255)
+	 table [i] = 255;
+      else
+	 table [i] = i;
+
+   gray_clip = table;
+}
+
 #ifndef HAVE_STRDUP
 char *
 strdup (const char *s)
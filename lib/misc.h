@@ -28,10 +28,16 @@
 
 enum action_e {START, STOP};
 
+#define MEMORY_ALIGNMENT 64	/* alignment of fiasco_aligned_calloc () */
+
 void *
 fiasco_calloc (size_t n, size_t size);
 void
 fiasco_free (void *ptr);
+void *
+fiasco_aligned_calloc (size_t n, size_t size);
+void
+fiasco_aligned_free (void *ptr);
 unsigned
 prg_timer (clock_t *ptimer, enum action_e action);
 int 
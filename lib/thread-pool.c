@@ -0,0 +1,314 @@
+/*
+ *  thread-pool.c:	Pool of worker threads for parallel loops
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#if HAVE_UNISTD_H
+#	include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#if HAVE_PTHREAD_H && HAVE_THREAD_LOCAL && HAVE_SETJMP_H
+#	define USE_THREADS 1
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H && HAVE_THREAD_LOCAL && HAVE_SETJMP_H */
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "fiasco.h"
+#include "misc.h"
+#include "thread-pool.h"
+
+/*****************************************************************************
+
+				local variables
+
+*****************************************************************************/
+
+struct thread_pool
+/*
+ *  The calling thread and 'threads' - 1 worker threads share the tasks
+ *  of a job: every thread repeatedly takes the next task number until
+ *  all tasks are processed. All members below 'threads' are protected
+ *  by 'lock'.
+ */
+{
+   unsigned	   threads;		/* number of threads incl. caller */
+#if USE_THREADS
+   pthread_t	   worker [MAXTHREADS];	/* worker threads */
+   pthread_mutex_t lock;		/* protects the job description */
+   pthread_cond_t  start;		/* signals a new job or 'quit' */
+   pthread_cond_t  done;		/* signals end of the current job */
+   task_func_t	   func;		/* task function of current job */
+   void		  *data;		/* argument of 'func' */
+   unsigned	   tasks;		/* number of tasks of current job */
+   unsigned	   next_task;		/* next task to process */
+   unsigned	   pending;		/* number of unfinished tasks */
+   unsigned	   generation;		/* number of the current job */
+   bool_t	   quit;		/* terminate worker threads */
+   char		  *error_message;	/* first error of the current job */
+#endif /* USE_THREADS */
+};
+
+#if USE_THREADS
+/*
+ *  Set while a thread processes tasks of a pool. Nested calls of
+ *  run_tasks () are executed sequentially by the calling thread.
+ */
+static THREAD_LOCAL bool_t in_task = NO;
+#endif /* USE_THREADS */
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+#if USE_THREADS
+static void *
+worker_main (void *arg);
+static void
+execute_tasks (thread_pool_t *pool);
+#endif /* USE_THREADS */
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+thread_pool_t *
+alloc_thread_pool (unsigned threads)
+/*
+ *  Thread pool constructor.
+ *  Start 'threads' - 1 worker threads, the thread calling run_tasks ()
+ *  is the last member of the pool. If 'threads' is zero then
+ *  use one thread per online processor.
+ *
+ *  Return value:
+ *	pointer to the new thread pool
+ */
+{
+   thread_pool_t *pool = fiasco_calloc (1, sizeof (thread_pool_t));
+
+   if (threads == 0)
+   {
+#if defined (_SC_NPROCESSORS_ONLN)
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+
+      threads = cpus > 0 ? cpus : 1;
+#else  /* not _SC_NPROCESSORS_ONLN */
+      threads = 1;
+#endif /* not _SC_NPROCESSORS_ONLN */
+   }
+   pool->threads = min (threads, MAXTHREADS);
+
+#if USE_THREADS
+   pthread_mutex_init (&pool->lock, NULL);
+   pthread_cond_init (&pool->start, NULL);
+   pthread_cond_init (&pool->done, NULL);
+   {
+      unsigned n;
+
+      for (n = 0; n + 1 < pool->threads; n++)
+	 if (pthread_create (&pool->worker [n], NULL, worker_main, pool))
+	 {
+	    warning ("Can't create worker thread, using %d threads.", n + 1);
+	    break;
+	 }
+      pool->threads = n + 1;
+   }
+#else  /* not USE_THREADS */
+   pool->threads = 1;
+#endif /* not USE_THREADS */
+
+   return pool;
+}
+
+void
+free_thread_pool (thread_pool_t *pool)
+/*
+ *  Thread pool destructor.
+ *  Terminate the worker threads and free memory of 'pool'.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	structure 'pool' is discarded.
+ */
+{
+#if USE_THREADS
+   unsigned n;
+
+   pthread_mutex_lock (&pool->lock);
+   pool->quit = YES;
+   pthread_cond_broadcast (&pool->start);
+   pthread_mutex_unlock (&pool->lock);
+
+   for (n = 0; n + 1 < pool->threads; n++)
+      pthread_join (pool->worker [n], NULL);
+
+   pthread_cond_destroy (&pool->done);
+   pthread_cond_destroy (&pool->start);
+   pthread_mutex_destroy (&pool->lock);
+#endif /* USE_THREADS */
+
+   fiasco_free (pool);
+}
+
+unsigned
+thread_pool_size (const thread_pool_t *pool)
+/*
+ *  Return value:
+ *	number of threads of 'pool' (including the calling thread)
+ */
+{
+   return pool ? pool->threads : 1;
+}
+
+void
+run_tasks (thread_pool_t *pool, unsigned tasks, task_func_t func, void *data)
+/*
+ *  Call 'func' ('data', 'task') for 'task' = 0, ... , 'tasks' - 1.
+ *  The tasks are distributed among the threads of 'pool' in no
+ *  particular order, hence they must not depend on each other.
+ *  If 'pool' is NULL then the tasks are executed sequentially.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	if a task fails then the error is raised in the calling thread
+ *	after all remaining tasks have been finished
+ */
+{
+   unsigned task;
+
+#if USE_THREADS
+   if (pool && pool->threads > 1 && tasks > 1 && !in_task)
+   {
+      char *message;
+
+      pthread_mutex_lock (&pool->lock);
+      pool->func          = func;
+      pool->data          = data;
+      pool->tasks         = tasks;
+      pool->next_task     = 0;
+      pool->pending       = tasks;
+      pool->error_message = NULL;
+      pool->generation++;
+      pthread_cond_broadcast (&pool->start);
+
+      in_task = YES;
+      execute_tasks (pool);
+      in_task = NO;
+
+      while (pool->pending)
+	 pthread_cond_wait (&pool->done, &pool->lock);
+      message             = pool->error_message;
+      pool->error_message = NULL;
+      pthread_mutex_unlock (&pool->lock);
+
+      if (message)
+      {
+	 char text [MAXSTRLEN];
+
+	 strncpy (text, message, MAXSTRLEN - 1);
+	 text [MAXSTRLEN - 1] = 0;
+	 fiasco_free (message);
+	 error ("%s", text);
+      }
+      return;
+   }
+#endif /* USE_THREADS */
+
+   for (task = 0; task < tasks; task++)
+      func (data, task);
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+#if USE_THREADS
+
+static void *
+worker_main (void *arg)
+/*
+ *  Main loop of a worker thread: wait for new jobs of the pool 'arg'
+ *  and process their tasks.
+ *
+ *  Return value:
+ *	NULL
+ */
+{
+   thread_pool_t *pool       = (thread_pool_t *) arg;
+   unsigned	  generation = 0;	/* number of the last job */
+
+   in_task = YES;
+
+   pthread_mutex_lock (&pool->lock);
+   for (;;)
+   {
+      while (!pool->quit && pool->generation == generation)
+	 pthread_cond_wait (&pool->start, &pool->lock);
+      if (pool->quit)
+	 break;
+      generation = pool->generation;
+      execute_tasks (pool);
+   }
+   pthread_mutex_unlock (&pool->lock);
+
+   return NULL;
+}
+
+static void
+execute_tasks (thread_pool_t *pool)
+/*
+ *  Process tasks of the current job of 'pool' until no task is left.
+ *  Must be called with 'pool->lock' held, the lock is released
+ *  while a task is running.
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the message of a failing task is stored in 'pool->error_message'
+ */
+{
+   while (pool->next_task < pool->tasks)
+   {
+      task_func_t func   = pool->func;
+      void       *data   = pool->data;
+      unsigned    task   = pool->next_task++;
+      bool_t      failed = NO;
+      jmp_buf	  saved_env;		/* jump buffer of the caller */
+
+      pthread_mutex_unlock (&pool->lock);
+      memcpy (saved_env, env, sizeof (jmp_buf));
+      try
+      {
+	 func (data, task);
+      }
+      catch
+      {
+	 failed = YES;
+      }
+      memcpy (env, saved_env, sizeof (jmp_buf));
+      pthread_mutex_lock (&pool->lock);
+
+      if (failed && !pool->error_message)
+	 pool->error_message = strdup (fiasco_get_error_message ());
+      if (--pool->pending == 0)
+	 pthread_cond_broadcast (&pool->done);
+   }
+}
+
+#endif /* USE_THREADS */
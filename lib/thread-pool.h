@@ -0,0 +1,26 @@
+/*
+ *  thread-pool.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#define MAXTHREADS 64			/* max. number of threads of a pool */
+
+typedef void (*task_func_t) (void *data, unsigned task);
+
+typedef struct thread_pool thread_pool_t;
+
+thread_pool_t *
+alloc_thread_pool (unsigned threads);
+void
+free_thread_pool (thread_pool_t *pool);
+unsigned
+thread_pool_size (const thread_pool_t *pool);
+void
+run_tasks (thread_pool_t *pool, unsigned tasks, task_func_t func, void *data);
+
+#endif /* not _THREAD_POOL_H */
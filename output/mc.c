@@ -17,16 +17,19 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+
 #include "types.h"
 #include "macros.h"
 #include "error.h"
 
 #include "wfa.h"
 #include "bit-io.h"
+#include "wfalib.h"
 
 #include "mc.h"
 
-int mv_code_table [33][2];		/* VLC table for coordinates, mwfa.c */
+extern unsigned mv_code_table [33][2]; /* VLC of coordinates, mwfa.c */
 
 /*****************************************************************************
 
@@ -65,6 +68,8 @@ encode_mc_tree (unsigned max_state, frame_type_e frame_type, const wfa_t *wfa,
 	       bitfile_t *output);
 static void
 encode_mc_coords (unsigned max_state, const wfa_t *wfa, bitfile_t *output);
+static void
+write_mv (int value, unsigned f_code, bitfile_t *output);
 
 /*****************************************************************************
 
@@ -160,7 +165,8 @@ static void
 encode_mc_coords (unsigned max_state, const wfa_t *wfa, bitfile_t *output)
 /*
  *  Write motion vector coordinates to the 'output' stream. They are stored
- *  with the static Huffman code of the MPEG and H.263 standards.
+ *  with the static Huffman code of the MPEG and H.263 standards
+ *  (see write_mv ()).
  *  'max_state' is the last state with motion compensation infos.
  *
  *  No return value.
@@ -174,7 +180,7 @@ encode_mc_coords (unsigned max_state, const wfa_t *wfa, bitfile_t *output)
    unsigned  btotal = 0;		/* #backward decisions */
    unsigned  itotal = 0;		/* #interpolated decisions */
    unsigned  bits   = bits_processed (output); /* number of bits used */
-   unsigned  sr     = wfa->wfainfo->search_range; /* search range */
+   unsigned  f_code = motion_vector_f_code (wfa->wfainfo);
    
    for (level = wfa->wfainfo->p_max_level;
 	level >= wfa->wfainfo->p_min_level; level--)
@@ -191,36 +197,20 @@ encode_mc_coords (unsigned max_state, const wfa_t *wfa, bitfile_t *output)
 	    switch (mv->type)
 	    {
 	       case FORWARD:
-		  put_bits (output,
-			    mv_code_table[(mv->fx + sr)][CODE],
-			    mv_code_table[(mv->fx + sr)][BITS]);
-		  put_bits (output,
-			    mv_code_table[(mv->fy + sr)][CODE],
-			    mv_code_table[(mv->fy + sr)][BITS]);
+		  write_mv (mv->fx, f_code, output);
+		  write_mv (mv->fy, f_code, output);
 		  ftotal++;
 		  break;
 	       case BACKWARD:
-		  put_bits (output,
-			    mv_code_table[(mv->bx + sr)][CODE],
-			    mv_code_table[(mv->bx + sr)][BITS]);
-		  put_bits (output,
-			    mv_code_table[(mv->by + sr)][CODE],
-			    mv_code_table[(mv->by + sr)][BITS]);
+		  write_mv (mv->bx, f_code, output);
+		  write_mv (mv->by, f_code, output);
 		  btotal++;
 		  break;
 	       case INTERPOLATED:
-		  put_bits (output,
-			    mv_code_table[(mv->fx + sr)][CODE],
-			    mv_code_table[(mv->fx + sr)][BITS]);
-		  put_bits (output,
-			    mv_code_table[(mv->fy + sr)][CODE],
-			    mv_code_table[(mv->fy + sr)][BITS]);
-		  put_bits (output,
-			    mv_code_table[(mv->bx + sr)][CODE],
-			    mv_code_table[(mv->bx + sr)][BITS]);
-		  put_bits (output,
-			    mv_code_table[(mv->by + sr)][CODE],
-			    mv_code_table[(mv->by + sr)][BITS]);
+		  write_mv (mv->fx, f_code, output);
+		  write_mv (mv->fy, f_code, output);
+		  write_mv (mv->bx, f_code, output);
+		  write_mv (mv->by, f_code, output);
 		  itotal++;
 		  break;
 	       default:
@@ -249,3 +239,30 @@ encode_mc_coords (unsigned max_state, const wfa_t *wfa, bitfile_t *output)
 
    return;
 }
+
+static void
+write_mv (int value, unsigned f_code, bitfile_t *output)
+/*
+ *  Write the motion vector component 'value' to the 'output' stream.
+ *  If 'f_code' > 1 then the VLC of MPEG codes the magnitude of 'value'
+ *  divided by 2^('f_code' - 1), the remainder is appended with
+ *  'f_code' - 1 bits (see get_mv () in input/mc.c).
+ *
+ *  No return value.
+ */
+{
+   if (f_code == 1 || value == 0)
+      put_bits (output, mv_code_table [value + 16][CODE],
+		mv_code_table [value + 16][BITS]);
+   else
+   {
+      unsigned magnitude = abs (value) - 1;
+      int      vlc	 = (magnitude >> (f_code - 1)) + 1;
+
+      if (value < 0)
+	 vlc = -vlc;
+      put_bits (output, mv_code_table [vlc + 16][CODE],
+		mv_code_table [vlc + 16][BITS]);
+      put_bits (output, magnitude & ((1U << (f_code - 1)) - 1), f_code - 1);
+   }
+}
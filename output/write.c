@@ -31,6 +31,7 @@
 #include "weights.h"
 #include "mc.h"
 #include "nd.h"
+#include "wfalib.h"
 #include "write.h"
  
 /*****************************************************************************
@@ -69,6 +70,9 @@ write_next_wfa (const wfa_t *wfa, const coding_t *c, bitfile_t *output)
       write_header (wfa->wfainfo, output);
   
    bits = bits_processed (output);
+
+   if (c->index)			/* remember position of frame */
+      append_frame_index (c->index, bits, c->mt->frame_type, c->mt->number);
    
    /*
     *  Frame header information
@@ -141,7 +145,7 @@ write_header (const wfa_info_t *wi, bitfile_t *output)
       put_bits (output, *text, 8);
    put_bits (output, *text, 8);
    
-   write_rice_code (FIASCO_BINFILE_RELEASE, rice_k, output);
+   write_rice_code (wi->release, rice_k, output);
 
    write_rice_code (HEADER_TITLE, rice_k, output);
    for (text = wi->title;
@@ -167,7 +171,7 @@ write_header (const wfa_info_t *wi, bitfile_t *output)
       write_rice_code (wi->chroma_max_states, rice_k, output); 
    write_rice_code (wi->p_min_level, rice_k, output); 
    write_rice_code (wi->p_max_level, rice_k, output); 
-   write_rice_code (wi->frames, rice_k, output);
+   write_rice_code (wi->open_ended ? 0 : wi->frames, rice_k, output);
    write_rice_code (wi->smoothing, rice_k, output);
 
    put_bits (output, wi->rpf->mantissa_bits - 2, 3);
@@ -200,7 +204,7 @@ write_header (const wfa_info_t *wi, bitfile_t *output)
    else
       put_bit (output, NO);
 
-   if (wi->frames > 1)			/* motion compensation stuff */
+   if (wi->frames > 1 || wi->open_ended) /* motion compensation stuff */
    {
       write_rice_code (wi->fps, rice_k, output); 
       write_rice_code (wi->search_range, rice_k, output); 
@@ -209,9 +213,92 @@ write_header (const wfa_info_t *wi, bitfile_t *output)
    }
 
    OUTPUT_BYTE_ALIGN (output);
+   /*
+    *  If the number of frames is not known yet then the frame counter is
+    *  zero and the stream is terminated by write_end_marker ().
+    *  The number of frames follows with 32 bits, a coder writing to a
+    *  seekable file replaces the zero by the final number of frames.
+    */
+   if (wi->open_ended)
+      put_bits (output, wi->frames, 32);
    debug_message ("header:         %d bits.", bits_processed (output) - bits);
 }
 
+void
+write_end_marker (frame_index_t *index, bitfile_t *output)
+/*
+ *  Terminate the stream 'output' whose number of frames was not known
+ *  when the header has been written: the end marker is a frame header
+ *  without states. If 'index' is not NULL then the end of the last
+ *  frame is stored in 'index'.
+ *
+ *  No return value.
+ */
+{
+   const unsigned rice_k = 8;		/* parameter of Rice Code */
+
+   if (index)
+      index->offset [index->frames] = bits_processed (output);
+   
+   write_rice_code (0, rice_k, output);	/* number of states */
+   write_rice_code (0, rice_k, output);	/* frame type */
+   write_rice_code (0, rice_k, output);	/* frame number */
+   OUTPUT_BYTE_ALIGN (output);
+}
+
+void
+write_frame_index (frame_index_t *index, bitfile_t *output)
+/*
+ *  Append the frame 'index' to the stream 'output', the index has to
+ *  follow the last frame (or the end marker) of the stream. The index
+ *  is located by the byte offset and the magic number stored in the
+ *  last eight bytes of the file, decoders without index support skip
+ *  these trailing bytes.
+ *  The offsets are stored with 32 bits, hence no index is appended if
+ *  the stream would exceed FIASCO_INDEX_MAX_BITS bits (512 MB).
+ *
+ *  No return value.
+ *
+ *  Side effects:
+ *	the end of the last frame is stored in 'index' unless it
+ *	has been already stored by write_end_marker ()
+ */
+{
+   unsigned    start;			/* byte offset of index */
+   unsigned    n;			/* counter */
+   const char *text;			/* next character to write */
+
+   if (!index->offset [index->frames])
+      index->offset [index->frames] = bits_processed (output);
+   
+   OUTPUT_BYTE_ALIGN (output);
+   if (output->bits_processed + (20 + 9 * index->frames) * 8
+       > FIASCO_INDEX_MAX_BITS)
+   {
+      warning ("Stream is too long for a frame index, index not written.");
+      return;
+   }
+   start = bits_processed (output) / 8;
+
+   for (text = FIASCO_INDEX_MAGIC; *text; text++)
+      put_bits (output, *text, 8);
+   put_bits (output, index->frames, 32);
+   for (n = 0; n < index->frames; n++)
+   {
+      put_bits (output, index->offset [n], 32);
+      put_bits (output, index->type [n], 8);
+      put_bits (output, index->number [n], 32);
+   }
+   put_bits (output, index->offset [index->frames], 32);
+   
+   put_bits (output, start, 32);
+   for (text = FIASCO_INDEX_MAGIC; *text; text++)
+      put_bits (output, *text, 8);
+
+   debug_message ("frame index:    %d bits.",
+		  bits_processed (output) - start * 8);
+}
+
 /*****************************************************************************
 
 				private code
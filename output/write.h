@@ -24,5 +24,9 @@ void
 write_next_wfa (const wfa_t *wfa, const coding_t *c, bitfile_t *output);
 void
 write_header (const wfa_info_t *wi, bitfile_t *output);
+void
+write_end_marker (frame_index_t *index, bitfile_t *output);
+void
+write_frame_index (frame_index_t *index, bitfile_t *output);
 
 #endif /* not _WRITE_H */
@@ -0,0 +1,193 @@
+/*
+ *  bench-kernels.c:	Benchmark of the inner product and accumulation
+ *			kernels of the coder
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  Usage: bench-kernels [images-level]
+ *
+ *  For every level up to 'images-level' (default: 5, see option
+ *  --images-level of cfiasco) the vectors of size_of_level (level)
+ *  elements are processed by dot_product () and add_scaled_vector ()
+ *  with the kernels of each instruction set. The time per call and
+ *  the speedup compared with the plain C kernels are printed. The
+ *  results of the SIMD kernels have to be identical to the C results.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "misc.h"
+#include "vector.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define ELEMENTS (1 << 24)		/* vector elements per measurement */
+
+static const char *isa_names [] = {"C", "SSE2", "AVX2", "AVX-512", NULL};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static double
+time_dot_product (const real_t *a, const real_t *b, unsigned n,
+		  real_t *result);
+static double
+time_add_scaled (real_t *dst, const real_t *src, unsigned n,
+		 real_t *result);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (int argc, char **argv)
+{
+   unsigned images_level = argc > 1 ? atoi (argv [1]) : 5;
+   unsigned size	 = size_of_level (images_level);
+   real_t  *a		 = fiasco_aligned_calloc (size, sizeof (real_t));
+   real_t  *b		 = fiasco_aligned_calloc (size, sizeof (real_t));
+   unsigned level, i;
+   int	    failed	 = 0;
+
+   for (i = 0; i < size; i++)
+   {
+      a [i] = (real_t) ((i * 7919) % 255) / 16;
+      b [i] = (real_t) ((i * 104729) % 251) / 32 - 4;
+   }
+
+   printf ("%-18s %5s %8s", "kernel", "level", "elements");
+   for (i = 0; isa_names [i]; i++)
+      printf (" %16s", isa_names [i]);
+   printf ("\n");
+
+   for (level = 0; level <= images_level; level++)
+   {
+      unsigned n      = size_of_level (level);
+      unsigned kernel;
+
+      for (kernel = 0; kernel < 2; kernel++)
+      {
+	 double c_time = 0;
+	 real_t c_result = 0;
+
+	 printf ("%-18s %5u %8u", kernel ? "add_scaled_vector" : "dot_product",
+		 level, n);
+	 for (i = 0; isa_names [i]; i++)
+	 {
+	    double seconds;
+	    real_t result;
+
+	    if (!force_vector_kernels (isa_names [i]))
+	    {
+	       printf (" %16s", "-");
+	       continue;
+	    }
+	    seconds = kernel ? time_add_scaled (a, b, n, &result)
+		      : time_dot_product (a, b, n, &result);
+	    if (i == 0)
+	    {
+	       c_time   = seconds;
+	       c_result = result;
+	       printf (" %13.2f ns", seconds);
+	    }
+	    else if (result != c_result)
+	    {
+	       printf (" %16s", "MISMATCH");
+	       failed = 1;
+	    }
+	    else
+	       printf (" %8.2f ns %4.1fx", seconds,
+		       seconds > 0 ? c_time / seconds : 0.0);
+	 }
+	 printf ("\n");
+      }
+   }
+
+   fiasco_aligned_free (a);
+   fiasco_aligned_free (b);
+
+   return failed;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static double
+time_dot_product (const real_t *a, const real_t *b, unsigned n,
+		  real_t *result)
+/*
+ *  Compute the inner product of the first 'n' elements of 'a' and 'b'
+ *  repeatedly.
+ *
+ *  Return value:
+ *	time per call in nanoseconds
+ *
+ *  Side effects:
+ *	'result' is set to the inner product
+ */
+{
+   unsigned	     calls = max (1, ELEMENTS / n);
+   volatile real_t   sum   = 0;
+   clock_t	     start = clock ();
+   unsigned	     k;
+
+   for (k = 0; k < calls; k++)
+      sum += dot_product (a, b, n);
+   *result = dot_product (a, b, n);
+
+   return (double) (clock () - start) / CLOCKS_PER_SEC * 1e9 / calls;
+}
+
+static double
+time_add_scaled (real_t *dst, const real_t *src, unsigned n, real_t *result)
+/*
+ *  Add the first 'n' elements of 'src', scaled alternately by +0.5 and
+ *  -0.5, to a copy of 'dst' repeatedly.
+ *
+ *  Return value:
+ *	time per call in nanoseconds
+ *
+ *  Side effects:
+ *	'result' is set to the sum of the elements of the final vector
+ */
+{
+   unsigned calls = max (1, ELEMENTS / n);
+   real_t  *copy  = fiasco_aligned_calloc (n, sizeof (real_t));
+   clock_t  start;
+   unsigned k;
+
+   memcpy (copy, dst, n * sizeof (real_t));
+   start = clock ();
+   for (k = 0; k < calls; k++)
+      add_scaled_vector (copy, src, k & 1 ? -0.5 : 0.5, n);
+   start = clock () - start;
+
+   for (*result = 0, k = 0; k < n; k++)
+      *result += copy [k] * (k + 1);
+   fiasco_aligned_free (copy);
+
+   return (double) start / CLOCKS_PER_SEC * 1e9 / calls;
+}
@@ -0,0 +1,232 @@
+/*
+ *  bench-motion.c:	Benchmark of the motion vector search strategies
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  Usage: bench-motion [size [frames]]
+ *
+ *  A video of 'frames' frames (default: 7) of 'size' x 'size' pixels
+ *  (default: 256) is cut from the synthetic test sequence with a window
+ *  that pans by (6, 4) pixels per frame, i.e., the P-frames of an IBBP
+ *  video move by 18 pixels. The video is encoded with the exhaustive,
+ *  the pyramid and the diamond search using the search ranges 8, 16
+ *  and 32. The encoding time, the stream size and the PSNR of the
+ *  decoded video are printed, speed and size are compared with the
+ *  exhaustive search of the same range.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define PAN_X	6			/* horizontal panning per frame */
+#define PAN_Y	4			/* vertical panning per frame */
+
+static const char *search_names [] = {"exhaustive", "pyramid", "diamond"};
+static const unsigned ranges [] = {8, 16, 32, 0};
+static const char *patterns [] = {"ippp", "ibbp", NULL};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static char **
+write_panning_frames (const char *dir, unsigned frames, unsigned size,
+		      unsigned char **pixels);
+static double
+psnr (const void *stream, size_t bytes, unsigned frames, unsigned size,
+      unsigned char **pixels);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (int argc, char **argv)
+{
+   unsigned	   size	  = argc > 1 ? atoi (argv [1]) : 256;
+   unsigned	   frames = argc > 2 ? atoi (argv [2]) : 7;
+   char		  *dir	  = make_test_dir ("bench-motion");
+   unsigned char **pixels = calloc (frames, sizeof (unsigned char *));
+   char		 **names  = write_panning_frames (dir, frames, size, pixels);
+   const char	 **pattern;
+   unsigned	   n;
+
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   printf ("%-7s %-10s %5s %9s %7s %9s %7s %9s\n", "pattern", "search",
+	   "range", "seconds", "speed", "bytes", "size", "PSNR");
+   for (pattern = patterns; *pattern; pattern++)
+   {
+      const unsigned *range;
+
+      for (range = ranges; *range; range++)
+      {
+	 fiasco_mv_search_e search;
+	 double		    exhaustive_time = 0;
+	 size_t		    exhaustive_size = 0;
+
+	 for (search = FIASCO_MV_SEARCH_EXHAUSTIVE;
+	      search <= FIASCO_MV_SEARCH_DIAMOND; search++)
+	 {
+	    fiasco_c_options_t *options = fiasco_c_options_new ();
+	    void	       *stream;
+	    size_t		bytes;
+	    clock_t		start;
+	    double		seconds;
+
+	    fiasco_c_options_set_frame_pattern (options, *pattern);
+	    fiasco_c_options_set_motion_search (options, search);
+	    fiasco_c_options_set_search_range (options, *range);
+
+	    start = clock ();
+	    if (!fiasco_coder_to_memory ((char const * const *) names,
+					 &stream, &bytes, 20, options))
+	    {
+	       fprintf (stderr, "%s\n", fiasco_get_error_message ());
+	       return 1;
+	    }
+	    seconds = (double) (clock () - start) / CLOCKS_PER_SEC;
+	    fiasco_c_options_delete (options);
+
+	    if (search == FIASCO_MV_SEARCH_EXHAUSTIVE)
+	    {
+	       exhaustive_time = seconds;
+	       exhaustive_size = bytes;
+	    }
+	    printf ("%-7s %-10s %5u %9.2f %6.1fx %9lu %6.1f%% %6.2f dB\n",
+		    *pattern, search_names [search], *range, seconds,
+		    seconds > 0 ? exhaustive_time / seconds : 0.0,
+		    (unsigned long) bytes, 100.0 * bytes / exhaustive_size,
+		    psnr (stream, bytes, frames, size, pixels));
+	    free (stream);
+	 }
+      }
+   }
+
+   for (n = 0; n < frames; n++)
+      free (pixels [n]);
+   free (pixels);
+   remove_test_frames (names);
+   remove_test_dir (dir);
+
+   return 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static char **
+write_panning_frames (const char *dir, unsigned frames, unsigned size,
+		      unsigned char **pixels)
+/*
+ *  Write 'frames' frames of 'size' x 'size' pixels as PGM files to the
+ *  directory 'dir'. Frame n is the window at (PAN_X * n, PAN_Y * n) of
+ *  frame n of the synthetic test sequence.
+ *
+ *  Return value:
+ *	NULL terminated list of filenames (must be freed by
+ *	remove_test_frames ())
+ *
+ *  Side effects:
+ *	'pixels'[n] is set to the pixels of frame n
+ */
+{
+   unsigned width  = size + PAN_X * frames;
+   unsigned height = size + PAN_Y * frames;
+   char   **names  = calloc (frames + 1, sizeof (char *));
+   unsigned n;
+
+   for (n = 0; n < frames; n++)
+   {
+      unsigned char *frame = test_frame_pixels (n, width, height, NO);
+      FILE	    *file;
+      unsigned	     y;
+
+      pixels [n] = malloc (size * size);
+      for (y = 0; y < size; y++)
+	 memcpy (pixels [n] + y * size,
+		 frame + (y + PAN_Y * n) * width + PAN_X * n, size);
+      free (frame);
+
+      names [n] = malloc (strlen (dir) + 16);
+      sprintf (names [n], "%s/frame-%03u.pgm", dir, n);
+      if (!(file = fopen (names [n], "wb")))
+      {
+	 perror (names [n]);
+	 exit (1);
+      }
+      fprintf (file, "P5\n%u %u\n255\n", size, size);
+      fwrite (pixels [n], 1, size * size, file);
+      fclose (file);
+   }
+
+   return names;
+}
+
+static double
+psnr (const void *stream, size_t bytes, unsigned frames, unsigned size,
+      unsigned char **pixels)
+/*
+ *  Decode the FIASCO video 'stream' of 'bytes' bytes and compare the
+ *  frames with the original frames 'pixels'.
+ *
+ *  Return value:
+ *	PSNR of the decoded video in dB
+ */
+{
+   fiasco_decoder_t *decoder = fiasco_decoder_new_from_memory (stream, bytes,
+							       NULL);
+   unsigned char    *buffer  = malloc (size * size);
+   double	     error   = 0;
+   unsigned	     n, i;
+
+   if (!decoder)
+   {
+      fprintf (stderr, "%s\n", fiasco_get_error_message ());
+      exit (1);
+   }
+   for (n = 0; n < frames; n++)
+   {
+      if (!fiasco_decoder_get_frame_into (decoder, buffer, size,
+					  FIASCO_GRAY_8))
+      {
+	 fprintf (stderr, "%s\n", fiasco_get_error_message ());
+	 exit (1);
+      }
+      for (i = 0; i < size * size; i++)
+	 error += square ((int) buffer [i] - (int) pixels [n][i]);
+   }
+   fiasco_decoder_delete (decoder);
+   free (buffer);
+
+   error /= (double) frames * size * size;
+
+   return error > 0 ? 10 * log10 (255.0 * 255.0 / error) : 99.99;
+}
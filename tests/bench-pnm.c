@@ -0,0 +1,234 @@
+/*
+ *  bench-pnm.c:	Benchmark of the PNM reader and writer
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  Usage: bench-pnm [width height]
+ *
+ *  A frame of the synthetic test sequence of 'width' x 'height' pixels
+ *  (default: 3840 x 2160) is written as raw PGM and PPM image with 8
+ *  and 16 bit samples and as plain (ASCII) PGM and PPM image. Every
+ *  file is loaded with read_image () repeatedly, the images with 8 bit
+ *  raw samples are stored with write_image () as well (the writer
+ *  supports no other format). The throughput of both functions is
+ *  printed in megapixels per second.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "fiasco.h"
+#include "image.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define MIN_SECONDS 0.5			/* min. time of a measurement */
+
+typedef struct bench
+{
+   const char *name;			/* description of the format */
+   bool_t      color;			/* PPM image */
+   bool_t      ascii;			/* plain PNM format */
+   unsigned    maxval;			/* maximum sample value */
+} bench_t;
+
+static const bench_t benches [] =
+{
+   {"PGM (P5)",		 NO,  NO,  255},
+   {"PPM (P6)",		 YES, NO,  255},
+   {"PGM (P5, 16 bit)", NO,  NO,  65535},
+   {"PPM (P6, 16 bit)", YES, NO,  65535},
+   {"PGM (P2)",		 NO,  YES, 255},
+   {"PPM (P3)",		 YES, YES, 255},
+   {NULL,		 NO,  NO,  0}
+};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static void
+write_pnm (const char *filename, const bench_t *bench, unsigned width,
+	   unsigned height);
+static double
+load_throughput (const char *filename, unsigned pixels);
+static double
+store_throughput (const char *filename, const char *pnm_filename,
+		  unsigned pixels);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (int argc, char **argv)
+{
+   unsigned	  width	       = argc > 2 ? atoi (argv [1]) : 3840;
+   unsigned	  height       = argc > 2 ? atoi (argv [2]) : 2160;
+   char		 *dir	       = make_test_dir ("bench-pnm");
+   char		 *filename     = malloc (strlen (dir) + 16);
+   char		 *out_filename = malloc (strlen (dir) + 16);
+   const bench_t *bench;
+
+   sprintf (filename, "%s/image.pnm", dir);
+   sprintf (out_filename, "%s/output.pnm", dir);
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   printf ("%-18s %10s %10s %12s\n", "format", "pixels", "load MP/s",
+	   "store MP/s");
+   for (bench = benches; bench->name; bench++)
+   {
+      write_pnm (filename, bench, width, height);
+      printf ("%-18s %4ux%-5u %10.2f", bench->name, width, height,
+	      load_throughput (filename, width * height));
+      if (!bench->ascii && bench->maxval == 255)
+	 printf (" %12.2f",
+		 store_throughput (out_filename, filename, width * height));
+      printf ("\n");
+      remove (filename);
+   }
+
+   free (filename);
+   free (out_filename);
+   remove_test_dir (dir);
+
+   return 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static void
+write_pnm (const char *filename, const bench_t *bench, unsigned width,
+	   unsigned height)
+/*
+ *  Write frame 0 of the synthetic test sequence of 'width' x 'height'
+ *  pixels to the file 'filename' using the PNM format of 'bench'.
+ *  16 bit samples are scaled from the 8 bit samples.
+ *
+ *  No return value.
+ */
+{
+   unsigned	  samples = width * height * (bench->color ? 3 : 1);
+   unsigned char *pixels  = test_frame_pixels (0, width, height,
+					       bench->color);
+   FILE		 *file	  = fopen (filename, "wb");
+   unsigned	  i;
+
+   if (!file)
+   {
+      perror (filename);
+      exit (1);
+   }
+   fprintf (file, "P%c\n%u %u\n%u\n",
+	    '2' + (bench->color ? 1 : 0) + (bench->ascii ? 0 : 3),
+	    width, height, bench->maxval);
+   if (bench->ascii)
+      for (i = 0; i < samples; i++)
+	 fprintf (file, "%u%c", pixels [i], (i + 1) % 16 ? ' ' : '\n');
+   else if (bench->maxval > 255)
+      for (i = 0; i < samples; i++)
+      {
+	 unsigned value = pixels [i] * 257;
+
+	 putc (value >> 8, file);
+	 putc (value & 0xff, file);
+      }
+   else
+      fwrite (pixels, 1, samples, file);
+   fclose (file);
+   free (pixels);
+}
+
+static double
+load_throughput (const char *filename, unsigned pixels)
+/*
+ *  Read the image 'filename' of 'pixels' pixels repeatedly for at least
+ *  MIN_SECONDS seconds.
+ *
+ *  Return value:
+ *	load throughput in megapixels per second
+ */
+{
+   unsigned runs  = 0;
+   clock_t  start = clock ();
+   double   seconds;
+
+   try
+   {
+      do
+      {
+	 free_image (read_image (filename));
+	 runs++;
+	 seconds = (double) (clock () - start) / CLOCKS_PER_SEC;
+      } while (seconds < MIN_SECONDS);
+   }
+   catch
+   {
+      fprintf (stderr, "%s\n", fiasco_get_error_message ());
+      exit (1);
+   }
+
+   return seconds > 0 ? (double) pixels * runs / seconds / 1e6 : 0.0;
+}
+
+static double
+store_throughput (const char *filename, const char *pnm_filename,
+		  unsigned pixels)
+/*
+ *  Read the image 'pnm_filename' of 'pixels' pixels and write it to the
+ *  file 'filename' repeatedly for at least MIN_SECONDS seconds.
+ *
+ *  Return value:
+ *	store throughput in megapixels per second
+ */
+{
+   image_t *image = NULL;
+   unsigned runs  = 0;
+   double   seconds;
+   clock_t  start;
+
+   try
+   {
+      image = read_image (pnm_filename);
+      start = clock ();
+      do
+      {
+	 write_image (filename, image);
+	 runs++;
+	 seconds = (double) (clock () - start) / CLOCKS_PER_SEC;
+      } while (seconds < MIN_SECONDS);
+   }
+   catch
+   {
+      fprintf (stderr, "%s\n", fiasco_get_error_message ());
+      exit (1);
+   }
+   free_image (image);
+   remove (filename);
+
+   return seconds > 0 ? (double) pixels * runs / seconds / 1e6 : 0.0;
+}
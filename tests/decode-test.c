@@ -0,0 +1,185 @@
+/*
+ *  decode-test.c:	Compare decoded images of every instruction set
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The decoder computes the state images with the integer kernels of
+ *  the best instruction set of the host processor. Every kernel has to
+ *  produce exactly the pixels of the plain C decoder: the test streams
+ *  are decoded with the kernels of each supported instruction set and
+ *  the checksums of the decoded frames are compared with the checksums
+ *  recorded with the decoder of FIASCO 1.3 (before the SIMD kernels
+ *  have been added).
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "vector.h"
+#include "testutil.h"
+#include "streams.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+typedef struct variant
+/*
+ *  Decoder options
+ */
+{
+   int magnification;			/* magnification of frames */
+   int smoothing;			/* smoothing (-1: value of stream) */
+   int format_4_2_0;			/* 4:2:0 chroma format */
+} variant_t;
+
+#define VARIANTS 6
+
+static const variant_t variants [VARIANTS] =
+{
+   {0, -1, NO}, {0, -1, YES}, {1, -1, NO}, {-1, -1, NO}, {0, 0, NO},
+   {0, 30, NO}
+};
+
+static const char *isa_names [] = {"C", "SSE2", "AVX2", "AVX-512", NULL};
+
+/*
+ *  Checksums of the decoded frames of 'test_streams'[], a zero entry is
+ *  not checked: FIASCO 1.3 can't magnify the predicted frames of color
+ *  videos.
+ */
+static const unsigned long checksums [][VARIANTS] =
+{
+   {0xa78e46dc, 0xa78e46dc, 0x48aebdf6, 0xe5ac09fa, 0x37e7d228, 0x1d27e956},
+   {0x9828893e, 0x9828893e, 0x9937d5d6, 0x7bac002b, 0x1e17f552, 0x59a35f0f},
+   {0x31dd8630, 0x31dd8630, 0xdc5d8c54, 0xb4130f7d, 0x28f9a0a9, 0x37cc1489},
+   {0x3c0a3268, 0x3c0a3268, 0x6c3bc2ae, 0x1ee15abe, 0xc0dfd741, 0x9949f790},
+   {0x00093587, 0x00093587, 0x07ae88c6, 0xae120a6c, 0x11352af0, 0x0c733df0},
+   {0x97190875, 0x97190875, 0x0865c472, 0xf93808d5, 0xc0c46110, 0x17e8822a},
+   {0xe3044e5c, 0xe3044e5c, 0x00000000, 0x6c085420, 0xce1bda1d, 0x71d7d01f}
+};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static unsigned long
+decode (const test_stream_t *stream, const variant_t *variant,
+	const char *filename);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   char	       *dir	 = make_test_dir ("decode-test");
+   char	       *filename = malloc (strlen (dir) + 16);
+   const char **isa;
+   unsigned	failed	 = 0;
+
+   sprintf (filename, "%s/frame.pnm", dir);
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   for (isa = isa_names; *isa; isa++)
+   {
+      const test_stream_t *stream;
+      unsigned		   n;
+
+      if (!force_vector_kernels (*isa))
+      {
+	 printf ("%s: not supported by this processor\n", *isa);
+	 continue;
+      }
+      for (stream = test_streams, n = 0; stream->name; stream++, n++)
+      {
+	 unsigned v;
+
+	 printf ("%s: %s:", *isa, stream->name);
+	 for (v = 0; v < VARIANTS; v++)
+	    if (checksums [n][v])
+	    {
+	       unsigned long sum = decode (stream, variants + v, filename);
+
+	       if (sum == checksums [n][v])
+		  printf (" ok");
+	       else
+	       {
+		  printf (" FAILED (0x%08lx)", sum);
+		  failed++;
+	       }
+	    }
+	 printf ("\n");
+      }
+   }
+
+   free (filename);
+   remove_test_dir (dir);
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static unsigned long
+decode (const test_stream_t *stream, const variant_t *variant,
+	const char *filename)
+/*
+ *  Decode all frames of 'stream' with the options 'variant'. Every
+ *  frame is written to the temporary file 'filename'.
+ *
+ *  Return value:
+ *	checksum of the decoded frames (0 on error)
+ */
+{
+   fiasco_d_options_t *options = fiasco_d_options_new ();
+   fiasco_decoder_t   *decoder;
+   unsigned long       sum = 0;
+   unsigned	       n;
+
+   fiasco_d_options_set_magnification (options, variant->magnification);
+   if (variant->smoothing >= 0)
+      fiasco_d_options_set_smoothing (options, variant->smoothing);
+   fiasco_d_options_set_4_2_0_format (options, variant->format_4_2_0);
+
+   decoder = fiasco_decoder_new_from_memory (stream->data, stream->size,
+					     options);
+   fiasco_d_options_delete (options);
+   if (!decoder)
+      return 0;
+
+   for (n = 0; n < stream->frames; n++)
+   {
+      if (!fiasco_decoder_write_frame (decoder, filename))
+      {
+	 sum = 0;
+	 break;
+      }
+      sum = (sum * 31 + file_checksum (filename)) & 0xffffffffUL;
+   }
+   remove (filename);
+   fiasco_decoder_delete (decoder);
+
+   return sum;
+}
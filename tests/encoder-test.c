@@ -0,0 +1,361 @@
+/*
+ *  encoder-test.c:	Test the incremental coder with an unknown number
+ *			of frames
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The synthetic test sequence is passed frame by frame to the
+ *  incremental coder. The reference stream is encoded with the number
+ *  of frames given in advance, the other streams are encoded with an
+ *  unknown number of frames and written to a sink which can or can't
+ *  be repositioned. The last frame of the sequence would be a B-frame,
+ *  hence it has to be encoded as P-frame when the coder is finished.
+ *  Every stream has to report the number of frames and decode to the
+ *  frames of the reference stream, a stream read from a callback
+ *  reports the number of frames when its end marker has been reached.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define FRAMES	11			/* number of frames of test video */
+#define SIZE	64			/* width and height of frames */
+
+typedef struct stream_test
+{
+   const char *name;			/* description of the test */
+   unsigned    frames;			/* frames given in advance (or 0) */
+   bool_t      seekable;		/* sink can be repositioned */
+   int	       index;			/* append frame index */
+} stream_test_t;
+
+static const stream_test_t tests [] =
+{
+   {"known length",	      FRAMES, NO,  0}, /* reference stream */
+   {"seekable",		      0,      YES, 0},
+   {"not seekable",	      0,      NO,  0},
+   {"seekable, index",	      0,      YES, 1},
+   {"not seekable, index",    0,      NO,  1},
+   {NULL,		      0,      NO,  0}
+};
+
+typedef struct sink
+/*
+ *  Growable memory block which is written by the coder
+ */
+{
+   unsigned char *data;			/* bytes of the stream */
+   size_t	  size;			/* length of the stream */
+   size_t	  position;		/* current write position */
+   bool_t	  seekable;		/* seek callback succeeds */
+} sink_t;
+
+typedef struct source
+/*
+ *  Stream of read_memory ()
+ */
+{
+   const unsigned char *data;		/* bytes of the stream */
+   size_t		size;		/* bytes left */
+} source_t;
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static bool_t
+encode (const stream_test_t *test, sink_t *sink);
+static bool_t
+decode (const sink_t *sink, const unsigned long *sums, bool_t callback);
+static bool_t
+empty_sequence (void);
+static size_t
+write_memory (void *data, const void *buffer, size_t size);
+static int
+seek_memory (void *data, unsigned long offset);
+static size_t
+read_memory (void *data, void *buffer, size_t size);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   unsigned long       sums [FRAMES];	/* checksums of reference frames */
+   const stream_test_t *test;
+   int		       failed = 0;
+
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   memset (sums, 0, sizeof (sums));
+   for (test = tests; test->name; test++)
+   {
+      sink_t sink;
+
+      printf ("%-20s: ", test->name);
+      if (!encode (test, &sink))
+      {
+	 printf ("FAILED (coder: %s)\n", fiasco_get_error_message ());
+	 failed++;
+	 continue;
+      }
+      if (test == tests)		/* reference stream */
+      {
+	 fiasco_decoder_t *decoder
+	    = fiasco_decoder_new_from_memory (sink.data, sink.size, NULL);
+	 unsigned	   n;
+
+	 for (n = 0; decoder && n < FRAMES; n++)
+	 {
+	    unsigned char buffer [SIZE * SIZE];
+
+	    if (fiasco_decoder_get_frame_into (decoder, buffer, SIZE,
+					       FIASCO_GRAY_8))
+	       sums [n] = checksum (buffer, sizeof (buffer));
+	 }
+	 if (decoder)
+	    fiasco_decoder_delete (decoder);
+      }
+      if (!decode (&sink, sums, NO))
+      {
+	 printf ("FAILED (memory decoder)\n");
+	 failed++;
+      }
+      else if (!decode (&sink, sums, YES))
+      {
+	 printf ("FAILED (callback decoder)\n");
+	 failed++;
+      }
+      else
+	 printf ("ok\n");
+      free (sink.data);
+   }
+
+   printf ("%-20s: ", "empty sequence");
+   if (empty_sequence ())
+      printf ("ok\n");
+   else
+   {
+      printf ("FAILED\n");
+      failed++;
+   }
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static bool_t
+encode (const stream_test_t *test, sink_t *sink)
+/*
+ *  Encode the test sequence with the options of 'test'.
+ *
+ *  Return value:
+ *	YES on success, NO otherwise
+ *
+ *  Side effects:
+ *	'sink' is filled with the new FIASCO stream
+ *	('sink->data' has to be freed by the caller)
+ */
+{
+   fiasco_c_options_t *options = fiasco_c_options_new ();
+   fiasco_encoder_t   *encoder;
+   bool_t		success = YES;
+   unsigned		n;
+
+   memset (sink, 0, sizeof (sink_t));
+   sink->seekable = test->seekable;
+   fiasco_c_options_set_frame_pattern (options, "ibbp");
+   fiasco_c_options_set_frame_index (options, test->index);
+   fiasco_c_options_set_basisfile (options, "small.fco");
+
+   encoder = fiasco_encoder_new (SIZE, SIZE, NO, test->frames, 20, options,
+				 write_memory, seek_memory, sink);
+   if (!encoder)
+      success = NO;
+   for (n = 0; success && n < FRAMES; n++)
+   {
+      unsigned char  *pixels = test_frame_pixels (n, SIZE, SIZE, NO);
+      fiasco_image_t *image
+	 = fiasco_image_new_from_buffer (pixels, SIZE, SIZE, 0,
+					 FIASCO_GRAY_8);
+
+      if (!image || !fiasco_encoder_push_frame (encoder, image))
+	 success = NO;
+      if (image)
+	 fiasco_image_delete (image);
+      free (pixels);
+   }
+   if (encoder && !fiasco_encoder_finish (encoder))
+      success = NO;
+   fiasco_c_options_delete (options);
+
+   return success;
+}
+
+static bool_t
+decode (const sink_t *sink, const unsigned long *sums, bool_t callback)
+/*
+ *  Decode the FIASCO stream of 'sink' from memory or from a 'callback'
+ *  and compare the frames with the checksums 'sums'.
+ *
+ *  Return value:
+ *	YES if the frames and the number of frames are correct
+ *	NO  otherwise
+ */
+{
+   fiasco_decoder_t *decoder;
+   source_t	     source;
+   unsigned	     length;
+   bool_t	     success;
+   unsigned	     n;
+
+   source.data = sink->data;
+   source.size = sink->size;
+   decoder	= callback
+		  ? fiasco_decoder_new_from_callback (read_memory, &source, NULL)
+		  : fiasco_decoder_new_from_memory (sink->data, sink->size,
+						    NULL);
+   if (!decoder)
+      return NO;
+
+   /*
+    *  The number of frames of a stream written to a sink which can't be
+    *  repositioned is unknown until its end marker has been reached.
+    */
+   length  = fiasco_decoder_get_length (decoder);
+   success = length == FRAMES || (!length && callback && !sink->seekable);
+   for (n = 0; success && n < FRAMES; n++)
+   {
+      unsigned char buffer [SIZE * SIZE];
+
+      if (!fiasco_decoder_get_frame_into (decoder, buffer, SIZE,
+					  FIASCO_GRAY_8)
+	  || checksum (buffer, sizeof (buffer)) != sums [n])
+	 success = NO;
+   }
+   if (success && !length)
+   {
+      unsigned char buffer [SIZE * SIZE];
+
+      success = !fiasco_decoder_get_frame_into (decoder, buffer, SIZE,
+						FIASCO_GRAY_8)
+		&& fiasco_decoder_get_length (decoder) == FRAMES;
+   }
+   fiasco_decoder_delete (decoder);
+
+   return success;
+}
+
+static bool_t
+empty_sequence (void)
+/*
+ *  Finish a coder of an unknown number of frames without passing a frame.
+ *
+ *  Return value:
+ *	YES if the coder reports an error and writes no stream
+ *	NO  otherwise
+ */
+{
+   sink_t	     sink;
+   fiasco_encoder_t *encoder;
+   bool_t	     success;
+
+   memset (&sink, 0, sizeof (sink_t));
+   encoder = fiasco_encoder_new (SIZE, SIZE, NO, 0, 20, NULL, write_memory,
+				 NULL, &sink);
+   success = encoder && !fiasco_encoder_finish (encoder) && !sink.size
+	     && *fiasco_get_error_message ();
+   free (sink.data);
+
+   return success;
+}
+
+static size_t
+write_memory (void *data, const void *buffer, size_t size)
+/*
+ *  Write callback: copy 'size' bytes of 'buffer' to the current position
+ *  of the sink 'data'.
+ *
+ *  Return value:
+ *	number of bytes copied
+ */
+{
+   sink_t *sink = data;
+
+   if (sink->position + size > sink->size)
+   {
+      sink->data = realloc (sink->data, sink->position + size);
+      sink->size = sink->position + size;
+   }
+   memcpy (sink->data + sink->position, buffer, size);
+   sink->position += size;
+
+   return size;
+}
+
+static int
+seek_memory (void *data, unsigned long offset)
+/*
+ *  Seek callback: continue writing at byte 'offset' of the sink 'data'.
+ *
+ *  Return value:
+ *	1 on success, 0 if the sink can't be repositioned
+ */
+{
+   sink_t *sink = data;
+
+   if (!sink->seekable || offset > sink->size)
+      return 0;
+   sink->position = offset;
+
+   return 1;
+}
+
+static size_t
+read_memory (void *data, void *buffer, size_t size)
+/*
+ *  Read callback: copy at most 'size' bytes of the stream 'data' to
+ *  'buffer'.
+ *
+ *  Return value:
+ *	number of bytes copied
+ */
+{
+   source_t *source = data;
+
+   size = min (size, source->size);
+   memcpy (buffer, source->data, size);
+   source->data += size;
+   source->size -= size;
+
+   return size;
+}
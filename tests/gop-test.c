@@ -0,0 +1,224 @@
+/*
+ *  gop-test.c:		Compare threaded and serial coding of videos
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The groups of pictures of a video are encoded in parallel if more
+ *  than one thread is requested. The resulting streams have to be
+ *  identical to the stream of the serial coder, bit for bit. Color
+ *  videos are coded with every motion search strategy, too. The
+ *  search ranges 8 and 32 test the motion vector codes of ranges other
+ *  than 16 (32 requires file format release 3).
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define FRAMES	13			/* number of frames of test video */
+#define SIZE	64			/* width and height of frames */
+
+typedef struct video_test
+{
+   const char	     *pattern;		/* frame type pattern */
+   int		      index;		/* append frame index */
+   int		      half_pixel;	/* half pixel motion compensation */
+   fiasco_mv_search_e search;		/* motion search strategy */
+   unsigned	      search_range;	/* motion vector search range */
+   bool_t	      color;		/* color video */
+} video_test_t;
+
+static const video_test_t tests [] =
+{
+   {"ibbp",  0, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ibbp",  1, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ibbp",  1, 1, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ibbp",  0, 0, FIASCO_MV_SEARCH_DIAMOND,    16, NO},
+   {"ibbbp", 0, 0, FIASCO_MV_SEARCH_PYRAMID,    16, NO},
+   {"ibp",   1, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ipbp",  0, 1, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ippp",  1, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, NO},
+   {"ippp",  0, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 16, YES},
+   {"ippp",  0, 0, FIASCO_MV_SEARCH_DIAMOND,    16, YES},
+   {"ibbp",  1, 1, FIASCO_MV_SEARCH_PYRAMID,    16, YES},
+   {"ibbp",  0, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 8,  NO},
+   {"ibbp",  0, 1, FIASCO_MV_SEARCH_DIAMOND,    32, NO},
+   {"ippp",  1, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 32, YES},
+   {NULL,    0, 0, FIASCO_MV_SEARCH_EXHAUSTIVE, 0,  NO}
+};
+
+static const unsigned threads [] = {2, 3, 4, 0};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static bool_t
+encode (char **frames, const video_test_t *test, unsigned threads,
+	void **stream, size_t *size);
+static bool_t
+decode (const void *stream, size_t size);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   char		     *dir    = make_test_dir ("gop-test");
+   char		    **gray   = write_test_frames (dir, FRAMES, SIZE, SIZE, NO);
+   char		    **color  = write_test_frames (dir, FRAMES, SIZE, SIZE, YES);
+   const video_test_t *test;
+   int		      failed = 0;
+
+   for (test = tests; test->pattern; test++)
+   {
+      char	    **frames = test->color ? color : gray;
+      void	     *serial;
+      size_t	      serial_size;
+      const unsigned *t;
+
+      printf ("%-6s %-5s index=%d half-pixel=%d search=%d range=%u:",
+	      test->pattern, test->color ? "color" : "gray", test->index,
+	      test->half_pixel, test->search, test->search_range);
+      if (!encode (frames, test, 1, &serial, &serial_size))
+      {
+	 printf (" FAILED (serial coder)\n");
+	 failed++;
+	 continue;
+      }
+      for (t = threads; *t; t++)
+      {
+	 void  *stream;
+	 size_t size;
+
+	 if (!encode (frames, test, *t, &stream, &size))
+	 {
+	    printf (" FAILED (%u threads)", *t);
+	    failed++;
+	    continue;
+	 }
+	 if (size != serial_size || memcmp (stream, serial, size) != 0)
+	 {
+	    printf (" FAILED (%u threads: %lu bytes differ from %lu bytes)",
+		    *t, (unsigned long) size, (unsigned long) serial_size);
+	    failed++;
+	 }
+	 else if (!decode (stream, size))
+	 {
+	    printf (" FAILED (decoding of %u threads)", *t);
+	    failed++;
+	 }
+	 else
+	    printf (" %u", *t);
+	 free (stream);
+      }
+      printf (" (%lu bytes)\n", (unsigned long) serial_size);
+      free (serial);
+   }
+
+   remove_test_frames (gray);
+   remove_test_frames (color);
+   remove_test_dir (dir);
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static bool_t
+encode (char **frames, const video_test_t *test, unsigned threads,
+	void **stream, size_t *size)
+/*
+ *  Encode the video 'frames' with the options of 'test' using
+ *  'threads' threads.
+ *
+ *  Return value:
+ *	YES on success, NO otherwise
+ *
+ *  Side effects:
+ *	'stream' and 'size' are set to the new FIASCO stream
+ *	(must be freed by the caller)
+ */
+{
+   fiasco_c_options_t *options = fiasco_c_options_new ();
+   bool_t		success;
+
+   fiasco_c_options_set_frame_pattern (options, test->pattern);
+   fiasco_c_options_set_frame_index (options, test->index);
+   fiasco_c_options_set_video_param (options, 25, test->half_pixel, NO, NO);
+   fiasco_c_options_set_motion_search (options, test->search);
+   fiasco_c_options_set_search_range (options, test->search_range);
+   fiasco_c_options_set_basisfile (options, "small.fco");
+   fiasco_c_options_set_threads (options, threads);
+
+   success = fiasco_coder_to_memory ((char const * const *) frames,
+				     stream, size, 20, options);
+   if (!success)
+      fprintf (stderr, "%s\n", fiasco_get_error_message ());
+   fiasco_c_options_delete (options);
+
+   return success;
+}
+
+static bool_t
+decode (const void *stream, size_t size)
+/*
+ *  Decode all frames of the FIASCO video 'stream' of 'size' bytes.
+ *
+ *  Return value:
+ *	YES if all frames have been decoded, NO otherwise
+ */
+{
+   fiasco_decoder_t *decoder = fiasco_decoder_new_from_memory (stream, size,
+							       NULL);
+   unsigned	     n;
+
+   if (!decoder)
+      return NO;
+   if (fiasco_decoder_get_length (decoder) != FRAMES)
+   {
+      fiasco_decoder_delete (decoder);
+      return NO;
+   }
+   for (n = 0; n < FRAMES; n++)
+   {
+      fiasco_image_t *image = fiasco_decoder_get_frame (decoder);
+
+      if (!image)
+      {
+	 fiasco_decoder_delete (decoder);
+	 return NO;
+      }
+      fiasco_image_delete (image);
+   }
+   fiasco_decoder_delete (decoder);
+
+   return YES;
+}
@@ -0,0 +1,176 @@
+/*
+ *  mt-test.c:		Encode several images at once in one process
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  Each coder keeps its scratch tables in its own workspace, hence
+ *  several coders may run at the same time. Every thread encodes its
+ *  own image a couple of times, each stream has to be identical to
+ *  the stream of the same image encoded serially.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define IMAGES	8			/* number of concurrent coders */
+#define RUNS	3			/* number of encodings per thread */
+
+static const char *basis [] = {"small.fco", "medium.fco", "large.fco"};
+
+typedef struct job
+{
+   char	       *name [2];		/* image filename, NULL */
+   const char  *basis;			/* initial basis */
+   void	       *stream;			/* stream of serial coder */
+   size_t	size;			/* size of 'stream' */
+   unsigned	failed;			/* number of mismatches */
+} job_t;
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static bool_t
+encode (const job_t *job, void **stream, size_t *size);
+static void *
+encode_thread (void *data);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   char	    *dir    = make_test_dir ("mt-test");
+   char	   **frames = write_test_frames (dir, IMAGES, 128, 128, NO);
+   job_t     jobs [IMAGES];
+   pthread_t thread [IMAGES];
+   unsigned  n, failed = 0;
+
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+   for (n = 0; n < IMAGES; n++)
+   {
+      jobs [n].name [0] = frames [n];
+      jobs [n].name [1] = NULL;
+      jobs [n].basis	= basis [n % 3];
+      jobs [n].failed	= 0;
+      if (!encode (jobs + n, &jobs [n].stream, &jobs [n].size))
+      {
+	 printf ("image %u: FAILED (serial coder)\n", n);
+	 return 1;
+      }
+   }
+
+   for (n = 0; n < IMAGES; n++)
+      if (pthread_create (thread + n, NULL, encode_thread, jobs + n))
+      {
+	 perror ("pthread_create");
+	 return 1;
+      }
+   for (n = 0; n < IMAGES; n++)
+   {
+      pthread_join (thread [n], NULL);
+      printf ("image %u (%s, %lu bytes): %s\n", n, jobs [n].basis,
+	      (unsigned long) jobs [n].size, jobs [n].failed ? "FAILED" : "ok");
+      failed += jobs [n].failed;
+      free (jobs [n].stream);
+   }
+
+   remove_test_frames (frames);
+   remove_test_dir (dir);
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static bool_t
+encode (const job_t *job, void **stream, size_t *size)
+/*
+ *  Encode the image of 'job'.
+ *
+ *  Return value:
+ *	YES on success, NO otherwise
+ *
+ *  Side effects:
+ *	'stream' and 'size' are set to the new FIASCO stream
+ *	(must be freed by the caller)
+ */
+{
+   fiasco_c_options_t *options = fiasco_c_options_new ();
+   bool_t		success;
+
+   fiasco_c_options_set_basisfile (options, job->basis);
+   success = fiasco_coder_to_memory ((char const * const *) job->name,
+				     stream, size, 20, options);
+   if (!success)
+      fprintf (stderr, "%s: %s\n", job->name [0],
+	       fiasco_get_error_message ());
+   fiasco_c_options_delete (options);
+
+   return success;
+}
+
+static void *
+encode_thread (void *data)
+/*
+ *  Encode the image of job 'data' RUNS times and compare the streams
+ *  with the stream of the serial coder.
+ *
+ *  Return value:
+ *	NULL
+ *
+ *  Side effects:
+ *	'failed' of job 'data' is incremented for every mismatch
+ */
+{
+   job_t   *job = (job_t *) data;
+   unsigned run;
+
+   for (run = 0; run < RUNS; run++)
+   {
+      void  *stream;
+      size_t size;
+
+      if (!encode (job, &stream, &size))
+	 job->failed++;
+      else
+      {
+	 if (size != job->size || memcmp (stream, job->stream, size) != 0)
+	    job->failed++;
+	 free (stream);
+      }
+   }
+
+   return NULL;
+}
@@ -0,0 +1,155 @@
+/*
+ *  pnm-test.c:		Compare plain and 16 bit PNM images with raw images
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The images of the test directory store the same pixels in different
+ *  PNM formats: raw.pgm and raw.ppm use raw 8 bit samples, plain.pgm
+ *  (maximum value 15) and plain.ppm are plain (ASCII) images, wide.pgm
+ *  (maximum value 65535) and wide.ppm (maximum value 4095) use raw 16 bit
+ *  samples. Every image is loaded with read_image () and compared with
+ *  the raw 8 bit image: the samples are scaled to [0, 255] by the reader.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+#include "error.h"
+
+#include "fiasco.h"
+#include "image.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+typedef struct pnm_test
+{
+   const char *name;			/* image to test */
+   const char *reference;		/* raw 8 bit image */
+} pnm_test_t;
+
+static const pnm_test_t tests [] =
+{
+   {"plain.pgm", "raw.pgm"},
+   {"plain.ppm", "raw.ppm"},
+   {"wide.pgm",  "raw.pgm"},
+   {"wide.ppm",  "raw.ppm"},
+   {NULL,	 NULL}
+};
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static image_t *
+load (const char *srcdir, const char *name);
+static bool_t
+same_pixels (const image_t *image1, const image_t *image2);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   const char	    *srcdir = getenv ("srcdir") ? getenv ("srcdir") : ".";
+   const pnm_test_t *test;
+   int		     failed = 0;
+
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   for (test = tests; test->name; test++)
+   {
+      image_t *image	 = load (srcdir, test->name);
+      image_t *reference = load (srcdir, test->reference);
+
+      printf ("%-9s %-7s: ", test->name, test->reference);
+      if (!image || !reference)
+      {
+	 printf ("FAILED (%s)\n", fiasco_get_error_message ());
+	 failed++;
+      }
+      else if (!same_pixels (image, reference))
+      {
+	 printf ("FAILED (pixels differ)\n");
+	 failed++;
+      }
+      else
+	 printf ("ok\n");
+      if (image)
+	 free_image (image);
+      if (reference)
+	 free_image (reference);
+   }
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static image_t *
+load (const char *srcdir, const char *name)
+/*
+ *  Read the image 'name' of the directory 'srcdir'.
+ *
+ *  Return value:
+ *	pointer to the image or NULL on error
+ */
+{
+   char	   *filename = malloc (strlen (srcdir) + strlen (name) + 2);
+   image_t *image    = NULL;
+
+   sprintf (filename, "%s/%s", srcdir, name);
+   try
+   {
+      image = read_image (filename);
+   }
+   catch
+   {
+      image = NULL;
+   }
+   free (filename);
+
+   return image;
+}
+
+static bool_t
+same_pixels (const image_t *image1, const image_t *image2)
+/*
+ *  Return value:
+ *	YES if both images have the same size, color model and pixels
+ *	NO  otherwise
+ */
+{
+   unsigned band;
+
+   if (image1->width != image2->width || image1->height != image2->height
+       || image1->color != image2->color)
+      return NO;
+   for (band = 0; band < (image1->color ? 3U : 1U); band++)
+      if (memcmp (image1->pixels [band], image2->pixels [band],
+		  image1->width * image1->height * sizeof (word_t)))
+	 return NO;
+
+   return YES;
+}
@@ -0,0 +1,371 @@
+/*
+ *  seek-test.c:	Compare random access and sequential decoding
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  IBBP videos of the synthetic test sequence are encoded with and
+ *  without frame index. Every video is decoded sequentially, afterwards
+ *  the frames are requested in random order with fiasco_decoder_seek ():
+ *  each frame has to match the frame of the sequential decoder. The
+ *  decoder options cover parser threads, smoothing and the 4:2:0 format.
+ *  A decoder reading from a callback can't seek, fiasco_decoder_seek ()
+ *  has to fail without disturbing the sequential decoding.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "macros.h"
+
+#include "fiasco.h"
+#include "testutil.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+#define SIZE	64			/* width and height of frames */
+
+typedef struct video_test
+/*
+ *  Encoder options
+ */
+{
+   unsigned    frames;			/* number of frames */
+   int	       index;			/* append frame index */
+   bool_t      color;			/* color video */
+   const char *basis;			/* initial basis */
+} video_test_t;
+
+static const video_test_t tests [] =
+{
+   {10, 0, NO,  "small.fco"},
+   {10, 1, NO,  "small.fco"},
+   {20, 0, NO,  "small.fco"},
+   {20, 1, NO,  "small.fco"},
+   {10, 1, YES, "large.fco"},
+   {20, 0, YES, "large.fco"},
+   {0,  0, NO,  NULL}
+};
+
+typedef struct variant
+/*
+ *  Decoder options
+ */
+{
+   unsigned threads;			/* number of threads */
+   int	    smoothing;			/* smoothing (-1: value of stream) */
+   int	    format_4_2_0;		/* 4:2:0 chroma format */
+} variant_t;
+
+static const variant_t variants [] =
+{
+   {1, -1, NO}, {3, -1, NO}, {1, 0, NO}, {3, 50, NO}, {1, -1, YES},
+   {3, 0, YES}, {0, 0, NO}
+};
+
+typedef struct memory
+/*
+ *  Stream of read_memory ()
+ */
+{
+   const unsigned char *data;		/* bytes of the stream */
+   size_t		size;		/* bytes left */
+} memory_t;
+
+#define SEEKS	3			/* every frame is requested 3 times */
+
+/*****************************************************************************
+
+				prototypes
+
+*****************************************************************************/
+
+static bool_t
+encode (char **frames, const video_test_t *test, void **stream, size_t *size);
+static fiasco_decoder_t *
+open_decoder (const void *stream, size_t size, const variant_t *variant);
+static unsigned long
+frame_checksum (fiasco_decoder_t *decoder, bool_t color);
+static bool_t
+test_seek (const void *stream, size_t size, const video_test_t *test,
+	   const variant_t *variant);
+static bool_t
+test_callback (const void *stream, size_t size, const video_test_t *test);
+static size_t
+read_memory (void *data, void *buffer, size_t size);
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+int
+main (void)
+{
+   char		     *dir    = make_test_dir ("seek-test");
+   const video_test_t *test;
+   int		      failed = 0;
+
+   fiasco_set_verbosity (FIASCO_NO_VERBOSITY);
+
+   for (test = tests; test->frames; test++)
+   {
+      char	     **frames = write_test_frames (dir, test->frames, SIZE,
+						   SIZE, test->color);
+      const variant_t *variant;
+      void	      *stream;
+      size_t	       size;
+
+      printf ("ibbp %s frames=%u index=%d:", test->color ? "color" : "gray",
+	      test->frames, test->index);
+      if (!encode (frames, test, &stream, &size))
+      {
+	 printf (" FAILED (coder)\n");
+	 failed++;
+	 remove_test_frames (frames);
+	 continue;
+      }
+      for (variant = variants; variant->threads; variant++)
+	 if (test_seek (stream, size, test, variant))
+	    printf (" ok");
+	 else
+	 {
+	    printf (" FAILED (threads=%u smoothing=%d 4:2:0=%d)",
+		    variant->threads, variant->smoothing,
+		    variant->format_4_2_0);
+	    failed++;
+	 }
+      if (test_callback (stream, size, test))
+	 printf (" ok\n");
+      else
+      {
+	 printf (" FAILED (callback)\n");
+	 failed++;
+      }
+      free (stream);
+      remove_test_frames (frames);
+   }
+
+   remove_test_dir (dir);
+
+   return failed ? 1 : 0;
+}
+
+/*****************************************************************************
+
+				private code
+
+*****************************************************************************/
+
+static bool_t
+encode (char **frames, const video_test_t *test, void **stream, size_t *size)
+/*
+ *  Encode the video 'frames' with the options of 'test'.
+ *
+ *  Return value:
+ *	YES on success, NO otherwise
+ *
+ *  Side effects:
+ *	'stream' and 'size' are set to the new FIASCO stream
+ *	(must be freed by the caller)
+ */
+{
+   fiasco_c_options_t *options = fiasco_c_options_new ();
+   bool_t		success;
+
+   fiasco_c_options_set_frame_pattern (options, "ibbp");
+   fiasco_c_options_set_frame_index (options, test->index);
+   fiasco_c_options_set_basisfile (options, test->basis);
+
+   success = fiasco_coder_to_memory ((char const * const *) frames,
+				     stream, size, 20, options);
+   if (!success)
+      fprintf (stderr, "%s\n", fiasco_get_error_message ());
+   fiasco_c_options_delete (options);
+
+   return success;
+}
+
+static fiasco_decoder_t *
+open_decoder (const void *stream, size_t size, const variant_t *variant)
+/*
+ *  Open a decoder of the FIASCO 'stream' of 'size' bytes with the
+ *  options 'variant'.
+ *
+ *  Return value:
+ *	pointer to the new decoder or NULL on error
+ */
+{
+   fiasco_d_options_t *options = fiasco_d_options_new ();
+   fiasco_decoder_t   *decoder;
+
+   fiasco_d_options_set_threads (options, variant->threads);
+   if (variant->smoothing >= 0)
+      fiasco_d_options_set_smoothing (options, variant->smoothing);
+   fiasco_d_options_set_4_2_0_format (options, variant->format_4_2_0);
+
+   decoder = fiasco_decoder_new_from_memory (stream, size, options);
+   fiasco_d_options_delete (options);
+
+   return decoder;
+}
+
+static unsigned long
+frame_checksum (fiasco_decoder_t *decoder, bool_t color)
+/*
+ *  Decode the next frame of 'decoder'.
+ *
+ *  Return value:
+ *	checksum of the pixels of the frame (0 on error)
+ */
+{
+   unsigned	  stride = SIZE * (color ? 3 : 1);
+   unsigned char *buffer = malloc (stride * SIZE);
+   unsigned long  sum	 = 0;
+
+   if (fiasco_decoder_get_frame_into (decoder, buffer, stride,
+				      color ? FIASCO_RGB_24 : FIASCO_GRAY_8))
+      sum = checksum (buffer, stride * SIZE) | 1;
+   free (buffer);
+
+   return sum;
+}
+
+static bool_t
+test_seek (const void *stream, size_t size, const video_test_t *test,
+	   const variant_t *variant)
+/*
+ *  Decode the video 'stream' of 'size' bytes sequentially and compare
+ *  the frames with the frames decoded in random order. The decoders use
+ *  the options 'variant'.
+ *
+ *  Return value:
+ *	YES if both decoders produce the same frames, NO otherwise
+ */
+{
+   unsigned long    *sums    = calloc (test->frames, sizeof (unsigned long));
+   fiasco_decoder_t *decoder = open_decoder (stream, size, variant);
+   bool_t	     success = decoder ? YES : NO;
+   unsigned	     n;
+
+   for (n = 0; success && n < test->frames; n++)
+      if (!(sums [n] = frame_checksum (decoder, test->color)))
+	 success = NO;
+   if (decoder)
+      fiasco_decoder_delete (decoder);
+
+   decoder = success ? open_decoder (stream, size, variant) : NULL;
+   if (decoder)
+   {
+      unsigned long random = 4711;	/* seed of the frame sequence */
+
+      for (n = 0; success && n < SEEKS * test->frames; n++)
+      {
+	 unsigned frame;
+
+	 random = (random * 1103515245 + 12345) & 0x7fffffffUL;
+	 frame	= (random >> 8) % test->frames;
+	 if (!fiasco_decoder_seek (decoder, frame))
+	 {
+	    fprintf (stderr, "%s\n", fiasco_get_error_message ());
+	    success = NO;
+	 }
+	 else if (frame_checksum (decoder, test->color) != sums [frame])
+	 {
+	    fprintf (stderr, "Frame %u differs after seeking.\n", frame);
+	    success = NO;
+	 }
+      }
+      fiasco_decoder_delete (decoder);
+   }
+   else
+      success = NO;
+   free (sums);
+
+   return success;
+}
+
+static bool_t
+test_callback (const void *stream, size_t size, const video_test_t *test)
+/*
+ *  Decode the video 'stream' of 'size' bytes with a decoder reading from
+ *  a callback. A seek to the last frame has to fail with an error
+ *  message, the following frames have to match the frames of the
+ *  decoder reading from memory.
+ *
+ *  Return value:
+ *	YES on success, NO otherwise
+ */
+{
+   static const variant_t variant = {1, -1, NO};
+   fiasco_decoder_t	  *decoder = open_decoder (stream, size, &variant);
+   fiasco_decoder_t	  *callback;
+   memory_t		   memory;
+   bool_t		   success = YES;
+   unsigned		   n;
+
+   memory.data = stream;
+   memory.size = size;
+   callback    = fiasco_decoder_new_from_callback (read_memory, &memory, NULL);
+   if (!decoder || !callback)
+      success = NO;
+   for (n = 0; success && n < test->frames; n++)
+   {
+      if (n == 1)
+      {
+	 if (fiasco_decoder_seek (callback, test->frames - 1))
+	 {
+	    fprintf (stderr, "Seeking in a callback stream succeeded.\n");
+	    success = NO;
+	 }
+	 else if (!*fiasco_get_error_message ())
+	 {
+	    fprintf (stderr, "Failing seek didn't set an error message.\n");
+	    success = NO;
+	 }
+      }
+      if (success && frame_checksum (decoder, test->color)
+	  != frame_checksum (callback, test->color))
+      {
+	 fprintf (stderr, "Frame %u of the callback decoder differs.\n", n);
+	 success = NO;
+      }
+   }
+   if (decoder)
+      fiasco_decoder_delete (decoder);
+   if (callback)
+      fiasco_decoder_delete (callback);
+
+   return success;
+}
+
+static size_t
+read_memory (void *data, void *buffer, size_t size)
+/*
+ *  Read callback: copy at most 'size' bytes of the stream 'data' to
+ *  'buffer'.
+ *
+ *  Return value:
+ *	number of bytes copied
+ */
+{
+   memory_t *memory = data;
+
+   size = min (size, memory->size);
+   memcpy (buffer, memory->data, size);
+   memory->data += size;
+   memory->size -= size;
+
+   return size;
+}
@@ -0,0 +1,170 @@
+/*
+ *  streams.c:		FIASCO streams of the test programs
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+/*
+ *  The streams have been written by the coder of FIASCO 1.3 (before
+ *  the SIMD kernels have been added) from the first frames of the synthetic test sequence
+ *  of size 64 x 64 and quality 20. Each stream uses one of the initial
+ *  bases of the data directory.
+ */
+
+#include "config.h"
+
+#include "streams.h"
+
+/*****************************************************************************
+
+			     local variables
+
+*****************************************************************************/
+
+static const unsigned char gray_small [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x73, 0x6d, 0x61, 0x6c, 0x6c,
+   0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x0f,
+   0xff, 0xff, 0xe7, 0x01, 0x00, 0x80, 0x08, 0x05, 0x00, 0x48, 0xc6, 0xb4,
+   0x06, 0x80, 0x00, 0x00, 0x00, 0x2f, 0xf8, 0xf5, 0xd3, 0xb0, 0x6f, 0xff,
+   0xff, 0xf0, 0x33, 0x8e, 0x05, 0x44, 0xf8, 0x7e, 0xf0, 0xa0, 0x00, 0x09,
+   0xd0, 0x42, 0xf6, 0xf5, 0x9d, 0x47, 0xa2, 0x5e, 0xab, 0xba, 0x9e, 0xcb,
+   0xbf, 0xc0
+};
+
+static const unsigned char gray_medium [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x6d, 0x65, 0x64, 0x69, 0x75,
+   0x6d, 0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00,
+   0x0f, 0xff, 0xff, 0xe7, 0x01, 0x00, 0x80, 0x08, 0x05, 0x00, 0x48, 0xc6,
+   0xb4, 0x49, 0x00, 0x00, 0x00, 0x00, 0xdb, 0xcc, 0x33, 0xc2, 0x56, 0x6f,
+   0xe4, 0x7f, 0xf8, 0x20, 0x09, 0x14, 0x6a, 0x6e, 0xd2, 0xe0, 0xff, 0xc3,
+   0xfe, 0x87, 0x26, 0x4b, 0xf8, 0x98, 0x03, 0x53, 0xa0, 0x85, 0xed, 0x38,
+   0x9d, 0xc8, 0xd9, 0xee, 0x6e, 0x97, 0xc7, 0x23, 0xf0
+};
+
+static const unsigned char gray_large [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x6c, 0x61, 0x72, 0x67, 0x65,
+   0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x0f,
+   0xff, 0xff, 0xe7, 0x01, 0x00, 0x80, 0x08, 0x05, 0x00, 0x48, 0xc6, 0xb4,
+   0x74, 0x00, 0x00, 0x00, 0x00, 0xcc, 0x1f, 0x6f, 0x09, 0x58, 0x6f, 0xe5,
+   0xff, 0xf8, 0x20, 0x08, 0x14, 0x54, 0x77, 0x2e, 0xc0, 0xff, 0xc3, 0xfe,
+   0x87, 0x20, 0x3f, 0xf8, 0x18, 0xc9, 0xd0, 0x42, 0xf6, 0x9c, 0x4e, 0xe4,
+   0x6c, 0xf7, 0x38, 0x18, 0x59, 0x6f, 0xc0
+};
+
+static const unsigned char color_medium [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x6d, 0x65, 0x64, 0x69, 0x75,
+   0x6d, 0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00,
+   0x0f, 0xff, 0xff, 0xe7, 0x09, 0x00, 0x80, 0x28, 0x04, 0x02, 0x80, 0x24,
+   0x63, 0x5a, 0x00, 0x4b, 0x80, 0x00, 0x00, 0x00, 0xee, 0xf4, 0x75, 0xe1,
+   0x70, 0x95, 0x80, 0x6e, 0xf7, 0xff, 0xf8, 0x20, 0x0a, 0x08, 0xc5, 0x85,
+   0xc0, 0xff, 0xff, 0x44, 0x08, 0x16, 0x5b, 0x37, 0x1b, 0x62, 0xf5, 0x78,
+   0x50, 0x74, 0x68, 0x80, 0x08, 0xd0, 0xf4, 0x85, 0x4d, 0x4f, 0x94, 0x79,
+   0x64, 0x08, 0xe5, 0xcd, 0xdf, 0xff, 0x80
+};
+
+static const unsigned char color_large [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x6c, 0x61, 0x72, 0x67, 0x65,
+   0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x0f,
+   0xff, 0xff, 0xe7, 0x09, 0x00, 0x80, 0x28, 0x04, 0x02, 0x80, 0x24, 0x63,
+   0x5a, 0x00, 0x76, 0x80, 0x00, 0x00, 0x00, 0xe9, 0x26, 0x3c, 0x85, 0xc2,
+   0x56, 0x6e, 0xff, 0xff, 0xf0, 0x20, 0x09, 0x08, 0xa8, 0x3a, 0xf0, 0xff,
+   0xff, 0x44, 0x0f, 0x6c, 0x5c, 0xd0, 0x04, 0xfb, 0x73, 0xbc, 0x74, 0x68,
+   0x80, 0x08, 0xd0, 0xf4, 0x85, 0x4b, 0xb1, 0xf7, 0xe1, 0xcd, 0x02, 0xf5,
+   0xf8, 0x81, 0xbe
+};
+
+static const unsigned char video_small [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x73, 0x6d, 0x61, 0x6c, 0x6c,
+   0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x0f,
+   0xff, 0xff, 0xe7, 0x01, 0x00, 0x80, 0x08, 0x05, 0x02, 0x88, 0xc6, 0xb4,
+   0x0c, 0x84, 0x10, 0x06, 0x80, 0x00, 0x00, 0x00, 0x2f, 0xf8, 0xf5, 0xd3,
+   0xb0, 0x6f, 0xff, 0xff, 0xf0, 0x33, 0x8e, 0x05, 0x44, 0xf8, 0x7e, 0xf0,
+   0xa0, 0x00, 0x09, 0xd0, 0x42, 0xf6, 0xf5, 0x9d, 0x47, 0xa2, 0x5e, 0xab,
+   0xba, 0x9e, 0xcb, 0xbf, 0xc0, 0x0c, 0x00, 0x40, 0x60, 0x00, 0xf4, 0x6e,
+   0x33, 0xf8, 0x0b, 0x96, 0x96, 0x6e, 0x16, 0x05, 0x42, 0x63, 0xe1, 0xf9,
+   0x00, 0xfd, 0x92, 0x8e, 0x6f, 0x3d, 0x4b, 0x8f, 0x0c, 0x71, 0xdb, 0x69,
+   0x86, 0xe1, 0x70, 0xc4, 0xac, 0xc2, 0xdf, 0x29, 0x52, 0x8d, 0x53, 0x04,
+   0x8f, 0x24, 0x56, 0x45, 0xb7, 0x09, 0xd8, 0xc3, 0xa6, 0xb7, 0xc0, 0x03,
+   0x00, 0x80, 0x20, 0x00, 0x46, 0x22, 0xb0, 0x12, 0x08, 0x08, 0x0d, 0xd6,
+   0x97, 0xff, 0xe0, 0x1e, 0xb6, 0xbf, 0xf8, 0xc7, 0xff, 0xff, 0x06, 0x80,
+   0x80, 0x40, 0x00, 0x85, 0x8a, 0xcf, 0x9d, 0x80, 0x40, 0x07, 0x70, 0x19,
+   0x88, 0x84, 0x5f, 0x80, 0xce, 0x97, 0xff, 0xe0, 0x1c, 0xef, 0xaa, 0xf4,
+   0x66, 0xfd, 0xd5, 0x1a, 0x55, 0x8e, 0xf7, 0x3f, 0xc0, 0x0c, 0x80, 0x00,
+   0x80, 0x00, 0xf4, 0x72, 0x4f, 0xc1, 0x43, 0xcb, 0x05, 0x80, 0x79, 0xbf,
+   0x56, 0x5f, 0xff, 0x80, 0x31, 0xe2, 0x57, 0xa5, 0x19, 0x97, 0xba, 0x6e,
+   0xca, 0x40, 0x22, 0x92, 0x72, 0x18, 0x00, 0x55, 0x23, 0xf3, 0x89, 0x17,
+   0x81, 0xba, 0x3c, 0x66, 0xf8, 0xc9, 0x0d, 0x46, 0xed, 0xdb, 0x34, 0x27,
+   0x8f, 0x5c, 0xf8, 0x05, 0x80, 0x40, 0xe0, 0x00, 0xe4, 0x3c, 0xb6, 0x58,
+   0x72, 0x54, 0x05, 0x42, 0x7c, 0x3c, 0x15, 0x09, 0xf0, 0xca, 0xdf, 0xff,
+   0x80, 0x3c, 0xa4, 0x65, 0x43, 0x0e, 0x58, 0xc1, 0xe5, 0x22, 0x20, 0x8f,
+   0x73, 0x1e, 0x1f, 0x03, 0x80, 0x80, 0xa0, 0x00, 0x50, 0x3c, 0xac, 0x16,
+   0x0a, 0x08, 0x0d, 0x78, 0x40, 0x6f, 0xc0, 0xa7, 0xff, 0xf8, 0x1e, 0xd8,
+   0xe9, 0xde, 0xc7, 0x17, 0xa0, 0xf8, 0x04, 0x00, 0x80, 0xc0, 0x00, 0x52,
+   0xc3, 0x2b, 0x16, 0x29, 0x40, 0x11, 0x7e, 0x33, 0x11, 0x7e, 0x8d, 0x7f,
+   0xf0, 0x1f, 0xae, 0x67, 0xa6, 0xc5, 0xff, 0xff, 0x06, 0x00, 0x01, 0x00,
+   0x00, 0x14, 0x34, 0x8c, 0x92, 0xe0, 0x6b, 0xbf, 0xff, 0xe0, 0x33, 0x26,
+   0x6b, 0xd3, 0xcc, 0x36, 0xcd, 0xc0, 0x00, 0x4e, 0x4f, 0x52, 0x8a, 0xd5,
+   0xfe, 0xa6, 0xe8, 0x0a, 0x9a, 0xef, 0x91, 0xf0, 0x05, 0x00, 0x41, 0x20,
+   0x00, 0x5c, 0x63, 0xe4, 0xb0, 0x16, 0x00, 0xa8, 0xf1, 0x98, 0xe3, 0x31,
+   0x98, 0x29, 0xff, 0xff, 0x80, 0x1c, 0xc1, 0x7f, 0xff, 0xf0, 0xc4, 0x08,
+   0x1f, 0xb9, 0xff, 0x80
+};
+
+static const unsigned char video_color [] =
+{
+   0x46, 0x49, 0x41, 0x53, 0x43, 0x4f, 0x0a, 0x6c, 0x61, 0x72, 0x67, 0x65,
+   0x2e, 0x66, 0x63, 0x6f, 0x00, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x0f,
+   0xff, 0xff, 0xe7, 0x09, 0x00, 0x80, 0x28, 0x04, 0x02, 0x80, 0xe4, 0x63,
+   0x5a, 0x06, 0x42, 0x08, 0x76, 0x80, 0x00, 0x00, 0x00, 0xe9, 0x26, 0x3c,
+   0x85, 0xc2, 0x56, 0x6e, 0xff, 0xff, 0xf0, 0x20, 0x09, 0x08, 0xa8, 0x3a,
+   0xf0, 0xff, 0xff, 0x44, 0x0f, 0x6c, 0x5c, 0xd0, 0x04, 0xfb, 0x73, 0xbc,
+   0x74, 0x68, 0x80, 0x08, 0xd0, 0xf4, 0x85, 0x4b, 0xb1, 0xf7, 0xe1, 0xcd,
+   0x02, 0xf5, 0xf8, 0x81, 0xbe, 0x78, 0x80, 0x40, 0x20, 0x00, 0xeb, 0xf0,
+   0x62, 0xec, 0x9d, 0xe3, 0x56, 0x42, 0x00, 0x1c, 0x67, 0xfe, 0x05, 0xbb,
+   0xa0, 0x23, 0x02, 0x0e, 0xc5, 0x0b, 0x69, 0x1b, 0x80, 0xc3, 0x59, 0x0b,
+   0x01, 0xfc, 0x7a, 0xb2, 0x98, 0x00, 0x6d, 0x52, 0xc5, 0x67, 0xa9, 0xb5,
+   0x52, 0xd6, 0xa8, 0x3c, 0x76, 0x00, 0x40, 0x60, 0x00, 0xeb, 0xf6, 0x2f,
+   0x43, 0x78, 0x58, 0x57, 0x46, 0x09, 0x0f, 0x84, 0xc2, 0x43, 0xf8, 0x3b,
+   0x35, 0xff, 0xf8, 0x21, 0x06, 0x0b, 0xc9, 0x84, 0xa8, 0xc6, 0xc4, 0x11,
+   0x86, 0x0a, 0x60, 0xe2, 0x33, 0x52, 0x74, 0x10, 0x52, 0x41, 0x54, 0xf8,
+   0xd9, 0x04, 0xeb, 0x37, 0x5a, 0x58, 0xc6, 0xf8, 0x72, 0x00, 0x80, 0x40,
+   0x00, 0xeb, 0xd0, 0x2a, 0x58, 0x12, 0x00, 0x11, 0x4f, 0xc0, 0x97, 0xff,
+   0xe0, 0x10, 0xc1, 0xda, 0xff, 0xe0, 0xc9, 0xca, 0x2c, 0x90, 0x0e, 0xc2,
+   0xf3, 0xfe, 0x73, 0x00, 0x00, 0x80, 0x00, 0xee, 0xd4, 0x28, 0xa5, 0x80,
+   0x37, 0xff, 0xf8, 0x30, 0x01, 0x04, 0x2b, 0x3f, 0xff, 0xc0, 0xc2, 0x85,
+   0x24, 0x20, 0x0f, 0xf8, 0xbf, 0xd0, 0xa9, 0xf3, 0xe5, 0x7c, 0xd5, 0x65,
+   0xc0, 0x34, 0xe4, 0x01, 0x87, 0x09, 0xbc, 0xb1, 0x7a, 0xf0, 0xdb, 0xe6,
+   0x18, 0x46, 0x6f, 0x08, 0xf0, 0x72, 0x00, 0x40, 0xa0, 0x00, 0xeb, 0xd0,
+   0x2a, 0x58, 0x40, 0xfc, 0xaf, 0xff, 0xf0, 0x40, 0x80, 0x04, 0x00, 0x74,
+   0xff, 0xff, 0xc9, 0x01, 0x00, 0x48, 0xca, 0x6b, 0x42, 0x78, 0xf0, 0xff,
+   0x48, 0x9a, 0xce, 0xd8, 0x2a, 0xfe, 0x7e, 0xd1, 0xf8, 0x72, 0x80, 0x40,
+   0xc0, 0x00, 0xec, 0x0d, 0xc8, 0x96, 0x10, 0xfc, 0x37, 0xff, 0xf8, 0x50,
+   0xc0, 0x00, 0x00, 0x01, 0x86, 0xff, 0xc0, 0xc3, 0x03, 0x02, 0x15, 0x80,
+   0x1e, 0x23, 0xd5, 0x63, 0x80, 0x54, 0x87, 0x2a, 0xd8, 0x83, 0x29, 0x04,
+   0x8a, 0xf8
+};
+
+/*****************************************************************************
+
+			     global variables
+
+*****************************************************************************/
+
+const test_stream_t test_streams [] =
+{
+   {"gray image, small.fco",         gray_small,   sizeof (gray_small),   1},
+   {"gray image, medium.fco",        gray_medium,  sizeof (gray_medium),  1},
+   {"gray image, large.fco",         gray_large,   sizeof (gray_large),   1},
+   {"color image, medium.fco",       color_medium, sizeof (color_medium), 1},
+   {"color image, large.fco",        color_large,  sizeof (color_large),  1},
+   {"gray video (ibbp), small.fco",  video_small,  sizeof (video_small),  10},
+   {"color video (ipbp), large.fco", video_color,  sizeof (video_color),  7},
+   {NULL, NULL, 0, 0}
+};
@@ -0,0 +1,26 @@
+/*
+ *  streams.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _STREAMS_H
+#define _STREAMS_H
+
+#include <stddef.h>
+
+typedef struct test_stream
+/*
+ *  FIASCO stream of the test sequence (see write_test_frames ())
+ */
+{
+   const char		*name;		/* description of the stream */
+   const unsigned char *data;		/* bytes of the stream */
+   size_t		 size;		/* number of bytes */
+   unsigned		 frames;	/* number of frames */
+} test_stream_t;
+
+extern const test_stream_t test_streams [];
+
+#endif /* not _STREAMS_H */
@@ -0,0 +1,209 @@
+/*
+ *  testutil.c:		Test images and checksums of the test programs
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_UNISTD_H
+#	include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include "types.h"
+#include "macros.h"
+
+#include "testutil.h"
+
+/*****************************************************************************
+
+				public code
+
+*****************************************************************************/
+
+char *
+make_test_dir (const char *prefix)
+/*
+ *  Create a new temporary directory for the files of a test program.
+ *  The name of the directory starts with 'prefix', it is located in
+ *  the current working directory.
+ *
+ *  Return value:
+ *	absolute path of the new directory (must be freed by
+ *	remove_test_dir ())
+ */
+{
+   char  cwd [1024];
+   char *dir;
+
+   if (!getcwd (cwd, sizeof (cwd)))
+   {
+      perror ("getcwd");
+      exit (1);
+   }
+   dir = malloc (strlen (cwd) + strlen (prefix) + 9);
+   sprintf (dir, "%s/%s-XXXXXX", cwd, prefix);
+   if (!mkdtemp (dir))
+   {
+      perror (dir);
+      exit (1);
+   }
+
+   return dir;
+}
+
+void
+remove_test_dir (char *dir)
+/*
+ *  Remove the (empty) temporary directory 'dir'.
+ *
+ *  No return value.
+ */
+{
+   rmdir (dir);
+   free (dir);
+}
+
+unsigned char *
+test_frame_pixels (unsigned frame, unsigned width, unsigned height,
+		   bool_t color)
+/*
+ *  Render frame number 'frame' of the synthetic test sequence: a
+ *  diagonal ramp with a coarse checker texture and a bright box that
+ *  moves from frame to frame. Only integer arithmetic is used, hence
+ *  the pixels are identical on every platform.
+ *
+ *  Return value:
+ *	pointer to the new 8 bit gray (or packed RGB if 'color' is YES)
+ *	pixels of the frame
+ */
+{
+   unsigned	  bpp    = color ? 3 : 1;
+   unsigned char *pixels = malloc (width * height * bpp);
+   unsigned	  box_x  = (8 + 3 * frame) % (width > 20 ? width - 16 : 1);
+   unsigned	  box_y  = (4 + 2 * frame) % (height > 16 ? height - 12 : 1);
+   unsigned	  x, y;
+
+   for (y = 0; y < height; y++)
+      for (x = 0; x < width; x++)
+      {
+	 int  ramp  = 40 + (x + y) * 128 / (width + height);
+	 int  tex   = (((x >> 2) + (y >> 2)) & 1) * 16;
+	 bool_t box = x >= box_x && x < box_x + 16
+		      && y >= box_y && y < box_y + 12;
+	 int  v     = min (255, ramp + tex + (box ? 90 : 0));
+
+	 if (color)
+	 {
+	    unsigned char *p = pixels + (y * width + x) * 3;
+
+	    p [0] = v;
+	    p [1] = 40 + ramp / 2 + (box ? 60 : 0);
+	    p [2] = 220 - ramp;
+	 }
+	 else
+	    pixels [y * width + x] = v;
+      }
+
+   return pixels;
+}
+
+char **
+write_test_frames (const char *dir, unsigned frames, unsigned width,
+		   unsigned height, bool_t color)
+/*
+ *  Write the first 'frames' frames of the synthetic test sequence as
+ *  PGM (or PPM if 'color' is YES) files of size 'width' x 'height' to
+ *  the directory 'dir'.
+ *
+ *  Return value:
+ *	NULL terminated list of filenames (must be freed by
+ *	remove_test_frames ())
+ */
+{
+   char	  **names = calloc (frames + 1, sizeof (char *));
+   unsigned n;
+
+   for (n = 0; n < frames; n++)
+   {
+      unsigned char *pixels = test_frame_pixels (n, width, height, color);
+      FILE	    *file;
+
+      names [n] = malloc (strlen (dir) + 16);
+      sprintf (names [n], "%s/frame-%03u.p%cm", dir, n, color ? 'p' : 'g');
+      file = fopen (names [n], "wb");
+      if (!file)
+      {
+	 perror (names [n]);
+	 exit (1);
+      }
+      fprintf (file, "P%c\n%u %u\n255\n", color ? '6' : '5', width, height);
+      fwrite (pixels, color ? 3 : 1, width * height, file);
+      fclose (file);
+      free (pixels);
+   }
+
+   return names;
+}
+
+void
+remove_test_frames (char **names)
+/*
+ *  Remove the files 'names' written by write_test_frames ().
+ *
+ *  No return value.
+ */
+{
+   char **name;
+
+   for (name = names; *name; name++)
+   {
+      remove (*name);
+      free (*name);
+   }
+   free (names);
+}
+
+unsigned long
+checksum (const void *data, size_t size)
+/*
+ *  Compute the 32 bit FNV-1a hash of the 'size' bytes of 'data'.
+ *
+ *  Return value:
+ *	hash value
+ */
+{
+   const unsigned char *byte = data;
+   unsigned long	hash = 2166136261UL;
+
+   while (size--)
+      hash = ((hash ^ *byte++) * 16777619UL) & 0xffffffffUL;
+
+   return hash;
+}
+
+unsigned long
+file_checksum (const char *filename)
+/*
+ *  Compute the 32 bit FNV-1a hash of the contents of file 'filename'.
+ *
+ *  Return value:
+ *	hash value (0 if the file can't be read)
+ */
+{
+   FILE		*file = fopen (filename, "rb");
+   unsigned long hash = 2166136261UL;
+   int		 c;
+
+   if (!file)
+      return 0;
+   while ((c = getc (file)) != EOF)
+      hash = ((hash ^ c) * 16777619UL) & 0xffffffffUL;
+   fclose (file);
+
+   return hash;
+}
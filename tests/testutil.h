@@ -0,0 +1,31 @@
+/*
+ *  testutil.h
+ *
+ *  This file is part of FIASCO ([F]ractal [I]mage [A]nd [S]equence [CO]dec)
+ *  Copyright (C) 1994-2000 Ullrich Hafner <hafner@bigfoot.de>
+ */
+
+#ifndef _TESTUTIL_H
+#define _TESTUTIL_H
+
+#include <stddef.h>
+#include "types.h"
+
+char *
+make_test_dir (const char *prefix);
+void
+remove_test_dir (char *dir);
+char **
+write_test_frames (const char *dir, unsigned frames, unsigned width,
+		   unsigned height, bool_t color);
+void
+remove_test_frames (char **names);
+unsigned char *
+test_frame_pixels (unsigned frame, unsigned width, unsigned height,
+		   bool_t color);
+unsigned long
+checksum (const void *data, size_t size);
+unsigned long
+file_checksum (const char *filename);
+
+#endif /* not _TESTUTIL_H */